@@ -0,0 +1,65 @@
+/* Copyright (c) 2013-2024 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#ifndef AUDIO_RESAMPLER_H
+#define AUDIO_RESAMPLER_H
+
+#include <mgba-util/common.h>
+
+CXX_GUARD_START
+
+#define mAUDIO_RESAMPLER_MAX_CHANNELS 2
+#define mAUDIO_RESAMPLER_TAPS 32
+#define mAUDIO_RESAMPLER_PHASES 256
+#define mAUDIO_RESAMPLER_BUFFER 4096
+
+struct mAudioResampler {
+	unsigned channels;
+	double sourceRate;
+	double destRate;
+	double stretch;
+
+	// Polyphase filter, indexed by phase then tap
+	int16_t* filter;
+	uint64_t step;
+	uint64_t position;
+	size_t dropFrames;
+
+	int16_t* input[mAUDIO_RESAMPLER_MAX_CHANNELS];
+	size_t inputFrames;
+
+	// Output of the filter at the destination rate
+	int16_t* output[mAUDIO_RESAMPLER_MAX_CHANNELS];
+	size_t outputFrames;
+	size_t outputCapacity;
+
+	// Overlap-add time stretching, used when the stretch is too large to hide as a pitch change
+	bool stretching;
+	bool stretchPrimed;
+	size_t sequence;
+	size_t overlap;
+	size_t seek;
+	double skipResidue;
+	int16_t* tail[mAUDIO_RESAMPLER_MAX_CHANNELS];
+	int16_t* segment[mAUDIO_RESAMPLER_MAX_CHANNELS];
+	size_t segmentFrames;
+	size_t segmentRead;
+	float* mix;
+	float* tailMix;
+};
+
+void mAudioResamplerInit(struct mAudioResampler*, unsigned channels);
+void mAudioResamplerDeinit(struct mAudioResampler*);
+
+void mAudioResamplerSetRates(struct mAudioResampler*, double sourceRate, double destRate);
+void mAudioResamplerSetStretch(struct mAudioResampler*, double stretch);
+void mAudioResamplerClear(struct mAudioResampler*);
+
+size_t mAudioResamplerWrite(struct mAudioResampler*, const int16_t* samples, size_t frames);
+size_t mAudioResamplerRead(struct mAudioResampler*, int16_t* samples, size_t frames, unsigned channels);
+
+CXX_GUARD_END
+
+#endif
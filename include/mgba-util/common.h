@@ -106,6 +106,7 @@ typedef intptr_t ssize_t;
 #define ATOMIC_CMPXCHG(DST, EXPECTED, SRC) __atomic_compare_exchange_n(&DST, &EXPECTED, SRC, true,__ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)
 #define ATOMIC_STORE_PTR(DST, SRC) ATOMIC_STORE(DST, SRC)
 #define ATOMIC_LOAD_PTR(DST, SRC) ATOMIC_LOAD(DST, SRC)
+#define ATOMIC_CMPXCHG_PTR(DST, EXPECTED, SRC) ATOMIC_CMPXCHG(DST, EXPECTED, SRC)
 #elif defined _MSC_VER
 #define ATOMIC_STORE(DST, SRC) InterlockedExchange(&DST, SRC)
 #define ATOMIC_LOAD(DST, SRC) DST = InterlockedOrAcquire(&SRC, 0)
@@ -116,6 +117,7 @@ typedef intptr_t ssize_t;
 #define ATOMIC_CMPXCHG(DST, EXPECTED, SRC) (InterlockedCompareExchange(&DST, SRC, EXPECTED) == EXPECTED)
 #define ATOMIC_STORE_PTR(DST, SRC) InterlockedExchangePointer(&DST, SRC)
 #define ATOMIC_LOAD_PTR(DST, SRC) DST = InterlockedCompareExchangePointer(&SRC, 0, 0)
+#define ATOMIC_CMPXCHG_PTR(DST, EXPECTED, SRC) (InterlockedCompareExchangePointer(&DST, SRC, EXPECTED) == EXPECTED)
 #else
 // TODO
 #define ATOMIC_STORE(DST, SRC) ((DST) = (SRC))
@@ -127,6 +129,7 @@ typedef intptr_t ssize_t;
 #define ATOMIC_CMPXCHG(DST, EXPECTED, OP) (((DST) == (EXPECTED)) ? (((DST) = (OP)), true) : false)
 #define ATOMIC_STORE_PTR(DST, SRC) ATOMIC_STORE(DST, SRC)
 #define ATOMIC_LOAD_PTR(DST, SRC) ATOMIC_LOAD(DST, SRC)
+#define ATOMIC_CMPXCHG_PTR(DST, EXPECTED, SRC) ATOMIC_CMPXCHG(DST, EXPECTED, SRC)
 #endif
 
 #if defined(__3DS__) || defined(GEKKO) || defined(PSP2)
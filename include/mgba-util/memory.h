@@ -10,8 +10,21 @@
 
 CXX_GUARD_START
 
+enum mHugePageMode {
+	mHUGE_PAGES_NONE = 0,
+	mHUGE_PAGES_TRANSPARENT,
+	mHUGE_PAGES_EXPLICIT,
+};
+
 void* anonymousMemoryMap(size_t size);
 void mappedMemoryFree(void* memory, size_t size);
+void* mappedMemoryResize(void* memory, size_t oldSize, size_t newSize);
+void mappedMemoryClear(void* memory, size_t size);
+size_t mappedMemoryResident(const void* memory, size_t size);
+
+void mappedMemorySetHugePages(enum mHugePageMode mode);
+enum mHugePageMode mappedMemoryGetHugePages(void);
+bool mappedMemoryBindLocal(void* memory, size_t size);
 
 CXX_GUARD_END
 
@@ -104,6 +104,21 @@ static inline int ThreadSetName(const char* name) {
 #endif
 }
 
+static inline int ThreadSetAffinity(int cpu) {
+#if defined(__linux__) && defined(HAVE_PTHREAD_SETAFFINITY_NP)
+	if (cpu < 0 || cpu >= CPU_SETSIZE) {
+		return -1;
+	}
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	CPU_SET(cpu, &set);
+	return pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#else
+	UNUSED(cpu);
+	return -1;
+#endif
+}
+
 #if (__STDC_VERSION__ < 201112L) || (__STDC_NO_THREADS__ == 1)
 typedef pthread_key_t ThreadLocal;
 
@@ -145,6 +145,11 @@ static inline int ThreadSetName(const char* name) {
 	return -1;
 }
 
+static inline int ThreadSetAffinity(int cpu) {
+	UNUSED(cpu);
+	return -1;
+}
+
 #if (__STDC_VERSION__ < 201112L) || (__STDC_NO_THREADS__ == 1)
 typedef int ThreadLocal;
 
@@ -85,4 +85,9 @@ static inline void ThreadSetName(const char* name) {
 	// Unimplemented
 }
 
+static inline int ThreadSetAffinity(int cpu) {
+	UNUSED(cpu);
+	return -1;
+}
+
 #endif
@@ -87,6 +87,16 @@ static inline int ThreadSetName(const char* name) {
 	return -1;
 }
 
+static inline int ThreadSetAffinity(int cpu) {
+	if (cpu < 0 || cpu >= (int) sizeof(DWORD_PTR) * 8) {
+		return -1;
+	}
+	if (!SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR) 1 << cpu)) {
+		return GetLastError();
+	}
+	return 0;
+}
+
 #if (__STDC_VERSION__ < 201112L) || (__STDC_NO_THREADS__ == 1)
 typedef DWORD ThreadLocal;
 
@@ -21,6 +21,12 @@ struct TextCodecIterator {
 	struct TextCodecNode* current;
 };
 
+struct TextCodecMatch {
+	size_t consumed;
+	const uint8_t* output;
+	size_t outputLength;
+};
+
 struct VFile;
 bool TextCodecLoadTBL(struct TextCodec*, struct VFile*, bool createReverse);
 void TextCodecDeinit(struct TextCodec*);
@@ -31,6 +37,8 @@ void TextCodecStartEncode(struct TextCodec*, struct TextCodecIterator*);
 ssize_t TextCodecAdvance(struct TextCodecIterator*, uint8_t byte, uint8_t* output, size_t outputLength);
 ssize_t TextCodecFinish(struct TextCodecIterator*, uint8_t* output, size_t outputLength);
 
+size_t TextCodecMatchPrefixes(const struct TextCodec*, bool reverse, const uint8_t* input, size_t inputLength, struct TextCodecMatch* matches, size_t maxMatches);
+
 CXX_GUARD_END
 
 #endif
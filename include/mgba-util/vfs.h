@@ -72,6 +72,7 @@ struct VFile* VFileFromFD(int fd);
 struct VFile* VFileFromMemory(void* mem, size_t size);
 struct VFile* VFileFromConstMemory(const void* mem, size_t size);
 struct VFile* VFileMemChunk(const void* mem, size_t size);
+void VFileMemChunkPoolFlush(void);
 
 struct CircleBuffer;
 struct VFile* VFileFIFO(struct CircleBuffer* backing);
@@ -5,6 +5,8 @@ Sample buffer that resamples from input clock rate to output sample rate */
 #ifndef BLIP_BUF_H 
 #define BLIP_BUF_H
 
+#include <stddef.h>
+
 #ifdef __cplusplus
 	extern "C" {
 #endif
@@ -61,6 +63,9 @@ int blip_read_samples( blip_t*, short out [], int count, int stereo );
 /** Frees buffer. No effect if NULL is passed. */
 void blip_delete( blip_t* );
 
+/** Number of bytes allocated for buffer, including its sample storage. */
+size_t blip_footprint( const blip_t* );
+
 
 /* Deprecated */
 typedef blip_t blip_buffer_t;
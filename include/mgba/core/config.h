@@ -31,6 +31,7 @@ struct mCoreOptions {
 	bool useBios;
 	int logLevel;
 	int frameskip;
+	int autoFrameskip;
 	bool rewindEnable;
 	int rewindBufferCapacity;
 	int rewindBufferInterval;
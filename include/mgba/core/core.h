@@ -32,9 +32,28 @@ enum mCoreChecksumType {
 	mCHECKSUM_CRC32,
 };
 
+enum mCoreMemoryUsageType {
+	mCORE_MEMORY_USAGE_SYSTEM,
+	mCORE_MEMORY_USAGE_RAM,
+	mCORE_MEMORY_USAGE_ROM,
+	mCORE_MEMORY_USAGE_SAVEDATA,
+	mCORE_MEMORY_USAGE_VIDEO,
+	mCORE_MEMORY_USAGE_AUDIO,
+	mCORE_MEMORY_USAGE_MAX
+};
+
+struct mCoreMemoryUsage {
+	size_t allocated[mCORE_MEMORY_USAGE_MAX];
+	size_t resident[mCORE_MEMORY_USAGE_MAX];
+	// Read-only file mappings, such as a pristine ROM, whose pages are shared between instances
+	size_t shared[mCORE_MEMORY_USAGE_MAX];
+};
+
+struct mCodeAnalysisPlatform;
 struct mCoreConfig;
 struct mCoreSync;
 struct mDebuggerSymbols;
+struct mRunPredicate;
 struct mStateExtdata;
 struct mVideoLogContext;
 struct mCore {
@@ -103,6 +122,12 @@ struct mCore {
 	void (*runFrame)(struct mCore*);
 	void (*runLoop)(struct mCore*);
 	void (*step)(struct mCore*);
+	// Both run to the first instruction boundary at or after the limit, in
+	// units of frequency(), and report how many cycles actually ran. runUntil
+	// stops early when a predicate is met, returning its index, or -1 if the
+	// limit was hit first; a maxCycles of 0 means no limit.
+	uint64_t (*runCycles)(struct mCore*, uint64_t cycles);
+	ssize_t (*runUntil)(struct mCore*, const struct mRunPredicate* predicates, size_t nPredicates, uint64_t maxCycles, uint64_t* cyclesRun);
 
 	size_t (*stateSize)(struct mCore*);
 	bool (*loadState)(struct mCore*, const void* state);
@@ -141,6 +166,7 @@ struct mCore {
 
 	size_t (*listMemoryBlocks)(const struct mCore*, const struct mCoreMemoryBlock**);
 	void* (*getMemoryBlock)(struct mCore*, size_t id, size_t* sizeOut);
+	void (*memoryUsage)(struct mCore*, struct mCoreMemoryUsage*);
 
 	size_t (*listRegisters)(const struct mCore*, const struct mCoreRegisterInfo**);
 	bool (*readRegister)(const struct mCore*, const char* name, void* out);
@@ -155,6 +181,7 @@ struct mCore {
 
 	void (*loadSymbols)(struct mCore*, struct VFile*);
 	bool (*lookupIdentifier)(struct mCore*, const char* name, int32_t* value, int* segment);
+	const struct mCodeAnalysisPlatform* (*codeAnalysisPlatform)(struct mCore*);
 #endif
 
 	struct mCheatDevice* (*cheatDevice)(struct mCore*);
@@ -167,6 +194,8 @@ struct mCore {
 	void (*enableVideoLayer)(struct mCore*, size_t id, bool enable);
 	void (*enableAudioChannel)(struct mCore*, size_t id, bool enable);
 	void (*adjustVideoLayer)(struct mCore*, size_t id, int32_t x, int32_t y);
+	// Optional; pass NULL to stop. Buffers must stay valid until then.
+	void (*setVideoLayerOutput)(struct mCore*, const struct mVideoLayerOutput*);
 
 #ifndef MINIMAL_CORE
 	void (*startVideoLog)(struct mCore*, struct mVideoLogContext*);
@@ -197,6 +226,8 @@ void mCoreDeleteState(struct mCore* core, int slot);
 
 void mCoreTakeScreenshot(struct mCore* core);
 bool mCoreTakeScreenshotVF(struct mCore* core, struct VFile* vf);
+struct mVideoFilter;
+bool mCoreTakeScreenshotFilteredVF(struct mCore* core, struct VFile* vf, struct mVideoFilter* filter);
 #endif
 
 struct mCore* mCoreFindVF(struct VFile* vf);
@@ -215,6 +246,10 @@ void mCoreSetRTC(struct mCore* core, struct mRTCSource* rtc);
 void* mCoreGetMemoryBlock(struct mCore* core, uint32_t start, size_t* size);
 void* mCoreGetMemoryBlockMasked(struct mCore* core, uint32_t start, size_t* size, uint32_t mask);
 const struct mCoreMemoryBlock* mCoreGetMemoryBlockInfo(struct mCore* core, uint32_t address);
+size_t mCoreBindMemoryLocal(struct mCore* core);
+
+void mCoreMemoryUsageAdd(struct mCoreMemoryUsage* usage, enum mCoreMemoryUsageType type, const void* memory, size_t size, bool shared);
+const char* mCoreMemoryUsageName(enum mCoreMemoryUsageType type);
 
 #ifdef USE_ELF
 struct ELF;
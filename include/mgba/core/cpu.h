@@ -26,6 +26,113 @@ struct mCPUComponent {
 	void (*deinit)(struct mCPUComponent* component);
 };
 
+#define mBREAKPOINT_PAGE_SHIFT 8
+#define mBREAKPOINT_PAGE_COUNT 0x4000
+
+// Coarse map of which code pages contain breakpoints. Addresses alias modulo
+// the size of the map, so a set bit only means the page might contain one;
+// the CPU calls check for each instruction it lands on in a flagged page.
+struct mBreakpointPages {
+	uint32_t flags[mBREAKPOINT_PAGE_COUNT / 32];
+	void (*check)(struct mBreakpointPages*);
+	void* context;
+};
+
+static inline void mBreakpointPagesClear(struct mBreakpointPages* pages) {
+	memset(pages->flags, 0, sizeof(pages->flags));
+}
+
+static inline void mBreakpointPagesMark(struct mBreakpointPages* pages, uint32_t address) {
+	uint32_t page = (address >> mBREAKPOINT_PAGE_SHIFT) & (mBREAKPOINT_PAGE_COUNT - 1);
+	pages->flags[page >> 5] |= 1U << (page & 31);
+}
+
+static inline bool mBreakpointPagesTest(const struct mBreakpointPages* pages, uint32_t address) {
+	uint32_t page = (address >> mBREAKPOINT_PAGE_SHIFT) & (mBREAKPOINT_PAGE_COUNT - 1);
+	return pages->flags[page >> 5] & (1U << (page & 31));
+}
+
+#define mWATCHPOINT_PAGE_SHIFT 8
+#define mWATCHPOINT_PAGE_COUNT 0x4000
+
+// Coarse maps of which data pages contain read and write watchpoints. The top
+// bits of the address are folded in so that regions mapped 4MB apart don't
+// share pages. Memory accesses that land on a flagged page call read or write,
+// which does the exact matching; everything else pays for a single bit test.
+struct mWatchpointPages {
+	uint32_t readFlags[mWATCHPOINT_PAGE_COUNT / 32];
+	uint32_t writeFlags[mWATCHPOINT_PAGE_COUNT / 32];
+	void (*read)(struct mWatchpointPages*, uint32_t address, int width);
+	void (*write)(struct mWatchpointPages*, uint32_t address, uint32_t value, int width);
+	void* context;
+};
+
+static inline uint32_t mWatchpointPageIndex(uint32_t address) {
+	return ((address >> mWATCHPOINT_PAGE_SHIFT) ^ (address >> 22)) & (mWATCHPOINT_PAGE_COUNT - 1);
+}
+
+static inline void mWatchpointPagesClear(struct mWatchpointPages* pages) {
+	memset(pages->readFlags, 0, sizeof(pages->readFlags));
+	memset(pages->writeFlags, 0, sizeof(pages->writeFlags));
+}
+
+// Flags every page overlapping [minAddress, maxAddress)
+static inline void mWatchpointPagesMark(struct mWatchpointPages* pages, uint32_t minAddress, uint32_t maxAddress, bool read, bool write) {
+	if (maxAddress <= minAddress) {
+		return;
+	}
+	uint32_t first = minAddress >> mWATCHPOINT_PAGE_SHIFT;
+	uint32_t last = (maxAddress - 1) >> mWATCHPOINT_PAGE_SHIFT;
+	if (last - first >= mWATCHPOINT_PAGE_COUNT) {
+		if (read) {
+			memset(pages->readFlags, 0xFF, sizeof(pages->readFlags));
+		}
+		if (write) {
+			memset(pages->writeFlags, 0xFF, sizeof(pages->writeFlags));
+		}
+		return;
+	}
+	uint32_t page = first;
+	do {
+		uint32_t index = mWatchpointPageIndex(page << mWATCHPOINT_PAGE_SHIFT);
+		if (read) {
+			pages->readFlags[index >> 5] |= 1U << (index & 31);
+		}
+		if (write) {
+			pages->writeFlags[index >> 5] |= 1U << (index & 31);
+		}
+	} while (page++ != last);
+}
+
+static inline void mWatchpointPagesCheckRead(struct mWatchpointPages* pages, uint32_t address, int width) {
+	if (UNLIKELY(pages != NULL)) {
+		uint32_t index = mWatchpointPageIndex(address);
+		if (pages->readFlags[index >> 5] & (1U << (index & 31))) {
+			pages->read(pages, address, width);
+		}
+	}
+}
+
+static inline void mWatchpointPagesCheckWrite(struct mWatchpointPages* pages, uint32_t address, uint32_t value, int width) {
+	if (UNLIKELY(pages != NULL)) {
+		uint32_t index = mWatchpointPageIndex(address);
+		if (pages->writeFlags[index >> 5] & (1U << (index & 31))) {
+			pages->write(pages, address, value, width);
+		}
+	}
+}
+
+// Called by the CPU before each instruction it executes while installed. mode
+// is CPU-specific state worth recording alongside the instruction, e.g. the
+// CPSR on ARM, and regs is the register file as seen before the instruction,
+// with the program counter last. write is optional, and is called before every
+// data write the CPU makes.
+struct mInstructionHook {
+	void (*instruction)(struct mInstructionHook*, uint32_t pc, uint32_t opcode, uint32_t mode, const uint32_t* regs, size_t nRegs);
+	void (*write)(struct mInstructionHook*, uint32_t address, uint32_t value, int width);
+	void* context;
+};
+
 CXX_GUARD_END
 
 #endif
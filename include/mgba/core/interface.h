@@ -22,6 +22,22 @@ enum mCoreFeature {
 	mCORE_FEATURE_OPENGL = 1,
 };
 
+// Selected with the "accuracy" config key when a core loads its config.
+// What each tier models is fixed once released, so that results from a
+// given tier stay reproducible across versions; new trade-offs get new tiers.
+enum mCoreAccuracy {
+	// Everything the core knows how to model
+	mCORE_ACCURACY_ACCURATE = 0,
+	// GBA: The prefetch buffer is treated as always full and VRAM contention is ignored
+	// GB: OAM DMA does not cause bus conflicts
+	mCORE_ACCURACY_RELAXED = 1,
+	// As relaxed, and GBA cartridge accesses never pay the nonsequential penalty
+	mCORE_ACCURACY_FAST = 2,
+};
+
+bool mCoreAccuracyParse(const char* name, enum mCoreAccuracy* accuracy);
+const char* mCoreAccuracyName(enum mCoreAccuracy accuracy);
+
 struct mCoreCallbacks {
 	void* context;
 	void (*videoFrameStarted)(void* context);
@@ -40,6 +56,8 @@ struct mAVStream {
 	void (*videoDimensionsChanged)(struct mAVStream*, unsigned width, unsigned height);
 	void (*audioRateChanged)(struct mAVStream*, unsigned rate);
 	void (*postVideoFrame)(struct mAVStream*, const color_t* buffer, size_t stride);
+	// Optional; called instead of postVideoFrame when the frame is unchanged
+	void (*postVideoFrameRepeat)(struct mAVStream*, const color_t* buffer, size_t stride);
 	void (*postAudioFrame)(struct mAVStream*, int16_t left, int16_t right);
 	void (*postAudioBuffer)(struct mAVStream*, struct blip_t* left, struct blip_t* right);
 };
@@ -120,6 +138,29 @@ struct mCoreChannelInfo {
 	const char* visibleType;
 };
 
+#define mVIDEO_LAYER_OUTPUT_MAX 8
+#define mPROVENANCE_LAYER_BACKDROP 0xF
+#define mPROVENANCE_PALETTE_NONE 0x3FF
+#define mPROVENANCE_OBJECT_NONE 0xFF
+
+// Where a final pixel came from: the layer ID from listVideoLayers, the palette
+// entry (backgrounds first, then objects), the OAM index for objects, and
+// whether the color was changed afterwards, e.g. by blending. The object field
+// is wider than any OAM index so that mPROVENANCE_OBJECT_NONE can't collide.
+DECL_BITFIELD(mPixelProvenance, uint32_t);
+DECL_BITS(mPixelProvenance, Layer, 0, 4);
+DECL_BITS(mPixelProvenance, Palette, 4, 10);
+DECL_BITS(mPixelProvenance, Object, 14, 8);
+DECL_BIT(mPixelProvenance, Blended, 22);
+
+struct mVideoLayerOutput {
+	// Indexed by the IDs from listVideoLayers; ABGR8, with 0 wherever the layer is transparent.
+	// Any of these may be NULL, as may provenance.
+	uint32_t* layers[mVIDEO_LAYER_OUTPUT_MAX];
+	mPixelProvenance* provenance;
+	size_t stride;
+};
+
 enum mCoreMemoryBlockFlags {
 	mCORE_MEMORY_READ = 0x01,
 	mCORE_MEMORY_WRITE = 0x02,
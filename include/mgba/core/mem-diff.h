@@ -0,0 +1,52 @@
+/* Copyright (c) 2013-2024 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#ifndef CORE_MEM_DIFF_H
+#define CORE_MEM_DIFF_H
+
+#include <mgba-util/common.h>
+
+CXX_GUARD_START
+
+#include <mgba/core/interface.h>
+#include <mgba-util/vector.h>
+
+struct mCoreMemoryChange {
+	size_t blockId;
+	uint32_t offset;
+	uint32_t address;
+	int segment;
+	uint32_t length;
+};
+
+struct mCoreMemoryDiffRegion {
+	struct mCoreMemoryBlock block;
+	uint8_t* snapshot;
+	size_t size;
+};
+
+DECLARE_VECTOR(mCoreMemoryChanges, struct mCoreMemoryChange);
+DECLARE_VECTOR(mCoreMemoryDiffRegions, struct mCoreMemoryDiffRegion);
+
+struct mCore;
+struct mCoreMemoryDiff {
+	struct mCore* core;
+	struct mCoreMemoryDiffRegions regions;
+	struct mCoreMemoryChanges changes;
+};
+
+void mCoreMemoryDiffInit(struct mCoreMemoryDiff*, struct mCore* core);
+void mCoreMemoryDiffDeinit(struct mCoreMemoryDiff*);
+
+bool mCoreMemoryDiffAddBlock(struct mCoreMemoryDiff*, size_t blockId);
+size_t mCoreMemoryDiffAddBlocks(struct mCoreMemoryDiff*, int memoryFlags);
+void mCoreMemoryDiffClear(struct mCoreMemoryDiff*);
+
+void mCoreMemoryDiffSnapshot(struct mCoreMemoryDiff*);
+size_t mCoreMemoryDiffUpdate(struct mCoreMemoryDiff*);
+
+CXX_GUARD_END
+
+#endif
@@ -16,6 +16,7 @@ enum mCoreMemorySearchType {
 	mCORE_MEMORY_SEARCH_INT,
 	mCORE_MEMORY_SEARCH_STRING,
 	mCORE_MEMORY_SEARCH_GUESS,
+	mCORE_MEMORY_SEARCH_TEXT,
 };
 
 enum mCoreMemorySearchOp {
@@ -29,6 +30,28 @@ enum mCoreMemorySearchOp {
 	mCORE_MEMORY_SEARCH_DELTA_ANY,
 };
 
+#define mCORE_TEXT_SEARCH_MAX_ENCODINGS 64
+#define mCORE_TEXT_SEARCH_MAX_LENGTH 256
+
+struct mCoreTextSearchPattern {
+	uint32_t string;
+	uint32_t length;
+	int32_t next;
+};
+
+DECLARE_VECTOR(mCoreTextSearchPatterns, struct mCoreTextSearchPattern);
+
+// Every table encoding of every string, compiled into one byte-level automaton
+struct mCoreTextSearch {
+	uint8_t classes[256];
+	size_t nClasses;
+	size_t nStates;
+	struct UInt32List transitions;
+	struct SInt32List outputs;
+	struct SInt32List suffixes;
+	struct mCoreTextSearchPatterns patterns;
+};
+
 struct mCoreMemorySearchParams {
 	int memoryFlags;
 	enum mCoreMemorySearchType type;
@@ -38,6 +61,7 @@ struct mCoreMemorySearchParams {
 	union {
 		const char* valueStr;
 		int32_t valueInt;
+		const struct mCoreTextSearch* text;
 	};
 };
 
@@ -54,6 +78,12 @@ struct mCoreMemorySearchResult {
 DECLARE_VECTOR(mCoreMemorySearchResults, struct mCoreMemorySearchResult);
 
 struct mCore;
+struct TextCodec;
+// Strings are in the table's text encoding; fails if one has no encoding at all
+bool mCoreTextSearchInit(struct mCoreTextSearch*, const struct TextCodec*, const char* const* strings, size_t nStrings);
+void mCoreTextSearchDeinit(struct mCoreTextSearch*);
+
+// Text results store the index of the string that matched in oldValue
 void mCoreMemorySearch(struct mCore* core, const struct mCoreMemorySearchParams* params, struct mCoreMemorySearchResults* out, size_t limit);
 void mCoreMemorySearchRepeat(struct mCore* core, const struct mCoreMemorySearchParams* params, struct mCoreMemorySearchResults* inout);
 
@@ -0,0 +1,74 @@
+/* Copyright (c) 2013-2024 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#ifndef M_RUN_UNTIL_H
+#define M_RUN_UNTIL_H
+
+#include <mgba-util/common.h>
+
+CXX_GUARD_START
+
+#include <mgba/core/cpu.h>
+#include <mgba/core/timing.h>
+
+enum mRunPredicateType {
+	// Stops before the instruction at address executes
+	mRUN_UNTIL_PC,
+	// Stops after a store through the memory bus changes the byte at address
+	mRUN_UNTIL_MEMORY_CHANGE,
+	// Stops when the hardware requests an interrupt whose bit is in irqMask, or any if irqMask is 0
+	mRUN_UNTIL_IRQ,
+};
+
+struct mRunPredicate {
+	enum mRunPredicateType type;
+	uint32_t address;
+	uint32_t irqMask;
+};
+
+struct mCore;
+struct mRunUntil {
+	struct mCore* core;
+	const struct mRunPredicate* predicates;
+	size_t nPredicates;
+	uint8_t* values;
+	bool hasPC;
+	bool hasMemory;
+	bool hasIRQ;
+
+	struct mBreakpointPages pcPages;
+	struct mWatchpointPages memoryPages;
+	struct mBreakpointPages** cpuPCPages;
+	struct mWatchpointPages** cpuMemoryPages;
+	struct mBreakpointPages* chainedPCPages;
+	struct mWatchpointPages* chainedMemoryPages;
+
+	struct mTimingEvent limitEvent;
+	uint64_t cycles;
+	uint64_t remaining;
+	uint32_t cyclesLate;
+
+	bool stopped;
+	ssize_t fired;
+
+	// Provided by the core: where the CPU is about to execute, and how to leave the run loop promptly
+	uint32_t (*pc)(struct mRunUntil*);
+	void (*stop)(struct mRunUntil*);
+};
+
+void mRunUntilInit(struct mRunUntil*, struct mCore* core, const struct mRunPredicate* predicates, size_t nPredicates, uint64_t maxCycles);
+void mRunUntilDeinit(struct mRunUntil*);
+
+void mRunUntilInstall(struct mRunUntil*, struct mBreakpointPages** pcPages, struct mWatchpointPages** memoryPages);
+void mRunUntilUninstall(struct mRunUntil*);
+
+bool mRunUntilShouldStop(struct mRunUntil*);
+uint64_t mRunUntilElapsed(const struct mRunUntil*);
+
+void mRunUntilIRQ(struct mRunUntil*, int irq);
+
+CXX_GUARD_END
+
+#endif
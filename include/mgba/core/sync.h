@@ -24,6 +24,13 @@ struct mCoreSync {
 	Mutex audioBufferMutex;
 
 	float fpsTarget;
+
+	// Adaptive frameskip, raised when frames are posted late and lowered once caught up
+	int frameskipMax;
+	int frameskip;
+	int64_t frameDeadline;
+	unsigned framesOnTime;
+	unsigned framesSinceAdjust;
 };
 
 void mCoreSyncPostFrame(struct mCoreSync* sync);
@@ -31,6 +38,8 @@ void mCoreSyncForceFrame(struct mCoreSync* sync);
 bool mCoreSyncWaitFrameStart(struct mCoreSync* sync);
 void mCoreSyncWaitFrameEnd(struct mCoreSync* sync);
 void mCoreSyncSetVideoSync(struct mCoreSync* sync, bool wait);
+void mCoreSyncSetAdaptiveFrameskip(struct mCoreSync* sync, int max);
+int mCoreSyncFrameskip(const struct mCoreSync* sync, int frameskip);
 
 struct blip_t;
 bool mCoreSyncProduceAudio(struct mCoreSync* sync, const struct blip_t*, size_t samples);
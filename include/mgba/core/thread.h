@@ -24,6 +24,24 @@ struct mThreadLogger {
 	struct mLogger* logger;
 };
 
+enum mCoreThreadCommandStatus {
+	mTHREAD_COMMAND_PENDING = 0,
+	mTHREAD_COMMAND_DONE,
+	mTHREAD_COMMAND_CANCELLED,
+};
+
+struct mCoreThreadCommand {
+	// Run on the emulation thread at the next point between frames, or while it is paused
+	void (*run)(struct mCoreThread*, struct mCoreThreadCommand*);
+	// Optional; also called on the emulation thread, after run or if the thread ends first.
+	// Free a command either here or after waiting on it, not both.
+	void (*done)(struct mCoreThread*, struct mCoreThreadCommand*);
+	void* context;
+
+	struct mCoreThreadCommand* next;
+	int status;
+};
+
 #ifdef ENABLE_SCRIPTING
 struct mScriptContext;
 #endif
@@ -95,6 +113,10 @@ struct mCoreThreadInternal {
 	struct mCoreSync sync;
 	struct mCoreRewindContext rewind;
 	struct mCore* core;
+
+	struct mCoreThreadCommand* commands;
+	Mutex commandMutex;
+	Condition commandCond;
 };
 
 #endif
@@ -113,6 +135,13 @@ void mCoreThreadContinue(struct mCoreThread* threadContext);
 
 void mCoreThreadRunFunction(struct mCoreThread* threadContext, void (*run)(struct mCoreThread*));
 
+// Neither blocks; commands queued together are run in order during the same visit.
+// Commands queued together finish in order, so the batch can be freed once the last one has.
+bool mCoreThreadQueueCommand(struct mCoreThread* threadContext, struct mCoreThreadCommand* command);
+bool mCoreThreadQueueCommands(struct mCoreThread* threadContext, struct mCoreThreadCommand* commands, size_t nCommands);
+enum mCoreThreadCommandStatus mCoreThreadCommandPoll(const struct mCoreThreadCommand* command);
+enum mCoreThreadCommandStatus mCoreThreadCommandWait(struct mCoreThread* threadContext, struct mCoreThreadCommand* command);
+
 void mCoreThreadPause(struct mCoreThread* threadContext);
 void mCoreThreadUnpause(struct mCoreThread* threadContext);
 bool mCoreThreadIsPaused(struct mCoreThread* threadContext);
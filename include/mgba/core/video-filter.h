@@ -0,0 +1,79 @@
+/* Copyright (c) 2013-2024 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#ifndef CORE_VIDEO_FILTER_H
+#define CORE_VIDEO_FILTER_H
+
+#include <mgba-util/common.h>
+
+CXX_GUARD_START
+
+#include <mgba/core/interface.h>
+#include <mgba-util/image.h>
+
+enum mVideoFilterScaler {
+	mVIDEO_SCALER_NEAREST = 0,
+	mVIDEO_SCALER_SCALE2X,
+	mVIDEO_SCALER_SCALE3X,
+	mVIDEO_SCALER_SCALE4X,
+};
+
+enum mVideoFilterColor {
+	mVIDEO_COLOR_NONE = 0,
+	mVIDEO_COLOR_GBA,
+	mVIDEO_COLOR_GBC,
+};
+
+// CPU counterpart of the upscaling, LCD color and frame blending shaders, for output without a GPU.
+// The stages run in the order blending, color correction, scaling.
+struct mVideoFilter {
+	enum mVideoFilterScaler scaler;
+	unsigned scale;
+	enum mVideoFilterColor color;
+	bool interframeBlending;
+
+	color_t* colorTable;
+	color_t* previous;
+	color_t* stage;
+	color_t* scaleTemp;
+	color_t* output;
+	size_t sourceSize;
+	size_t outputSize;
+	unsigned previousWidth;
+	unsigned previousHeight;
+};
+
+void mVideoFilterInit(struct mVideoFilter*);
+void mVideoFilterDeinit(struct mVideoFilter*);
+
+// For the nearest scaler, scale is any factor from 1 up; the other scalers have a fixed factor
+void mVideoFilterSetScaler(struct mVideoFilter*, enum mVideoFilterScaler scaler, unsigned scale);
+void mVideoFilterSetColor(struct mVideoFilter*, enum mVideoFilterColor color);
+void mVideoFilterSetInterframeBlending(struct mVideoFilter*, bool enable);
+// Forget the previous frame, e.g. after a reset or loading a state
+void mVideoFilterReset(struct mVideoFilter*);
+
+bool mVideoFilterIsIdentity(const struct mVideoFilter*);
+void mVideoFilterOutputSize(const struct mVideoFilter*, unsigned width, unsigned height, unsigned* outWidth, unsigned* outHeight);
+// Strides are in pixels. The result is owned by the filter, or is the input if the filter does nothing,
+// and stays valid until the next call.
+const color_t* mVideoFilterApply(struct mVideoFilter*, const color_t* pixels, size_t stride, unsigned width, unsigned height, size_t* outStride);
+
+struct mVideoFilterStream {
+	struct mAVStream d;
+	struct mAVStream* next;
+	struct mVideoFilter* filter;
+	unsigned width;
+	unsigned height;
+	const color_t* lastOutput;
+	size_t lastStride;
+};
+
+// Wraps another stream, filtering video on its way through and passing everything else along as-is
+void mVideoFilterStreamInit(struct mVideoFilterStream*, struct mVideoFilter* filter, struct mAVStream* next);
+
+CXX_GUARD_END
+
+#endif
@@ -59,6 +59,7 @@ enum mDebuggerType {
 	DEBUGGER_CLI,
 	DEBUGGER_GDB,
 	DEBUGGER_ACCESS_LOGGER,
+	DEBUGGER_TRACER,
 	DEBUGGER_MAX
 };
 
@@ -186,7 +187,7 @@ struct mDebuggerPlatform {
 	void (*deinit)(struct mDebuggerPlatform*);
 	void (*entered)(struct mDebuggerPlatform*, enum mDebuggerEntryReason, struct mDebuggerEntryInfo*);
 
-	bool (*hasBreakpoints)(struct mDebuggerPlatform*);
+	bool (*requiresStepping)(struct mDebuggerPlatform*);
 	void (*checkBreakpoints)(struct mDebuggerPlatform*);
 	bool (*clearBreakpoint)(struct mDebuggerPlatform*, ssize_t id);
 
@@ -205,6 +206,7 @@ struct mDebuggerPlatform {
 	bool (*updateStackTrace)(struct mDebuggerPlatform* d);
 
 	void (*nextInstructionInfo)(struct mDebuggerPlatform* d, struct mDebuggerInstructionInfo* info);
+	void (*setInstructionHook)(struct mDebuggerPlatform* d, struct mInstructionHook* hook);
 };
 
 struct mDebugger {
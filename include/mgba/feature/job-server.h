@@ -0,0 +1,105 @@
+/* Copyright (c) 2013-2024 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#ifndef M_JOB_SERVER_H
+#define M_JOB_SERVER_H
+
+#include <mgba-util/common.h>
+
+CXX_GUARD_START
+
+#include <mgba-util/socket.h>
+#include <mgba-util/table.h>
+#include <mgba-util/threading.h>
+
+// A job is a sequence of records, each a 16-byte little-endian header
+// (op, arg0, arg1, payload size) followed by its payload. The response is a
+// sequence of records in the same format, one for each op that produces
+// output, terminated by an mJOB_OP_END record carrying the status. Over a
+// socket, requests and responses are each prefixed by their 32-bit
+// little-endian length.
+#define mJOB_RECORD_SIZE 16
+#define mJOB_MAX_MESSAGE 0x4000000
+
+enum mJobOp {
+	mJOB_OP_END = 0,
+	// Payload: path of the ROM. Must come first in each job
+	mJOB_OP_LOAD_ROM,
+	mJOB_OP_RESET,
+	// Payload: savestate
+	mJOB_OP_LOAD_STATE,
+	// Response payload: savestate
+	mJOB_OP_SAVE_STATE,
+	// arg0: keys
+	mJOB_OP_SET_KEYS,
+	// arg0: frame count
+	mJOB_OP_RUN_FRAMES,
+	// Payload: 16-bit keys for each frame to run
+	mJOB_OP_RUN_INPUTS,
+	// arg0: address, arg1: length. Response payload: memory
+	mJOB_OP_READ_MEMORY,
+	// arg0: address. Payload: memory. Read-only regions such as ROM can't be written
+	mJOB_OP_WRITE_MEMORY,
+	// Response arg0: width, arg1: height. Response payload: pixels
+	mJOB_OP_GET_FRAME,
+	mJOB_OP_MAX
+};
+
+enum mJobStatus {
+	mJOB_OK = 0,
+	mJOB_ERROR_MALFORMED,
+	mJOB_ERROR_UNKNOWN_OP,
+	mJOB_ERROR_NO_ROM,
+	mJOB_ERROR_LOAD_ROM,
+	mJOB_ERROR_STATE,
+	mJOB_ERROR_RANGE,
+	mJOB_ERROR_MEMORY,
+};
+
+struct mJobRecord {
+	uint32_t op;
+	uint32_t arg0;
+	uint32_t arg1;
+	uint32_t size;
+};
+
+struct mCoreConfig;
+struct VFile;
+struct mJobServer {
+	const struct mCoreConfig* config;
+	size_t idleLimit;
+
+	Mutex mutex;
+	struct Table idle;
+	size_t idleCores;
+
+#ifndef DISABLE_THREADING
+	Condition queueCond;
+	Socket* queue;
+	size_t queueSize;
+	size_t queueCapacity;
+	Thread* workers;
+	unsigned nWorkers;
+	bool stopping;
+#endif
+};
+
+void mJobServerInit(struct mJobServer*, const struct mCoreConfig* config);
+void mJobServerDeinit(struct mJobServer*);
+
+enum mJobStatus mJobServerRun(struct mJobServer*, struct VFile* request, struct VFile* response);
+
+bool mJobRecordRead(struct VFile* vf, struct mJobRecord* record);
+bool mJobRecordWrite(struct VFile* vf, const struct mJobRecord* record, const void* payload);
+
+#ifndef DISABLE_THREADING
+bool mJobServerStart(struct mJobServer*, unsigned workers);
+bool mJobServerServe(struct mJobServer*, Socket listener, volatile bool* exiting);
+void mJobServerStop(struct mJobServer*);
+#endif
+
+CXX_GUARD_END
+
+#endif
@@ -12,6 +12,9 @@ CXX_GUARD_START
 
 #include <mgba/core/interface.h>
 
+#define GB_IDLE_LOOP_NONE 0xFFFFFFFF
+#define GB_IDLE_LOOP_DISABLED 0xFFFFFFFE
+
 enum GBModel {
 	GB_MODEL_AUTODETECT = 0xFF,
 	GB_MODEL_DMG  = 0x00,
@@ -80,6 +83,7 @@ struct GBCartridgeOverride {
 	enum GBMemoryBankControllerType mbc;
 
 	uint32_t gbColors[12];
+	uint32_t idleLoop;
 };
 
 struct GBColorPreset {
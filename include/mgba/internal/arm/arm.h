@@ -173,6 +173,13 @@ struct ARMCore {
 	int32_t shifterOperand;
 	int32_t shifterCarryOut;
 
+	// The last flag-setting operation, if its flags haven't been written to the CPSR yet
+	int32_t flagsOp;
+	int32_t flagsM;
+	int32_t flagsN;
+	int32_t flagsD;
+	int32_t flagsNZ;
+
 	uint32_t prefetch[2];
 	enum ExecutionMode executionMode;
 	enum PrivilegeMode privilegeMode;
@@ -184,6 +191,10 @@ struct ARMCore {
 
 	size_t numComponents;
 	struct mCPUComponent** components;
+
+	struct mBreakpointPages* breakpointPages;
+	struct mWatchpointPages* watchpointPages;
+	struct mInstructionHook* instructionHook;
 };
 #undef ARM_REGISTER_FILE
 
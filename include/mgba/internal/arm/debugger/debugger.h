@@ -33,7 +33,8 @@ struct ARMDebugger {
 	struct ARMDebugBreakpointList breakpoints;
 	struct ARMDebugBreakpointList swBreakpoints;
 	struct mWatchpointList watchpoints;
-	struct ARMMemory originalMemory;
+	struct mBreakpointPages breakpointPages;
+	struct mWatchpointPages watchpointPages;
 
 	ssize_t nextId;
 	enum mStackTraceMode stackTraceMode;
@@ -12,8 +12,7 @@ CXX_GUARD_START
 
 struct ARMDebugger;
 
-void ARMDebuggerInstallMemoryShim(struct ARMDebugger* debugger);
-void ARMDebuggerRemoveMemoryShim(struct ARMDebugger* debugger);
+void ARMDebuggerUpdateWatchpoints(struct ARMDebugger* debugger);
 
 CXX_GUARD_END
 
@@ -10,20 +10,20 @@
 
 #include "arm.h"
 
-#define ARM_COND_EQ (cpu->cpsr.z)
-#define ARM_COND_NE (!cpu->cpsr.z)
-#define ARM_COND_CS (cpu->cpsr.c)
-#define ARM_COND_CC (!cpu->cpsr.c)
-#define ARM_COND_MI (cpu->cpsr.n)
-#define ARM_COND_PL (!cpu->cpsr.n)
-#define ARM_COND_VS (cpu->cpsr.v)
-#define ARM_COND_VC (!cpu->cpsr.v)
-#define ARM_COND_HI (cpu->cpsr.c && !cpu->cpsr.z)
-#define ARM_COND_LS (!cpu->cpsr.c || cpu->cpsr.z)
-#define ARM_COND_GE (!cpu->cpsr.n == !cpu->cpsr.v)
-#define ARM_COND_LT (!cpu->cpsr.n != !cpu->cpsr.v)
-#define ARM_COND_GT (!cpu->cpsr.z && !cpu->cpsr.n == !cpu->cpsr.v)
-#define ARM_COND_LE (cpu->cpsr.z || !cpu->cpsr.n != !cpu->cpsr.v)
+#define ARM_COND_EQ (_ARMFlagZ(cpu))
+#define ARM_COND_NE (!_ARMFlagZ(cpu))
+#define ARM_COND_CS (_ARMCarry(cpu))
+#define ARM_COND_CC (!_ARMCarry(cpu))
+#define ARM_COND_MI (_ARMFlagN(cpu))
+#define ARM_COND_PL (!_ARMFlagN(cpu))
+#define ARM_COND_VS (_ARMFlagV(cpu))
+#define ARM_COND_VC (!_ARMFlagV(cpu))
+#define ARM_COND_HI (_ARMCarry(cpu) && !_ARMFlagZ(cpu))
+#define ARM_COND_LS (!_ARMCarry(cpu) || _ARMFlagZ(cpu))
+#define ARM_COND_GE (_ARMFlagN(cpu) == _ARMFlagV(cpu))
+#define ARM_COND_LT (_ARMFlagN(cpu) != _ARMFlagV(cpu))
+#define ARM_COND_GT (!_ARMFlagZ(cpu) && _ARMFlagN(cpu) == _ARMFlagV(cpu))
+#define ARM_COND_LE (_ARMFlagZ(cpu) || _ARMFlagN(cpu) != _ARMFlagV(cpu))
 #define ARM_COND_AL 1
 
 #define ARM_SIGN(I) ((I) >> 31)
@@ -37,6 +37,105 @@
 #define ARM_V_ADDITION(M, N, D) (!(ARM_SIGN((M) ^ (N))) && (ARM_SIGN((M) ^ (D))))
 #define ARM_V_SUBTRACTION(M, N, D) ((ARM_SIGN((M) ^ (N))) && (ARM_SIGN((M) ^ (D))))
 
+// Flag-setting instructions only record their operands and result; NZCV are
+// computed from them when something actually reads the flags. N and Z are
+// tracked separately from C and V since logical operations only replace N and Z.
+enum ARMFlagsOp {
+	ARM_FLAGS_NONE = 0, // The CPSR is up to date
+	ARM_FLAGS_NZ = 1, // N and Z come from flagsNZ
+	ARM_FLAGS_ADDITION = 2, // C and V come from flagsM + flagsN = flagsD
+	ARM_FLAGS_SUBTRACTION = 4, // C and V come from flagsM - flagsN = flagsD
+	ARM_FLAGS_CV = ARM_FLAGS_ADDITION | ARM_FLAGS_SUBTRACTION
+};
+
+static inline void _ARMFlushCV(struct ARMCore* cpu) {
+	// Arithmetic operations clear the rest of the flags byte; N and Z are
+	// always pending alongside C and V, so they are not lost here
+	cpu->cpsr.flags = 0;
+	if (cpu->flagsOp & ARM_FLAGS_ADDITION) {
+		cpu->cpsr.c = ARM_CARRY_FROM(cpu->flagsM, cpu->flagsN, cpu->flagsD);
+		cpu->cpsr.v = ARM_V_ADDITION(cpu->flagsM, cpu->flagsN, cpu->flagsD);
+	} else {
+		cpu->cpsr.c = ARM_BORROW_FROM(cpu->flagsM, cpu->flagsN, cpu->flagsD);
+		cpu->cpsr.v = ARM_V_SUBTRACTION(cpu->flagsM, cpu->flagsN, cpu->flagsD);
+	}
+	cpu->flagsOp &= ~ARM_FLAGS_CV;
+}
+
+static inline void _ARMMaterializeFlags(struct ARMCore* cpu) {
+	if (cpu->flagsOp == ARM_FLAGS_NONE) {
+		return;
+	}
+	if (cpu->flagsOp & ARM_FLAGS_CV) {
+		_ARMFlushCV(cpu);
+	}
+	cpu->cpsr.n = ARM_SIGN(cpu->flagsNZ);
+	cpu->cpsr.z = !cpu->flagsNZ;
+	cpu->flagsOp = ARM_FLAGS_NONE;
+}
+
+static inline bool _ARMCarry(const struct ARMCore* cpu) {
+	if (cpu->flagsOp & ARM_FLAGS_ADDITION) {
+		return ARM_CARRY_FROM(cpu->flagsM, cpu->flagsN, cpu->flagsD);
+	}
+	if (cpu->flagsOp & ARM_FLAGS_SUBTRACTION) {
+		return ARM_BORROW_FROM(cpu->flagsM, cpu->flagsN, cpu->flagsD);
+	}
+	return cpu->cpsr.c;
+}
+
+static inline bool _ARMFlagN(const struct ARMCore* cpu) {
+	if (cpu->flagsOp & ARM_FLAGS_NZ) {
+		return ARM_SIGN(cpu->flagsNZ);
+	}
+	return cpu->cpsr.n;
+}
+
+static inline bool _ARMFlagZ(const struct ARMCore* cpu) {
+	if (cpu->flagsOp & ARM_FLAGS_NZ) {
+		return !cpu->flagsNZ;
+	}
+	return cpu->cpsr.z;
+}
+
+static inline bool _ARMFlagV(const struct ARMCore* cpu) {
+	if (cpu->flagsOp & ARM_FLAGS_ADDITION) {
+		return ARM_V_ADDITION(cpu->flagsM, cpu->flagsN, cpu->flagsD);
+	}
+	if (cpu->flagsOp & ARM_FLAGS_SUBTRACTION) {
+		return ARM_V_SUBTRACTION(cpu->flagsM, cpu->flagsN, cpu->flagsD);
+	}
+	return cpu->cpsr.v;
+}
+
+static inline void _ARMSetFlagsAddition(struct ARMCore* cpu, int32_t m, int32_t n, int32_t d) {
+	cpu->flagsOp = ARM_FLAGS_NZ | ARM_FLAGS_ADDITION;
+	cpu->flagsM = m;
+	cpu->flagsN = n;
+	cpu->flagsD = d;
+	cpu->flagsNZ = d;
+}
+
+static inline void _ARMSetFlagsSubtraction(struct ARMCore* cpu, int32_t m, int32_t n, int32_t d) {
+	cpu->flagsOp = ARM_FLAGS_NZ | ARM_FLAGS_SUBTRACTION;
+	cpu->flagsM = m;
+	cpu->flagsN = n;
+	cpu->flagsD = d;
+	cpu->flagsNZ = d;
+}
+
+static inline void _ARMSetFlagsNZ(struct ARMCore* cpu, int32_t d) {
+	cpu->flagsOp |= ARM_FLAGS_NZ;
+	cpu->flagsNZ = d;
+}
+
+static inline void _ARMSetCarry(struct ARMCore* cpu, bool c) {
+	if (UNLIKELY(cpu->flagsOp & ARM_FLAGS_CV)) {
+		_ARMFlushCV(cpu);
+	}
+	cpu->cpsr.c = c;
+}
+
 #define ARM_WAIT_SMUL(R, WAIT)                                            \
 	{                                                                     \
 		int32_t wait = WAIT;                                              \
@@ -113,6 +212,7 @@ static inline void _ARMSetMode(struct ARMCore* cpu, enum ExecutionMode execution
 }
 
 static inline void _ARMReadCPSR(struct ARMCore* cpu) {
+	cpu->flagsOp = ARM_FLAGS_NONE;
 	_ARMSetMode(cpu, cpu->cpsr.t);
 	ARMSetPrivilegeMode(cpu, cpu->cpsr.priv);
 	cpu->irqh.readCPSR(cpu);
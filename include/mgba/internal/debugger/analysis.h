@@ -0,0 +1,152 @@
+/* Copyright (c) 2013-2024 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#ifndef DEBUGGER_ANALYSIS_H
+#define DEBUGGER_ANALYSIS_H
+
+#include <mgba-util/common.h>
+
+CXX_GUARD_START
+
+#include <mgba-util/table.h>
+#include <mgba-util/vector.h>
+
+#define mCODE_ANALYSIS_MAX_REGISTERS 16
+
+enum mCodeFlow {
+	// Execution can reach the next instruction
+	mCODE_FLOW_CONTINUES = 0x01,
+	mCODE_FLOW_JUMP = 0x02,
+	mCODE_FLOW_CALL = 0x04,
+	mCODE_FLOW_RETURN = 0x08,
+	// The jump or call target isn't known statically
+	mCODE_FLOW_INDIRECT = 0x10,
+	mCODE_FLOW_DATA = 0x20,
+};
+
+enum mCodeInstructionFlags {
+	mCODE_INSTRUCTION_LEADER = 0x01,
+	mCODE_INSTRUCTION_FUNCTION = 0x02,
+	mCODE_INSTRUCTION_OBSERVED = 0x04,
+};
+
+enum mCodeXrefType {
+	mCODE_XREF_JUMP,
+	mCODE_XREF_CALL,
+	mCODE_XREF_DATA,
+};
+
+// The mode is platform-defined, e.g. ARM or Thumb
+struct mCodeLocation {
+	uint32_t address;
+	int segment;
+	int mode;
+};
+
+struct mCodeInstructionInfo {
+	unsigned length;
+	unsigned flow;
+	struct mCodeLocation target;
+	struct mCodeLocation data;
+};
+
+struct mCodeInstruction {
+	struct mCodeLocation location;
+	struct mCodeInstructionInfo info;
+	uint32_t flags;
+	uint32_t nextAtAddress;
+};
+
+struct mCodeBlock {
+	struct mCodeLocation start;
+	uint32_t end;
+	// The furthest end of this or any earlier block in the same segment
+	uint32_t reach;
+	// Index into the analysis's instruction order
+	uint32_t firstInstruction;
+	uint32_t nInstructions;
+	ssize_t function;
+};
+
+struct mCodeFunction {
+	struct mCodeLocation entry;
+	size_t nBlocks;
+	size_t size;
+};
+
+struct mCodeXref {
+	struct mCodeLocation from;
+	struct mCodeLocation to;
+	enum mCodeXrefType type;
+};
+
+struct mCodeAnalysisTarget {
+	struct mCodeLocation location;
+	uint32_t flags;
+	bool force;
+};
+
+DECLARE_VECTOR(mCodeInstructionList, struct mCodeInstruction);
+DECLARE_VECTOR(mCodeBlockList, struct mCodeBlock);
+DECLARE_VECTOR(mCodeFunctionList, struct mCodeFunction);
+DECLARE_VECTOR(mCodeXrefList, struct mCodeXref);
+DECLARE_VECTOR(mCodeAnalysisTargetList, struct mCodeAnalysisTarget);
+
+struct mCodeAnalysis;
+struct mCodeAnalysisPlatform {
+	uint32_t id;
+	// Returns false for anything that can't be executed
+	bool (*decode)(struct mCodeAnalysis*, const struct mCodeLocation*, struct mCodeInstructionInfo*);
+	// Whether the contents of a location are fixed, such as ROM, and can be followed without running the game
+	bool (*isStatic)(struct mCodeAnalysis*, const struct mCodeLocation*);
+	void (*addEntryPoints)(struct mCodeAnalysis*);
+};
+
+struct mCore;
+struct mCodeAnalysis {
+	struct mCore* core;
+	const struct mCodeAnalysisPlatform* platform;
+	uint32_t romCrc32;
+
+	struct mCodeInstructionList instructions;
+	struct Table instructionIndex;
+	struct mCodeAnalysisTargetList pending;
+	struct mCodeXrefList observedXrefs;
+
+	// Rebuilt by mCodeAnalysisRun
+	struct UInt32List order;
+	struct mCodeBlockList blocks;
+	struct mCodeFunctionList functions;
+	struct mCodeXrefList xrefs;
+
+	// Register values the platform has inferred along the current straight-line run
+	uint32_t knownValues[mCODE_ANALYSIS_MAX_REGISTERS];
+	uint32_t knownMask;
+};
+
+// If platform is NULL, the core's is used
+void mCodeAnalysisInit(struct mCodeAnalysis*, struct mCore* core, const struct mCodeAnalysisPlatform* platform);
+void mCodeAnalysisDeinit(struct mCodeAnalysis*);
+
+void mCodeAnalysisAddEntryPoint(struct mCodeAnalysis*, uint32_t address, int segment, int mode);
+// Targets seen at runtime, such as indirect jumps, are followed even outside of static memory
+void mCodeAnalysisAddTarget(struct mCodeAnalysis*, const struct mCodeLocation* from, const struct mCodeLocation* to, enum mCodeXrefType type);
+bool mCodeAnalysisObserve(struct mCodeAnalysis*, const struct mCodeLocation*);
+void mCodeAnalysisRun(struct mCodeAnalysis*);
+
+const struct mCodeInstruction* mCodeAnalysisInstructionAt(const struct mCodeAnalysis*, uint32_t address, int segment);
+const struct mCodeBlock* mCodeAnalysisBlockAt(const struct mCodeAnalysis*, uint32_t address, int segment);
+const struct mCodeFunction* mCodeAnalysisFunctionAt(const struct mCodeAnalysis*, uint32_t address, int segment);
+size_t mCodeAnalysisXrefsTo(const struct mCodeAnalysis*, uint32_t address, int segment, const struct mCodeXref** xrefs);
+
+struct VDir;
+struct VFile;
+struct VFile* mCodeAnalysisOpenCache(const struct mCodeAnalysis*, struct VDir* dir, bool write);
+bool mCodeAnalysisSave(const struct mCodeAnalysis*, struct VFile*);
+bool mCodeAnalysisLoad(struct mCodeAnalysis*, struct VFile*);
+
+CXX_GUARD_END
+
+#endif
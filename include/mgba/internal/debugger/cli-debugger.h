@@ -81,6 +81,7 @@ struct CLIDebuggerBackend {
 	void (*interrupt)(struct CLIDebuggerBackend*);
 };
 
+struct mDebuggerTracer;
 struct CLIDebugger {
 	struct mDebuggerModule d;
 
@@ -89,6 +90,7 @@ struct CLIDebugger {
 
 	int traceRemaining;
 	struct VFile* traceVf;
+	struct mDebuggerTracer* tracer;
 	bool skipStatus;
 };
 
@@ -0,0 +1,84 @@
+/* Copyright (c) 2013-2024 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#ifndef DEBUGGER_TRACER_H
+#define DEBUGGER_TRACER_H
+
+#include <mgba-util/common.h>
+
+CXX_GUARD_START
+
+#include <mgba/debugger/debugger.h>
+
+#define mDEBUGGER_TRACE_BLOCK_RECORDS 0x1000
+#define mDEBUGGER_TRACE_MAX_REGISTERS 16
+
+DECL_BITFIELD(mDebuggerTracerFlags, uint32_t);
+DECL_BIT(mDebuggerTracerFlags, Registers, 0);
+DECL_BIT(mDebuggerTracerFlags, Memory, 1);
+
+enum mDebuggerTraceRecordType {
+	mTRACE_RECORD_INSTRUCTION = 1,
+	mTRACE_RECORD_REGISTER = 2,
+	mTRACE_RECORD_MEMORY = 3,
+};
+
+// Records are stored little-endian. cycles is the time elapsed since the
+// previous record in the same block. Register records describe the effects
+// of the preceding instruction and memory records those of the current one.
+struct mDebuggerTraceRecord {
+	uint8_t type;
+	uint8_t index;
+	uint16_t reserved;
+	uint32_t cycles;
+	uint32_t address;
+	uint32_t value;
+	uint32_t mode;
+};
+static_assert(sizeof(struct mDebuggerTraceRecord) == 0x14, "mDebuggerTraceRecord struct sized wrong");
+
+struct VFile;
+struct mDebuggerTracer {
+	struct mDebuggerModule d;
+	struct mInstructionHook hook;
+	struct VFile* vf;
+	mDebuggerTracerFlags flags;
+
+	struct mDebuggerTraceRecord* records;
+	size_t nRecords;
+	uint64_t blockStart;
+	uint64_t lastCycles;
+	uint32_t regs[mDEBUGGER_TRACE_MAX_REGISTERS];
+	bool keyframe;
+	bool failed;
+
+	uint64_t instructions;
+};
+
+void mDebuggerTracerInit(struct mDebuggerTracer*);
+void mDebuggerTracerDeinit(struct mDebuggerTracer*);
+
+bool mDebuggerTracerOpen(struct mDebuggerTracer*, struct VFile*, mDebuggerTracerFlags);
+bool mDebuggerTracerClose(struct mDebuggerTracer*);
+
+struct mDebuggerTraceReader {
+	struct VFile* vf;
+	uint32_t platform;
+	mDebuggerTracerFlags flags;
+	uint32_t romCrc32;
+
+	struct mDebuggerTraceRecord* records;
+	size_t nRecords;
+	size_t index;
+	uint64_t cycles;
+};
+
+bool mDebuggerTraceReaderOpen(struct mDebuggerTraceReader*, struct VFile*);
+void mDebuggerTraceReaderClose(struct mDebuggerTraceReader*);
+bool mDebuggerTraceReaderNext(struct mDebuggerTraceReader*, struct mDebuggerTraceRecord*, uint64_t* cycles);
+
+CXX_GUARD_END
+
+#endif
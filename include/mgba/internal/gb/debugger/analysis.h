@@ -0,0 +1,20 @@
+/* Copyright (c) 2013-2024 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#ifndef GB_ANALYSIS_H
+#define GB_ANALYSIS_H
+
+#include <mgba-util/common.h>
+
+CXX_GUARD_START
+
+#include <mgba/internal/debugger/analysis.h>
+
+// Segments are ROM banks for 0x4000-0x7FFF and -1 everywhere else
+extern const struct mCodeAnalysisPlatform GBCodeAnalysisPlatform;
+
+CXX_GUARD_END
+
+#endif
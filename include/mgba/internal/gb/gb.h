@@ -20,6 +20,7 @@ CXX_GUARD_START
 #include <mgba/internal/gb/sio.h>
 #include <mgba/internal/gb/timer.h>
 #include <mgba/internal/gb/video.h>
+#include <mgba/internal/sm83/sm83.h>
 
 extern const uint32_t DMG_SM83_FREQUENCY;
 extern const uint32_t CGB_SM83_FREQUENCY;
@@ -43,6 +44,12 @@ enum GBIRQVector {
 	GB_VECTOR_KEYPAD = 0x60,
 };
 
+enum GBIdleLoopOptimization {
+	GB_IDLE_LOOP_IGNORE = -1,
+	GB_IDLE_LOOP_REMOVE = 0,
+	GB_IDLE_LOOP_DETECT
+};
+
 enum GBSGBCommand {
 	SGB_PAL01 = 0,
 	SGB_PAL23,
@@ -87,6 +94,7 @@ struct GBXMetadata {
 struct SM83Core;
 struct mCoreSync;
 struct mAVStream;
+struct mRunUntil;
 struct GB {
 	struct mCPUComponent d;
 
@@ -130,9 +138,20 @@ struct GB {
 
 	bool cpuBlocked;
 	bool earlyExit;
+	struct mRunUntil* runUntil;
 	struct mTimingEvent eiPending;
 	unsigned doubleSpeed;
 
+	enum GBIdleLoopOptimization idleOptimization;
+	uint32_t idleLoop;
+	uint16_t lastJump;
+	enum mCoreAccuracy accuracy;
+	int idleDetectionStep;
+	int idleDetectionFailures;
+	struct SM83RegisterFile cachedRegisters;
+	uint32_t cachedMasterCycles;
+	int32_t cachedCycles;
+
 	bool allowOpposingDirections;
 };
 
@@ -169,6 +188,7 @@ void GBMapBIOS(struct GB* gb);
 void GBUnmapBIOS(struct GB* gb);
 void GBDetectModel(struct GB* gb);
 
+void GBRaiseIRQ(struct GB* gb, enum GBIRQ irq);
 void GBUpdateIRQs(struct GB* gb);
 void GBHalt(struct SM83Core* cpu);
 
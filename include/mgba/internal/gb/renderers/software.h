@@ -63,6 +63,13 @@ struct GBVideoSoftwareRenderer {
 	uint32_t sgbBorderMask[18];
 
 	uint8_t lastHighlightAmount;
+
+	uint8_t lastOam[GB_VIDEO_MAX_OBJ * 4];
+	bool frameDirty;
+	bool frameDrawn;
+	bool outputCurrent;
+
+	const struct mVideoLayerOutput* layerOutput;
 };
 
 void GBVideoSoftwareRendererCreate(struct GBVideoSoftwareRenderer*);
@@ -111,6 +111,9 @@ struct GBVideoRenderer {
 	bool highlightWIN;
 	color_t highlightColor;
 	uint8_t highlightAmount;
+
+	// Set by finishFrame when the frame is identical to the previous one
+	bool repeatFrame;
 };
 
 DECL_BITFIELD(GBRegisterLCDC, uint8_t);
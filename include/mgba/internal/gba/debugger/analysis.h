@@ -0,0 +1,20 @@
+/* Copyright (c) 2013-2024 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#ifndef GBA_ANALYSIS_H
+#define GBA_ANALYSIS_H
+
+#include <mgba-util/common.h>
+
+CXX_GUARD_START
+
+#include <mgba/internal/debugger/analysis.h>
+
+// Modes are MODE_ARM and MODE_THUMB
+extern const struct mCodeAnalysisPlatform GBACodeAnalysisPlatform;
+
+CXX_GUARD_END
+
+#endif
@@ -52,6 +52,7 @@ enum {
 
 struct ARMCore;
 struct GBA;
+struct mRunUntil;
 struct Patch;
 struct VFile;
 
@@ -110,6 +111,7 @@ struct GBA {
 	bool haltPending;
 	bool cpuBlocked;
 	bool earlyExit;
+	struct mRunUntil* runUntil;
 	uint32_t dmaPC;
 	uint32_t biosStall;
 
@@ -121,6 +123,8 @@ struct GBA {
 	bool vbaBugCompat;
 	bool hardCrash;
 	bool allowOpposingDirections;
+	bool hleBiosCalls;
+	enum mCoreAccuracy accuracy;
 
 	bool debug;
 	char debugString[0x100];
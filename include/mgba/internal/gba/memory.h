@@ -104,6 +104,8 @@ struct GBAMemory {
 	uint32_t* wram;
 	uint32_t* iwram;
 	uint32_t* rom;
+	uint8_t* matrixRom;
+	size_t matrixRomSize;
 	uint16_t io[512];
 
 	struct GBACartridgeHardware hw;
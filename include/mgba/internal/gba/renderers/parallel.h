@@ -0,0 +1,76 @@
+/* Copyright (c) 2013-2024 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#ifndef GBA_VIDEO_PARALLEL_H
+#define GBA_VIDEO_PARALLEL_H
+
+#include <mgba-util/common.h>
+
+CXX_GUARD_START
+
+#include <mgba/internal/gba/renderers/video-software.h>
+#include <mgba-util/threading.h>
+#include <mgba-util/vector.h>
+
+#ifndef DISABLE_THREADING
+
+#define GBA_VIDEO_PARALLEL_MAX_BANDS 8
+
+enum GBAVideoParallelDeltaType {
+	PARALLEL_DELTA_REGISTER = 0,
+	PARALLEL_DELTA_VRAM,
+	PARALLEL_DELTA_VRAM_BLOCK,
+	PARALLEL_DELTA_PALETTE,
+	PARALLEL_DELTA_OAM,
+	PARALLEL_DELTA_SCANLINE,
+	PARALLEL_DELTA_FRAME,
+};
+
+struct GBAVideoParallelDelta {
+	uint8_t type;
+	uint16_t value;
+	uint32_t address;
+};
+
+DECLARE_VECTOR(GBAVideoParallelDeltaList, struct GBAVideoParallelDelta);
+DECLARE_VECTOR(GBAVideoParallelBlockList, uint16_t);
+
+struct GBAVideoParallelRenderer;
+struct GBAVideoParallelBand {
+	struct GBAVideoSoftwareRenderer renderer;
+	struct GBAVideoParallelRenderer* p;
+	uint16_t* vram;
+	uint16_t palette[512];
+	union GBAOAM oam;
+
+	Thread thread;
+	unsigned generation;
+};
+
+struct GBAVideoParallelRenderer {
+	struct GBAVideoRenderer d;
+	struct GBAVideoSoftwareRenderer* primary;
+
+	int requestedBands;
+	int nBands;
+	struct GBAVideoParallelBand* bands;
+	struct GBAVideoParallelDeltaList deltas;
+	struct GBAVideoParallelBlockList blocks;
+
+	Mutex mutex;
+	Condition toThreadCond;
+	Condition fromThreadCond;
+	unsigned generation;
+	int pending;
+	bool stopping;
+};
+
+void GBAVideoParallelRendererCreate(struct GBAVideoParallelRenderer* renderer, struct GBAVideoSoftwareRenderer* primary, int bands);
+
+#endif
+
+CXX_GUARD_END
+
+#endif
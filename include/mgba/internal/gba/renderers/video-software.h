@@ -74,6 +74,9 @@ struct WindowControl {
 
 #define MAX_WINDOW 5
 
+#define VRAM_REFERENCE_SHIFT 9
+#define VRAM_REFERENCE_BLOCKS (0x18000 >> VRAM_REFERENCE_SHIFT)
+
 struct Window {
 	uint8_t endX;
 	struct WindowControl control;
@@ -138,20 +141,29 @@ struct GBAVideoSoftwareRenderer {
 	int16_t objOffsetY;
 
 	uint32_t scanlineDirty[5];
+	// Scanlines that read from each block of VRAM when they were last drawn
+	uint32_t vramLines[VRAM_REFERENCE_BLOCKS][5];
 	uint16_t nextIo[GBA_REG(SOUND1CNT_LO)];
 	struct ScanlineCache {
 		uint16_t io[GBA_REG(SOUND1CNT_LO)];
 		int32_t scale[2][2];
 	} cache[GBA_VIDEO_VERTICAL_PIXELS];
+	bool outputDirty;
 	int nextY;
+	int bandStart;
+	int bandEnd;
 
 	int start;
 	int end;
 
 	uint8_t lastHighlightAmount;
+
+	const struct mVideoLayerOutput* layerOutput;
 };
 
 void GBAVideoSoftwareRendererCreate(struct GBAVideoSoftwareRenderer* renderer);
+// Applies the masks a video register write goes through, without touching any renderer state
+uint16_t GBAVideoSoftwareRendererMaskVideoRegister(uint32_t address, uint16_t value);
 
 CXX_GUARD_START
 
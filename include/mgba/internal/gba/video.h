@@ -178,6 +178,8 @@ struct GBAVideoRenderer {
 
 	uint16_t (*writeVideoRegister)(struct GBAVideoRenderer* renderer, uint32_t address, uint16_t value);
 	void (*writeVRAM)(struct GBAVideoRenderer* renderer, uint32_t address);
+	// Equivalent to calling writeVRAM for every halfword in [address, address + size)
+	void (*writeVRAMRange)(struct GBAVideoRenderer* renderer, uint32_t address, uint32_t size);
 	void (*writePalette)(struct GBAVideoRenderer* renderer, uint32_t address, uint16_t value);
 	void (*writeOAM)(struct GBAVideoRenderer* renderer, uint32_t oam);
 	void (*drawScanline)(struct GBAVideoRenderer* renderer, int y);
@@ -200,6 +202,9 @@ struct GBAVideoRenderer {
 	bool highlightOBJ[128];
 	color_t highlightColor;
 	uint8_t highlightAmount;
+
+	// Set by finishFrame when the frame is identical to the previous one
+	bool repeatFrame;
 };
 
 struct GBAVideo {
@@ -27,7 +27,8 @@ struct SM83Debugger {
 
 	struct mBreakpointList breakpoints;
 	struct mWatchpointList watchpoints;
-	struct SM83Memory originalMemory;
+	struct mBreakpointPages breakpointPages;
+	struct mWatchpointPages watchpointPages;
 
 	ssize_t nextId;
 
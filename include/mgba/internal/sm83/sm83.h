@@ -54,6 +54,8 @@ struct SM83Memory {
 	uint8_t (*cpuLoad8)(struct SM83Core*, uint16_t address);
 	uint8_t (*load8)(struct SM83Core*, uint16_t address);
 	void (*store8)(struct SM83Core*, uint16_t address, int8_t value);
+	// Reads without any side effects on the bus, e.g. for tracing
+	uint8_t (*view8)(struct SM83Core*, uint16_t address);
 
 	int (*currentSegment)(struct SM83Core*, uint16_t address);
 
@@ -152,6 +154,10 @@ struct SM83Core {
 
 	size_t numComponents;
 	struct mCPUComponent** components;
+
+	struct mBreakpointPages* breakpointPages;
+	struct mWatchpointPages* watchpointPages;
+	struct mInstructionHook* instructionHook;
 };
 #undef SM83_REGISTER_FILE
 
@@ -45,6 +45,9 @@ void ARMSetPrivilegeMode(struct ARMCore* cpu, enum PrivilegeMode mode) {
 }
 
 void ARMInit(struct ARMCore* cpu) {
+	cpu->breakpointPages = NULL;
+	cpu->watchpointPages = NULL;
+	cpu->instructionHook = NULL;
 	cpu->master->init(cpu, cpu->master);
 	size_t i;
 	for (i = 0; i < cpu->numComponents; ++i) {
@@ -105,6 +108,7 @@ void ARMReset(struct ARMCore* cpu) {
 	cpu->privilegeMode = MODE_SYSTEM;
 	cpu->cpsr.packed = MODE_SYSTEM;
 	cpu->spsr.packed = 0;
+	cpu->flagsOp = ARM_FLAGS_NONE;
 
 	cpu->shifterOperand = 0;
 	cpu->shifterCarryOut = 0;
@@ -124,6 +128,7 @@ void ARMRaiseIRQ(struct ARMCore* cpu) {
 	if (cpu->cpsr.i) {
 		return;
 	}
+	_ARMMaterializeFlags(cpu);
 	union PSR cpsr = cpu->cpsr;
 	int instructionWidth;
 	if (cpu->executionMode == MODE_THUMB) {
@@ -143,6 +148,7 @@ void ARMRaiseIRQ(struct ARMCore* cpu) {
 }
 
 void ARMRaiseSWI(struct ARMCore* cpu) {
+	_ARMMaterializeFlags(cpu);
 	union PSR cpsr = cpu->cpsr;
 	int instructionWidth;
 	if (cpu->executionMode == MODE_THUMB) {
@@ -161,6 +167,7 @@ void ARMRaiseSWI(struct ARMCore* cpu) {
 }
 
 void ARMRaiseUndefined(struct ARMCore* cpu) {
+	_ARMMaterializeFlags(cpu);
 	union PSR cpsr = cpu->cpsr;
 	int instructionWidth;
 	if (cpu->executionMode == MODE_THUMB) {
@@ -205,6 +212,7 @@ static inline void ARMStep(struct ARMCore* cpu) {
 
 	unsigned condition = opcode >> 28;
 	if (condition != 0xE) {
+		_ARMMaterializeFlags(cpu);
 		unsigned flags = cpu->cpsr.flags >> 4;
 		bool conditionMet = conditionLut[condition] & (1 << flags);
 		if (!conditionMet) {
@@ -234,12 +242,61 @@ void ARMRun(struct ARMCore* cpu) {
 	} else {
 		ARMStep(cpu);
 	}
+	_ARMMaterializeFlags(cpu);
 	while (cpu->cycles >= cpu->nextEvent) {
 		cpu->irqh.processEvents(cpu);
 	}
 }
 
+static void _ARMRunLoopInstrumented(struct ARMCore* cpu) {
+	struct mBreakpointPages* pages = cpu->breakpointPages;
+	struct mInstructionHook* hook = cpu->instructionHook;
+	uint32_t page = 0xFFFFFFFF;
+	bool flagged = false;
+	while (cpu->cycles < cpu->nextEvent) {
+		uint32_t pc;
+		if (cpu->executionMode == MODE_THUMB) {
+			if (hook) {
+				_ARMMaterializeFlags(cpu);
+				hook->instruction(hook, cpu->gprs[ARM_PC] - WORD_SIZE_THUMB, cpu->prefetch[0], cpu->cpsr.packed, (const uint32_t*) cpu->gprs, 16);
+			}
+			ThumbStep(cpu);
+			pc = cpu->gprs[ARM_PC] - WORD_SIZE_THUMB;
+		} else {
+			if (hook) {
+				_ARMMaterializeFlags(cpu);
+				hook->instruction(hook, cpu->gprs[ARM_PC] - WORD_SIZE_ARM, cpu->prefetch[0], cpu->cpsr.packed, (const uint32_t*) cpu->gprs, 16);
+			}
+			ARMStep(cpu);
+			pc = cpu->gprs[ARM_PC] - WORD_SIZE_ARM;
+		}
+		if (!pages) {
+			continue;
+		}
+		if (pc >> mBREAKPOINT_PAGE_SHIFT != page) {
+			page = pc >> mBREAKPOINT_PAGE_SHIFT;
+			flagged = mBreakpointPagesTest(pages, pc);
+		}
+		if (flagged) {
+			_ARMMaterializeFlags(cpu);
+			pages->check(pages);
+		}
+	}
+	_ARMMaterializeFlags(cpu);
+
+	// An interrupt may move the PC, so check the first instruction of the handler
+	int32_t pc = cpu->gprs[ARM_PC];
+	cpu->irqh.processEvents(cpu);
+	if (cpu->gprs[ARM_PC] != pc && cpu->breakpointPages && mBreakpointPagesTest(cpu->breakpointPages, cpu->gprs[ARM_PC] - _ARMInstructionLength(cpu))) {
+		cpu->breakpointPages->check(cpu->breakpointPages);
+	}
+}
+
 void ARMRunLoop(struct ARMCore* cpu) {
+	if (cpu->breakpointPages || cpu->instructionHook) {
+		_ARMRunLoopInstrumented(cpu);
+		return;
+	}
 	if (cpu->executionMode == MODE_THUMB) {
 		while (cpu->cycles < cpu->nextEvent) {
 			ThumbStep(cpu);
@@ -249,6 +306,8 @@ void ARMRunLoop(struct ARMCore* cpu) {
 			ARMStep(cpu);
 		}
 	}
+	// Anything outside of the CPU loop may look at the CPSR
+	_ARMMaterializeFlags(cpu);
 	cpu->irqh.processEvents(cpu);
 }
 
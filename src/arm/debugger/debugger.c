@@ -228,6 +228,23 @@ static void ARMDebuggerCheckBreakpoints(struct mDebuggerPlatform* d) {
 	mDebuggerEnter(d->p, DEBUGGER_ENTER_BREAKPOINT, &info);
 }
 
+static void _checkBreakpointPage(struct mBreakpointPages* pages) {
+	ARMDebuggerCheckBreakpoints(pages->context);
+}
+
+static void _updateBreakpointPages(struct ARMDebugger* debugger) {
+	mBreakpointPagesClear(&debugger->breakpointPages);
+	size_t i;
+	for (i = 0; i < ARMDebugBreakpointListSize(&debugger->breakpoints); ++i) {
+		mBreakpointPagesMark(&debugger->breakpointPages, ARMDebugBreakpointListGetPointer(&debugger->breakpoints, i)->d.address);
+	}
+	if (ARMDebugBreakpointListSize(&debugger->breakpoints)) {
+		debugger->cpu->breakpointPages = &debugger->breakpointPages;
+	} else {
+		debugger->cpu->breakpointPages = NULL;
+	}
+}
+
 static void ARMDebuggerInit(void* cpu, struct mDebuggerPlatform* platform);
 static void ARMDebuggerDeinit(struct mDebuggerPlatform* platform);
 
@@ -239,7 +256,7 @@ static void ARMDebuggerListBreakpoints(struct mDebuggerPlatform*, struct mDebugg
 static ssize_t ARMDebuggerSetWatchpoint(struct mDebuggerPlatform*, struct mDebuggerModule* owner, const struct mWatchpoint*);
 static void ARMDebuggerListWatchpoints(struct mDebuggerPlatform*, struct mDebuggerModule* owner, struct mWatchpointList*);
 static void ARMDebuggerCheckBreakpoints(struct mDebuggerPlatform*);
-static bool ARMDebuggerHasBreakpoints(struct mDebuggerPlatform*);
+static bool ARMDebuggerRequiresStepping(struct mDebuggerPlatform*);
 static void ARMDebuggerTrace(struct mDebuggerPlatform*, char* out, size_t* length);
 static void ARMDebuggerFormatRegisters(struct ARMRegisterFile* regs, char* out, size_t* length);
 static void ARMDebuggerFrameFormatRegisters(struct mStackFrame* frame, char* out, size_t* length);
@@ -247,6 +264,7 @@ static enum mStackTraceMode ARMDebuggerGetStackTraceMode(struct mDebuggerPlatfor
 static void ARMDebuggerSetStackTraceMode(struct mDebuggerPlatform*, enum mStackTraceMode);
 static bool ARMDebuggerUpdateStackTrace(struct mDebuggerPlatform* d);
 static void ARMDebuggerNextInstructionInfo(struct mDebuggerPlatform* d, struct mDebuggerInstructionInfo*);
+static void ARMDebuggerSetInstructionHook(struct mDebuggerPlatform* d, struct mInstructionHook* hook);
 
 struct mDebuggerPlatform* ARMDebuggerPlatformCreate(void) {
 	struct mDebuggerPlatform* platform = (struct mDebuggerPlatform*) malloc(sizeof(struct ARMDebugger));
@@ -259,24 +277,27 @@ struct mDebuggerPlatform* ARMDebuggerPlatformCreate(void) {
 	platform->setWatchpoint = ARMDebuggerSetWatchpoint;
 	platform->listWatchpoints = ARMDebuggerListWatchpoints;
 	platform->checkBreakpoints = ARMDebuggerCheckBreakpoints;
-	platform->hasBreakpoints = ARMDebuggerHasBreakpoints;
+	platform->requiresStepping = ARMDebuggerRequiresStepping;
 	platform->trace = ARMDebuggerTrace;
 	platform->getStackTraceMode = ARMDebuggerGetStackTraceMode;
 	platform->setStackTraceMode = ARMDebuggerSetStackTraceMode;
 	platform->updateStackTrace = ARMDebuggerUpdateStackTrace;
 	platform->nextInstructionInfo = ARMDebuggerNextInstructionInfo;
+	platform->setInstructionHook = ARMDebuggerSetInstructionHook;
 	return platform;
 }
 
 void ARMDebuggerInit(void* cpu, struct mDebuggerPlatform* platform) {
 	struct ARMDebugger* debugger = (struct ARMDebugger*) platform;
 	debugger->cpu = cpu;
-	debugger->originalMemory = debugger->cpu->memory;
 	debugger->nextId = 1;
 	debugger->stackTraceMode = STACK_TRACE_DISABLED;
 	ARMDebugBreakpointListInit(&debugger->breakpoints, 0);
 	ARMDebugBreakpointListInit(&debugger->swBreakpoints, 0);
 	mWatchpointListInit(&debugger->watchpoints, 0);
+	mBreakpointPagesClear(&debugger->breakpointPages);
+	debugger->breakpointPages.check = _checkBreakpointPage;
+	debugger->breakpointPages.context = debugger;
 	struct mStackTrace* stack = &platform->p->stackTrace;
 	mStackTraceInit(stack, sizeof(struct ARMRegisterFile));
 	stack->formatRegisters = ARMDebuggerFrameFormatRegisters;
@@ -292,7 +313,9 @@ void ARMDebuggerDeinit(struct mDebuggerPlatform* platform) {
 			debugger->clearSoftwareBreakpoint(debugger, breakpoint);
 		}
 	}
-	ARMDebuggerRemoveMemoryShim(debugger);
+	debugger->cpu->breakpointPages = NULL;
+	debugger->cpu->watchpointPages = NULL;
+	debugger->cpu->instructionHook = NULL;
 
 	size_t i;
 	for (i = 0; i < ARMDebugBreakpointListSize(&debugger->breakpoints); ++i) {
@@ -312,6 +335,7 @@ static void ARMDebuggerEnter(struct mDebuggerPlatform* platform, enum mDebuggerE
 	struct ARMDebugger* debugger = (struct ARMDebugger*) platform;
 	struct ARMCore* cpu = debugger->cpu;
 	cpu->nextEvent = cpu->cycles;
+	_ARMMaterializeFlags(cpu);
 	if (reason == DEBUGGER_ENTER_BREAKPOINT) {
 		struct ARMDebugBreakpoint* breakpoint = _lookupBreakpoint(&debugger->swBreakpoints, _ARMPCAddress(cpu));
 		if (breakpoint && breakpoint->d.type == BREAKPOINT_SOFTWARE) {
@@ -365,6 +389,7 @@ static ssize_t ARMDebuggerSetBreakpoint(struct mDebuggerPlatform* d, struct mDeb
 		// TODO
 		abort();
 	}
+	_updateBreakpointPages(debugger);
 	return id;
 }
 
@@ -377,6 +402,7 @@ static bool ARMDebuggerClearBreakpoint(struct mDebuggerPlatform* d, ssize_t id)
 		if (ARMDebugBreakpointListGetPointer(breakpoints, i)->d.id == id) {
 			_destroyBreakpoint(debugger->d.p, ARMDebugBreakpointListGetPointer(breakpoints, i));
 			ARMDebugBreakpointListShift(breakpoints, i, 1);
+			_updateBreakpointPages(debugger);
 			return true;
 		}
 	}
@@ -397,9 +423,7 @@ static bool ARMDebuggerClearBreakpoint(struct mDebuggerPlatform* d, ssize_t id)
 		if (mWatchpointListGetPointer(watchpoints, i)->id == id) {
 			_destroyWatchpoint(debugger->d.p, mWatchpointListGetPointer(watchpoints, i));
 			mWatchpointListShift(watchpoints, i, 1);
-			if (!mWatchpointListSize(&debugger->watchpoints)) {
-				ARMDebuggerRemoveMemoryShim(debugger);
-			}
+			ARMDebuggerUpdateWatchpoints(debugger);
 			return true;
 		}
 	}
@@ -448,22 +472,22 @@ static void ARMDebuggerListBreakpoints(struct mDebuggerPlatform* d, struct mDebu
 	}
 }
 
-static bool ARMDebuggerHasBreakpoints(struct mDebuggerPlatform* d) {
+static bool ARMDebuggerRequiresStepping(struct mDebuggerPlatform* d) {
 	struct ARMDebugger* debugger = (struct ARMDebugger*) d;
-	return ARMDebugBreakpointListSize(&debugger->breakpoints) || mWatchpointListSize(&debugger->watchpoints) || debugger->stackTraceMode != STACK_TRACE_DISABLED;
+	// Breakpoints are checked by the run loop and watchpoints by the memory bus,
+	// but stack tracing needs to see every instruction
+	return debugger->stackTraceMode != STACK_TRACE_DISABLED;
 }
 
 static ssize_t ARMDebuggerSetWatchpoint(struct mDebuggerPlatform* d, struct mDebuggerModule* owner, const struct mWatchpoint* info) {
 	struct ARMDebugger* debugger = (struct ARMDebugger*) d;
-	if (!mWatchpointListSize(&debugger->watchpoints)) {
-		ARMDebuggerInstallMemoryShim(debugger);
-	}
 	struct mWatchpoint* watchpoint = mWatchpointListAppend(&debugger->watchpoints);
 	ssize_t id = debugger->nextId;
 	++debugger->nextId;
 	*watchpoint = *info;
 	watchpoint->id = id;
 	TableInsert(&debugger->d.p->pointOwner, id, owner);
+	ARMDebuggerUpdateWatchpoints(debugger);
 	return id;
 }
 
@@ -577,3 +601,9 @@ static void ARMDebuggerNextInstructionInfo(struct mDebuggerPlatform* d, struct m
 
 	// TODO Access types
 }
+
+static void ARMDebuggerSetInstructionHook(struct mDebuggerPlatform* d, struct mInstructionHook* hook) {
+	struct ARMDebugger* debugger = (struct ARMDebugger*) d;
+	debugger->cpu->instructionHook = hook;
+	ARMDebuggerUpdateWatchpoints(debugger);
+}
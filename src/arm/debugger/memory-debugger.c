@@ -8,80 +8,8 @@
 #include <mgba/internal/arm/debugger/debugger.h>
 #include <mgba/internal/debugger/parser.h>
 
-#include <mgba-util/math.h>
-
 #include <string.h>
 
-static void _checkWatchpoints(struct ARMDebugger* debugger, uint32_t address, enum mWatchpointType type, uint32_t newValue, int width);
-
-#define FIND_DEBUGGER(DEBUGGER, CPU) \
-	do { \
-		DEBUGGER = 0; \
-		size_t i; \
-		for (i = 0; i < CPU->numComponents; ++i) { \
-			if (CPU->components[i]->id == DEBUGGER_ID) { \
-				DEBUGGER = (struct ARMDebugger*) ((struct mDebugger*) cpu->components[i])->platform; \
-				goto debuggerFound; \
-			} \
-		} \
-		abort(); \
-		debuggerFound: break; \
-	} while(0)
-
-#define CREATE_SHIM(NAME, RETURN, TYPES, ...) \
-	static RETURN DebuggerShim_ ## NAME TYPES { \
-		struct ARMDebugger* debugger; \
-		FIND_DEBUGGER(debugger, cpu); \
-		return debugger->originalMemory.NAME(cpu, __VA_ARGS__); \
-	}
-
-#define CREATE_WATCHPOINT_READ_SHIM(NAME, WIDTH, RETURN, TYPES, ...) \
-	static RETURN DebuggerShim_ ## NAME TYPES { \
-		struct ARMDebugger* debugger; \
-		FIND_DEBUGGER(debugger, cpu); \
-		_checkWatchpoints(debugger, address, WATCHPOINT_READ, 0, WIDTH); \
-		return debugger->originalMemory.NAME(cpu, __VA_ARGS__); \
-	}
-
-#define CREATE_WATCHPOINT_WRITE_SHIM(NAME, WIDTH, RETURN, TYPES, ...) \
-	static RETURN DebuggerShim_ ## NAME TYPES { \
-		struct ARMDebugger* debugger; \
-		FIND_DEBUGGER(debugger, cpu); \
-		_checkWatchpoints(debugger, address, WATCHPOINT_WRITE, value, WIDTH); \
-		return debugger->originalMemory.NAME(cpu, __VA_ARGS__); \
-	}
-
-#define CREATE_MULTIPLE_WATCHPOINT_SHIM(NAME, ACCESS_TYPE) \
-	static uint32_t DebuggerShim_ ## NAME (struct ARMCore* cpu, uint32_t address, int mask, enum LSMDirection direction, int* cycleCounter) { \
-		struct ARMDebugger* debugger; \
-		FIND_DEBUGGER(debugger, cpu); \
-		uint32_t popcount = popcount32(mask); \
-		int offset = 4; \
-		int base = address; \
-		if (direction & LSM_D) { \
-			offset = -4; \
-			base -= (popcount << 2) - 4; \
-		} \
-		if (direction & LSM_B) { \
-			base += offset; \
-		} \
-		unsigned i; \
-		for (i = 0; i < popcount; ++i) { \
-			_checkWatchpoints(debugger, base + 4 * i, ACCESS_TYPE, 0, 4); \
-		} \
-		return debugger->originalMemory.NAME(cpu, address, mask, direction, cycleCounter); \
-	}
-
-CREATE_WATCHPOINT_READ_SHIM(load32, 4, uint32_t, (struct ARMCore* cpu, uint32_t address, int* cycleCounter), address, cycleCounter)
-CREATE_WATCHPOINT_READ_SHIM(load16, 2, uint32_t, (struct ARMCore* cpu, uint32_t address, int* cycleCounter), address, cycleCounter)
-CREATE_WATCHPOINT_READ_SHIM(load8, 1, uint32_t, (struct ARMCore* cpu, uint32_t address, int* cycleCounter), address, cycleCounter)
-CREATE_WATCHPOINT_WRITE_SHIM(store32, 4, void, (struct ARMCore* cpu, uint32_t address, int32_t value, int* cycleCounter), address, value, cycleCounter)
-CREATE_WATCHPOINT_WRITE_SHIM(store16, 2, void, (struct ARMCore* cpu, uint32_t address, int16_t value, int* cycleCounter), address, value, cycleCounter)
-CREATE_WATCHPOINT_WRITE_SHIM(store8, 1, void, (struct ARMCore* cpu, uint32_t address, int8_t value, int* cycleCounter), address, value, cycleCounter)
-CREATE_MULTIPLE_WATCHPOINT_SHIM(loadMultiple, WATCHPOINT_READ)
-CREATE_MULTIPLE_WATCHPOINT_SHIM(storeMultiple, WATCHPOINT_WRITE)
-CREATE_SHIM(setActiveRegion, void, (struct ARMCore* cpu, uint32_t address), address)
-
 static void _checkWatchpoints(struct ARMDebugger* debugger, uint32_t address, enum mWatchpointType type, uint32_t newValue, int width) {
 	struct mWatchpoint* watchpoint;
 	size_t i;
@@ -101,13 +29,13 @@ static void _checkWatchpoints(struct ARMDebugger* debugger, uint32_t address, en
 			uint32_t oldValue;
 			switch (width) {
 			case 1:
-				oldValue = debugger->originalMemory.load8(debugger->cpu, address, 0);
+				oldValue = debugger->cpu->memory.load8(debugger->cpu, address, 0);
 				break;
 			case 2:
-				oldValue = debugger->originalMemory.load16(debugger->cpu, address, 0);
+				oldValue = debugger->cpu->memory.load16(debugger->cpu, address, 0);
 				break;
 			case 4:
-				oldValue = debugger->originalMemory.load32(debugger->cpu, address, 0);
+				oldValue = debugger->cpu->memory.load32(debugger->cpu, address, 0);
 				break;
 			default:
 				continue;
@@ -131,27 +59,51 @@ static void _checkWatchpoints(struct ARMDebugger* debugger, uint32_t address, en
 	}
 }
 
-void ARMDebuggerInstallMemoryShim(struct ARMDebugger* debugger) {
-	debugger->originalMemory = debugger->cpu->memory;
-	debugger->cpu->memory.store32 = DebuggerShim_store32;
-	debugger->cpu->memory.store16 = DebuggerShim_store16;
-	debugger->cpu->memory.store8 = DebuggerShim_store8;
-	debugger->cpu->memory.load32 = DebuggerShim_load32;
-	debugger->cpu->memory.load16 = DebuggerShim_load16;
-	debugger->cpu->memory.load8 = DebuggerShim_load8;
-	debugger->cpu->memory.storeMultiple = DebuggerShim_storeMultiple;
-	debugger->cpu->memory.loadMultiple = DebuggerShim_loadMultiple;
-	debugger->cpu->memory.setActiveRegion = DebuggerShim_setActiveRegion;
+static void _watchRead(struct mWatchpointPages* pages, uint32_t address, int width) {
+	struct ARMDebugger* debugger = pages->context;
+	// Detach while checking so reading the old value doesn't trip the watchpoint again
+	struct mWatchpointPages* attached = debugger->cpu->watchpointPages;
+	debugger->cpu->watchpointPages = NULL;
+	_checkWatchpoints(debugger, address, WATCHPOINT_READ, 0, width);
+	// Editing watchpoints from the debugger reattaches them itself
+	if (!debugger->cpu->watchpointPages) {
+		debugger->cpu->watchpointPages = attached;
+	}
+}
+
+static void _watchWrite(struct mWatchpointPages* pages, uint32_t address, uint32_t value, int width) {
+	struct ARMDebugger* debugger = pages->context;
+	struct mInstructionHook* hook = debugger->cpu->instructionHook;
+	if (hook && hook->write) {
+		hook->write(hook, address, value, width);
+	}
+	struct mWatchpointPages* attached = debugger->cpu->watchpointPages;
+	debugger->cpu->watchpointPages = NULL;
+	_checkWatchpoints(debugger, address, WATCHPOINT_WRITE, value, width);
+	if (!debugger->cpu->watchpointPages) {
+		debugger->cpu->watchpointPages = attached;
+	}
 }
 
-void ARMDebuggerRemoveMemoryShim(struct ARMDebugger* debugger) {
-	debugger->cpu->memory.store32 = debugger->originalMemory.store32;
-	debugger->cpu->memory.store16 = debugger->originalMemory.store16;
-	debugger->cpu->memory.store8 = debugger->originalMemory.store8;
-	debugger->cpu->memory.load32 = debugger->originalMemory.load32;
-	debugger->cpu->memory.load16 = debugger->originalMemory.load16;
-	debugger->cpu->memory.load8 = debugger->originalMemory.load8;
-	debugger->cpu->memory.storeMultiple = debugger->originalMemory.storeMultiple;
-	debugger->cpu->memory.loadMultiple = debugger->originalMemory.loadMultiple;
-	debugger->cpu->memory.setActiveRegion = debugger->originalMemory.setActiveRegion;
+void ARMDebuggerUpdateWatchpoints(struct ARMDebugger* debugger) {
+	struct mWatchpointPages* pages = &debugger->watchpointPages;
+	mWatchpointPagesClear(pages);
+	pages->read = _watchRead;
+	pages->write = _watchWrite;
+	pages->context = debugger;
+	size_t i;
+	for (i = 0; i < mWatchpointListSize(&debugger->watchpoints); ++i) {
+		struct mWatchpoint* watchpoint = mWatchpointListGetPointer(&debugger->watchpoints, i);
+		mWatchpointPagesMark(pages, watchpoint->minAddress, watchpoint->maxAddress, watchpoint->type & WATCHPOINT_READ, watchpoint->type & WATCHPOINT_WRITE);
+	}
+	// A hook that sees every write needs every page flagged
+	bool hooked = debugger->cpu->instructionHook && debugger->cpu->instructionHook->write;
+	if (hooked) {
+		mWatchpointPagesMark(pages, 0, 0xFFFFFFFF, false, true);
+	}
+	if (mWatchpointListSize(&debugger->watchpoints) || hooked) {
+		debugger->cpu->watchpointPages = pages;
+	} else {
+		debugger->cpu->watchpointPages = NULL;
+	}
 }
@@ -12,28 +12,20 @@
 // Beware pre-processor insanity
 
 #define THUMB_ADDITION_S(M, N, D) \
-	cpu->cpsr.flags = 0; \
-	cpu->cpsr.n = ARM_SIGN(D); \
-	cpu->cpsr.z = !(D); \
-	cpu->cpsr.c = ARM_CARRY_FROM(M, N, D); \
-	cpu->cpsr.v = ARM_V_ADDITION(M, N, D);
+	_ARMSetFlagsAddition(cpu, M, N, D);
 
 #define THUMB_SUBTRACTION_S(M, N, D) \
-	cpu->cpsr.flags = 0; \
-	cpu->cpsr.n = ARM_SIGN(D); \
-	cpu->cpsr.z = !(D); \
-	cpu->cpsr.c = ARM_BORROW_FROM(M, N, D); \
-	cpu->cpsr.v = ARM_V_SUBTRACTION(M, N, D);
+	_ARMSetFlagsSubtraction(cpu, M, N, D);
 
 #define THUMB_SUBTRACTION_CARRY_S(M, N, D, C) \
+	_ARMMaterializeFlags(cpu); \
 	cpu->cpsr.n = ARM_SIGN(D); \
 	cpu->cpsr.z = !(D); \
 	cpu->cpsr.c = ARM_BORROW_FROM_CARRY(M, N, D, C); \
 	cpu->cpsr.v = ARM_V_SUBTRACTION(M, N, D);
 
 #define THUMB_NEUTRAL_S(M, N, D) \
-	cpu->cpsr.n = ARM_SIGN(D); \
-	cpu->cpsr.z = !(D);
+	_ARMSetFlagsNZ(cpu, D);
 
 #define THUMB_ADDITION(D, M, N) \
 	int n = N; \
@@ -73,31 +65,31 @@ DEFINE_IMMEDIATE_5_INSTRUCTION_THUMB(LSL1,
 	if (!immediate) {
 		cpu->gprs[rd] = cpu->gprs[rm];
 	} else {
-		cpu->cpsr.c = (cpu->gprs[rm] >> (32 - immediate)) & 1;
+		_ARMSetCarry(cpu, (cpu->gprs[rm] >> (32 - immediate)) & 1);
 		cpu->gprs[rd] = cpu->gprs[rm] << immediate;
 	}
 	THUMB_NEUTRAL_S( , , cpu->gprs[rd]);)
 
 DEFINE_IMMEDIATE_5_INSTRUCTION_THUMB(LSR1,
 	if (!immediate) {
-		cpu->cpsr.c = ARM_SIGN(cpu->gprs[rm]);
+		_ARMSetCarry(cpu, ARM_SIGN(cpu->gprs[rm]));
 		cpu->gprs[rd] = 0;
 	} else {
-		cpu->cpsr.c = (cpu->gprs[rm] >> (immediate - 1)) & 1;
+		_ARMSetCarry(cpu, (cpu->gprs[rm] >> (immediate - 1)) & 1);
 		cpu->gprs[rd] = ((uint32_t) cpu->gprs[rm]) >> immediate;
 	}
 	THUMB_NEUTRAL_S( , , cpu->gprs[rd]);)
 
 DEFINE_IMMEDIATE_5_INSTRUCTION_THUMB(ASR1, 
 	if (!immediate) {
-		cpu->cpsr.c = ARM_SIGN(cpu->gprs[rm]);
-		if (cpu->cpsr.c) {
+		_ARMSetCarry(cpu, ARM_SIGN(cpu->gprs[rm]));
+		if (ARM_SIGN(cpu->gprs[rm])) {
 			cpu->gprs[rd] = 0xFFFFFFFF;
 		} else {
 			cpu->gprs[rd] = 0;
 		}
 	} else {
-		cpu->cpsr.c = (cpu->gprs[rm] >> (immediate - 1)) & 1;
+		_ARMSetCarry(cpu, (cpu->gprs[rm] >> (immediate - 1)) & 1);
 		cpu->gprs[rd] = cpu->gprs[rm] >> immediate;
 	}
 	THUMB_NEUTRAL_S( , , cpu->gprs[rd]);)
@@ -152,13 +144,13 @@ DEFINE_DATA_FORM_5_INSTRUCTION_THUMB(LSL2,
 	int rs = cpu->gprs[rn] & 0xFF;
 	if (rs) {
 		if (rs < 32) {
-			cpu->cpsr.c = (cpu->gprs[rd] >> (32 - rs)) & 1;
+			_ARMSetCarry(cpu, (cpu->gprs[rd] >> (32 - rs)) & 1);
 			cpu->gprs[rd] <<= rs;
 		} else {
 			if (rs > 32) {
-				cpu->cpsr.c = 0;
+				_ARMSetCarry(cpu, 0);
 			} else {
-				cpu->cpsr.c = cpu->gprs[rd] & 0x00000001;
+				_ARMSetCarry(cpu, cpu->gprs[rd] & 0x00000001);
 			}
 			cpu->gprs[rd] = 0;
 		}
@@ -170,13 +162,13 @@ DEFINE_DATA_FORM_5_INSTRUCTION_THUMB(LSR2,
 	int rs = cpu->gprs[rn] & 0xFF;
 	if (rs) {
 		if (rs < 32) {
-			cpu->cpsr.c = (cpu->gprs[rd] >> (rs - 1)) & 1;
+			_ARMSetCarry(cpu, (cpu->gprs[rd] >> (rs - 1)) & 1);
 			cpu->gprs[rd] = (uint32_t) cpu->gprs[rd] >> rs;
 		} else {
 			if (rs > 32) {
-				cpu->cpsr.c = 0;
+				_ARMSetCarry(cpu, 0);
 			} else {
-				cpu->cpsr.c = ARM_SIGN(cpu->gprs[rd]);
+				_ARMSetCarry(cpu, ARM_SIGN(cpu->gprs[rd]));
 			}
 			cpu->gprs[rd] = 0;
 		}
@@ -188,11 +180,11 @@ DEFINE_DATA_FORM_5_INSTRUCTION_THUMB(ASR2,
 	int rs = cpu->gprs[rn] & 0xFF;
 	if (rs) {
 		if (rs < 32) {
-			cpu->cpsr.c = (cpu->gprs[rd] >> (rs - 1)) & 1;
+			_ARMSetCarry(cpu, (cpu->gprs[rd] >> (rs - 1)) & 1);
 			cpu->gprs[rd] >>= rs;
 		} else {
-			cpu->cpsr.c = ARM_SIGN(cpu->gprs[rd]);
-			if (cpu->cpsr.c) {
+			_ARMSetCarry(cpu, ARM_SIGN(cpu->gprs[rd]));
+			if (ARM_SIGN(cpu->gprs[rd])) {
 				cpu->gprs[rd] = 0xFFFFFFFF;
 			} else {
 				cpu->gprs[rd] = 0;
@@ -205,24 +197,25 @@ DEFINE_DATA_FORM_5_INSTRUCTION_THUMB(ASR2,
 DEFINE_DATA_FORM_5_INSTRUCTION_THUMB(ADC,
 	int n = cpu->gprs[rn];
 	int d = cpu->gprs[rd];
-	cpu->gprs[rd] = d + n + cpu->cpsr.c;
+	cpu->gprs[rd] = d + n + _ARMCarry(cpu);
 	THUMB_ADDITION_S(d, n, cpu->gprs[rd]);)
 
 DEFINE_DATA_FORM_5_INSTRUCTION_THUMB(SBC,
 	int n = cpu->gprs[rn];
 	int d = cpu->gprs[rd];
-	cpu->gprs[rd] = d - n - !cpu->cpsr.c;
-	THUMB_SUBTRACTION_CARRY_S(d, n, cpu->gprs[rd], !cpu->cpsr.c);)
+	int carry = _ARMCarry(cpu);
+	cpu->gprs[rd] = d - n - !carry;
+	THUMB_SUBTRACTION_CARRY_S(d, n, cpu->gprs[rd], !carry);)
 
 DEFINE_DATA_FORM_5_INSTRUCTION_THUMB(ROR,
 	int rs = cpu->gprs[rn] & 0xFF;
 	if (rs) {
 		int r4 = rs & 0x1F;
 		if (r4 > 0) {
-			cpu->cpsr.c = (cpu->gprs[rd] >> (r4 - 1)) & 1;
+			_ARMSetCarry(cpu, (cpu->gprs[rd] >> (r4 - 1)) & 1);
 			cpu->gprs[rd] = ROR(cpu->gprs[rd], r4);
 		} else {
-			cpu->cpsr.c = ARM_SIGN(cpu->gprs[rd]);
+			_ARMSetCarry(cpu, ARM_SIGN(cpu->gprs[rd]));
 		}
 	}
 	++currentCycles;
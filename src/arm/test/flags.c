@@ -0,0 +1,128 @@
+/* Copyright (c) 2013-2024 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "util/test/suite.h"
+
+#include <mgba/core/core.h>
+#include <mgba/gba/core.h>
+#include <mgba/internal/arm/isa-inlines.h>
+#include <mgba/internal/gba/gba.h>
+#include <mgba/internal/gba/memory.h>
+#include <mgba-util/vfs.h>
+
+#define FLAGS(CPSR) ((CPSR) & 0xF0000000)
+#define FLAG_N 0x80000000
+#define FLAG_Z 0x40000000
+#define FLAG_C 0x20000000
+#define FLAG_V 0x10000000
+
+static const uint32_t _interworkingArm[] = {
+	0xE3E00000, // $00: mvn r0, #0
+	0xE2901002, // $04: adds r1, r0, #2
+	0xE28F2001, // $08: add r2, pc, #1
+	0xE12FFF12, // $0C: bx r2
+};
+
+static const uint16_t _interworkingThumb[] = {
+	0x2300, // $10: movs r3, #0
+	0x415B, // $12: adcs r3, r3
+	0x0044, // $14: lsls r4, r0, #1
+	0x2500, // $16: movs r5, #0
+	0x416D, // $18: adcs r5, r5
+	0x2600, // $1A: movs r6, #0
+	0x41B6, // $1C: sbcs r6, r6
+	0xE7FE, // $1E: b $1E
+};
+
+static const uint32_t _privilege[] = {
+	0xE3A00005, // $00: mov r0, #5
+	0xE0500000, // $04: subs r0, r0, r0
+	0xE321F0D2, // $08: msr cpsr_c, #0xD2
+	0xE2A02000, // $0C: adc r2, r0, #0
+	0xE10F3000, // $10: mrs r3, cpsr
+	0xE361F01F, // $14: msr spsr_c, #0x1F
+	0xE368F102, // $18: msr spsr_f, #0x80000000
+	0xE0907000, // $1C: adds r7, r0, r0
+	0xE10F9000, // $20: mrs r9, cpsr
+	0xE28FE004, // $24: add lr, pc, #4
+	0xE3770000, // $28: cmn r7, #0
+	0xE1B0F00E, // $2C: movs pc, lr
+	0xE10F4000, // $30: mrs r4, cpsr
+	0xE2D05000, // $34: sbcs r5, r0, #0
+	0xE1B06065, // $38: movs r6, r5, rrx
+	0xE10F8000, // $3C: mrs r8, cpsr
+	0xEAFFFFFE, // $40: b $40
+};
+
+static struct mCore* _runProgram(struct VFile* vf, uint32_t end) {
+	struct mCore* core = GBACoreCreate();
+	core->init(core);
+	mCoreInitConfig(core, NULL);
+	core->loadROM(core, vf);
+	core->reset(core);
+
+	// Stopping at a PC would materialize the flags after every instruction, so
+	// run for long enough to reach the final loop instead
+	core->runCycles(core, 2000);
+	struct ARMCore* cpu = core->cpu;
+	assert_int_equal(cpu->gprs[ARM_PC] - _ARMInstructionLength(cpu), GBA_BASE_ROM0 + end);
+	return core;
+}
+
+static void _destroyCore(struct mCore* core) {
+	mCoreConfigDeinit(&core->config);
+	core->deinit(core);
+}
+
+M_TEST_DEFINE(interworking) {
+	struct VFile* vf = VFileMemChunk(NULL, 0x1000);
+	vf->write(vf, _interworkingArm, sizeof(_interworkingArm));
+	vf->write(vf, _interworkingThumb, sizeof(_interworkingThumb));
+	struct mCore* core = _runProgram(vf, 0x1E);
+	struct ARMCore* cpu = ((struct GBA*) core->board)->cpu;
+
+	// The carry from the ARM adds survives the switch to Thumb and a movs
+	assert_int_equal(cpu->gprs[1], 1);
+	assert_int_equal(cpu->gprs[3], 1);
+	// A shift replaces the carry of the adcs before it
+	assert_int_equal(cpu->gprs[4], -2);
+	assert_int_equal(cpu->gprs[5], 1);
+	// Which in turn clears it, so the sbcs borrows
+	assert_int_equal(cpu->gprs[6], -1);
+
+	assert_int_equal(cpu->executionMode, MODE_THUMB);
+	assert_true(cpu->cpsr.t);
+	assert_int_equal(FLAGS(cpu->cpsr.packed), FLAG_N);
+	_destroyCore(core);
+}
+
+M_TEST_DEFINE(privilegeSwitch) {
+	struct VFile* vf = VFileMemChunk(NULL, 0x1000);
+	vf->write(vf, _privilege, sizeof(_privilege));
+	struct mCore* core = _runProgram(vf, 0x40);
+	struct ARMCore* cpu = ((struct GBA*) core->board)->cpu;
+
+	// Writing only the control field keeps the flags from the subs
+	assert_int_equal(cpu->gprs[2], 1);
+	assert_int_equal(FLAGS(cpu->gprs[3]), FLAG_Z | FLAG_C);
+	assert_int_equal(cpu->gprs[3] & 0x1F, MODE_IRQ);
+	// The adds hasn't been written back when mrs reads it
+	assert_int_equal(FLAGS(cpu->gprs[9]), FLAG_Z);
+
+	// Returning restores the flags from the SPSR, not the pending ones from the cmn
+	assert_int_equal(FLAGS(cpu->gprs[4]), FLAG_N);
+	assert_int_equal(cpu->gprs[4] & 0x1F, MODE_SYSTEM);
+	assert_int_equal(cpu->gprs[5], -1);
+
+	// The rrx shifts the clear carry in and a set bit out
+	assert_int_equal(cpu->gprs[6], 0x7FFFFFFF);
+	assert_int_equal(FLAGS(cpu->gprs[8]), FLAG_C);
+	assert_int_equal(cpu->cpsr.packed, cpu->gprs[8]);
+	_destroyCore(core);
+}
+
+M_TEST_SUITE_DEFINE(ARMFlags,
+	cmocka_unit_test(interworking),
+	cmocka_unit_test(privilegeSwitch))
@@ -72,6 +72,13 @@ void mCacheSetWriteVRAM(struct mCacheSet* cache, uint32_t address) {
 	}
 }
 
+void mCacheSetWriteVRAMRange(struct mCacheSet* cache, uint32_t address, uint32_t size) {
+	uint32_t end = address + size;
+	for (address &= ~1; address < end; address += 2) {
+		mCacheSetWriteVRAM(cache, address);
+	}
+}
+
 void mCacheSetWritePalette(struct mCacheSet* cache, uint32_t entry, color_t color) {
 	size_t i;
 	for (i = 0; i < mBitmapCacheSetSize(&cache->bitmaps); ++i) {
@@ -8,6 +8,8 @@
 #include <mgba/core/cheats.h>
 #include <mgba/core/log.h>
 #include <mgba/core/serialize.h>
+#include <mgba/core/video-filter.h>
+#include <mgba-util/memory.h>
 #include <mgba-util/vfs.h>
 #include <mgba/internal/debugger/symbols.h>
 
@@ -358,12 +360,20 @@ void mCoreTakeScreenshot(struct mCore* core) {
 #endif
 
 bool mCoreTakeScreenshotVF(struct mCore* core, struct VFile* vf) {
+	return mCoreTakeScreenshotFilteredVF(core, vf, NULL);
+}
+
+bool mCoreTakeScreenshotFilteredVF(struct mCore* core, struct VFile* vf, struct mVideoFilter* filter) {
 #ifdef USE_PNG
 	size_t stride;
 	const void* pixels = 0;
 	unsigned width, height;
 	core->currentVideoSize(core, &width, &height);
 	core->getPixels(core, &pixels, &stride);
+	if (filter) {
+		pixels = mVideoFilterApply(filter, pixels, stride, width, height, &stride);
+		mVideoFilterOutputSize(filter, width, height, &width, &height);
+	}
 	png_structp png = PNGWriteOpen(vf);
 	png_infop info = PNGWriteHeader(png, width, height, mCOLOR_NATIVE);
 	bool success = PNGWritePixels(png, width, height, stride, pixels, mCOLOR_NATIVE);
@@ -372,6 +382,7 @@ bool mCoreTakeScreenshotVF(struct mCore* core, struct VFile* vf) {
 #else
 	UNUSED(core);
 	UNUSED(vf);
+	UNUSED(filter);
 	return false;
 #endif
 }
@@ -442,6 +453,55 @@ const struct mCoreMemoryBlock* mCoreGetMemoryBlockInfo(struct mCore* core, uint3
 	return NULL;
 }
 
+size_t mCoreBindMemoryLocal(struct mCore* core) {
+	const struct mCoreMemoryBlock* blocks;
+	size_t nBlocks = core->listMemoryBlocks(core, &blocks);
+	size_t bound = 0;
+	size_t i;
+	for (i = 0; i < nBlocks; ++i) {
+		if (blocks[i].flags & mCORE_MEMORY_VIRTUAL) {
+			continue;
+		}
+		size_t size = 0;
+		void* memory = core->getMemoryBlock(core, blocks[i].id, &size);
+		if (memory && size && mappedMemoryBindLocal(memory, size)) {
+			bound += size;
+		}
+	}
+	return bound;
+}
+
+void mCoreMemoryUsageAdd(struct mCoreMemoryUsage* usage, enum mCoreMemoryUsageType type, const void* memory, size_t size, bool shared) {
+	if (!memory || !size || type < 0 || type >= mCORE_MEMORY_USAGE_MAX) {
+		return;
+	}
+	usage->allocated[type] += size;
+	if (shared) {
+		usage->shared[type] += size;
+	} else {
+		usage->resident[type] += mappedMemoryResident(memory, size);
+	}
+}
+
+const char* mCoreMemoryUsageName(enum mCoreMemoryUsageType type) {
+	switch (type) {
+	case mCORE_MEMORY_USAGE_SYSTEM:
+		return "system";
+	case mCORE_MEMORY_USAGE_RAM:
+		return "ram";
+	case mCORE_MEMORY_USAGE_ROM:
+		return "rom";
+	case mCORE_MEMORY_USAGE_SAVEDATA:
+		return "savedata";
+	case mCORE_MEMORY_USAGE_VIDEO:
+		return "video";
+	case mCORE_MEMORY_USAGE_AUDIO:
+		return "audio";
+	default:
+		return NULL;
+	}
+}
+
 #ifdef USE_ELF
 bool mCoreLoadELF(struct mCore* core, struct ELF* elf) {
 	struct ELFProgramHeaders ph;
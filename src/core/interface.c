@@ -10,6 +10,30 @@
 
 DEFINE_VECTOR(mCoreCallbacksList, struct mCoreCallbacks);
 
+static const char* const _accuracyNames[] = {
+	[mCORE_ACCURACY_ACCURATE] = "accurate",
+	[mCORE_ACCURACY_RELAXED] = "relaxed",
+	[mCORE_ACCURACY_FAST] = "fast",
+};
+
+bool mCoreAccuracyParse(const char* name, enum mCoreAccuracy* accuracy) {
+	size_t i;
+	for (i = 0; i < sizeof(_accuracyNames) / sizeof(*_accuracyNames); ++i) {
+		if (strcasecmp(name, _accuracyNames[i]) == 0) {
+			*accuracy = i;
+			return true;
+		}
+	}
+	return false;
+}
+
+const char* mCoreAccuracyName(enum mCoreAccuracy accuracy) {
+	if ((size_t) accuracy >= sizeof(_accuracyNames) / sizeof(*_accuracyNames)) {
+		return NULL;
+	}
+	return _accuracyNames[accuracy];
+}
+
 static void _rtcGenericSample(struct mRTCSource* source) {
 	struct mRTCGenericSource* rtc = (struct mRTCGenericSource*) source;
 	switch (rtc->override) {
@@ -0,0 +1,198 @@
+/* Copyright (c) 2013-2024 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include <mgba/core/mem-diff.h>
+
+#include <mgba/core/core.h>
+
+// Regions are compared in chunks large enough for memcmp to use its vectorized
+// path, and only chunks that differ are walked byte-by-byte
+#define DIFF_CHUNK_SIZE 256
+
+DEFINE_VECTOR(mCoreMemoryChanges, struct mCoreMemoryChange);
+DEFINE_VECTOR(mCoreMemoryDiffRegions, struct mCoreMemoryDiffRegion);
+
+void mCoreMemoryDiffInit(struct mCoreMemoryDiff* diff, struct mCore* core) {
+	diff->core = core;
+	mCoreMemoryDiffRegionsInit(&diff->regions, 0);
+	mCoreMemoryChangesInit(&diff->changes, 0);
+}
+
+void mCoreMemoryDiffDeinit(struct mCoreMemoryDiff* diff) {
+	mCoreMemoryDiffClear(diff);
+	mCoreMemoryDiffRegionsDeinit(&diff->regions);
+	mCoreMemoryChangesDeinit(&diff->changes);
+}
+
+bool mCoreMemoryDiffAddBlock(struct mCoreMemoryDiff* diff, size_t blockId) {
+	const struct mCoreMemoryBlock* blocks;
+	size_t nBlocks = diff->core->listMemoryBlocks(diff->core, &blocks);
+	size_t i;
+	for (i = 0; i < mCoreMemoryDiffRegionsSize(&diff->regions); ++i) {
+		if (mCoreMemoryDiffRegionsGetPointer(&diff->regions, i)->block.id == blockId) {
+			return true;
+		}
+	}
+	for (i = 0; i < nBlocks; ++i) {
+		if (blocks[i].id != blockId) {
+			continue;
+		}
+		struct mCoreMemoryDiffRegion* region = mCoreMemoryDiffRegionsAppend(&diff->regions);
+		region->block = blocks[i];
+		region->snapshot = NULL;
+		region->size = 0;
+		return true;
+	}
+	return false;
+}
+
+size_t mCoreMemoryDiffAddBlocks(struct mCoreMemoryDiff* diff, int memoryFlags) {
+	const struct mCoreMemoryBlock* blocks;
+	size_t nBlocks = diff->core->listMemoryBlocks(diff->core, &blocks);
+	size_t added = 0;
+	size_t i;
+	for (i = 0; i < nBlocks; ++i) {
+		if (blocks[i].flags & mCORE_MEMORY_VIRTUAL) {
+			continue;
+		}
+		if (!(blocks[i].flags & memoryFlags)) {
+			continue;
+		}
+		if (mCoreMemoryDiffAddBlock(diff, blocks[i].id)) {
+			++added;
+		}
+	}
+	return added;
+}
+
+void mCoreMemoryDiffClear(struct mCoreMemoryDiff* diff) {
+	size_t i;
+	for (i = 0; i < mCoreMemoryDiffRegionsSize(&diff->regions); ++i) {
+		free(mCoreMemoryDiffRegionsGetPointer(&diff->regions, i)->snapshot);
+	}
+	mCoreMemoryDiffRegionsClear(&diff->regions);
+	mCoreMemoryChangesClear(&diff->changes);
+}
+
+static const uint8_t* _takeSnapshot(struct mCoreMemoryDiff* diff, struct mCoreMemoryDiffRegion* region, bool* fresh) {
+	size_t size = 0;
+	const uint8_t* mem = diff->core->getMemoryBlock(diff->core, region->block.id, &size);
+	if (!mem || !size) {
+		free(region->snapshot);
+		region->snapshot = NULL;
+		region->size = 0;
+		*fresh = true;
+		return NULL;
+	}
+	if (!region->snapshot || region->size != size) {
+		free(region->snapshot);
+		region->snapshot = malloc(size);
+		region->size = size;
+		memcpy(region->snapshot, mem, size);
+		*fresh = true;
+		return mem;
+	}
+	*fresh = false;
+	return mem;
+}
+
+static void _addChange(struct mCoreMemoryDiff* diff, const struct mCoreMemoryDiffRegion* region, uint32_t offset, uint32_t length) {
+	const struct mCoreMemoryBlock* block = &region->block;
+	uint32_t segmentSize = block->end - block->start;
+	uint32_t segmentStart = block->segmentStart - block->start;
+	if (block->segmentStart) {
+		segmentSize -= segmentStart;
+	}
+	while (length) {
+		struct mCoreMemoryChange* change = mCoreMemoryChangesAppend(&diff->changes);
+		change->blockId = block->id;
+		change->offset = offset;
+		change->length = length;
+		if (!block->maxSegment || !segmentSize) {
+			change->address = block->start + offset;
+			change->segment = -1;
+			return;
+		}
+
+		// Split runs that straddle a bank boundary so each change has one segment
+		uint32_t segmentOffset = offset % segmentSize;
+		change->segment = offset / segmentSize;
+		change->address = block->start + segmentOffset;
+		if (block->segmentStart && change->segment) {
+			change->address += segmentStart;
+		}
+		if (segmentOffset + length > segmentSize) {
+			change->length = segmentSize - segmentOffset;
+		}
+		offset += change->length;
+		length -= change->length;
+	}
+}
+
+static void _diffRegion(struct mCoreMemoryDiff* diff, struct mCoreMemoryDiffRegion* region, const uint8_t* mem) {
+	uint8_t* snapshot = region->snapshot;
+	size_t size = region->size;
+	size_t runStart = 0;
+	size_t runEnd = 0;
+	bool inRun = false;
+	size_t chunk;
+	for (chunk = 0; chunk < size; chunk += DIFF_CHUNK_SIZE) {
+		size_t chunkSize = size - chunk;
+		if (chunkSize > DIFF_CHUNK_SIZE) {
+			chunkSize = DIFF_CHUNK_SIZE;
+		}
+		if (memcmp(&mem[chunk], &snapshot[chunk], chunkSize) == 0) {
+			continue;
+		}
+		size_t i;
+		for (i = chunk; i < chunk + chunkSize; ++i) {
+			if (mem[i] == snapshot[i]) {
+				continue;
+			}
+			if (inRun && runEnd == i) {
+				++runEnd;
+				continue;
+			}
+			if (inRun) {
+				_addChange(diff, region, runStart, runEnd - runStart);
+			}
+			inRun = true;
+			runStart = i;
+			runEnd = i + 1;
+		}
+		memcpy(&snapshot[chunk], &mem[chunk], chunkSize);
+	}
+	if (inRun) {
+		_addChange(diff, region, runStart, runEnd - runStart);
+	}
+}
+
+void mCoreMemoryDiffSnapshot(struct mCoreMemoryDiff* diff) {
+	size_t i;
+	for (i = 0; i < mCoreMemoryDiffRegionsSize(&diff->regions); ++i) {
+		struct mCoreMemoryDiffRegion* region = mCoreMemoryDiffRegionsGetPointer(&diff->regions, i);
+		bool fresh;
+		const uint8_t* mem = _takeSnapshot(diff, region, &fresh);
+		if (mem && !fresh) {
+			memcpy(region->snapshot, mem, region->size);
+		}
+	}
+	mCoreMemoryChangesClear(&diff->changes);
+}
+
+size_t mCoreMemoryDiffUpdate(struct mCoreMemoryDiff* diff) {
+	mCoreMemoryChangesClear(&diff->changes);
+	size_t i;
+	for (i = 0; i < mCoreMemoryDiffRegionsSize(&diff->regions); ++i) {
+		struct mCoreMemoryDiffRegion* region = mCoreMemoryDiffRegionsGetPointer(&diff->regions, i);
+		bool fresh;
+		const uint8_t* mem = _takeSnapshot(diff, region, &fresh);
+		if (!mem || fresh) {
+			continue;
+		}
+		_diffRegion(diff, region, mem);
+	}
+	return mCoreMemoryChangesSize(&diff->changes);
+}
@@ -7,8 +7,211 @@
 
 #include <mgba/core/core.h>
 #include <mgba/core/interface.h>
+#include <mgba-util/text-codec.h>
+
+#define MAX_PREFIXES 16
 
 DEFINE_VECTOR(mCoreMemorySearchResults, struct mCoreMemorySearchResult);
+DEFINE_VECTOR(mCoreTextSearchPatterns, struct mCoreTextSearchPattern);
+
+struct mCoreTextSearchEncoder {
+	const struct TextCodec* codec;
+	const uint8_t* string;
+	size_t length;
+	bool* encodable;
+	uint32_t index;
+	size_t found;
+	uint8_t buffer[mCORE_TEXT_SEARCH_MAX_LENGTH];
+	struct UInt8List bytes;
+	struct UInt32List lengths;
+	struct UInt32List owners;
+};
+
+static void _encodeText(struct mCoreTextSearchEncoder* encoder, size_t offset, size_t outputLength) {
+	if (encoder->found >= mCORE_TEXT_SEARCH_MAX_ENCODINGS) {
+		return;
+	}
+	if (offset == encoder->length) {
+		size_t start = UInt8ListSize(&encoder->bytes);
+		UInt8ListResize(&encoder->bytes, outputLength);
+		memcpy(UInt8ListGetPointer(&encoder->bytes, start), encoder->buffer, outputLength);
+		*UInt32ListAppend(&encoder->lengths) = outputLength;
+		*UInt32ListAppend(&encoder->owners) = encoder->index;
+		++encoder->found;
+		return;
+	}
+	struct TextCodecMatch matches[MAX_PREFIXES];
+	size_t nMatches = TextCodecMatchPrefixes(encoder->codec, true, &encoder->string[offset], encoder->length - offset, matches, MAX_PREFIXES);
+	// Longest entries first, so the encoding a game most likely uses is never cut off by the limit
+	while (nMatches--) {
+		const struct TextCodecMatch* match = &matches[nMatches];
+		if (!encoder->encodable[offset + match->consumed] || outputLength + match->outputLength > mCORE_TEXT_SEARCH_MAX_LENGTH) {
+			continue;
+		}
+		memcpy(&encoder->buffer[outputLength], match->output, match->outputLength);
+		_encodeText(encoder, offset + match->consumed, outputLength + match->outputLength);
+	}
+}
+
+static bool _encodeString(struct mCoreTextSearchEncoder* encoder, const char* string, uint32_t index) {
+	encoder->string = (const uint8_t*) string;
+	encoder->length = strlen(string);
+	encoder->index = index;
+	encoder->found = 0;
+	if (!encoder->length) {
+		return false;
+	}
+
+	// Mark which suffixes can be encoded at all, so the search never walks into a dead end
+	encoder->encodable = calloc(encoder->length + 1, sizeof(bool));
+	encoder->encodable[encoder->length] = true;
+	size_t offset = encoder->length;
+	while (offset--) {
+		struct TextCodecMatch matches[MAX_PREFIXES];
+		size_t nMatches = TextCodecMatchPrefixes(encoder->codec, true, &encoder->string[offset], encoder->length - offset, matches, MAX_PREFIXES);
+		size_t i;
+		for (i = 0; i < nMatches && !encoder->encodable[offset]; ++i) {
+			encoder->encodable[offset] = encoder->encodable[offset + matches[i].consumed];
+		}
+	}
+	if (encoder->encodable[0]) {
+		_encodeText(encoder, 0, 0);
+	}
+	free(encoder->encodable);
+	return encoder->found > 0;
+}
+
+static uint32_t _addTextState(struct mCoreTextSearch* search) {
+	size_t start = UInt32ListSize(&search->transitions);
+	UInt32ListResize(&search->transitions, search->nClasses);
+	memset(UInt32ListGetPointer(&search->transitions, start), 0, search->nClasses * sizeof(uint32_t));
+	*SInt32ListAppend(&search->outputs) = -1;
+	*SInt32ListAppend(&search->suffixes) = -1;
+	return search->nStates++;
+}
+
+static void _linkTextStates(struct mCoreTextSearch* search) {
+	uint32_t* transitions = UInt32ListGetPointer(&search->transitions, 0);
+	int32_t* outputs = SInt32ListGetPointer(&search->outputs, 0);
+	int32_t* suffixes = SInt32ListGetPointer(&search->suffixes, 0);
+	uint32_t* fallbacks = calloc(search->nStates, sizeof(uint32_t));
+	uint32_t* queue = malloc(search->nStates * sizeof(uint32_t));
+	size_t head = 0;
+	size_t tail = 0;
+	size_t c;
+
+	for (c = 1; c < search->nClasses; ++c) {
+		if (transitions[c]) {
+			queue[tail] = transitions[c];
+			++tail;
+		}
+	}
+	// Breadth-first, so each fallback's row is complete before anything deeper uses it
+	while (head < tail) {
+		uint32_t state = queue[head];
+		++head;
+		uint32_t* row = &transitions[state * search->nClasses];
+		const uint32_t* fallbackRow = &transitions[fallbacks[state] * search->nClasses];
+		for (c = 1; c < search->nClasses; ++c) {
+			uint32_t next = row[c];
+			if (!next) {
+				row[c] = fallbackRow[c];
+				continue;
+			}
+			uint32_t fallback = fallbackRow[c];
+			fallbacks[next] = fallback;
+			suffixes[next] = outputs[fallback] >= 0 ? (int32_t) fallback : suffixes[fallback];
+			queue[tail] = next;
+			++tail;
+		}
+	}
+	free(queue);
+	free(fallbacks);
+}
+
+bool mCoreTextSearchInit(struct mCoreTextSearch* search, const struct TextCodec* codec, const char* const* strings, size_t nStrings) {
+	memset(search->classes, 0, sizeof(search->classes));
+	search->nClasses = 1;
+	search->nStates = 0;
+	UInt32ListInit(&search->transitions, 0);
+	SInt32ListInit(&search->outputs, 0);
+	SInt32ListInit(&search->suffixes, 0);
+	mCoreTextSearchPatternsInit(&search->patterns, 0);
+	if (!codec->reverseRoot) {
+		return false;
+	}
+
+	struct mCoreTextSearchEncoder encoder = {
+		.codec = codec
+	};
+	UInt8ListInit(&encoder.bytes, 0);
+	UInt32ListInit(&encoder.lengths, 0);
+	UInt32ListInit(&encoder.owners, 0);
+
+	bool success = true;
+	size_t i;
+	for (i = 0; i < nStrings && success; ++i) {
+		success = _encodeString(&encoder, strings[i], i);
+	}
+
+	if (success) {
+		// Bytes that appear in no pattern share class 0, which always leads back to the root
+		for (i = 0; i < UInt8ListSize(&encoder.bytes); ++i) {
+			uint8_t byte = *UInt8ListGetPointer(&encoder.bytes, i);
+			if (!search->classes[byte]) {
+				search->classes[byte] = search->nClasses;
+				++search->nClasses;
+			}
+		}
+
+		_addTextState(search);
+		const uint8_t* bytes = UInt8ListGetPointer(&encoder.bytes, 0);
+		for (i = 0; i < UInt32ListSize(&encoder.lengths); ++i) {
+			uint32_t length = *UInt32ListGetPointer(&encoder.lengths, i);
+			uint32_t owner = *UInt32ListGetPointer(&encoder.owners, i);
+			uint32_t state = 0;
+			uint32_t j;
+			for (j = 0; j < length; ++j) {
+				size_t edge = state * search->nClasses + search->classes[bytes[j]];
+				uint32_t next = *UInt32ListGetPointer(&search->transitions, edge);
+				if (!next) {
+					next = _addTextState(search);
+					*UInt32ListGetPointer(&search->transitions, edge) = next;
+				}
+				state = next;
+			}
+			bytes += length;
+
+			int32_t* output = SInt32ListGetPointer(&search->outputs, state);
+			int32_t pattern;
+			for (pattern = *output; pattern >= 0; pattern = mCoreTextSearchPatternsGetPointer(&search->patterns, pattern)->next) {
+				if (mCoreTextSearchPatternsGetPointer(&search->patterns, pattern)->string == owner) {
+					break;
+				}
+			}
+			if (pattern < 0) {
+				struct mCoreTextSearchPattern* newPattern = mCoreTextSearchPatternsAppend(&search->patterns);
+				newPattern->string = owner;
+				newPattern->length = length;
+				newPattern->next = *output;
+				*output = mCoreTextSearchPatternsSize(&search->patterns) - 1;
+			}
+		}
+		_linkTextStates(search);
+	}
+
+	UInt8ListDeinit(&encoder.bytes);
+	UInt32ListDeinit(&encoder.lengths);
+	UInt32ListDeinit(&encoder.owners);
+	return success;
+}
+
+void mCoreTextSearchDeinit(struct mCoreTextSearch* search) {
+	UInt32ListDeinit(&search->transitions);
+	SInt32ListDeinit(&search->outputs);
+	SInt32ListDeinit(&search->suffixes);
+	mCoreTextSearchPatternsDeinit(&search->patterns);
+}
 
 static bool _op(int32_t value, int32_t match, enum mCoreMemorySearchOp op) {
 	switch (op) {
@@ -213,6 +416,68 @@ static size_t _searchGuess(const void* mem, size_t size, const struct mCoreMemor
 	return found;
 }
 
+static void _blockAddress(const struct mCoreMemoryBlock* block, size_t offset, uint32_t* address, int* segment) {
+	uint32_t segmentStart = block->segmentStart ? block->segmentStart : block->start;
+	uint32_t fixed = segmentStart - block->start;
+	uint32_t bankSize = block->end - segmentStart;
+	if (!block->maxSegment || !bankSize || offset < fixed) {
+		*address = block->start + offset;
+		*segment = -1;
+		return;
+	}
+	*address = segmentStart + (offset - fixed) % bankSize;
+	*segment = offset / bankSize;
+}
+
+static size_t _searchText(const void* mem, size_t size, const struct mCoreMemoryBlock* block, const struct mCoreTextSearch* search, struct mCoreMemorySearchResults* out, size_t limit) {
+	const uint8_t* mem8 = mem;
+	const uint32_t* transitions = UInt32ListGetConstPointer(&search->transitions, 0);
+	const int32_t* outputs = SInt32ListGetConstPointer(&search->outputs, 0);
+	const int32_t* suffixes = SInt32ListGetConstPointer(&search->suffixes, 0);
+	size_t nClasses = search->nClasses;
+	size_t found = 0;
+	uint32_t state = 0;
+	size_t i;
+	for (i = 0; (!limit || found < limit) && i < size; ++i) {
+		state = transitions[state * nClasses + search->classes[mem8[i]]];
+		int32_t match = outputs[state] >= 0 ? (int32_t) state : suffixes[state];
+		for (; match >= 0; match = suffixes[match]) {
+			int32_t p;
+			for (p = outputs[match]; p >= 0 && (!limit || found < limit);) {
+				const struct mCoreTextSearchPattern* pattern = mCoreTextSearchPatternsGetConstPointer(&search->patterns, p);
+				struct mCoreMemorySearchResult* res = mCoreMemorySearchResultsAppend(out);
+				_blockAddress(block, i + 1 - pattern->length, &res->address, &res->segment);
+				res->type = mCORE_MEMORY_SEARCH_TEXT;
+				res->width = pattern->length;
+				res->guessDivisor = 1;
+				res->guessMultiplier = 1;
+				res->oldValue = pattern->string;
+				++found;
+				p = pattern->next;
+			}
+		}
+	}
+	return found;
+}
+
+static bool _testText(struct mCore* core, const struct mCoreMemorySearchResult* res, const struct mCoreTextSearch* search) {
+	uint32_t state = 0;
+	int i;
+	for (i = 0; i < res->width; ++i) {
+		uint8_t byte = core->rawRead8(core, res->address + i, res->segment);
+		state = *UInt32ListGetConstPointer(&search->transitions, state * search->nClasses + search->classes[byte]);
+	}
+	int32_t p;
+	for (p = *SInt32ListGetConstPointer(&search->outputs, state); p >= 0;) {
+		const struct mCoreTextSearchPattern* pattern = mCoreTextSearchPatternsGetConstPointer(&search->patterns, p);
+		if ((int32_t) pattern->string == res->oldValue && (int) pattern->length == res->width) {
+			return true;
+		}
+		p = pattern->next;
+	}
+	return false;
+}
+
 static size_t _search(const void* mem, size_t size, const struct mCoreMemoryBlock* block, const struct mCoreMemorySearchParams* params, struct mCoreMemorySearchResults* out, size_t limit) {
 	switch (params->type) {
 	case mCORE_MEMORY_SEARCH_INT:
@@ -221,6 +486,8 @@ static size_t _search(const void* mem, size_t size, const struct mCoreMemoryBloc
 		return _searchStr(mem, size, block, params->valueStr, params->width, out, limit);
 	case mCORE_MEMORY_SEARCH_GUESS:
 		return _searchGuess(mem, size, block, params, out, limit);
+	case mCORE_MEMORY_SEARCH_TEXT:
+		return _searchText(mem, size, block, params->text, out, limit);
 	}
 	return 0;
 }
@@ -230,6 +497,8 @@ void mCoreMemorySearch(struct mCore* core, const struct mCoreMemorySearchParams*
 	size_t nBlocks = core->listMemoryBlocks(core, &blocks);
 	size_t found = 0;
 
+	const void* lastMem = NULL;
+
 	size_t b;
 	for (b = 0; (!limit || found < limit) && b < nBlocks; ++b) {
 		size_t size;
@@ -241,7 +510,16 @@ void mCoreMemorySearch(struct mCore* core, const struct mCoreMemorySearchParams*
 		if (!mem) {
 			continue;
 		}
-		if (size > block->end - block->start) {
+		if (params->type == mCORE_MEMORY_SEARCH_TEXT) {
+			// Text is scanned across every bank, but only once across mirrors such as the GBA waitstate regions
+			if (mem == lastMem) {
+				continue;
+			}
+			lastMem = mem;
+			if (!block->maxSegment && size > block->end - block->start) {
+				size = block->end - block->start;
+			}
+		} else if (size > block->end - block->start) {
 			size = block->end - block->start; // TOOD: Segments
 		}
 		found += _search(mem, size, block, params, out, limit ? limit - found : 0);
@@ -333,6 +611,13 @@ void mCoreMemorySearchRepeat(struct mCore* core, const struct mCoreMemorySearchP
 				}
 			}
 			break;
+		case mCORE_MEMORY_SEARCH_TEXT:
+			if (params->type == mCORE_MEMORY_SEARCH_TEXT && !_testText(core, res, params->text)) {
+				*res = *mCoreMemorySearchResultsGetPointer(inout, mCoreMemorySearchResultsSize(inout) - 1);
+				mCoreMemorySearchResultsResize(inout, -1);
+				--i;
+			}
+			break;
 		case mCORE_MEMORY_SEARCH_STRING:
 		case mCORE_MEMORY_SEARCH_GUESS:
 			// TODO
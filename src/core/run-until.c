@@ -0,0 +1,228 @@
+/* Copyright (c) 2013-2024 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include <mgba/core/run-until.h>
+
+#include <mgba/core/core.h>
+
+// Events are scheduled with 32-bit offsets, so long limits are walked in chunks
+#define LIMIT_CHUNK 0x40000000
+
+static void _limitEvent(struct mTiming* timing, void* context, uint32_t cyclesLate) {
+	struct mRunUntil* ru = context;
+	if (ru->remaining) {
+		uint64_t chunk = ru->remaining > LIMIT_CHUNK ? LIMIT_CHUNK : ru->remaining;
+		ru->remaining -= chunk;
+		mTimingSchedule(timing, &ru->limitEvent, chunk - cyclesLate);
+		return;
+	}
+	ru->cyclesLate = cyclesLate;
+	if (!ru->stopped) {
+		ru->stopped = true;
+		ru->fired = -1;
+	}
+	ru->stop(ru);
+}
+
+static void _checkPC(struct mBreakpointPages* pages) {
+	struct mRunUntil* ru = pages->context;
+	if (ru->chainedPCPages && mBreakpointPagesTest(ru->chainedPCPages, ru->pc(ru))) {
+		ru->chainedPCPages->check(ru->chainedPCPages);
+	}
+	if (ru->stopped) {
+		return;
+	}
+	uint32_t pc = ru->pc(ru);
+	size_t i;
+	for (i = 0; i < ru->nPredicates; ++i) {
+		if (ru->predicates[i].type == mRUN_UNTIL_PC && ru->predicates[i].address == pc) {
+			ru->stopped = true;
+			ru->fired = i;
+			ru->stop(ru);
+			return;
+		}
+	}
+}
+
+static void _checkRead(struct mWatchpointPages* pages, uint32_t address, int width) {
+	struct mRunUntil* ru = pages->context;
+	mWatchpointPagesCheckRead(ru->chainedMemoryPages, address, width);
+}
+
+static void _checkWrite(struct mWatchpointPages* pages, uint32_t address, uint32_t value, int width) {
+	struct mRunUntil* ru = pages->context;
+	mWatchpointPagesCheckWrite(ru->chainedMemoryPages, address, value, width);
+	if (ru->stopped) {
+		return;
+	}
+	size_t i;
+	for (i = 0; i < ru->nPredicates; ++i) {
+		const struct mRunPredicate* predicate = &ru->predicates[i];
+		if (predicate->type != mRUN_UNTIL_MEMORY_CHANGE) {
+			continue;
+		}
+		uint32_t offset = predicate->address - (address & ~(width - 1));
+		if (offset >= (uint32_t) width || (uint8_t) (value >> (offset * 8)) == ru->values[i]) {
+			continue;
+		}
+		// The store hasn't landed yet, and may not stick at all, so leave the
+		// run loop after this instruction and compare the memory itself
+		ru->stopped = true;
+		ru->fired = i;
+		ru->stop(ru);
+		return;
+	}
+}
+
+void mRunUntilInit(struct mRunUntil* ru, struct mCore* core, const struct mRunPredicate* predicates, size_t nPredicates, uint64_t maxCycles) {
+	memset(ru, 0, sizeof(*ru));
+	ru->core = core;
+	ru->predicates = predicates;
+	ru->nPredicates = nPredicates;
+	ru->fired = -1;
+	ru->cycles = maxCycles ? maxCycles : UINT64_MAX;
+
+	if (nPredicates) {
+		ru->values = calloc(nPredicates, sizeof(*ru->values));
+	}
+	size_t i;
+	for (i = 0; i < nPredicates; ++i) {
+		switch (predicates[i].type) {
+		case mRUN_UNTIL_PC:
+			ru->hasPC = true;
+			mBreakpointPagesMark(&ru->pcPages, predicates[i].address);
+			break;
+		case mRUN_UNTIL_MEMORY_CHANGE:
+			ru->hasMemory = true;
+			ru->values[i] = core->rawRead8(core, predicates[i].address, -1);
+			mWatchpointPagesMark(&ru->memoryPages, predicates[i].address, predicates[i].address + 1, false, true);
+			break;
+		case mRUN_UNTIL_IRQ:
+			ru->hasIRQ = true;
+			break;
+		}
+	}
+
+	ru->limitEvent.name = "Run Until Limit";
+	ru->limitEvent.callback = _limitEvent;
+	ru->limitEvent.context = ru;
+	ru->limitEvent.priority = 0x7FFFFFFF;
+	// Unbounded runs still get an event so that elapsed time can be measured
+	uint64_t chunk = ru->cycles > LIMIT_CHUNK ? LIMIT_CHUNK : ru->cycles;
+	ru->remaining = ru->cycles - chunk;
+	mTimingSchedule(core->timing, &ru->limitEvent, chunk);
+}
+
+void mRunUntilDeinit(struct mRunUntil* ru) {
+	mTimingDeschedule(ru->core->timing, &ru->limitEvent);
+	free(ru->values);
+	ru->values = NULL;
+}
+
+void mRunUntilInstall(struct mRunUntil* ru, struct mBreakpointPages** pcPages, struct mWatchpointPages** memoryPages) {
+	ru->cpuPCPages = pcPages;
+	ru->cpuMemoryPages = memoryPages;
+	if (ru->hasPC) {
+		// Share the CPU's hooks with anything already installed, e.g. a debugger
+		ru->chainedPCPages = *pcPages;
+		if (ru->chainedPCPages) {
+			size_t i;
+			for (i = 0; i < mBREAKPOINT_PAGE_COUNT / 32; ++i) {
+				ru->pcPages.flags[i] |= ru->chainedPCPages->flags[i];
+			}
+		}
+		ru->pcPages.check = _checkPC;
+		ru->pcPages.context = ru;
+		*pcPages = &ru->pcPages;
+	}
+	if (ru->hasMemory) {
+		ru->chainedMemoryPages = *memoryPages;
+		if (ru->chainedMemoryPages) {
+			size_t i;
+			for (i = 0; i < mWATCHPOINT_PAGE_COUNT / 32; ++i) {
+				ru->memoryPages.readFlags[i] |= ru->chainedMemoryPages->readFlags[i];
+				ru->memoryPages.writeFlags[i] |= ru->chainedMemoryPages->writeFlags[i];
+			}
+		}
+		ru->memoryPages.read = _checkRead;
+		ru->memoryPages.write = _checkWrite;
+		ru->memoryPages.context = ru;
+		*memoryPages = &ru->memoryPages;
+	}
+}
+
+void mRunUntilUninstall(struct mRunUntil* ru) {
+	// Only put back what we replaced, in case something else took over in the meantime
+	if (ru->hasPC && *ru->cpuPCPages == &ru->pcPages) {
+		*ru->cpuPCPages = ru->chainedPCPages;
+	}
+	if (ru->hasMemory && *ru->cpuMemoryPages == &ru->memoryPages) {
+		*ru->cpuMemoryPages = ru->chainedMemoryPages;
+	}
+}
+
+bool mRunUntilShouldStop(struct mRunUntil* ru) {
+	if (!ru->stopped) {
+		return false;
+	}
+	if (ru->fired < 0) {
+		return true;
+	}
+	const struct mRunPredicate* predicate = &ru->predicates[ru->fired];
+	switch (predicate->type) {
+	case mRUN_UNTIL_PC:
+		// An interrupt taken on the way out of the run loop moves the PC elsewhere
+		if (ru->pc(ru) == predicate->address) {
+			return true;
+		}
+		break;
+	case mRUN_UNTIL_MEMORY_CHANGE: {
+		uint8_t value = ru->core->rawRead8(ru->core, predicate->address, -1);
+		if (value != ru->values[ru->fired]) {
+			return true;
+		}
+		break;
+	}
+	case mRUN_UNTIL_IRQ:
+		return true;
+	}
+	ru->stopped = false;
+	ru->fired = -1;
+
+	// Wherever we ended up instead may be a target too
+	uint32_t pc = ru->pc(ru);
+	size_t i;
+	for (i = 0; i < ru->nPredicates; ++i) {
+		if (ru->predicates[i].type == mRUN_UNTIL_PC && ru->predicates[i].address == pc) {
+			ru->stopped = true;
+			ru->fired = i;
+			return true;
+		}
+	}
+	return false;
+}
+
+uint64_t mRunUntilElapsed(const struct mRunUntil* ru) {
+	if (mTimingIsScheduled(ru->core->timing, &ru->limitEvent)) {
+		return ru->cycles - ru->remaining - mTimingUntil(ru->core->timing, &ru->limitEvent);
+	}
+	return ru->cycles + ru->cyclesLate;
+}
+
+void mRunUntilIRQ(struct mRunUntil* ru, int irq) {
+	if (ru->stopped || !ru->hasIRQ) {
+		return;
+	}
+	size_t i;
+	for (i = 0; i < ru->nPredicates; ++i) {
+		const struct mRunPredicate* predicate = &ru->predicates[i];
+		if (predicate->type == mRUN_UNTIL_IRQ && (!predicate->irqMask || (predicate->irqMask & (1U << irq)))) {
+			ru->stopped = true;
+			ru->fired = i;
+			ru->stop(ru);
+			return;
+		}
+	}
+}
@@ -6,6 +6,7 @@
 #include <mgba/core/scripting.h>
 
 #include <mgba/core/core.h>
+#include <mgba/core/mem-diff.h>
 #include <mgba/core/serialize.h>
 #ifdef M_CORE_GBA
 #include <mgba/gba/interface.h>
@@ -157,6 +158,7 @@ bool mScriptBridgeLookupSymbol(struct mScriptBridge* sb, const char* name, int32
 struct mScriptMemoryDomain {
 	struct mCore* core;
 	struct mCoreMemoryBlock block;
+	struct mCoreMemoryDiff* diff;
 };
 
 #ifdef USE_DEBUGGERS
@@ -289,6 +291,45 @@ static struct mScriptValue* mScriptMemoryDomainName(struct mScriptMemoryDomain*
 	return mScriptStringCreateFromUTF8(adapter->block.shortName);
 }
 
+static void _setChangeField(struct mScriptValue* table, const char* name, uint32_t value) {
+	struct mScriptValue* key = mScriptStringCreateFromUTF8(name);
+	struct mScriptValue* val = mScriptValueAlloc(mSCRIPT_TYPE_MS_U32);
+	val->value.u32 = value;
+	mScriptTableInsert(table, key, val);
+	mScriptValueDeref(key);
+	mScriptValueDeref(val);
+}
+
+static struct mScriptValue* mScriptMemoryDomainChanges(struct mScriptMemoryDomain* adapter) {
+	struct mScriptValue* list = mScriptValueAlloc(mSCRIPT_TYPE_MS_LIST);
+	if (!adapter->diff) {
+		adapter->diff = malloc(sizeof(*adapter->diff));
+		mCoreMemoryDiffInit(adapter->diff, adapter->core);
+		mCoreMemoryDiffAddBlock(adapter->diff, adapter->block.id);
+		mCoreMemoryDiffSnapshot(adapter->diff);
+		return list;
+	}
+	mCoreMemoryDiffUpdate(adapter->diff);
+	size_t i;
+	for (i = 0; i < mCoreMemoryChangesSize(&adapter->diff->changes); ++i) {
+		const struct mCoreMemoryChange* change = mCoreMemoryChangesGetConstPointer(&adapter->diff->changes, i);
+		struct mScriptValue* entry = mScriptValueAlloc(mSCRIPT_TYPE_MS_TABLE);
+		_setChangeField(entry, "offset", change->offset);
+		_setChangeField(entry, "length", change->length);
+		mScriptValueWrap(entry, mScriptListAppend(list->value.list));
+		mScriptValueDeref(entry);
+	}
+	return list;
+}
+
+static void mScriptMemoryDomainDeinit(struct mScriptMemoryDomain* adapter) {
+	if (adapter->diff) {
+		mCoreMemoryDiffDeinit(adapter->diff);
+		free(adapter->diff);
+		adapter->diff = NULL;
+	}
+}
+
 mSCRIPT_DECLARE_STRUCT(mScriptMemoryDomain);
 mSCRIPT_DECLARE_STRUCT_METHOD(mScriptMemoryDomain, U32, read8, mScriptMemoryDomainRead8, 1, U32, address);
 mSCRIPT_DECLARE_STRUCT_METHOD(mScriptMemoryDomain, U32, read16, mScriptMemoryDomainRead16, 1, U32, address);
@@ -302,6 +343,8 @@ mSCRIPT_DECLARE_STRUCT_METHOD(mScriptMemoryDomain, U32, base, mScriptMemoryDomai
 mSCRIPT_DECLARE_STRUCT_METHOD(mScriptMemoryDomain, U32, bound, mScriptMemoryDomainEnd, 0);
 mSCRIPT_DECLARE_STRUCT_METHOD(mScriptMemoryDomain, U32, size, mScriptMemoryDomainSize, 0);
 mSCRIPT_DECLARE_STRUCT_METHOD(mScriptMemoryDomain, WSTR, name, mScriptMemoryDomainName, 0);
+mSCRIPT_DECLARE_STRUCT_METHOD(mScriptMemoryDomain, WLIST, changes, mScriptMemoryDomainChanges, 0);
+mSCRIPT_DECLARE_STRUCT_VOID_METHOD(mScriptMemoryDomain, _deinit, mScriptMemoryDomainDeinit, 0);
 
 mSCRIPT_DEFINE_STRUCT(mScriptMemoryDomain)
 	mSCRIPT_DEFINE_CLASS_DOCSTRING(
@@ -331,6 +374,13 @@ mSCRIPT_DEFINE_STRUCT(mScriptMemoryDomain)
 	mSCRIPT_DEFINE_STRUCT_METHOD(mScriptMemoryDomain, size)
 	mSCRIPT_DEFINE_DOCSTRING("Get a short, human-readable name for this memory domain")
 	mSCRIPT_DEFINE_STRUCT_METHOD(mScriptMemoryDomain, name)
+	mSCRIPT_DEFINE_DOCSTRING(
+		"Get a list of the byte ranges in this memory domain that changed since the last call. "
+		"Each entry is a table with `offset` and `length` fields. The first call only records "
+		"the current contents and returns an empty list"
+	)
+	mSCRIPT_DEFINE_STRUCT_METHOD(mScriptMemoryDomain, changes)
+	mSCRIPT_DEFINE_STRUCT_DEINIT(mScriptMemoryDomain)
 mSCRIPT_DEFINE_END;
 
 static struct mScriptValue* _mScriptCoreGetGameTitle(const struct mCore* core) {
@@ -7,6 +7,12 @@
 
 #include <mgba/core/blip_buf.h>
 
+// Lateness thresholds for adaptive frameskip, in frame periods
+#define LATE_PERIODS 2
+#define RESYNC_PERIODS 15
+#define RAISE_HOLD_FRAMES 15
+#define LOWER_HOLD_FRAMES 120
+
 static void _changeVideoSync(struct mCoreSync* sync, bool wait) {
 	// Make sure the video thread can process events while the GBA thread is paused
 	MutexLock(&sync->videoFrameMutex);
@@ -17,11 +23,76 @@ static void _changeVideoSync(struct mCoreSync* sync, bool wait) {
 	MutexUnlock(&sync->videoFrameMutex);
 }
 
+static int64_t _now(void) {
+#ifndef _MSC_VER
+	struct timeval tv;
+	if (gettimeofday(&tv, 0)) {
+		return 0;
+	}
+	return tv.tv_usec + tv.tv_sec * 1000000LL;
+#else
+	struct timespec ts;
+	if (!timespec_get(&ts, TIME_UTC)) {
+		return 0;
+	}
+	return ts.tv_nsec / 1000 + ts.tv_sec * 1000000LL;
+#endif
+}
+
+static void _updateFrameskip(struct mCoreSync* sync) {
+	if (sync->fpsTarget <= 0) {
+		return;
+	}
+	int64_t period = 1000000 / sync->fpsTarget;
+	int64_t now = _now();
+	if (!sync->frameDeadline) {
+		sync->frameDeadline = now;
+	}
+	sync->frameDeadline += period;
+	if (sync->framesSinceAdjust < LOWER_HOLD_FRAMES) {
+		++sync->framesSinceAdjust;
+	}
+
+	int64_t lateness = now - sync->frameDeadline;
+	if (lateness > period * RESYNC_PERIODS) {
+		// A stall this long is a pause or an interrupt, not load; start counting afresh
+		sync->frameDeadline = now;
+		sync->framesOnTime = 0;
+		return;
+	}
+	if (lateness > period * LATE_PERIODS) {
+		sync->framesOnTime = 0;
+		if (sync->frameskip < sync->frameskipMax && sync->framesSinceAdjust >= RAISE_HOLD_FRAMES) {
+			++sync->frameskip;
+			sync->framesSinceAdjust = 0;
+		}
+		return;
+	}
+	if (lateness < -period) {
+		// Running ahead, e.g. unsynced; don't bank time that would hide later lateness
+		sync->frameDeadline = now;
+	}
+	if (lateness < period / 2) {
+		++sync->framesOnTime;
+		if (sync->frameskip > 0 && sync->framesOnTime >= LOWER_HOLD_FRAMES) {
+			--sync->frameskip;
+			sync->framesOnTime = 0;
+			sync->framesSinceAdjust = 0;
+		}
+	} else {
+		sync->framesOnTime = 0;
+	}
+}
+
 void mCoreSyncPostFrame(struct mCoreSync* sync) {
 	if (!sync) {
 		return;
 	}
 
+	if (sync->frameskipMax > 0) {
+		_updateFrameskip(sync);
+	}
+
 	MutexLock(&sync->videoFrameMutex);
 	++sync->videoFramePending;
 	do {
@@ -79,6 +150,30 @@ void mCoreSyncSetVideoSync(struct mCoreSync* sync, bool wait) {
 	_changeVideoSync(sync, wait);
 }
 
+void mCoreSyncSetAdaptiveFrameskip(struct mCoreSync* sync, int max) {
+	if (!sync) {
+		return;
+	}
+
+	if (max < 0) {
+		max = 0;
+	}
+	sync->frameskipMax = max;
+	if (sync->frameskip > max) {
+		sync->frameskip = max;
+	}
+	sync->frameDeadline = 0;
+	sync->framesOnTime = 0;
+	sync->framesSinceAdjust = 0;
+}
+
+int mCoreSyncFrameskip(const struct mCoreSync* sync, int frameskip) {
+	if (!sync || sync->frameskip <= frameskip) {
+		return frameskip;
+	}
+	return sync->frameskip;
+}
+
 bool mCoreSyncProduceAudio(struct mCoreSync* sync, const struct blip_t* buf, size_t samples) {
 	if (!sync) {
 		return true;
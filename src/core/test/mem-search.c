@@ -0,0 +1,183 @@
+/* Copyright (c) 2013-2024 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "util/test/suite.h"
+
+#include <mgba/core/core.h>
+#include <mgba/core/mem-search.h>
+#include <mgba-util/text-codec.h>
+#include <mgba-util/vfs.h>
+
+static uint8_t _ram[0x100];
+static uint8_t _rom[0x10000];
+
+static const struct mCoreMemoryBlock _blocks[] = {
+	{ 0, "ram", "RAM", "RAM", 0xC000, 0xC100, sizeof(_ram), mCORE_MEMORY_RW | mCORE_MEMORY_MAPPED },
+	{ 1, "cart0", "ROM", "ROM", 0x0000, 0x8000, sizeof(_rom), mCORE_MEMORY_READ | mCORE_MEMORY_WORM | mCORE_MEMORY_MAPPED, 3, 0x4000 },
+	{ 2, "cart1", "ROM", "ROM mirror", 0x0000, 0x8000, sizeof(_rom), mCORE_MEMORY_READ | mCORE_MEMORY_WORM | mCORE_MEMORY_MAPPED, 3, 0x4000 },
+};
+
+static const char _table[] =
+	"10=t\n"
+	"11=h\n"
+	"12=e\n"
+	"13=n\n"
+	"80=th\n"
+	"90=en";
+
+static size_t _listMemoryBlocks(const struct mCore* core, const struct mCoreMemoryBlock** blocks) {
+	UNUSED(core);
+	*blocks = _blocks;
+	return sizeof(_blocks) / sizeof(*_blocks);
+}
+
+static void* _getMemoryBlock(struct mCore* core, size_t id, size_t* sizeOut) {
+	UNUSED(core);
+	if (id == 0) {
+		*sizeOut = sizeof(_ram);
+		return _ram;
+	}
+	*sizeOut = sizeof(_rom);
+	return _rom;
+}
+
+static uint32_t _rawRead8(struct mCore* core, uint32_t address, int segment) {
+	UNUSED(core);
+	if (address >= 0xC000) {
+		return _ram[address - 0xC000];
+	}
+	if (segment < 0) {
+		return _rom[address];
+	}
+	return _rom[segment * 0x4000 + (address & 0x3FFF)];
+}
+
+static void _setup(struct mCore* core, struct TextCodec* codec, struct VFile** vf) {
+	memset(core, 0, sizeof(*core));
+	core->listMemoryBlocks = _listMemoryBlocks;
+	core->getMemoryBlock = _getMemoryBlock;
+	core->rawRead8 = _rawRead8;
+	memset(_ram, 0, sizeof(_ram));
+	memset(_rom, 0, sizeof(_rom));
+	*vf = VFileFromConstMemory(_table, sizeof(_table) - 1);
+	assert_true(TextCodecLoadTBL(codec, *vf, true));
+}
+
+static const struct mCoreMemorySearchResult* _find(const struct mCoreMemorySearchResults* results, uint32_t address, int segment) {
+	size_t i;
+	for (i = 0; i < mCoreMemorySearchResultsSize(results); ++i) {
+		const struct mCoreMemorySearchResult* res = mCoreMemorySearchResultsGetConstPointer(results, i);
+		if (res->address == address && res->segment == segment) {
+			return res;
+		}
+	}
+	return NULL;
+}
+
+M_TEST_DEFINE(textUnencodable) {
+	struct mCore core;
+	struct TextCodec codec;
+	struct VFile* vf;
+	_setup(&core, &codec, &vf);
+
+	struct mCoreTextSearch search;
+	const char* strings[] = { "then", "x" };
+	assert_false(mCoreTextSearchInit(&search, &codec, strings, 2));
+	mCoreTextSearchDeinit(&search);
+
+	TextCodecDeinit(&codec);
+	vf->close(vf);
+}
+
+M_TEST_DEFINE(textEncodings) {
+	struct mCore core;
+	struct TextCodec codec;
+	struct VFile* vf;
+	_setup(&core, &codec, &vf);
+
+	struct mCoreTextSearch search;
+	const char* strings[] = { "then", "hen" };
+	assert_true(mCoreTextSearchInit(&search, &codec, strings, 2));
+
+	// Both spellings of "then", and "hen" inside them
+	memcpy(&_ram[0x10], "\x80\x12\x13", 3);
+	memcpy(&_ram[0x20], "\x10\x11\x90", 3);
+
+	struct mCoreMemorySearchParams params = {
+		.memoryFlags = mCORE_MEMORY_RW,
+		.type = mCORE_MEMORY_SEARCH_TEXT,
+		.text = &search
+	};
+	struct mCoreMemorySearchResults results;
+	mCoreMemorySearchResultsInit(&results, 0);
+	mCoreMemorySearch(&core, &params, &results, 0);
+	assert_int_equal(mCoreMemorySearchResultsSize(&results), 3);
+
+	const struct mCoreMemorySearchResult* res = _find(&results, 0xC010, -1);
+	assert_non_null(res);
+	assert_int_equal(res->type, mCORE_MEMORY_SEARCH_TEXT);
+	assert_int_equal(res->width, 3);
+	assert_int_equal(res->oldValue, 0);
+	res = _find(&results, 0xC020, -1);
+	assert_non_null(res);
+	assert_int_equal(res->oldValue, 0);
+	res = _find(&results, 0xC021, -1);
+	assert_non_null(res);
+	assert_int_equal(res->width, 2);
+	assert_int_equal(res->oldValue, 1);
+
+	mCoreMemorySearchResultsDeinit(&results);
+	mCoreTextSearchDeinit(&search);
+	TextCodecDeinit(&codec);
+	vf->close(vf);
+}
+
+M_TEST_DEFINE(textBanked) {
+	struct mCore core;
+	struct TextCodec codec;
+	struct VFile* vf;
+	_setup(&core, &codec, &vf);
+
+	struct mCoreTextSearch search;
+	const char* strings[] = { "the" };
+	assert_true(mCoreTextSearchInit(&search, &codec, strings, 1));
+
+	memcpy(&_rom[0x0100], "\x80\x12", 2);
+	memcpy(&_rom[0x4200], "\x80\x12", 2);
+	memcpy(&_rom[0xC300], "\x10\x11\x12", 3);
+
+	struct mCoreMemorySearchParams params = {
+		.memoryFlags = mCORE_MEMORY_READ,
+		.type = mCORE_MEMORY_SEARCH_TEXT,
+		.text = &search
+	};
+	struct mCoreMemorySearchResults results;
+	mCoreMemorySearchResultsInit(&results, 0);
+	mCoreMemorySearch(&core, &params, &results, 0);
+	assert_int_equal(mCoreMemorySearchResultsSize(&results), 3);
+	assert_non_null(_find(&results, 0x0100, -1));
+	assert_non_null(_find(&results, 0x4200, 1));
+	assert_non_null(_find(&results, 0x4300, 3));
+
+	_rom[0x4201] = 0x13;
+	mCoreMemorySearchRepeat(&core, &params, &results);
+	assert_int_equal(mCoreMemorySearchResultsSize(&results), 2);
+	assert_non_null(_find(&results, 0x0100, -1));
+	assert_non_null(_find(&results, 0x4300, 3));
+
+	mCoreMemorySearchResultsClear(&results);
+	mCoreMemorySearch(&core, &params, &results, 1);
+	assert_int_equal(mCoreMemorySearchResultsSize(&results), 1);
+
+	mCoreMemorySearchResultsDeinit(&results);
+	mCoreTextSearchDeinit(&search);
+	TextCodecDeinit(&codec);
+	vf->close(vf);
+}
+
+M_TEST_SUITE_DEFINE(mCoreMemorySearch,
+	cmocka_unit_test(textUnencodable),
+	cmocka_unit_test(textEncodings),
+	cmocka_unit_test(textBanked))
@@ -17,10 +17,12 @@
 #include <mgba/internal/gba/memory.h>
 #define TEST_PLATFORM mPLATFORM_GBA
 #define RAM_BASE GBA_BASE_IWRAM
+#define RAM_DOMAIN "iwram"
 #elif defined(M_CORE_GB)
 #include <mgba/internal/gb/memory.h>
 #define TEST_PLATFORM mPLATFORM_GB
 #define RAM_BASE GB_BASE_WORKING_RAM_BANK0
+#define RAM_DOMAIN "wram"
 #else
 #error "Need a valid platform for testing"
 #endif
@@ -281,6 +283,45 @@ M_TEST_DEFINE(memoryWrite) {
 	TEARDOWN_CORE;
 }
 
+M_TEST_DEFINE(memoryChanges) {
+	SETUP_LUA;
+	CREATE_CORE;
+	core->reset(core);
+
+	LOAD_PROGRAM(
+		"domain = emu.memory." RAM_DOMAIN "\n"
+		"assert(domain)\n"
+		"assert(#domain:changes() == 0)\n"
+	);
+	assert_true(lua->run(lua));
+
+	core->busWrite8(core, RAM_BASE + 0x10, 0x55);
+	core->busWrite8(core, RAM_BASE + 0x11, 0x12);
+	core->busWrite8(core, RAM_BASE + 0x12, 0x34);
+	core->busWrite8(core, RAM_BASE + 0x40, 0xAA);
+
+	LOAD_PROGRAM(
+		"changes = domain:changes()\n"
+		"count = #changes\n"
+		"offset1 = changes[1].offset\n"
+		"length1 = changes[1].length\n"
+		"offset2 = changes[2].offset\n"
+		"length2 = changes[2].length\n"
+		"after = #domain:changes()\n"
+	);
+	assert_true(lua->run(lua));
+
+	TEST_VALUE(S32, "count", 2);
+	TEST_VALUE(S32, "offset1", 0x10);
+	TEST_VALUE(S32, "length1", 3);
+	TEST_VALUE(S32, "offset2", 0x40);
+	TEST_VALUE(S32, "length2", 1);
+	TEST_VALUE(S32, "after", 0);
+
+	mScriptContextDeinit(&context);
+	TEARDOWN_CORE;
+}
+
 M_TEST_DEFINE(logging) {
 	SETUP_LUA;
 	struct mScriptTestLogger logger;
@@ -725,6 +766,7 @@ M_TEST_SUITE_DEFINE_SETUP_TEARDOWN(mScriptCore,
 	cmocka_unit_test(runFrame),
 	cmocka_unit_test(memoryRead),
 	cmocka_unit_test(memoryWrite),
+	cmocka_unit_test(memoryChanges),
 	cmocka_unit_test(logging),
 	cmocka_unit_test(screenshot),
 #ifdef USE_DEBUGGERS
@@ -0,0 +1,194 @@
+/* Copyright (c) 2013-2024 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "util/test/suite.h"
+
+#include <mgba/core/core.h>
+#include <mgba/core/thread.h>
+#include <mgba-util/vfs.h>
+
+#ifdef M_CORE_GB
+#include <mgba/gb/core.h>
+#include <mgba/internal/gb/gb.h>
+#elif defined(M_CORE_GBA)
+#include <mgba/gba/core.h>
+#endif
+
+#define BATCH_SIZE 8
+
+struct mTestThread {
+	struct mCoreThread thread;
+	color_t* video;
+	int log[BATCH_SIZE * 2];
+	uint32_t frames[BATCH_SIZE * 2];
+	int logged;
+	int done;
+	bool onThread;
+	struct mCoreThreadCommand closed;
+	bool closedQueued;
+};
+
+static void _record(struct mCoreThread* thread, struct mCoreThreadCommand* command) {
+	struct mTestThread* test = (struct mTestThread*) thread;
+	test->onThread = mCoreThreadGet() == thread;
+	test->frames[test->logged] = thread->core->frameCounter(thread->core);
+	test->log[test->logged] = (intptr_t) command->context;
+	++test->logged;
+}
+
+static void _done(struct mCoreThread* thread, struct mCoreThreadCommand* command) {
+	UNUSED(command);
+	struct mTestThread* test = (struct mTestThread*) thread;
+	++test->done;
+}
+
+static void _clean(struct mCoreThread* thread) {
+	struct mTestThread* test = (struct mTestThread*) thread;
+	// By the time the thread cleans up, nothing can be queued onto it anymore
+	test->closed.run = _record;
+	test->closed.done = _done;
+	test->closedQueued = mCoreThreadQueueCommand(thread, &test->closed);
+}
+
+static void _start(struct mTestThread* test) {
+	memset(test, 0, sizeof(*test));
+#ifdef M_CORE_GB
+	struct VFile* vf = VFileMemChunk(NULL, GB_SIZE_CART_BANK0 * 2);
+	GBSynthesizeROM(vf);
+	// JR $0100
+	static const uint8_t loop[] = { 0x18, 0xFE };
+	vf->seek(vf, 0x100, SEEK_SET);
+	vf->write(vf, loop, sizeof(loop));
+	struct mCore* core = GBCoreCreate();
+#elif defined(M_CORE_GBA)
+	struct VFile* vf = VFileMemChunk(NULL, 0x1000);
+	// b .
+	static const uint8_t loop[] = { 0xFE, 0xFF, 0xFF, 0xEA };
+	vf->write(vf, loop, sizeof(loop));
+	struct mCore* core = GBACoreCreate();
+#endif
+	core->init(core);
+	mCoreInitConfig(core, NULL);
+	unsigned width, height;
+	core->baseVideoSize(core, &width, &height);
+	test->video = calloc(width * height, BYTES_PER_PIXEL);
+	core->setVideoBuffer(core, test->video, width);
+	core->loadROM(core, vf);
+
+	test->thread.core = core;
+	test->thread.cleanCallback = _clean;
+	assert_true(mCoreThreadStart(&test->thread));
+}
+
+static void _end(struct mTestThread* test) {
+	mCoreThreadEnd(&test->thread);
+	mCoreThreadJoin(&test->thread);
+	struct mCore* core = test->thread.core;
+	mCoreConfigDeinit(&core->config);
+	core->deinit(core);
+	free(test->video);
+}
+
+M_TEST_DEFINE(runCommand) {
+	struct mTestThread test;
+	_start(&test);
+	struct mCoreThreadCommand command = {
+		.run = _record,
+		.done = _done,
+		.context = (void*) 1,
+	};
+	assert_true(mCoreThreadQueueCommand(&test.thread, &command));
+	assert_int_equal(mCoreThreadCommandWait(&test.thread, &command), mTHREAD_COMMAND_DONE);
+	assert_int_equal(mCoreThreadCommandPoll(&command), mTHREAD_COMMAND_DONE);
+	assert_int_equal(test.logged, 1);
+	assert_int_equal(test.log[0], 1);
+	assert_true(test.onThread);
+	_end(&test);
+	assert_int_equal(test.done, 1);
+}
+
+M_TEST_DEFINE(runBatch) {
+	struct mTestThread test;
+	_start(&test);
+	struct mCoreThreadCommand first[BATCH_SIZE];
+	struct mCoreThreadCommand second[BATCH_SIZE];
+	int i;
+	for (i = 0; i < BATCH_SIZE; ++i) {
+		first[i] = (struct mCoreThreadCommand) { .run = _record, .done = _done, .context = (void*) (intptr_t) i };
+		second[i] = (struct mCoreThreadCommand) { .run = _record, .done = _done, .context = (void*) (intptr_t) (i + BATCH_SIZE) };
+	}
+	assert_true(mCoreThreadQueueCommands(&test.thread, first, BATCH_SIZE));
+	assert_true(mCoreThreadQueueCommands(&test.thread, second, BATCH_SIZE));
+	assert_int_equal(mCoreThreadCommandWait(&test.thread, &second[BATCH_SIZE - 1]), mTHREAD_COMMAND_DONE);
+
+	// Batches run in the order they were queued, and each within a single visit
+	assert_int_equal(test.logged, BATCH_SIZE * 2);
+	for (i = 0; i < BATCH_SIZE * 2; ++i) {
+		assert_int_equal(test.log[i], i);
+		assert_int_equal(test.frames[i], test.frames[i / BATCH_SIZE * BATCH_SIZE]);
+	}
+	for (i = 0; i < BATCH_SIZE; ++i) {
+		assert_int_equal(mCoreThreadCommandPoll(&first[i]), mTHREAD_COMMAND_DONE);
+	}
+	assert_int_equal(test.done, BATCH_SIZE * 2);
+	_end(&test);
+}
+
+M_TEST_DEFINE(runWhilePaused) {
+	struct mTestThread test;
+	_start(&test);
+	mCoreThreadPause(&test.thread);
+	uint32_t frame = test.thread.core->frameCounter(test.thread.core);
+
+	struct mCoreThreadCommand command = { .run = _record };
+	assert_true(mCoreThreadQueueCommand(&test.thread, &command));
+	assert_int_equal(mCoreThreadCommandWait(&test.thread, &command), mTHREAD_COMMAND_DONE);
+	assert_int_equal(test.logged, 1);
+	assert_int_equal(test.frames[0], frame);
+	assert_true(mCoreThreadIsPaused(&test.thread));
+
+	mCoreThreadUnpause(&test.thread);
+	_end(&test);
+}
+
+M_TEST_DEFINE(holdWhileInterrupted) {
+	struct mTestThread test;
+	_start(&test);
+	mCoreThreadInterrupt(&test.thread);
+	struct mCoreThreadCommand command = { .run = _record };
+	assert_true(mCoreThreadQueueCommand(&test.thread, &command));
+	assert_int_equal(mCoreThreadCommandPoll(&command), mTHREAD_COMMAND_PENDING);
+	assert_int_equal(test.logged, 0);
+
+	mCoreThreadContinue(&test.thread);
+	assert_int_equal(mCoreThreadCommandWait(&test.thread, &command), mTHREAD_COMMAND_DONE);
+	assert_int_equal(test.logged, 1);
+	_end(&test);
+}
+
+M_TEST_DEFINE(cancelOnShutdown) {
+	struct mTestThread test;
+	_start(&test);
+	_end(&test);
+
+	// Queued from the clean callback, after the queue was closed
+	assert_false(test.closedQueued);
+	assert_int_equal(mCoreThreadCommandPoll(&test.closed), mTHREAD_COMMAND_CANCELLED);
+
+	// Queued after the thread is gone
+	struct mCoreThreadCommand command = { .run = _record, .done = _done };
+	assert_false(mCoreThreadQueueCommand(&test.thread, &command));
+	assert_int_equal(mCoreThreadCommandPoll(&command), mTHREAD_COMMAND_CANCELLED);
+	assert_int_equal(mCoreThreadCommandWait(&test.thread, &command), mTHREAD_COMMAND_CANCELLED);
+	assert_int_equal(test.logged, 0);
+	assert_int_equal(test.done, 0);
+}
+
+M_TEST_SUITE_DEFINE(mCoreThread,
+	cmocka_unit_test(runCommand),
+	cmocka_unit_test(runBatch),
+	cmocka_unit_test(runWhilePaused),
+	cmocka_unit_test(holdWhileInterrupted),
+	cmocka_unit_test(cancelOnShutdown))
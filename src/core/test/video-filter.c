@@ -0,0 +1,217 @@
+/* Copyright (c) 2013-2024 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "util/test/suite.h"
+
+#include <mgba/core/video-filter.h>
+
+#define A mColorFrom555(0x001F)
+#define B mColorFrom555(0x7C00)
+
+struct mTestStream {
+	struct mAVStream d;
+	unsigned width;
+	unsigned height;
+	const color_t* pixels;
+	size_t stride;
+	int frames;
+	int repeats;
+};
+
+static void _dimensionsChanged(struct mAVStream* stream, unsigned width, unsigned height) {
+	struct mTestStream* test = (struct mTestStream*) stream;
+	test->width = width;
+	test->height = height;
+}
+
+static void _postVideoFrame(struct mAVStream* stream, const color_t* pixels, size_t stride) {
+	struct mTestStream* test = (struct mTestStream*) stream;
+	test->pixels = pixels;
+	test->stride = stride;
+	++test->frames;
+}
+
+static void _postVideoFrameRepeat(struct mAVStream* stream, const color_t* pixels, size_t stride) {
+	struct mTestStream* test = (struct mTestStream*) stream;
+	test->pixels = pixels;
+	test->stride = stride;
+	++test->repeats;
+}
+
+M_TEST_DEFINE(identity) {
+	struct mVideoFilter filter;
+	mVideoFilterInit(&filter);
+	color_t pixels[4] = { A, B, B, A };
+	size_t stride;
+	assert_true(mVideoFilterIsIdentity(&filter));
+	assert_ptr_equal(mVideoFilterApply(&filter, pixels, 2, 2, 2, &stride), pixels);
+	assert_int_equal(stride, 2);
+	mVideoFilterDeinit(&filter);
+}
+
+M_TEST_DEFINE(nearest) {
+	struct mVideoFilter filter;
+	mVideoFilterInit(&filter);
+	mVideoFilterSetScaler(&filter, mVIDEO_SCALER_NEAREST, 3);
+	// The second row of each source stride is padding that must be skipped
+	color_t pixels[8] = { A, B, 0, 0, B, A, 0, 0 };
+	unsigned width, height;
+	mVideoFilterOutputSize(&filter, 2, 2, &width, &height);
+	assert_int_equal(width, 6);
+	assert_int_equal(height, 6);
+
+	size_t stride;
+	const color_t* out = mVideoFilterApply(&filter, pixels, 4, 2, 2, &stride);
+	assert_int_equal(stride, 6);
+	unsigned x, y;
+	for (y = 0; y < 6; ++y) {
+		for (x = 0; x < 6; ++x) {
+			assert_int_equal(out[y * stride + x], pixels[(y / 3) * 4 + x / 3]);
+		}
+	}
+	mVideoFilterDeinit(&filter);
+}
+
+M_TEST_DEFINE(nearestWide) {
+	// Wide enough for the vector loops, with a remainder left for the scalar ones
+	enum { WIDTH = 21, HEIGHT = 3 };
+	color_t pixels[WIDTH * HEIGHT];
+	unsigned i;
+	for (i = 0; i < WIDTH * HEIGHT; ++i) {
+		pixels[i] = mColorFrom555(i * 0x1F3);
+	}
+	unsigned scale;
+	for (scale = 2; scale <= 5; ++scale) {
+		struct mVideoFilter filter;
+		mVideoFilterInit(&filter);
+		mVideoFilterSetScaler(&filter, mVIDEO_SCALER_NEAREST, scale);
+		size_t stride;
+		const color_t* out = mVideoFilterApply(&filter, pixels, WIDTH, WIDTH, HEIGHT, &stride);
+		assert_int_equal(stride, WIDTH * scale);
+		unsigned x, y;
+		for (y = 0; y < HEIGHT * scale; ++y) {
+			for (x = 0; x < WIDTH * scale; ++x) {
+				assert_int_equal(out[y * stride + x], pixels[(y / scale) * WIDTH + x / scale]);
+			}
+		}
+		mVideoFilterDeinit(&filter);
+	}
+}
+
+M_TEST_DEFINE(scale2x) {
+	struct mVideoFilter filter;
+	mVideoFilterInit(&filter);
+	mVideoFilterSetScaler(&filter, mVIDEO_SCALER_SCALE2X, 0);
+	// A diagonal edge gets its corners filled in
+	color_t pixels[9] = {
+		A, A, B,
+		A, B, B,
+		B, B, B,
+	};
+	size_t stride;
+	const color_t* out = mVideoFilterApply(&filter, pixels, 3, 3, 3, &stride);
+	assert_int_equal(stride, 6);
+	assert_int_equal(out[2 * stride + 2], A);
+	assert_int_equal(out[2 * stride + 3], B);
+	assert_int_equal(out[3 * stride + 2], B);
+	assert_int_equal(out[3 * stride + 3], B);
+	assert_int_equal(out[0], A);
+	assert_int_equal(out[5 * stride + 5], B);
+
+	mVideoFilterSetScaler(&filter, mVIDEO_SCALER_SCALE4X, 0);
+	out = mVideoFilterApply(&filter, pixels, 3, 3, 3, &stride);
+	assert_int_equal(stride, 12);
+	assert_int_equal(out[0], A);
+	assert_int_equal(out[11 * stride + 11], B);
+	mVideoFilterDeinit(&filter);
+}
+
+M_TEST_DEFINE(color) {
+	struct mVideoFilter filter;
+	mVideoFilterInit(&filter);
+	color_t pixels[3] = { mColorFrom555(0), mColorFrom555(0x7FFF), mColorFrom555(0x001F) };
+	size_t stride;
+	mVideoFilterSetColor(&filter, mVIDEO_COLOR_GBA);
+	const color_t* out = mVideoFilterApply(&filter, pixels, 3, 3, 1, &stride);
+	assert_int_equal(out[0], pixels[0]);
+	// White is dimmed slightly and pure red bleeds into the other channels
+	assert_int_not_equal(out[1], pixels[1]);
+	assert_int_not_equal(out[2] & ~A, 0);
+
+	mVideoFilterSetColor(&filter, mVIDEO_COLOR_NONE);
+	assert_true(mVideoFilterIsIdentity(&filter));
+	mVideoFilterDeinit(&filter);
+}
+
+M_TEST_DEFINE(interframeBlending) {
+	struct mVideoFilter filter;
+	mVideoFilterInit(&filter);
+	mVideoFilterSetInterframeBlending(&filter, true);
+	color_t black = mColorFrom555(0);
+	color_t white = mColorFrom555(0x7FFF);
+	size_t stride;
+	const color_t* out = mVideoFilterApply(&filter, &white, 1, 1, 1, &stride);
+	assert_int_equal(out[0], white);
+	out = mVideoFilterApply(&filter, &black, 1, 1, 1, &stride);
+	assert_int_not_equal(out[0], white);
+	assert_int_not_equal(out[0], black);
+	out = mVideoFilterApply(&filter, &black, 1, 1, 1, &stride);
+	assert_int_equal(out[0], black);
+
+	mVideoFilterReset(&filter);
+	out = mVideoFilterApply(&filter, &white, 1, 1, 1, &stride);
+	assert_int_equal(out[0], white);
+	mVideoFilterDeinit(&filter);
+}
+
+M_TEST_DEFINE(stream) {
+	struct mVideoFilter filter;
+	mVideoFilterInit(&filter);
+	mVideoFilterSetScaler(&filter, mVIDEO_SCALER_NEAREST, 2);
+
+	struct mTestStream test = {
+		.d = {
+			.videoDimensionsChanged = _dimensionsChanged,
+			.postVideoFrame = _postVideoFrame,
+			.postVideoFrameRepeat = _postVideoFrameRepeat,
+		}
+	};
+	struct mVideoFilterStream stream;
+	mVideoFilterStreamInit(&stream, &filter, &test.d);
+	assert_null(stream.d.postAudioFrame);
+	assert_null(stream.d.postAudioBuffer);
+
+	color_t pixels[2] = { A, B };
+	stream.d.videoDimensionsChanged(&stream.d, 2, 1);
+	assert_int_equal(test.width, 4);
+	assert_int_equal(test.height, 2);
+
+	stream.d.postVideoFrame(&stream.d, pixels, 2);
+	assert_int_equal(test.frames, 1);
+	assert_int_equal(test.stride, 4);
+	assert_int_equal(test.pixels[1], A);
+	assert_int_equal(test.pixels[4 + 2], B);
+
+	stream.d.postVideoFrameRepeat(&stream.d, pixels, 2);
+	assert_int_equal(test.frames, 1);
+	assert_int_equal(test.repeats, 1);
+	assert_int_equal(test.stride, 4);
+
+	// Blending changes the output of a repeated frame, so it isn't passed along as a repeat
+	mVideoFilterSetInterframeBlending(&filter, true);
+	stream.d.postVideoFrameRepeat(&stream.d, pixels, 2);
+	assert_int_equal(test.frames, 2);
+	assert_int_equal(test.repeats, 1);
+	mVideoFilterDeinit(&filter);
+}
+
+M_TEST_SUITE_DEFINE(VideoFilter,
+	cmocka_unit_test(identity),
+	cmocka_unit_test(nearest),
+	cmocka_unit_test(nearestWide),
+	cmocka_unit_test(scale2x),
+	cmocka_unit_test(color),
+	cmocka_unit_test(interframeBlending),
+	cmocka_unit_test(stream))
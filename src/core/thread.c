@@ -22,6 +22,10 @@
 static const float _defaultFPSTarget = 60.f;
 static ThreadLocal _contextKey;
 
+// Markers left at the head of the command queue: the thread is waiting and must be woken, or will never drain it again
+static struct mCoreThreadCommand _commandsSleeping;
+static struct mCoreThreadCommand _commandsClosed;
+
 #ifdef USE_PTHREADS
 static pthread_once_t _contextOnce = PTHREAD_ONCE_INIT;
 
@@ -143,6 +147,51 @@ static void _cancelRequest(struct mCoreThreadInternal* threadContext, enum mCore
 	ConditionWake(&threadContext->stateOffThreadCond);
 }
 
+static struct mCoreThreadCommand* _takeCommands(struct mCoreThreadInternal* threadContext, struct mCoreThreadCommand* marker) {
+	struct mCoreThreadCommand* head;
+	do {
+		ATOMIC_LOAD_PTR(head, threadContext->commands);
+		if (!head && !marker) {
+			return NULL;
+		}
+	} while (!ATOMIC_CMPXCHG_PTR(threadContext->commands, head, marker));
+	if (head == &_commandsSleeping || head == &_commandsClosed) {
+		return NULL;
+	}
+
+	// The queue is pushed newest first
+	struct mCoreThreadCommand* ordered = NULL;
+	while (head) {
+		struct mCoreThreadCommand* next = head->next;
+		head->next = ordered;
+		ordered = head;
+		head = next;
+	}
+	return ordered;
+}
+
+static void _runCommands(struct mCoreThread* threadContext, struct mCoreThreadCommand* command, bool run) {
+	if (!command) {
+		return;
+	}
+	while (command) {
+		if (run) {
+			command->run(threadContext, command);
+		}
+		// A waiter may free the command as soon as its status changes, so it can't be read after that
+		struct mCoreThreadCommand* next = command->next;
+		void (*done)(struct mCoreThread*, struct mCoreThreadCommand*) = command->done;
+		ATOMIC_STORE(command->status, run ? mTHREAD_COMMAND_DONE : mTHREAD_COMMAND_CANCELLED);
+		if (done) {
+			done(threadContext, command);
+		}
+		command = next;
+	}
+	MutexLock(&threadContext->impl->commandMutex);
+	ConditionWake(&threadContext->impl->commandCond);
+	MutexUnlock(&threadContext->impl->commandMutex);
+}
+
 void _frameStarted(void* context) {
 	struct mCoreThread* thread = context;
 	if (!thread) {
@@ -255,6 +304,18 @@ static THREAD_ENTRY _mCoreThreadRun(void* context) {
 #endif
 
 	struct mCore* core = threadContext->core;
+	int cpu;
+	if (mCoreConfigGetIntValue(&core->config, "threadAffinity", &cpu) && cpu >= 0) {
+		if (ThreadSetAffinity(cpu) == 0) {
+			bool numaLocal = false;
+			if (mCoreConfigGetBoolValue(&core->config, "numaLocal", &numaLocal) && numaLocal) {
+				mCoreBindMemoryLocal(core);
+			}
+		} else {
+			mLOG(STATUS, WARN, "Failed to pin CPU thread to processor %i", cpu);
+		}
+	}
+
 	struct mCoreCallbacks callbacks = {
 		.videoFrameStarted = _frameStarted,
 		.videoFrameEnded = _frameEnded,
@@ -345,6 +406,7 @@ static THREAD_ENTRY _mCoreThreadRun(void* context) {
 			while (impl->state == mTHREAD_RUNNING) {
 				MutexUnlock(&impl->stateMutex);
 				core->runLoop(core);
+				_runCommands(threadContext, _takeCommands(impl, NULL), true);
 				MutexLock(&impl->stateMutex);
 			}
 		}
@@ -355,6 +417,16 @@ static THREAD_ENTRY _mCoreThreadRun(void* context) {
 			}
 
 			while (impl->state >= mTHREAD_MIN_WAITING && impl->state <= mTHREAD_MAX_WAITING) {
+				// Commands can't run while another thread holds an interrupt
+				if (impl->state != mTHREAD_INTERRUPTED) {
+					struct mCoreThreadCommand* commands = _takeCommands(impl, &_commandsSleeping);
+					if (commands) {
+						MutexUnlock(&impl->stateMutex);
+						_runCommands(threadContext, commands, true);
+						MutexLock(&impl->stateMutex);
+						continue;
+					}
+				}
 #ifdef USE_DEBUGGERS
 				if (debugger && debugger->state != DEBUGGER_SHUTDOWN) {
 					mDebuggerUpdate(debugger);
@@ -431,6 +503,7 @@ static THREAD_ENTRY _mCoreThreadRun(void* context) {
 				threadContext->run(threadContext);
 			}
 		}
+		_runCommands(threadContext, _takeCommands(impl, NULL), true);
 		MutexLock(&impl->stateMutex);
 	}
 
@@ -440,6 +513,8 @@ static THREAD_ENTRY _mCoreThreadRun(void* context) {
 	ConditionWake(&threadContext->impl->stateOffThreadCond);
 	MutexUnlock(&impl->stateMutex);
 
+	_runCommands(threadContext, _takeCommands(impl, &_commandsClosed), false);
+
 	if (core->opts.rewindEnable) {
 		 mCoreRewindContextDeinit(&impl->rewind);
 	}
@@ -460,6 +535,7 @@ static THREAD_ENTRY _mCoreThreadRun(void* context) {
 	}
 	logger->filter = NULL;
 
+	VFileMemChunkPoolFlush();
 	return 0;
 }
 
@@ -485,6 +561,9 @@ bool mCoreThreadStart(struct mCoreThread* threadContext) {
 	MutexInit(&threadContext->impl->sync.audioBufferMutex);
 	ConditionInit(&threadContext->impl->sync.audioRequiredCond);
 
+	MutexInit(&threadContext->impl->commandMutex);
+	ConditionInit(&threadContext->impl->commandCond);
+
 	threadContext->impl->interruptDepth = 0;
 
 #ifdef USE_PTHREADS
@@ -498,6 +577,7 @@ bool mCoreThreadStart(struct mCoreThread* threadContext) {
 	threadContext->impl->sync.audioWait = threadContext->core->opts.audioSync;
 	threadContext->impl->sync.videoFrameWait = threadContext->core->opts.videoSync;
 	threadContext->impl->sync.fpsTarget = threadContext->core->opts.fpsTarget;
+	mCoreSyncSetAdaptiveFrameskip(&threadContext->impl->sync, threadContext->core->opts.autoFrameskip);
 
 	MutexLock(&threadContext->impl->stateMutex);
 	ThreadCreate(&threadContext->impl->thread, _mCoreThreadRun, threadContext);
@@ -603,6 +683,9 @@ void mCoreThreadJoin(struct mCoreThread* threadContext) {
 	ConditionDeinit(&threadContext->impl->sync.audioRequiredCond);
 	MutexDeinit(&threadContext->impl->sync.audioBufferMutex);
 
+	ConditionDeinit(&threadContext->impl->commandCond);
+	MutexDeinit(&threadContext->impl->commandMutex);
+
 	free(threadContext->impl);
 	threadContext->impl = NULL;
 }
@@ -672,6 +755,70 @@ void mCoreThreadRunFunction(struct mCoreThread* threadContext, void (*run)(struc
 	MutexUnlock(&threadContext->impl->stateMutex);
 }
 
+bool mCoreThreadQueueCommand(struct mCoreThread* threadContext, struct mCoreThreadCommand* command) {
+	return mCoreThreadQueueCommands(threadContext, command, 1);
+}
+
+bool mCoreThreadQueueCommands(struct mCoreThread* threadContext, struct mCoreThreadCommand* commands, size_t nCommands) {
+	if (!nCommands) {
+		return true;
+	}
+	size_t i;
+	for (i = 0; i < nCommands; ++i) {
+		commands[i].status = mTHREAD_COMMAND_PENDING;
+		commands[i].next = i ? &commands[i - 1] : NULL;
+	}
+	if (!threadContext->impl) {
+		for (i = 0; i < nCommands; ++i) {
+			commands[i].status = mTHREAD_COMMAND_CANCELLED;
+		}
+		return false;
+	}
+
+	struct mCoreThreadInternal* impl = threadContext->impl;
+	struct mCoreThreadCommand* head;
+	do {
+		ATOMIC_LOAD_PTR(head, impl->commands);
+		if (head == &_commandsClosed) {
+			for (i = 0; i < nCommands; ++i) {
+				commands[i].status = mTHREAD_COMMAND_CANCELLED;
+			}
+			return false;
+		}
+		commands[0].next = head == &_commandsSleeping ? NULL : head;
+	} while (!ATOMIC_CMPXCHG_PTR(impl->commands, head, &commands[nCommands - 1]));
+
+	if (head == &_commandsSleeping) {
+		MutexLock(&impl->stateMutex);
+		ConditionWake(&impl->stateOnThreadCond);
+		MutexUnlock(&impl->stateMutex);
+	}
+	return true;
+}
+
+enum mCoreThreadCommandStatus mCoreThreadCommandPoll(const struct mCoreThreadCommand* command) {
+	int status;
+	ATOMIC_LOAD(status, command->status);
+	return status;
+}
+
+enum mCoreThreadCommandStatus mCoreThreadCommandWait(struct mCoreThread* threadContext, struct mCoreThreadCommand* command) {
+	int status;
+	ATOMIC_LOAD(status, command->status);
+	if (status != mTHREAD_COMMAND_PENDING || !threadContext->impl || mCoreThreadGet() == threadContext) {
+		// Waiting from the emulation thread itself would never finish
+		return status;
+	}
+	MutexLock(&threadContext->impl->commandMutex);
+	ATOMIC_LOAD(status, command->status);
+	while (status == mTHREAD_COMMAND_PENDING) {
+		ConditionWait(&threadContext->impl->commandCond, &threadContext->impl->commandMutex);
+		ATOMIC_LOAD(status, command->status);
+	}
+	MutexUnlock(&threadContext->impl->commandMutex);
+	return status;
+}
+
 void mCoreThreadPause(struct mCoreThread* threadContext) {
 	MutexLock(&threadContext->impl->stateMutex);
 	_waitOnInterrupt(threadContext->impl);
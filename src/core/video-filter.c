@@ -0,0 +1,503 @@
+/* Copyright (c) 2013-2024 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include <mgba/core/video-filter.h>
+
+#include <math.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#define COLOR_TABLE_SIZE 0x8000
+
+struct mVideoFilterColorMatrix {
+	float inGamma;
+	float outGamma;
+	float luminance;
+	float matrix[3][3];
+};
+
+// Values from the gba-color and gbc-color shaders, with their default settings
+static const struct mVideoFilterColorMatrix _colorMatrices[] = {
+	[mVIDEO_COLOR_GBA] = {
+		.inGamma = 2.7f,
+		.outGamma = 1.0f / 2.5f + 0.0625f,
+		.luminance = 0.99f,
+		.matrix = {
+			{ 0.84f, 0.18f, 0.00f },
+			{ 0.09f, 0.67f, 0.26f },
+			{ 0.15f, 0.10f, 0.73f },
+		},
+	},
+	[mVIDEO_COLOR_GBC] = {
+		.inGamma = 2.2f,
+		.outGamma = 1.0f / 2.2f,
+		.luminance = 0.94f,
+		.matrix = {
+			{ 0.78824f, 0.12157f, 0.00f },
+			{ 0.025f, 0.72941f, 0.275f },
+			{ 0.12039f, 0.12157f, 0.82f },
+		},
+	},
+};
+
+static inline unsigned _colorIndex(color_t color) {
+#ifdef COLOR_16_BIT
+#ifdef COLOR_5_6_5
+	return ((color >> 11) & 0x1F) | ((color >> 1) & 0x3E0) | ((color & 0x1F) << 10);
+#else
+	return color & 0x7FFF;
+#endif
+#else
+	return ((color >> 3) & 0x1F) | ((color >> 6) & 0x3E0) | ((color >> 9) & 0x7C00);
+#endif
+}
+
+static inline color_t _colorPack(unsigned r, unsigned g, unsigned b) {
+#ifdef COLOR_16_BIT
+#ifdef COLOR_5_6_5
+	return ((r >> 3) << 11) | ((g >> 2) << 5) | (b >> 3);
+#else
+	return (r >> 3) | ((g >> 3) << 5) | ((b >> 3) << 10);
+#endif
+#else
+	return r | (g << 8) | (b << 16);
+#endif
+}
+
+// Averages two colors without unpacking them by dropping the low bit of each channel first
+static inline color_t _colorBlend(color_t a, color_t b) {
+#ifdef COLOR_16_BIT
+#ifdef COLOR_5_6_5
+	const color_t mask = 0xF7DE;
+#else
+	const color_t mask = 0x7BDE;
+#endif
+#else
+	const color_t mask = 0xFEFEFE;
+#endif
+	return (a & b) + (((a ^ b) & mask) >> 1);
+}
+
+static void _buildColorTable(color_t* table, const struct mVideoFilterColorMatrix* matrix) {
+	float linear[32];
+	unsigned i;
+	for (i = 0; i < 32; ++i) {
+		linear[i] = powf(i / 31.f, matrix->inGamma) * matrix->luminance;
+	}
+	for (i = 0; i < COLOR_TABLE_SIZE; ++i) {
+		float in[3] = { linear[i & 0x1F], linear[(i >> 5) & 0x1F], linear[(i >> 10) & 0x1F] };
+		unsigned out[3];
+		int c;
+		for (c = 0; c < 3; ++c) {
+			float value = matrix->matrix[c][0] * in[0] + matrix->matrix[c][1] * in[1] + matrix->matrix[c][2] * in[2];
+			if (value <= 0) {
+				out[c] = 0;
+			} else if (value >= 1) {
+				out[c] = 255;
+			} else {
+				out[c] = powf(value, matrix->outGamma) * 255.f + 0.5f;
+			}
+		}
+		table[i] = _colorPack(out[0], out[1], out[2]);
+	}
+}
+
+// Widens as much of a row as fits in whole vectors, and returns how many
+// source pixels that covered. The scalar loops finish the rest.
+static unsigned _scaleNearestRow(const color_t* in, color_t* out, unsigned width, unsigned scale) {
+	unsigned x = 0;
+#if defined(__SSE2__) && !defined(COLOR_16_BIT)
+	switch (scale) {
+	case 2:
+		for (; x + 4 <= width; x += 4) {
+			__m128i v = _mm_loadu_si128((const __m128i*) &in[x]);
+			_mm_storeu_si128((__m128i*) &out[x * 2], _mm_unpacklo_epi32(v, v));
+			_mm_storeu_si128((__m128i*) &out[x * 2 + 4], _mm_unpackhi_epi32(v, v));
+		}
+		break;
+	case 3:
+		for (; x + 4 <= width; x += 4) {
+			__m128i v = _mm_loadu_si128((const __m128i*) &in[x]);
+			_mm_storeu_si128((__m128i*) &out[x * 3], _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 0, 0)));
+			_mm_storeu_si128((__m128i*) &out[x * 3 + 4], _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 2, 1, 1)));
+			_mm_storeu_si128((__m128i*) &out[x * 3 + 8], _mm_shuffle_epi32(v, _MM_SHUFFLE(3, 3, 3, 2)));
+		}
+		break;
+	case 4:
+		for (; x + 4 <= width; x += 4) {
+			__m128i v = _mm_loadu_si128((const __m128i*) &in[x]);
+			_mm_storeu_si128((__m128i*) &out[x * 4], _mm_shuffle_epi32(v, _MM_SHUFFLE(0, 0, 0, 0)));
+			_mm_storeu_si128((__m128i*) &out[x * 4 + 4], _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 1, 1, 1)));
+			_mm_storeu_si128((__m128i*) &out[x * 4 + 8], _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 2, 2, 2)));
+			_mm_storeu_si128((__m128i*) &out[x * 4 + 12], _mm_shuffle_epi32(v, _MM_SHUFFLE(3, 3, 3, 3)));
+		}
+		break;
+	}
+#elif defined(__SSE2__)
+	switch (scale) {
+	case 2:
+		for (; x + 8 <= width; x += 8) {
+			__m128i v = _mm_loadu_si128((const __m128i*) &in[x]);
+			_mm_storeu_si128((__m128i*) &out[x * 2], _mm_unpacklo_epi16(v, v));
+			_mm_storeu_si128((__m128i*) &out[x * 2 + 8], _mm_unpackhi_epi16(v, v));
+		}
+		break;
+	case 4:
+		for (; x + 8 <= width; x += 8) {
+			__m128i v = _mm_loadu_si128((const __m128i*) &in[x]);
+			__m128i low = _mm_unpacklo_epi16(v, v);
+			__m128i high = _mm_unpackhi_epi16(v, v);
+			_mm_storeu_si128((__m128i*) &out[x * 4], _mm_unpacklo_epi32(low, low));
+			_mm_storeu_si128((__m128i*) &out[x * 4 + 8], _mm_unpackhi_epi32(low, low));
+			_mm_storeu_si128((__m128i*) &out[x * 4 + 16], _mm_unpacklo_epi32(high, high));
+			_mm_storeu_si128((__m128i*) &out[x * 4 + 24], _mm_unpackhi_epi32(high, high));
+		}
+		break;
+	}
+#else
+	UNUSED(in);
+	UNUSED(out);
+	UNUSED(width);
+	UNUSED(scale);
+#endif
+	return x;
+}
+
+static void _scaleNearest(const color_t* src, size_t srcStride, color_t* dst, size_t dstStride, unsigned width, unsigned height, unsigned scale) {
+	unsigned x, y, i;
+	for (y = 0; y < height; ++y) {
+		const color_t* in = &src[y * srcStride];
+		color_t* out = &dst[y * scale * dstStride];
+		unsigned start = _scaleNearestRow(in, out, width, scale);
+		switch (scale) {
+		case 2:
+			for (x = start; x < width; ++x) {
+				out[x * 2] = in[x];
+				out[x * 2 + 1] = in[x];
+			}
+			break;
+		case 3:
+			for (x = start; x < width; ++x) {
+				out[x * 3] = in[x];
+				out[x * 3 + 1] = in[x];
+				out[x * 3 + 2] = in[x];
+			}
+			break;
+		case 4:
+			for (x = start; x < width; ++x) {
+				out[x * 4] = in[x];
+				out[x * 4 + 1] = in[x];
+				out[x * 4 + 2] = in[x];
+				out[x * 4 + 3] = in[x];
+			}
+			break;
+		default:
+			for (x = start; x < width; ++x) {
+				for (i = 0; i < scale; ++i) {
+					out[x * scale + i] = in[x];
+				}
+			}
+			break;
+		}
+		for (i = 1; i < scale; ++i) {
+			memcpy(&out[i * dstStride], out, width * scale * sizeof(*out));
+		}
+	}
+}
+
+static void _scale2x(const color_t* src, size_t srcStride, color_t* dst, size_t dstStride, unsigned width, unsigned height) {
+	unsigned x, y;
+	for (y = 0; y < height; ++y) {
+		const color_t* row = &src[y * srcStride];
+		const color_t* above = y > 0 ? row - srcStride : row;
+		const color_t* below = y + 1 < height ? row + srcStride : row;
+		color_t* out0 = &dst[y * 2 * dstStride];
+		color_t* out1 = out0 + dstStride;
+		for (x = 0; x < width; ++x) {
+			color_t b = above[x];
+			color_t d = row[x > 0 ? x - 1 : x];
+			color_t e = row[x];
+			color_t f = row[x + 1 < width ? x + 1 : x];
+			color_t h = below[x];
+			if (b != h && d != f) {
+				out0[x * 2] = d == b ? d : e;
+				out0[x * 2 + 1] = b == f ? f : e;
+				out1[x * 2] = d == h ? d : e;
+				out1[x * 2 + 1] = h == f ? f : e;
+			} else {
+				out0[x * 2] = e;
+				out0[x * 2 + 1] = e;
+				out1[x * 2] = e;
+				out1[x * 2 + 1] = e;
+			}
+		}
+	}
+}
+
+static void _scale3x(const color_t* src, size_t srcStride, color_t* dst, size_t dstStride, unsigned width, unsigned height) {
+	unsigned x, y;
+	for (y = 0; y < height; ++y) {
+		const color_t* row = &src[y * srcStride];
+		const color_t* above = y > 0 ? row - srcStride : row;
+		const color_t* below = y + 1 < height ? row + srcStride : row;
+		color_t* out0 = &dst[y * 3 * dstStride];
+		color_t* out1 = out0 + dstStride;
+		color_t* out2 = out1 + dstStride;
+		for (x = 0; x < width; ++x) {
+			unsigned left = x > 0 ? x - 1 : x;
+			unsigned right = x + 1 < width ? x + 1 : x;
+			color_t a = above[left];
+			color_t b = above[x];
+			color_t c = above[right];
+			color_t d = row[left];
+			color_t e = row[x];
+			color_t f = row[right];
+			color_t g = below[left];
+			color_t h = below[x];
+			color_t i = below[right];
+			color_t* o0 = &out0[x * 3];
+			color_t* o1 = &out1[x * 3];
+			color_t* o2 = &out2[x * 3];
+			if (b != h && d != f) {
+				o0[0] = d == b ? d : e;
+				o0[1] = (d == b && e != c) || (b == f && e != a) ? b : e;
+				o0[2] = b == f ? f : e;
+				o1[0] = (d == b && e != g) || (d == h && e != a) ? d : e;
+				o1[1] = e;
+				o1[2] = (b == f && e != i) || (h == f && e != c) ? f : e;
+				o2[0] = d == h ? d : e;
+				o2[1] = (d == h && e != i) || (h == f && e != g) ? h : e;
+				o2[2] = h == f ? f : e;
+			} else {
+				o0[0] = o0[1] = o0[2] = e;
+				o1[0] = o1[1] = o1[2] = e;
+				o2[0] = o2[1] = o2[2] = e;
+			}
+		}
+	}
+}
+
+static unsigned _scaleFactor(const struct mVideoFilter* filter) {
+	switch (filter->scaler) {
+	case mVIDEO_SCALER_NEAREST:
+		return filter->scale;
+	case mVIDEO_SCALER_SCALE2X:
+		return 2;
+	case mVIDEO_SCALER_SCALE3X:
+		return 3;
+	case mVIDEO_SCALER_SCALE4X:
+		return 4;
+	}
+	return 1;
+}
+
+void mVideoFilterInit(struct mVideoFilter* filter) {
+	memset(filter, 0, sizeof(*filter));
+	filter->scaler = mVIDEO_SCALER_NEAREST;
+	filter->scale = 1;
+	filter->color = mVIDEO_COLOR_NONE;
+}
+
+void mVideoFilterDeinit(struct mVideoFilter* filter) {
+	free(filter->colorTable);
+	free(filter->previous);
+	free(filter->stage);
+	free(filter->scaleTemp);
+	free(filter->output);
+	memset(filter, 0, sizeof(*filter));
+}
+
+void mVideoFilterSetScaler(struct mVideoFilter* filter, enum mVideoFilterScaler scaler, unsigned scale) {
+	filter->scaler = scaler;
+	filter->scale = scale ? scale : 1;
+}
+
+void mVideoFilterSetColor(struct mVideoFilter* filter, enum mVideoFilterColor color) {
+	if (color == filter->color) {
+		return;
+	}
+	filter->color = color;
+	if (color == mVIDEO_COLOR_NONE) {
+		return;
+	}
+	if (!filter->colorTable) {
+		filter->colorTable = malloc(COLOR_TABLE_SIZE * sizeof(*filter->colorTable));
+	}
+	_buildColorTable(filter->colorTable, &_colorMatrices[color]);
+}
+
+void mVideoFilterSetInterframeBlending(struct mVideoFilter* filter, bool enable) {
+	filter->interframeBlending = enable;
+	mVideoFilterReset(filter);
+}
+
+void mVideoFilterReset(struct mVideoFilter* filter) {
+	filter->previousWidth = 0;
+	filter->previousHeight = 0;
+}
+
+bool mVideoFilterIsIdentity(const struct mVideoFilter* filter) {
+	return !filter->interframeBlending && filter->color == mVIDEO_COLOR_NONE && _scaleFactor(filter) == 1;
+}
+
+void mVideoFilterOutputSize(const struct mVideoFilter* filter, unsigned width, unsigned height, unsigned* outWidth, unsigned* outHeight) {
+	unsigned scale = _scaleFactor(filter);
+	*outWidth = width * scale;
+	*outHeight = height * scale;
+}
+
+const color_t* mVideoFilterApply(struct mVideoFilter* filter, const color_t* pixels, size_t stride, unsigned width, unsigned height, size_t* outStride) {
+	if (mVideoFilterIsIdentity(filter)) {
+		*outStride = stride;
+		return pixels;
+	}
+	size_t size = (size_t) width * height;
+	if (size > filter->sourceSize) {
+		filter->previous = realloc(filter->previous, size * sizeof(color_t));
+		filter->stage = realloc(filter->stage, size * sizeof(color_t));
+		free(filter->scaleTemp);
+		filter->scaleTemp = NULL;
+		filter->sourceSize = size;
+		mVideoFilterReset(filter);
+	}
+
+	const color_t* src = pixels;
+	size_t srcStride = stride;
+	unsigned x, y;
+	if (filter->interframeBlending) {
+		bool blend = filter->previousWidth == width && filter->previousHeight == height;
+		for (y = 0; y < height; ++y) {
+			const color_t* in = &src[y * srcStride];
+			color_t* prev = &filter->previous[y * width];
+			color_t* out = &filter->stage[y * width];
+			if (blend) {
+				for (x = 0; x < width; ++x) {
+					out[x] = _colorBlend(in[x], prev[x]);
+				}
+			} else {
+				memcpy(out, in, width * sizeof(*out));
+			}
+			memcpy(prev, in, width * sizeof(*prev));
+		}
+		filter->previousWidth = width;
+		filter->previousHeight = height;
+		src = filter->stage;
+		srcStride = width;
+	}
+	if (filter->color != mVIDEO_COLOR_NONE) {
+		const color_t* table = filter->colorTable;
+		for (y = 0; y < height; ++y) {
+			const color_t* in = &src[y * srcStride];
+			color_t* out = &filter->stage[y * width];
+			for (x = 0; x < width; ++x) {
+				out[x] = table[_colorIndex(in[x])];
+			}
+		}
+		src = filter->stage;
+		srcStride = width;
+	}
+
+	unsigned scale = _scaleFactor(filter);
+	if (scale == 1) {
+		*outStride = srcStride;
+		return src;
+	}
+	size_t scaledSize = size * scale * scale;
+	if (scaledSize > filter->outputSize) {
+		filter->output = realloc(filter->output, scaledSize * sizeof(color_t));
+		filter->outputSize = scaledSize;
+	}
+	size_t dstStride = width * scale;
+	switch (filter->scaler) {
+	case mVIDEO_SCALER_NEAREST:
+		_scaleNearest(src, srcStride, filter->output, dstStride, width, height, scale);
+		break;
+	case mVIDEO_SCALER_SCALE2X:
+		_scale2x(src, srcStride, filter->output, dstStride, width, height);
+		break;
+	case mVIDEO_SCALER_SCALE3X:
+		_scale3x(src, srcStride, filter->output, dstStride, width, height);
+		break;
+	case mVIDEO_SCALER_SCALE4X:
+		if (!filter->scaleTemp) {
+			filter->scaleTemp = malloc(filter->sourceSize * 4 * sizeof(color_t));
+		}
+		_scale2x(src, srcStride, filter->scaleTemp, width * 2, width, height);
+		_scale2x(filter->scaleTemp, width * 2, filter->output, dstStride, width * 2, height * 2);
+		break;
+	}
+	*outStride = dstStride;
+	return filter->output;
+}
+
+static void _filterStreamDimensionsChanged(struct mAVStream* stream, unsigned width, unsigned height) {
+	struct mVideoFilterStream* filterStream = (struct mVideoFilterStream*) stream;
+	filterStream->width = width;
+	filterStream->height = height;
+	filterStream->lastOutput = NULL;
+	mVideoFilterReset(filterStream->filter);
+	if (filterStream->next->videoDimensionsChanged) {
+		mVideoFilterOutputSize(filterStream->filter, width, height, &width, &height);
+		filterStream->next->videoDimensionsChanged(filterStream->next, width, height);
+	}
+}
+
+static void _filterStreamAudioRateChanged(struct mAVStream* stream, unsigned rate) {
+	struct mVideoFilterStream* filterStream = (struct mVideoFilterStream*) stream;
+	filterStream->next->audioRateChanged(filterStream->next, rate);
+}
+
+static void _filterStreamPostVideoFrame(struct mAVStream* stream, const color_t* buffer, size_t stride) {
+	struct mVideoFilterStream* filterStream = (struct mVideoFilterStream*) stream;
+	if (!filterStream->width || !filterStream->height) {
+		return;
+	}
+	filterStream->lastOutput = mVideoFilterApply(filterStream->filter, buffer, stride, filterStream->width, filterStream->height, &filterStream->lastStride);
+	filterStream->next->postVideoFrame(filterStream->next, filterStream->lastOutput, filterStream->lastStride);
+}
+
+static void _filterStreamPostVideoFrameRepeat(struct mAVStream* stream, const color_t* buffer, size_t stride) {
+	struct mVideoFilterStream* filterStream = (struct mVideoFilterStream*) stream;
+	// Blending a repeated frame still changes the output, so it has to go through the filter again
+	if (filterStream->filter->interframeBlending || !filterStream->lastOutput) {
+		_filterStreamPostVideoFrame(stream, buffer, stride);
+	} else if (filterStream->next->postVideoFrameRepeat) {
+		filterStream->next->postVideoFrameRepeat(filterStream->next, filterStream->lastOutput, filterStream->lastStride);
+	} else {
+		filterStream->next->postVideoFrame(filterStream->next, filterStream->lastOutput, filterStream->lastStride);
+	}
+}
+
+static void _filterStreamPostAudioFrame(struct mAVStream* stream, int16_t left, int16_t right) {
+	struct mVideoFilterStream* filterStream = (struct mVideoFilterStream*) stream;
+	filterStream->next->postAudioFrame(filterStream->next, left, right);
+}
+
+static void _filterStreamPostAudioBuffer(struct mAVStream* stream, struct blip_t* left, struct blip_t* right) {
+	struct mVideoFilterStream* filterStream = (struct mVideoFilterStream*) stream;
+	filterStream->next->postAudioBuffer(filterStream->next, left, right);
+}
+
+void mVideoFilterStreamInit(struct mVideoFilterStream* stream, struct mVideoFilter* filter, struct mAVStream* next) {
+	memset(stream, 0, sizeof(*stream));
+	stream->filter = filter;
+	stream->next = next;
+	stream->d.videoDimensionsChanged = _filterStreamDimensionsChanged;
+	if (next->audioRateChanged) {
+		stream->d.audioRateChanged = _filterStreamAudioRateChanged;
+	}
+	if (next->postVideoFrame) {
+		stream->d.postVideoFrame = _filterStreamPostVideoFrame;
+		stream->d.postVideoFrameRepeat = _filterStreamPostVideoFrameRepeat;
+	}
+	if (next->postAudioFrame) {
+		stream->d.postAudioFrame = _filterStreamPostAudioFrame;
+	}
+	if (next->postAudioBuffer) {
+		stream->d.postAudioBuffer = _filterStreamPostAudioBuffer;
+	}
+}
@@ -0,0 +1,607 @@
+/* Copyright (c) 2013-2024 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include <mgba/internal/debugger/analysis.h>
+
+#include <mgba/core/core.h>
+#include <mgba-util/vfs.h>
+
+const char mCA_MAGIC[] = "mCA\0";
+
+DEFINE_VECTOR(mCodeInstructionList, struct mCodeInstruction);
+DEFINE_VECTOR(mCodeBlockList, struct mCodeBlock);
+DEFINE_VECTOR(mCodeFunctionList, struct mCodeFunction);
+DEFINE_VECTOR(mCodeXrefList, struct mCodeXref);
+DEFINE_VECTOR(mCodeAnalysisTargetList, struct mCodeAnalysisTarget);
+
+struct mCodeAnalysisHeader {
+	char magic[4];
+	uint32_t version;
+	uint32_t platform;
+	uint32_t romCrc32;
+	uint32_t instructions;
+	uint32_t xrefs;
+	uint64_t reserved;
+};
+static_assert(sizeof(struct mCodeAnalysisHeader) == 0x20, "mCodeAnalysisHeader struct sized wrong");
+
+struct mCodeAnalysisLocationRecord {
+	uint32_t address;
+	int32_t segment;
+	uint32_t mode;
+};
+
+struct mCodeAnalysisInstructionRecord {
+	struct mCodeAnalysisLocationRecord location;
+	struct mCodeAnalysisLocationRecord target;
+	struct mCodeAnalysisLocationRecord data;
+	uint32_t length;
+	uint32_t flow;
+	uint32_t flags;
+};
+static_assert(sizeof(struct mCodeAnalysisInstructionRecord) == 0x30, "mCodeAnalysisInstructionRecord struct sized wrong");
+
+struct mCodeAnalysisXrefRecord {
+	struct mCodeAnalysisLocationRecord from;
+	struct mCodeAnalysisLocationRecord to;
+	uint32_t type;
+	uint32_t reserved;
+};
+static_assert(sizeof(struct mCodeAnalysisXrefRecord) == 0x20, "mCodeAnalysisXrefRecord struct sized wrong");
+
+static int _compareLocations(const struct mCodeLocation* a, const struct mCodeLocation* b) {
+	if (a->segment != b->segment) {
+		return a->segment < b->segment ? -1 : 1;
+	}
+	if (a->address != b->address) {
+		return a->address < b->address ? -1 : 1;
+	}
+	if (a->mode != b->mode) {
+		return a->mode < b->mode ? -1 : 1;
+	}
+	return 0;
+}
+
+// Groups each mode's instructions together, so that a block isn't split by
+// instructions in another mode that happen to fall between its own
+static int _compareInstructions(const void* a, const void* b) {
+	const struct mCodeLocation* la = &(*(const struct mCodeInstruction* const*) a)->location;
+	const struct mCodeLocation* lb = &(*(const struct mCodeInstruction* const*) b)->location;
+	if (la->segment != lb->segment) {
+		return la->segment < lb->segment ? -1 : 1;
+	}
+	if (la->mode != lb->mode) {
+		return la->mode < lb->mode ? -1 : 1;
+	}
+	if (la->address != lb->address) {
+		return la->address < lb->address ? -1 : 1;
+	}
+	return 0;
+}
+
+static int _compareBlocks(const void* a, const void* b) {
+	const struct mCodeBlock* ba = a;
+	const struct mCodeBlock* bb = b;
+	return _compareLocations(&ba->start, &bb->start);
+}
+
+static int _compareXrefs(const void* a, const void* b) {
+	const struct mCodeXref* xa = a;
+	const struct mCodeXref* xb = b;
+	if (xa->to.segment != xb->to.segment) {
+		return xa->to.segment < xb->to.segment ? -1 : 1;
+	}
+	if (xa->to.address != xb->to.address) {
+		return xa->to.address < xb->to.address ? -1 : 1;
+	}
+	return _compareLocations(&xa->from, &xb->from);
+}
+
+void mCodeAnalysisInit(struct mCodeAnalysis* analysis, struct mCore* core, const struct mCodeAnalysisPlatform* platform) {
+	memset(analysis, 0, sizeof(*analysis));
+	analysis->core = core;
+	analysis->platform = platform;
+	if (core) {
+		if (!platform && core->codeAnalysisPlatform) {
+			analysis->platform = core->codeAnalysisPlatform(core);
+		}
+		core->checksum(core, &analysis->romCrc32, mCHECKSUM_CRC32);
+	}
+	mCodeInstructionListInit(&analysis->instructions, 0);
+	TableInit(&analysis->instructionIndex, 0, NULL);
+	mCodeAnalysisTargetListInit(&analysis->pending, 0);
+	mCodeXrefListInit(&analysis->observedXrefs, 0);
+	UInt32ListInit(&analysis->order, 0);
+	mCodeBlockListInit(&analysis->blocks, 0);
+	mCodeFunctionListInit(&analysis->functions, 0);
+	mCodeXrefListInit(&analysis->xrefs, 0);
+
+	if (analysis->platform && analysis->platform->addEntryPoints) {
+		analysis->platform->addEntryPoints(analysis);
+	}
+}
+
+void mCodeAnalysisDeinit(struct mCodeAnalysis* analysis) {
+	mCodeInstructionListDeinit(&analysis->instructions);
+	TableDeinit(&analysis->instructionIndex);
+	mCodeAnalysisTargetListDeinit(&analysis->pending);
+	mCodeXrefListDeinit(&analysis->observedXrefs);
+	UInt32ListDeinit(&analysis->order);
+	mCodeBlockListDeinit(&analysis->blocks);
+	mCodeFunctionListDeinit(&analysis->functions);
+	mCodeXrefListDeinit(&analysis->xrefs);
+}
+
+static struct mCodeInstruction* _lookup(const struct mCodeAnalysis* analysis, uint32_t address, int segment, int mode, bool anyMode) {
+	uint32_t index = (uintptr_t) TableLookup(&analysis->instructionIndex, address);
+	while (index) {
+		struct mCodeInstruction* instruction = mCodeInstructionListGetPointer((struct mCodeInstructionList*) &analysis->instructions, index - 1);
+		if (instruction->location.segment == segment && (anyMode || instruction->location.mode == mode)) {
+			return instruction;
+		}
+		index = instruction->nextAtAddress;
+	}
+	return NULL;
+}
+
+static struct mCodeInstruction* _addInstruction(struct mCodeAnalysis* analysis, const struct mCodeLocation* location, const struct mCodeInstructionInfo* info, uint32_t flags) {
+	struct mCodeInstruction* instruction = mCodeInstructionListAppend(&analysis->instructions);
+	instruction->location = *location;
+	instruction->info = *info;
+	instruction->flags = flags;
+	instruction->nextAtAddress = (uintptr_t) TableLookup(&analysis->instructionIndex, location->address);
+	TableInsert(&analysis->instructionIndex, location->address, (void*) (uintptr_t) mCodeInstructionListSize(&analysis->instructions));
+	return instruction;
+}
+
+static void _addPending(struct mCodeAnalysis* analysis, const struct mCodeLocation* location, uint32_t flags, bool force) {
+	struct mCodeAnalysisTarget* target = mCodeAnalysisTargetListAppend(&analysis->pending);
+	target->location = *location;
+	target->flags = flags;
+	target->force = force;
+}
+
+void mCodeAnalysisAddEntryPoint(struct mCodeAnalysis* analysis, uint32_t address, int segment, int mode) {
+	struct mCodeLocation location = {
+		.address = address,
+		.segment = segment,
+		.mode = mode
+	};
+	_addPending(analysis, &location, mCODE_INSTRUCTION_LEADER | mCODE_INSTRUCTION_FUNCTION, false);
+}
+
+void mCodeAnalysisAddTarget(struct mCodeAnalysis* analysis, const struct mCodeLocation* from, const struct mCodeLocation* to, enum mCodeXrefType type) {
+	if (from) {
+		struct mCodeXref* xref = mCodeXrefListAppend(&analysis->observedXrefs);
+		xref->from = *from;
+		xref->to = *to;
+		xref->type = type;
+	}
+	if (type == mCODE_XREF_DATA) {
+		return;
+	}
+	uint32_t flags = mCODE_INSTRUCTION_LEADER | mCODE_INSTRUCTION_OBSERVED;
+	if (type == mCODE_XREF_CALL) {
+		flags |= mCODE_INSTRUCTION_FUNCTION;
+	}
+	_addPending(analysis, to, flags, true);
+}
+
+bool mCodeAnalysisObserve(struct mCodeAnalysis* analysis, const struct mCodeLocation* location) {
+	if (_lookup(analysis, location->address, location->segment, location->mode, false)) {
+		return false;
+	}
+	_addPending(analysis, location, mCODE_INSTRUCTION_LEADER | mCODE_INSTRUCTION_OBSERVED, true);
+	return true;
+}
+
+static void _walk(struct mCodeAnalysis* analysis, const struct mCodeAnalysisTarget* target) {
+	const struct mCodeAnalysisPlatform* platform = analysis->platform;
+	struct mCodeLocation location = target->location;
+	uint32_t flags = target->flags;
+	if (!target->force && !platform->isStatic(analysis, &location)) {
+		return;
+	}
+
+	analysis->knownMask = 0;
+	while (true) {
+		struct mCodeInstruction* instruction = _lookup(analysis, location.address, location.segment, location.mode, false);
+		if (instruction) {
+			instruction->flags |= flags;
+			return;
+		}
+		struct mCodeInstructionInfo info;
+		if (!platform->decode(analysis, &location, &info) || !info.length) {
+			return;
+		}
+		_addInstruction(analysis, &location, &info, flags);
+
+		if ((info.flow & (mCODE_FLOW_JUMP | mCODE_FLOW_CALL)) && !(info.flow & mCODE_FLOW_INDIRECT)) {
+			uint32_t targetFlags = mCODE_INSTRUCTION_LEADER;
+			if (info.flow & mCODE_FLOW_CALL) {
+				targetFlags |= mCODE_INSTRUCTION_FUNCTION;
+			}
+			_addPending(analysis, &info.target, targetFlags, false);
+		}
+		if (!(info.flow & mCODE_FLOW_CONTINUES)) {
+			return;
+		}
+		flags = 0;
+		if (info.flow & (mCODE_FLOW_JUMP | mCODE_FLOW_RETURN)) {
+			flags = mCODE_INSTRUCTION_LEADER;
+		}
+		location.address += info.length;
+	}
+}
+
+static bool _endsBlock(const struct mCodeInstruction* instruction) {
+	return !(instruction->info.flow & mCODE_FLOW_CONTINUES) || (instruction->info.flow & (mCODE_FLOW_JUMP | mCODE_FLOW_RETURN));
+}
+
+static ssize_t _blockIndex(const struct mCodeAnalysis* analysis, uint32_t address, int segment) {
+	size_t low = 0;
+	size_t high = mCodeBlockListSize(&analysis->blocks);
+	while (low < high) {
+		size_t mid = low + (high - low) / 2;
+		const struct mCodeBlock* block = mCodeBlockListGetConstPointer(&analysis->blocks, mid);
+		if (block->start.segment < segment || (block->start.segment == segment && block->start.address <= address)) {
+			low = mid + 1;
+		} else {
+			high = mid;
+		}
+	}
+	// Blocks decoded in different modes can overlap, so look back past any that end too early
+	while (low--) {
+		const struct mCodeBlock* block = mCodeBlockListGetConstPointer(&analysis->blocks, low);
+		if (block->start.segment != segment || address >= block->reach) {
+			break;
+		}
+		if (address < block->end) {
+			return low;
+		}
+	}
+	return -1;
+}
+
+static const struct mCodeInstruction* _orderedInstruction(const struct mCodeAnalysis* analysis, size_t index) {
+	return mCodeInstructionListGetConstPointer(&analysis->instructions, *UInt32ListGetConstPointer(&analysis->order, index));
+}
+
+static void _buildBlocks(struct mCodeAnalysis* analysis) {
+	size_t nInstructions = mCodeInstructionListSize(&analysis->instructions);
+	const struct mCodeInstruction** sorted = malloc(nInstructions * sizeof(*sorted));
+	size_t i;
+	for (i = 0; i < nInstructions; ++i) {
+		sorted[i] = mCodeInstructionListGetConstPointer(&analysis->instructions, i);
+	}
+	qsort(sorted, nInstructions, sizeof(*sorted), _compareInstructions);
+
+	UInt32ListClear(&analysis->order);
+	mCodeBlockListClear(&analysis->blocks);
+	const struct mCodeInstruction* previous = NULL;
+	struct mCodeBlock* block = NULL;
+	for (i = 0; i < nInstructions; ++i) {
+		const struct mCodeInstruction* instruction = sorted[i];
+		*UInt32ListAppend(&analysis->order) = instruction - mCodeInstructionListGetConstPointer(&analysis->instructions, 0);
+		if (!previous || (instruction->flags & mCODE_INSTRUCTION_LEADER) || _endsBlock(previous) ||
+		    previous->location.segment != instruction->location.segment || previous->location.mode != instruction->location.mode ||
+		    previous->location.address + previous->info.length != instruction->location.address) {
+			block = mCodeBlockListAppend(&analysis->blocks);
+			block->start = instruction->location;
+			block->firstInstruction = i;
+			block->nInstructions = 0;
+			block->function = -1;
+		}
+		++block->nInstructions;
+		block->end = instruction->location.address + instruction->info.length;
+		previous = instruction;
+	}
+	free(sorted);
+
+	size_t nBlocks = mCodeBlockListSize(&analysis->blocks);
+	if (nBlocks) {
+		qsort(mCodeBlockListGetPointer(&analysis->blocks, 0), nBlocks, sizeof(struct mCodeBlock), _compareBlocks);
+	}
+	const struct mCodeBlock* last = NULL;
+	for (i = 0; i < nBlocks; ++i) {
+		block = mCodeBlockListGetPointer(&analysis->blocks, i);
+		block->reach = block->end;
+		if (last && last->start.segment == block->start.segment && last->reach > block->reach) {
+			block->reach = last->reach;
+		}
+		last = block;
+	}
+}
+
+static void _assignFunctions(struct mCodeAnalysis* analysis) {
+	mCodeFunctionListClear(&analysis->functions);
+	size_t nBlocks = mCodeBlockListSize(&analysis->blocks);
+	size_t* queue = malloc(nBlocks * sizeof(*queue));
+	size_t b;
+	for (b = 0; b < nBlocks; ++b) {
+		struct mCodeBlock* entry = mCodeBlockListGetPointer(&analysis->blocks, b);
+		const struct mCodeInstruction* first = _orderedInstruction(analysis, entry->firstInstruction);
+		if (!(first->flags & mCODE_INSTRUCTION_FUNCTION) || entry->function >= 0) {
+			continue;
+		}
+		ssize_t functionId = mCodeFunctionListSize(&analysis->functions);
+		struct mCodeFunction function = {
+			.entry = entry->start
+		};
+
+		size_t head = 0;
+		size_t tail = 0;
+		entry->function = functionId;
+		queue[tail] = b;
+		++tail;
+		// Follow jumps and fallthrough, but not calls, to find the blocks belonging to this function
+		while (head < tail) {
+			struct mCodeBlock* block = mCodeBlockListGetPointer(&analysis->blocks, queue[head]);
+			++head;
+			++function.nBlocks;
+			function.size += block->end - block->start.address;
+
+			const struct mCodeInstruction* last = _orderedInstruction(analysis, block->firstInstruction + block->nInstructions - 1);
+			struct mCodeLocation successors[2];
+			size_t nSuccessors = 0;
+			if (last->info.flow & mCODE_FLOW_CONTINUES) {
+				successors[nSuccessors] = last->location;
+				successors[nSuccessors].address = block->end;
+				++nSuccessors;
+			}
+			if ((last->info.flow & mCODE_FLOW_JUMP) && !(last->info.flow & mCODE_FLOW_INDIRECT)) {
+				successors[nSuccessors] = last->info.target;
+				++nSuccessors;
+			}
+			size_t s;
+			for (s = 0; s < nSuccessors; ++s) {
+				ssize_t next = _blockIndex(analysis, successors[s].address, successors[s].segment);
+				if (next < 0) {
+					continue;
+				}
+				struct mCodeBlock* nextBlock = mCodeBlockListGetPointer(&analysis->blocks, next);
+				if (nextBlock->function >= 0 || nextBlock->start.address != successors[s].address) {
+					continue;
+				}
+				if (_orderedInstruction(analysis, nextBlock->firstInstruction)->flags & mCODE_INSTRUCTION_FUNCTION) {
+					// Tail call
+					continue;
+				}
+				nextBlock->function = functionId;
+				queue[tail] = next;
+				++tail;
+			}
+		}
+		*mCodeFunctionListAppend(&analysis->functions) = function;
+	}
+	free(queue);
+}
+
+static void _buildXrefs(struct mCodeAnalysis* analysis) {
+	mCodeXrefListClear(&analysis->xrefs);
+	size_t i;
+	for (i = 0; i < mCodeInstructionListSize(&analysis->instructions); ++i) {
+		const struct mCodeInstruction* instruction = mCodeInstructionListGetConstPointer(&analysis->instructions, i);
+		if ((instruction->info.flow & (mCODE_FLOW_JUMP | mCODE_FLOW_CALL)) && !(instruction->info.flow & mCODE_FLOW_INDIRECT)) {
+			struct mCodeXref* xref = mCodeXrefListAppend(&analysis->xrefs);
+			xref->from = instruction->location;
+			xref->to = instruction->info.target;
+			xref->type = (instruction->info.flow & mCODE_FLOW_CALL) ? mCODE_XREF_CALL : mCODE_XREF_JUMP;
+		}
+		if (instruction->info.flow & mCODE_FLOW_DATA) {
+			struct mCodeXref* xref = mCodeXrefListAppend(&analysis->xrefs);
+			xref->from = instruction->location;
+			xref->to = instruction->info.data;
+			xref->type = mCODE_XREF_DATA;
+		}
+	}
+	for (i = 0; i < mCodeXrefListSize(&analysis->observedXrefs); ++i) {
+		*mCodeXrefListAppend(&analysis->xrefs) = *mCodeXrefListGetConstPointer(&analysis->observedXrefs, i);
+	}
+	qsort(mCodeXrefListGetPointer(&analysis->xrefs, 0), mCodeXrefListSize(&analysis->xrefs), sizeof(struct mCodeXref), _compareXrefs);
+}
+
+void mCodeAnalysisRun(struct mCodeAnalysis* analysis) {
+	if (!analysis->platform) {
+		return;
+	}
+	while (mCodeAnalysisTargetListSize(&analysis->pending)) {
+		struct mCodeAnalysisTarget target = *mCodeAnalysisTargetListGetConstPointer(&analysis->pending, mCodeAnalysisTargetListSize(&analysis->pending) - 1);
+		mCodeAnalysisTargetListResize(&analysis->pending, -1);
+		_walk(analysis, &target);
+	}
+	_buildBlocks(analysis);
+	_assignFunctions(analysis);
+	_buildXrefs(analysis);
+}
+
+const struct mCodeInstruction* mCodeAnalysisInstructionAt(const struct mCodeAnalysis* analysis, uint32_t address, int segment) {
+	return _lookup(analysis, address, segment, 0, true);
+}
+
+const struct mCodeBlock* mCodeAnalysisBlockAt(const struct mCodeAnalysis* analysis, uint32_t address, int segment) {
+	ssize_t index = _blockIndex(analysis, address, segment);
+	if (index < 0) {
+		return NULL;
+	}
+	return mCodeBlockListGetConstPointer(&analysis->blocks, index);
+}
+
+const struct mCodeFunction* mCodeAnalysisFunctionAt(const struct mCodeAnalysis* analysis, uint32_t address, int segment) {
+	const struct mCodeBlock* block = mCodeAnalysisBlockAt(analysis, address, segment);
+	if (!block || block->function < 0) {
+		return NULL;
+	}
+	return mCodeFunctionListGetConstPointer(&analysis->functions, block->function);
+}
+
+size_t mCodeAnalysisXrefsTo(const struct mCodeAnalysis* analysis, uint32_t address, int segment, const struct mCodeXref** xrefs) {
+	size_t low = 0;
+	size_t high = mCodeXrefListSize(&analysis->xrefs);
+	while (low < high) {
+		size_t mid = low + (high - low) / 2;
+		const struct mCodeXref* xref = mCodeXrefListGetConstPointer(&analysis->xrefs, mid);
+		if (xref->to.segment < segment || (xref->to.segment == segment && xref->to.address < address)) {
+			low = mid + 1;
+		} else {
+			high = mid;
+		}
+	}
+	size_t end;
+	for (end = low; end < mCodeXrefListSize(&analysis->xrefs); ++end) {
+		const struct mCodeXref* xref = mCodeXrefListGetConstPointer(&analysis->xrefs, end);
+		if (xref->to.segment != segment || xref->to.address != address) {
+			break;
+		}
+	}
+	if (end > low) {
+		*xrefs = mCodeXrefListGetConstPointer(&analysis->xrefs, low);
+	} else {
+		*xrefs = NULL;
+	}
+	return end - low;
+}
+
+struct VFile* mCodeAnalysisOpenCache(const struct mCodeAnalysis* analysis, struct VDir* dir, bool write) {
+	char name[16];
+	snprintf(name, sizeof(name), "%08X.cfg", analysis->romCrc32);
+	return dir->openFile(dir, name, write ? O_CREAT | O_TRUNC | O_WRONLY : O_RDONLY);
+}
+
+static void _storeLocation(const struct mCodeLocation* location, struct mCodeAnalysisLocationRecord* record) {
+	STORE_32LE(location->address, 0, &record->address);
+	STORE_32LE(location->segment, 0, &record->segment);
+	STORE_32LE(location->mode, 0, &record->mode);
+}
+
+static void _loadLocation(struct mCodeLocation* location, const struct mCodeAnalysisLocationRecord* record) {
+	int32_t segment;
+	uint32_t mode;
+	LOAD_32LE(location->address, 0, &record->address);
+	LOAD_32LE(segment, 0, &record->segment);
+	LOAD_32LE(mode, 0, &record->mode);
+	location->segment = segment;
+	location->mode = mode;
+}
+
+bool mCodeAnalysisSave(const struct mCodeAnalysis* analysis, struct VFile* vf) {
+	struct mCodeAnalysisHeader header = {0};
+	memcpy(header.magic, mCA_MAGIC, sizeof(header.magic));
+	STORE_32LE(1, 0, &header.version);
+	STORE_32LE(analysis->platform ? analysis->platform->id : 0, 0, &header.platform);
+	STORE_32LE(analysis->romCrc32, 0, &header.romCrc32);
+	STORE_32LE(mCodeInstructionListSize(&analysis->instructions), 0, &header.instructions);
+	STORE_32LE(mCodeXrefListSize(&analysis->observedXrefs), 0, &header.xrefs);
+	if (vf->write(vf, &header, sizeof(header)) != sizeof(header)) {
+		return false;
+	}
+
+	size_t i;
+	for (i = 0; i < mCodeInstructionListSize(&analysis->instructions); ++i) {
+		const struct mCodeInstruction* instruction = mCodeInstructionListGetConstPointer(&analysis->instructions, i);
+		struct mCodeAnalysisInstructionRecord record;
+		_storeLocation(&instruction->location, &record.location);
+		_storeLocation(&instruction->info.target, &record.target);
+		_storeLocation(&instruction->info.data, &record.data);
+		STORE_32LE(instruction->info.length, 0, &record.length);
+		STORE_32LE(instruction->info.flow, 0, &record.flow);
+		STORE_32LE(instruction->flags, 0, &record.flags);
+		if (vf->write(vf, &record, sizeof(record)) != sizeof(record)) {
+			return false;
+		}
+	}
+	for (i = 0; i < mCodeXrefListSize(&analysis->observedXrefs); ++i) {
+		const struct mCodeXref* xref = mCodeXrefListGetConstPointer(&analysis->observedXrefs, i);
+		struct mCodeAnalysisXrefRecord record = {0};
+		_storeLocation(&xref->from, &record.from);
+		_storeLocation(&xref->to, &record.to);
+		STORE_32LE(xref->type, 0, &record.type);
+		if (vf->write(vf, &record, sizeof(record)) != sizeof(record)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+bool mCodeAnalysisLoad(struct mCodeAnalysis* analysis, struct VFile* vf) {
+	struct mCodeAnalysisHeader header;
+	vf->seek(vf, 0, SEEK_SET);
+	if (vf->read(vf, &header, sizeof(header)) != sizeof(header)) {
+		return false;
+	}
+	if (memcmp(header.magic, mCA_MAGIC, sizeof(header.magic)) != 0) {
+		return false;
+	}
+	uint32_t version;
+	uint32_t platform;
+	uint32_t crc32;
+	uint32_t nInstructions;
+	uint32_t nXrefs;
+	LOAD_32LE(version, 0, &header.version);
+	LOAD_32LE(platform, 0, &header.platform);
+	LOAD_32LE(crc32, 0, &header.romCrc32);
+	LOAD_32LE(nInstructions, 0, &header.instructions);
+	LOAD_32LE(nXrefs, 0, &header.xrefs);
+	if (version != 1 || !analysis->platform || platform != analysis->platform->id || crc32 != analysis->romCrc32) {
+		return false;
+	}
+
+	// The counts are only trusted as far as the file has room for them
+	uint64_t recordsSize = (uint64_t) nInstructions * sizeof(struct mCodeAnalysisInstructionRecord);
+	recordsSize += (uint64_t) nXrefs * sizeof(struct mCodeAnalysisXrefRecord);
+	ssize_t size = vf->size(vf);
+	if (size < (ssize_t) sizeof(header) || recordsSize > (uint64_t) size - sizeof(header)) {
+		return false;
+	}
+
+	struct mCodeInstructionList instructions;
+	struct mCodeXrefList xrefs;
+	mCodeInstructionListInit(&instructions, nInstructions);
+	mCodeXrefListInit(&xrefs, nXrefs);
+	bool success = true;
+	size_t i;
+	for (i = 0; i < nInstructions && success; ++i) {
+		struct mCodeAnalysisInstructionRecord record;
+		if (vf->read(vf, &record, sizeof(record)) != sizeof(record)) {
+			success = false;
+			break;
+		}
+		struct mCodeInstruction* instruction = mCodeInstructionListAppend(&instructions);
+		_loadLocation(&instruction->location, &record.location);
+		_loadLocation(&instruction->info.target, &record.target);
+		_loadLocation(&instruction->info.data, &record.data);
+		LOAD_32LE(instruction->info.length, 0, &record.length);
+		LOAD_32LE(instruction->info.flow, 0, &record.flow);
+		LOAD_32LE(instruction->flags, 0, &record.flags);
+	}
+	for (i = 0; i < nXrefs && success; ++i) {
+		struct mCodeAnalysisXrefRecord record;
+		if (vf->read(vf, &record, sizeof(record)) != sizeof(record)) {
+			success = false;
+			break;
+		}
+		struct mCodeXref* xref = mCodeXrefListAppend(&xrefs);
+		uint32_t type;
+		_loadLocation(&xref->from, &record.from);
+		_loadLocation(&xref->to, &record.to);
+		LOAD_32LE(type, 0, &record.type);
+		xref->type = type;
+	}
+
+	if (success) {
+		// Anything already analyzed is replaced, but pending targets are kept
+		TableClear(&analysis->instructionIndex);
+		mCodeInstructionListClear(&analysis->instructions);
+		mCodeXrefListClear(&analysis->observedXrefs);
+		for (i = 0; i < nInstructions; ++i) {
+			const struct mCodeInstruction* instruction = mCodeInstructionListGetConstPointer(&instructions, i);
+			_addInstruction(analysis, &instruction->location, &instruction->info, instruction->flags);
+		}
+		mCodeXrefListCopy(&analysis->observedXrefs, &xrefs);
+	}
+	mCodeInstructionListDeinit(&instructions);
+	mCodeXrefListDeinit(&xrefs);
+	return success;
+}
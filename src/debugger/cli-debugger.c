@@ -15,6 +15,7 @@
 #include <mgba/core/version.h>
 #include <mgba/internal/debugger/parser.h>
 #include <mgba/internal/debugger/stack-trace.h>
+#include <mgba/internal/debugger/tracer.h>
 #ifdef USE_ELF
 #include <mgba-util/elf-read.h>
 #endif
@@ -67,6 +68,7 @@ static void _setWriteRangeWatchpoint(struct CLIDebugger*, struct CLIDebugVector*
 static void _setWriteChangedRangeWatchpoint(struct CLIDebugger*, struct CLIDebugVector*);
 static void _listWatchpoints(struct CLIDebugger*, struct CLIDebugVector*);
 static void _trace(struct CLIDebugger*, struct CLIDebugVector*);
+static void _binaryTrace(struct CLIDebugger*, struct CLIDebugVector*);
 static void _writeByte(struct CLIDebugger*, struct CLIDebugVector*);
 static void _writeHalfword(struct CLIDebugger*, struct CLIDebugVector*);
 static void _writeRegister(struct CLIDebugger*, struct CLIDebugVector*);
@@ -111,6 +113,7 @@ static struct CLIDebuggerCommandSummary _debuggerCommands[] = {
 	{ "symbol", _findSymbol, "I", "Find the symbol name for an address" },
 	{ "load-symbols", _loadSymbols, "S", "Load symbols from an external file" },
 	{ "trace", _trace, "Is", "Trace a number of instructions" },
+	{ "trace/b", _binaryTrace, "ss", "Record a binary trace to a file (with regs, mem or all deltas), or stop recording" },
 	{ "w/1", _writeByte, "II", "Write a byte at a specified offset" },
 	{ "w/2", _writeHalfword, "II", "Write a halfword at a specified offset" },
 	{ "w/r", _writeRegister, "SI", "Write a register" },
@@ -840,6 +843,69 @@ static void _trace(struct CLIDebugger* debugger, struct CLIDebugVector* dv) {
 	}
 }
 
+static void _stopBinaryTrace(struct CLIDebugger* debugger) {
+	struct mDebuggerTracer* tracer = debugger->tracer;
+	if (!tracer) {
+		return;
+	}
+	bool written = mDebuggerTracerClose(tracer);
+	mDebuggerTracerDeinit(tracer);
+	mDebuggerDetachModule(debugger->d.p, &tracer->d);
+	debugger->tracer = NULL;
+	if (!written) {
+		debugger->backend->printf(debugger->backend, "Could not write the trace; recording stopped early\n");
+	}
+	debugger->backend->printf(debugger->backend, "Recorded %" PRIu64 " instructions\n", tracer->instructions);
+	free(tracer);
+}
+
+static void _binaryTrace(struct CLIDebugger* debugger, struct CLIDebugVector* dv) {
+	if (!dv) {
+		if (!debugger->tracer) {
+			debugger->backend->printf(debugger->backend, "%s\n", ERROR_MISSING_ARGS);
+		}
+		_stopBinaryTrace(debugger);
+		return;
+	}
+	if (dv->type != CLIDV_CHAR_TYPE) {
+		debugger->backend->printf(debugger->backend, "%s\n", ERROR_INVALID_ARGS);
+		return;
+	}
+	mDebuggerTracerFlags flags = 0;
+	if (dv->next && dv->next->charValue) {
+		const char* deltas = dv->next->charValue;
+		if (strcmp(deltas, "regs") == 0) {
+			flags = mDebuggerTracerFlagsFillRegisters(flags);
+		} else if (strcmp(deltas, "mem") == 0) {
+			flags = mDebuggerTracerFlagsFillMemory(flags);
+		} else if (strcmp(deltas, "all") == 0) {
+			flags = mDebuggerTracerFlagsFillRegisters(flags);
+			flags = mDebuggerTracerFlagsFillMemory(flags);
+		} else {
+			debugger->backend->printf(debugger->backend, "%s\n", ERROR_INVALID_ARGS);
+			return;
+		}
+	}
+	_stopBinaryTrace(debugger);
+
+	struct VFile* vf = VFileOpen(dv->charValue, O_CREAT | O_WRONLY | O_TRUNC);
+	if (!vf) {
+		debugger->backend->printf(debugger->backend, "Could not open %s\n", dv->charValue);
+		return;
+	}
+	struct mDebuggerTracer* tracer = malloc(sizeof(*tracer));
+	mDebuggerTracerInit(tracer);
+	mDebuggerAttachModule(debugger->d.p, &tracer->d);
+	if (!mDebuggerTracerOpen(tracer, vf, flags)) {
+		debugger->backend->printf(debugger->backend, "Binary tracing is not supported by this platform.\n");
+		mDebuggerDetachModule(debugger->d.p, &tracer->d);
+		free(tracer);
+		vf->close(vf);
+		return;
+	}
+	debugger->tracer = tracer;
+}
+
 static bool _doTrace(struct CLIDebugger* debugger) {
 	char trace[1024];
 	trace[sizeof(trace) - 1] = '\0';
@@ -1198,6 +1264,7 @@ static void _cliDebuggerInit(struct mDebuggerModule* debugger) {
 	struct CLIDebugger* cliDebugger = (struct CLIDebugger*) debugger;
 	cliDebugger->traceRemaining = 0;
 	cliDebugger->traceVf = NULL;
+	cliDebugger->tracer = NULL;
 	cliDebugger->skipStatus = false;
 	cliDebugger->backend->init(cliDebugger->backend);
 	if (cliDebugger->system && cliDebugger->system->init) {
@@ -1211,6 +1278,7 @@ static void _cliDebuggerDeinit(struct mDebuggerModule* debugger) {
 		cliDebugger->traceVf->close(cliDebugger->traceVf);
 		cliDebugger->traceVf = NULL;
 	}
+	_stopBinaryTrace(cliDebugger);
 
 	if (cliDebugger->system) {
 		if (cliDebugger->system->deinit) {
@@ -63,6 +63,7 @@ struct mDebuggerModule* mDebuggerCreateModule(enum mDebuggerType type, struct mC
 #endif
 	case DEBUGGER_NONE:
 	case DEBUGGER_ACCESS_LOGGER:
+	case DEBUGGER_TRACER:
 	case DEBUGGER_CUSTOM:
 	case DEBUGGER_MAX:
 		free(debugger);
@@ -129,7 +130,7 @@ void mDebuggerRunTimeout(struct mDebugger* debugger, int32_t timeoutMs) {
 
 	switch (debugger->state) {
 	case DEBUGGER_RUNNING:
-		if (!debugger->platform->hasBreakpoints(debugger->platform)) {
+		if (!debugger->platform->requiresStepping(debugger->platform)) {
 			debugger->core->runLoop(debugger->core);
 		} else {
 			debugger->core->step(debugger->core);
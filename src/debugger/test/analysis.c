@@ -0,0 +1,311 @@
+/* Copyright (c) 2013-2024 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "util/test/suite.h"
+
+#include <mgba/core/core.h>
+#include <mgba/internal/debugger/analysis.h>
+#include <mgba-util/vfs.h>
+
+enum {
+	OP_NOP,
+	OP_JMP,
+	OP_JZ,
+	OP_CALL,
+	OP_RET,
+	OP_LOAD,
+	OP_JMPI,
+};
+
+static uint8_t _rom[0x100];
+static uint32_t _crc;
+
+static const uint8_t _program[] = {
+	OP_CALL, 0x10,
+	OP_JZ, 0x08,
+	OP_LOAD, 0x80,
+	OP_JMP, 0x00,
+	OP_RET, 0,
+	0, 0, 0, 0, 0, 0,
+	OP_NOP, 0,
+	OP_RET, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	OP_NOP, 0,
+	OP_JMPI, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	OP_NOP, 0,
+	OP_RET, 0,
+};
+
+static void _checksum(const struct mCore* core, void* data, enum mCoreChecksumType type) {
+	UNUSED(core);
+	UNUSED(type);
+	memcpy(data, &_crc, sizeof(_crc));
+}
+
+static bool _isStatic(struct mCodeAnalysis* analysis, const struct mCodeLocation* location) {
+	UNUSED(analysis);
+	return location->address < 0x80;
+}
+
+static bool _decode(struct mCodeAnalysis* analysis, const struct mCodeLocation* location, struct mCodeInstructionInfo* info) {
+	UNUSED(analysis);
+	memset(info, 0, sizeof(*info));
+	if (location->address >= sizeof(_rom) - 1) {
+		return false;
+	}
+	uint8_t arg = _rom[location->address + 1];
+	info->length = 2;
+	info->flow = mCODE_FLOW_CONTINUES;
+	switch (_rom[location->address]) {
+	case OP_NOP:
+		// Mode 1 decodes the same bytes differently, so its blocks can overlap mode 0's
+		if (location->mode == 1) {
+			info->flow = mCODE_FLOW_RETURN;
+		}
+		break;
+	case OP_JMP:
+		info->flow = mCODE_FLOW_JUMP;
+		info->target.address = arg;
+		break;
+	case OP_JZ:
+		info->flow = mCODE_FLOW_JUMP | mCODE_FLOW_CONTINUES;
+		info->target.address = arg;
+		break;
+	case OP_CALL:
+		info->flow = mCODE_FLOW_CALL | mCODE_FLOW_CONTINUES;
+		info->target.address = arg;
+		break;
+	case OP_RET:
+		info->flow = mCODE_FLOW_RETURN;
+		break;
+	case OP_LOAD:
+		info->flow = mCODE_FLOW_DATA | mCODE_FLOW_CONTINUES;
+		info->data.address = arg;
+		break;
+	case OP_JMPI:
+		info->flow = mCODE_FLOW_JUMP | mCODE_FLOW_INDIRECT;
+		break;
+	default:
+		return false;
+	}
+	return true;
+}
+
+static void _addEntryPoints(struct mCodeAnalysis* analysis) {
+	mCodeAnalysisAddEntryPoint(analysis, 0, 0, 0);
+}
+
+static const struct mCodeAnalysisPlatform _platform = {
+	.id = 0x1234,
+	.decode = _decode,
+	.isStatic = _isStatic,
+	.addEntryPoints = _addEntryPoints,
+};
+
+static void _setup(struct mCore* core, struct mCodeAnalysis* analysis) {
+	memset(core, 0, sizeof(*core));
+	core->checksum = _checksum;
+	memset(_rom, 0xFF, sizeof(_rom));
+	memcpy(_rom, _program, sizeof(_program));
+	_crc = 0xC0DE;
+	mCodeAnalysisInit(analysis, core, &_platform);
+	mCodeAnalysisRun(analysis);
+}
+
+M_TEST_DEFINE(analysisBlocks) {
+	struct mCore core;
+	struct mCodeAnalysis analysis;
+	_setup(&core, &analysis);
+
+	assert_int_equal(mCodeInstructionListSize(&analysis.instructions), 7);
+	assert_int_equal(mCodeBlockListSize(&analysis.blocks), 4);
+
+	const struct mCodeBlock* block = mCodeAnalysisBlockAt(&analysis, 0x00, 0);
+	assert_non_null(block);
+	assert_int_equal(block->start.address, 0x00);
+	assert_int_equal(block->end, 0x04);
+	assert_int_equal(block->nInstructions, 2);
+
+	block = mCodeAnalysisBlockAt(&analysis, 0x05, 0);
+	assert_non_null(block);
+	assert_int_equal(block->start.address, 0x04);
+	assert_int_equal(block->end, 0x08);
+
+	block = mCodeAnalysisBlockAt(&analysis, 0x08, 0);
+	assert_non_null(block);
+	assert_int_equal(block->start.address, 0x08);
+	assert_int_equal(block->nInstructions, 1);
+
+	assert_null(mCodeAnalysisBlockAt(&analysis, 0x0C, 0));
+	assert_null(mCodeAnalysisBlockAt(&analysis, 0x00, 1));
+	assert_null(mCodeAnalysisInstructionAt(&analysis, 0x20, 0));
+
+	const struct mCodeInstruction* instruction = mCodeAnalysisInstructionAt(&analysis, 0x08, 0);
+	assert_non_null(instruction);
+	assert_true(instruction->flags & mCODE_INSTRUCTION_LEADER);
+	assert_int_equal(instruction->info.flow, mCODE_FLOW_RETURN);
+
+	mCodeAnalysisDeinit(&analysis);
+}
+
+M_TEST_DEFINE(analysisOverlap) {
+	struct mCore core;
+	struct mCodeAnalysis analysis;
+	_setup(&core, &analysis);
+
+	// A long block in mode 0 with short blocks in mode 1 starting inside of it
+	memset(&_rom[0x40], OP_NOP, 0x10);
+	_rom[0x50] = OP_RET;
+	mCodeAnalysisAddEntryPoint(&analysis, 0x40, 0, 0);
+	mCodeAnalysisAddEntryPoint(&analysis, 0x44, 0, 1);
+	mCodeAnalysisAddEntryPoint(&analysis, 0x48, 0, 1);
+	mCodeAnalysisRun(&analysis);
+
+	const struct mCodeBlock* block = mCodeAnalysisBlockAt(&analysis, 0x48, 0);
+	assert_non_null(block);
+	assert_int_equal(block->start.address, 0x48);
+	assert_int_equal(block->start.mode, 1);
+
+	// Past the end of both mode 1 blocks, only the mode 0 block is left
+	block = mCodeAnalysisBlockAt(&analysis, 0x4C, 0);
+	assert_non_null(block);
+	assert_int_equal(block->start.address, 0x40);
+	assert_int_equal(block->start.mode, 0);
+	assert_int_equal(block->end, 0x52);
+
+	assert_null(mCodeAnalysisBlockAt(&analysis, 0x52, 0));
+
+	mCodeAnalysisDeinit(&analysis);
+}
+
+M_TEST_DEFINE(analysisFunctions) {
+	struct mCore core;
+	struct mCodeAnalysis analysis;
+	_setup(&core, &analysis);
+
+	assert_int_equal(mCodeFunctionListSize(&analysis.functions), 2);
+
+	const struct mCodeFunction* function = mCodeAnalysisFunctionAt(&analysis, 0x08, 0);
+	assert_non_null(function);
+	assert_int_equal(function->entry.address, 0x00);
+	assert_int_equal(function->nBlocks, 3);
+	assert_int_equal(function->size, 10);
+
+	function = mCodeAnalysisFunctionAt(&analysis, 0x12, 0);
+	assert_non_null(function);
+	assert_int_equal(function->entry.address, 0x10);
+	assert_int_equal(function->nBlocks, 1);
+
+	mCodeAnalysisDeinit(&analysis);
+}
+
+M_TEST_DEFINE(analysisXrefs) {
+	struct mCore core;
+	struct mCodeAnalysis analysis;
+	_setup(&core, &analysis);
+
+	const struct mCodeXref* xrefs;
+	assert_int_equal(mCodeAnalysisXrefsTo(&analysis, 0x00, 0, &xrefs), 1);
+	assert_int_equal(xrefs[0].from.address, 0x06);
+	assert_int_equal(xrefs[0].type, mCODE_XREF_JUMP);
+
+	assert_int_equal(mCodeAnalysisXrefsTo(&analysis, 0x10, 0, &xrefs), 1);
+	assert_int_equal(xrefs[0].from.address, 0x00);
+	assert_int_equal(xrefs[0].type, mCODE_XREF_CALL);
+
+	assert_int_equal(mCodeAnalysisXrefsTo(&analysis, 0x80, 0, &xrefs), 1);
+	assert_int_equal(xrefs[0].from.address, 0x04);
+	assert_int_equal(xrefs[0].type, mCODE_XREF_DATA);
+
+	assert_int_equal(mCodeAnalysisXrefsTo(&analysis, 0x12, 0, &xrefs), 0);
+	assert_null(xrefs);
+
+	mCodeAnalysisDeinit(&analysis);
+}
+
+M_TEST_DEFINE(analysisObserve) {
+	struct mCore core;
+	struct mCodeAnalysis analysis;
+	_setup(&core, &analysis);
+
+	struct mCodeLocation location = { .address = 0x20 };
+	assert_true(mCodeAnalysisObserve(&analysis, &location));
+	mCodeAnalysisRun(&analysis);
+	assert_false(mCodeAnalysisObserve(&analysis, &location));
+	assert_int_equal(mCodeInstructionListSize(&analysis.instructions), 9);
+	assert_true(mCodeAnalysisInstructionAt(&analysis, 0x20, 0)->flags & mCODE_INSTRUCTION_OBSERVED);
+	assert_null(mCodeAnalysisFunctionAt(&analysis, 0x20, 0));
+
+	// Resolve the indirect jump as a call
+	struct mCodeLocation from = { .address = 0x22 };
+	location.address = 0x30;
+	mCodeAnalysisAddTarget(&analysis, &from, &location, mCODE_XREF_CALL);
+	mCodeAnalysisRun(&analysis);
+	assert_int_equal(mCodeFunctionListSize(&analysis.functions), 3);
+	assert_non_null(mCodeAnalysisFunctionAt(&analysis, 0x32, 0));
+
+	const struct mCodeXref* xrefs;
+	assert_int_equal(mCodeAnalysisXrefsTo(&analysis, 0x30, 0, &xrefs), 1);
+	assert_int_equal(xrefs[0].from.address, 0x22);
+
+	mCodeAnalysisDeinit(&analysis);
+}
+
+M_TEST_DEFINE(analysisCache) {
+	struct mCore core;
+	struct mCodeAnalysis analysis;
+	_setup(&core, &analysis);
+
+	struct mCodeLocation from = { .address = 0x22 };
+	struct mCodeLocation location = { .address = 0x30 };
+	mCodeAnalysisAddTarget(&analysis, &from, &location, mCODE_XREF_CALL);
+	mCodeAnalysisRun(&analysis);
+
+	struct VFile* vf = VFileMemChunk(NULL, 0);
+	assert_true(mCodeAnalysisSave(&analysis, vf));
+	mCodeAnalysisDeinit(&analysis);
+
+	// Wipe the ROM so that nothing can be rediscovered from it
+	memset(_rom, 0xFF, sizeof(_rom));
+	mCodeAnalysisInit(&analysis, &core, &_platform);
+	assert_true(mCodeAnalysisLoad(&analysis, vf));
+	mCodeAnalysisRun(&analysis);
+	assert_int_equal(mCodeInstructionListSize(&analysis.instructions), 9);
+	assert_int_equal(mCodeBlockListSize(&analysis.blocks), 5);
+	assert_int_equal(mCodeFunctionListSize(&analysis.functions), 3);
+
+	const struct mCodeXref* xrefs;
+	assert_int_equal(mCodeAnalysisXrefsTo(&analysis, 0x30, 0, &xrefs), 1);
+	assert_int_equal(mCodeAnalysisXrefsTo(&analysis, 0x80, 0, &xrefs), 1);
+	mCodeAnalysisDeinit(&analysis);
+
+	// Counts larger than the file holds are rejected up front
+	uint32_t instructions;
+	vf->seek(vf, 0x10, SEEK_SET);
+	vf->read(vf, &instructions, sizeof(instructions));
+	vf->seek(vf, 0x10, SEEK_SET);
+	vf->write(vf, &(uint32_t) { 0x10000000 }, sizeof(uint32_t));
+	mCodeAnalysisInit(&analysis, &core, &_platform);
+	assert_false(mCodeAnalysisLoad(&analysis, vf));
+	mCodeAnalysisDeinit(&analysis);
+	vf->seek(vf, 0x10, SEEK_SET);
+	vf->write(vf, &instructions, sizeof(instructions));
+
+	_crc = 0xBAD;
+	mCodeAnalysisInit(&analysis, &core, &_platform);
+	assert_false(mCodeAnalysisLoad(&analysis, vf));
+	mCodeAnalysisDeinit(&analysis);
+
+	vf->close(vf);
+}
+
+M_TEST_SUITE_DEFINE(CodeAnalysis,
+	cmocka_unit_test(analysisBlocks),
+	cmocka_unit_test(analysisOverlap),
+	cmocka_unit_test(analysisFunctions),
+	cmocka_unit_test(analysisXrefs),
+	cmocka_unit_test(analysisObserve),
+	cmocka_unit_test(analysisCache))
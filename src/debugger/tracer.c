@@ -0,0 +1,312 @@
+/* Copyright (c) 2013-2024 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include <mgba/internal/debugger/tracer.h>
+
+#include <mgba/core/core.h>
+#include <mgba/core/timing.h>
+#include <mgba-util/vfs.h>
+
+#ifdef USE_ZLIB
+#include <zlib.h>
+#endif
+
+static const char mTR_MAGIC[] = "mTR\0";
+
+struct mDebuggerTraceHeader {
+	char magic[4];
+	uint32_t version;
+	uint32_t platform;
+	mDebuggerTracerFlags flags;
+	uint32_t romCrc32;
+	uint32_t recordSize;
+	uint64_t reserved;
+};
+static_assert(sizeof(struct mDebuggerTraceHeader) == 0x20, "mDebuggerTraceHeader struct sized wrong");
+
+enum mDebuggerTraceBlockFlag {
+	mTRACE_BLOCK_COMPRESSED = 1
+};
+
+struct mDebuggerTraceBlockHeader {
+	uint32_t length;
+	uint32_t records;
+	uint32_t flags;
+	uint32_t reserved;
+	uint64_t startCycles;
+};
+static_assert(sizeof(struct mDebuggerTraceBlockHeader) == 0x18, "mDebuggerTraceBlockHeader struct sized wrong");
+
+static bool _flush(struct mDebuggerTracer* tracer) {
+	if (!tracer->nRecords) {
+		return true;
+	}
+	struct mDebuggerTraceBlockHeader header = {0};
+	size_t size = tracer->nRecords * sizeof(struct mDebuggerTraceRecord);
+	const void* data = tracer->records;
+	uint32_t flags = 0;
+#ifdef USE_ZLIB
+	uLongf compressedSize = compressBound(size);
+	uint8_t* compressed = malloc(compressedSize);
+	if (compress2(compressed, &compressedSize, (const Bytef*) tracer->records, size, Z_BEST_SPEED) == Z_OK && compressedSize < size) {
+		data = compressed;
+		size = compressedSize;
+		flags |= mTRACE_BLOCK_COMPRESSED;
+	}
+#endif
+	STORE_32LE(size, 0, &header.length);
+	STORE_32LE(tracer->nRecords, 0, &header.records);
+	STORE_32LE(flags, 0, &header.flags);
+	STORE_64LE(tracer->blockStart, 0, &header.startCycles);
+	bool written = tracer->vf->write(tracer->vf, &header, sizeof(header)) == sizeof(header) &&
+	               tracer->vf->write(tracer->vf, data, size) == (ssize_t) size;
+#ifdef USE_ZLIB
+	free(compressed);
+#endif
+
+	tracer->nRecords = 0;
+	tracer->blockStart = tracer->lastCycles;
+	tracer->keyframe = true;
+	if (!written) {
+		// A partial block would corrupt everything after it, so stop recording
+		tracer->failed = true;
+	}
+	return written;
+}
+
+static struct mDebuggerTraceRecord* _append(struct mDebuggerTracer* tracer, enum mDebuggerTraceRecordType type) {
+	if (tracer->nRecords == mDEBUGGER_TRACE_BLOCK_RECORDS) {
+		_flush(tracer);
+	}
+	uint64_t cycles = mTimingGlobalTime(tracer->d.p->core->timing);
+	struct mDebuggerTraceRecord* record = &tracer->records[tracer->nRecords];
+	++tracer->nRecords;
+	memset(record, 0, sizeof(*record));
+	record->type = type;
+	STORE_32LE(cycles - tracer->lastCycles, 0, &record->cycles);
+	tracer->lastCycles = cycles;
+	return record;
+}
+
+static void _instruction(struct mInstructionHook* hook, uint32_t pc, uint32_t opcode, uint32_t mode, const uint32_t* regs, size_t nRegs) {
+	struct mDebuggerTracer* tracer = hook->context;
+	if (tracer->failed) {
+		return;
+	}
+	struct mDebuggerTraceRecord* record;
+	if (mDebuggerTracerFlagsIsRegisters(tracer->flags)) {
+		if (nRegs > mDEBUGGER_TRACE_MAX_REGISTERS) {
+			nRegs = mDEBUGGER_TRACE_MAX_REGISTERS;
+		}
+		if (tracer->nRecords + nRegs > mDEBUGGER_TRACE_BLOCK_RECORDS && !_flush(tracer)) {
+			return;
+		}
+		// Each block starts with the full register file so it can be read alone.
+		// The program counter comes last and is implied by the instruction record.
+		bool keyframe = tracer->keyframe;
+		tracer->keyframe = false;
+		size_t i;
+		for (i = 0; i < nRegs - 1; ++i) {
+			if (regs[i] == tracer->regs[i] && !keyframe) {
+				continue;
+			}
+			tracer->regs[i] = regs[i];
+			record = _append(tracer, mTRACE_RECORD_REGISTER);
+			record->index = i;
+			STORE_32LE(regs[i], 0, &record->value);
+		}
+	}
+
+	record = _append(tracer, mTRACE_RECORD_INSTRUCTION);
+	STORE_32LE(pc, 0, &record->address);
+	STORE_32LE(opcode, 0, &record->value);
+	STORE_32LE(mode, 0, &record->mode);
+	++tracer->instructions;
+}
+
+static void _write(struct mInstructionHook* hook, uint32_t address, uint32_t value, int width) {
+	struct mDebuggerTracer* tracer = hook->context;
+	if (tracer->failed) {
+		return;
+	}
+	struct mDebuggerTraceRecord* record = _append(tracer, mTRACE_RECORD_MEMORY);
+	record->index = width;
+	STORE_32LE(address, 0, &record->address);
+	STORE_32LE(value, 0, &record->value);
+}
+
+static void _mDebuggerTracerEntered(struct mDebuggerModule* debugger, enum mDebuggerEntryReason reason, struct mDebuggerEntryInfo* info) {
+	UNUSED(reason);
+	UNUSED(info);
+	debugger->isPaused = false;
+}
+
+void mDebuggerTracerInit(struct mDebuggerTracer* tracer) {
+	memset(tracer, 0, sizeof(*tracer));
+	tracer->d.type = DEBUGGER_TRACER;
+	tracer->d.entered = _mDebuggerTracerEntered;
+	tracer->hook.instruction = _instruction;
+	tracer->hook.context = tracer;
+}
+
+void mDebuggerTracerDeinit(struct mDebuggerTracer* tracer) {
+	mDebuggerTracerClose(tracer);
+}
+
+bool mDebuggerTracerOpen(struct mDebuggerTracer* tracer, struct VFile* vf, mDebuggerTracerFlags flags) {
+	if (!tracer->d.p || !tracer->d.p->platform->setInstructionHook) {
+		return false;
+	}
+	if (tracer->vf && !mDebuggerTracerClose(tracer)) {
+		return false;
+	}
+	struct mCore* core = tracer->d.p->core;
+
+	struct mDebuggerTraceHeader header = {0};
+	uint32_t crc32 = 0;
+	core->checksum(core, &crc32, mCHECKSUM_CRC32);
+	memcpy(header.magic, mTR_MAGIC, sizeof(header.magic));
+	STORE_32LE(1, 0, &header.version);
+	STORE_32LE(core->platform(core), 0, &header.platform);
+	STORE_32LE(flags, 0, &header.flags);
+	STORE_32LE(crc32, 0, &header.romCrc32);
+	STORE_32LE(sizeof(struct mDebuggerTraceRecord), 0, &header.recordSize);
+	if (vf->write(vf, &header, sizeof(header)) != sizeof(header)) {
+		return false;
+	}
+
+	tracer->vf = vf;
+	tracer->flags = flags;
+	tracer->records = malloc(mDEBUGGER_TRACE_BLOCK_RECORDS * sizeof(struct mDebuggerTraceRecord));
+	tracer->nRecords = 0;
+	tracer->lastCycles = mTimingGlobalTime(core->timing);
+	tracer->blockStart = tracer->lastCycles;
+	tracer->keyframe = true;
+	tracer->failed = false;
+	tracer->instructions = 0;
+
+	// Writes are seen through the same pages as watchpoints, but without going through the debugger
+	tracer->hook.write = mDebuggerTracerFlagsIsMemory(flags) ? _write : NULL;
+	tracer->d.p->platform->setInstructionHook(tracer->d.p->platform, &tracer->hook);
+	return true;
+}
+
+bool mDebuggerTracerClose(struct mDebuggerTracer* tracer) {
+	if (!tracer->vf) {
+		return true;
+	}
+	struct mDebuggerPlatform* platform = tracer->d.p->platform;
+	platform->setInstructionHook(platform, NULL);
+	bool success = !tracer->failed && _flush(tracer);
+	free(tracer->records);
+	tracer->records = NULL;
+	tracer->vf->close(tracer->vf);
+	tracer->vf = NULL;
+	return success;
+}
+
+static bool _readBlock(struct mDebuggerTraceReader* reader) {
+	struct mDebuggerTraceBlockHeader header;
+	if (reader->vf->read(reader->vf, &header, sizeof(header)) != sizeof(header)) {
+		return false;
+	}
+	uint32_t length;
+	uint32_t records;
+	uint32_t flags;
+	LOAD_32LE(length, 0, &header.length);
+	LOAD_32LE(records, 0, &header.records);
+	LOAD_32LE(flags, 0, &header.flags);
+	LOAD_64LE(reader->cycles, 0, &header.startCycles);
+	if (!records || records > mDEBUGGER_TRACE_BLOCK_RECORDS) {
+		return false;
+	}
+	size_t size = records * sizeof(struct mDebuggerTraceRecord);
+
+	bool success = false;
+	if (flags & mTRACE_BLOCK_COMPRESSED) {
+#ifdef USE_ZLIB
+		// The writer never produces more than compressBound, so anything bigger is corrupt
+		if (length > compressBound(size)) {
+			return false;
+		}
+		uint8_t* compressed = malloc(length);
+		if (!compressed) {
+			return false;
+		}
+		uLongf uncompressedSize = size;
+		if (reader->vf->read(reader->vf, compressed, length) == (ssize_t) length &&
+		    uncompress((Bytef*) reader->records, &uncompressedSize, compressed, length) == Z_OK &&
+		    uncompressedSize == size) {
+			success = true;
+		}
+		free(compressed);
+#endif
+	} else if (length == size) {
+		success = reader->vf->read(reader->vf, reader->records, size) == (ssize_t) size;
+	}
+	if (!success) {
+		return false;
+	}
+	reader->nRecords = records;
+	reader->index = 0;
+	return true;
+}
+
+bool mDebuggerTraceReaderOpen(struct mDebuggerTraceReader* reader, struct VFile* vf) {
+	memset(reader, 0, sizeof(*reader));
+	struct mDebuggerTraceHeader header;
+	vf->seek(vf, 0, SEEK_SET);
+	if (vf->read(vf, &header, sizeof(header)) != sizeof(header)) {
+		return false;
+	}
+	if (memcmp(header.magic, mTR_MAGIC, sizeof(header.magic)) != 0) {
+		return false;
+	}
+	uint32_t version;
+	uint32_t recordSize;
+	LOAD_32LE(version, 0, &header.version);
+	LOAD_32LE(recordSize, 0, &header.recordSize);
+	if (version != 1 || recordSize != sizeof(struct mDebuggerTraceRecord)) {
+		return false;
+	}
+	LOAD_32LE(reader->platform, 0, &header.platform);
+	LOAD_32LE(reader->flags, 0, &header.flags);
+	LOAD_32LE(reader->romCrc32, 0, &header.romCrc32);
+	reader->vf = vf;
+	reader->records = malloc(mDEBUGGER_TRACE_BLOCK_RECORDS * sizeof(struct mDebuggerTraceRecord));
+	return true;
+}
+
+void mDebuggerTraceReaderClose(struct mDebuggerTraceReader* reader) {
+	free(reader->records);
+	reader->records = NULL;
+	if (reader->vf) {
+		reader->vf->close(reader->vf);
+		reader->vf = NULL;
+	}
+}
+
+bool mDebuggerTraceReaderNext(struct mDebuggerTraceReader* reader, struct mDebuggerTraceRecord* out, uint64_t* cycles) {
+	if (reader->index >= reader->nRecords && !_readBlock(reader)) {
+		return false;
+	}
+	const struct mDebuggerTraceRecord* record = &reader->records[reader->index];
+	++reader->index;
+
+	uint32_t delta;
+	out->type = record->type;
+	out->index = record->index;
+	out->reserved = 0;
+	LOAD_32LE(delta, 0, &record->cycles);
+	LOAD_32LE(out->address, 0, &record->address);
+	LOAD_32LE(out->value, 0, &record->value);
+	LOAD_32LE(out->mode, 0, &record->mode);
+	out->cycles = delta;
+	reader->cycles += delta;
+	if (cycles) {
+		*cycles = reader->cycles;
+	}
+	return true;
+}
@@ -35,12 +35,14 @@
 #include <libswscale/swscale.h>
 
 static void _ffmpegPostVideoFrame(struct mAVStream*, const color_t* pixels, size_t stride);
+static void _ffmpegPostVideoFrameRepeat(struct mAVStream*, const color_t* pixels, size_t stride);
 static void _ffmpegPostAudioFrame(struct mAVStream*, int16_t left, int16_t right);
 static void _ffmpegSetVideoDimensions(struct mAVStream*, unsigned width, unsigned height);
 static void _ffmpegSetAudioRate(struct mAVStream*, unsigned rate);
 
 static bool _ffmpegWriteAudioFrame(struct FFmpegEncoder* encoder, struct AVFrame* audioFrame);
 static bool _ffmpegWriteVideoFrame(struct FFmpegEncoder* encoder, struct AVFrame* videoFrame);
+static void _ffmpegSubmitVideoFrame(struct FFmpegEncoder* encoder, int64_t frame);
 
 static void _ffmpegOpenResampleContext(struct FFmpegEncoder* encoder);
 
@@ -56,6 +58,7 @@ void FFmpegEncoderInit(struct FFmpegEncoder* encoder) {
 	encoder->d.videoDimensionsChanged = _ffmpegSetVideoDimensions;
 	encoder->d.audioRateChanged = _ffmpegSetAudioRate;
 	encoder->d.postVideoFrame = _ffmpegPostVideoFrame;
+	encoder->d.postVideoFrameRepeat = _ffmpegPostVideoFrameRepeat;
 	encoder->d.postAudioFrame = _ffmpegPostAudioFrame;
 	encoder->d.postAudioBuffer = NULL;
 
@@ -71,6 +74,7 @@ void FFmpegEncoderInit(struct FFmpegEncoder* encoder) {
 	encoder->iheight = GBA_VIDEO_VERTICAL_PIXELS;
 	encoder->frameskip = 1;
 	encoder->skipResidue = 0;
+	encoder->lastVideoFrame = -1;
 	encoder->loop = false;
 	encoder->ipixFormat =
 #ifdef COLOR_16_BIT
@@ -299,6 +303,7 @@ bool FFmpegEncoderOpen(struct FFmpegEncoder* encoder, const char* outfile) {
 	encoder->currentAudioSample = 0;
 	encoder->currentAudioFrame = 0;
 	encoder->currentVideoFrame = 0;
+	encoder->lastVideoFrame = -1;
 	encoder->skipResidue = 0;
 
 	const AVOutputFormat* oformat = av_guess_format(encoder->containerFormat, 0, 0);
@@ -559,6 +564,10 @@ void FFmpegEncoderClose(struct FFmpegEncoder* encoder) {
 		}
 	}
 	if (encoder->video) {
+		if (encoder->lastVideoFrame >= 0 && encoder->lastVideoFrame < encoder->currentVideoFrame - 1) {
+			// Repeated frames were elided at the end, so give the last one its full duration
+			_ffmpegSubmitVideoFrame(encoder, encoder->currentVideoFrame - 1);
+		}
 		if (encoder->graph) {
 			if (av_buffersrc_add_frame(encoder->source, NULL) >= 0) {
 				while (true) {
@@ -796,15 +805,45 @@ void _ffmpegPostVideoFrame(struct mAVStream* stream, const color_t* pixels, size
 	stride *= BYTES_PER_PIXEL;
 
 	av_frame_make_writable(encoder->videoFrame);
+	sws_scale(encoder->scaleContext, (const uint8_t* const*) &pixels, (const int*) &stride, 0, encoder->iheight, encoder->videoFrame->data, encoder->videoFrame->linesize);
+
+	_ffmpegSubmitVideoFrame(encoder, encoder->currentVideoFrame);
+	++encoder->currentVideoFrame;
+}
+
+void _ffmpegPostVideoFrameRepeat(struct mAVStream* stream, const color_t* pixels, size_t stride) {
+	struct FFmpegEncoder* encoder = (struct FFmpegEncoder*) stream;
+	if (!encoder->context || !encoder->videoCodec) {
+		return;
+	}
+	if (encoder->lastVideoFrame < 0) {
+		// Nothing has been converted yet, so there is nothing to repeat
+		_ffmpegPostVideoFrame(stream, pixels, stride);
+		return;
+	}
+	encoder->skipResidue = (encoder->skipResidue + 1) % encoder->frameskip;
+	if (encoder->skipResidue) {
+		return;
+	}
+
+	// The converted frame from last time is still current, so skip the conversion.
+	// Containers that allow variable frame rates treat the gap in timestamps as
+	// the previous frame being held, so there is nothing to encode at all.
+	if (encoder->graph || !(encoder->context->oformat->flags & AVFMT_VARIABLE_FPS)) {
+		av_frame_make_writable(encoder->videoFrame);
+		_ffmpegSubmitVideoFrame(encoder, encoder->currentVideoFrame);
+	}
+	++encoder->currentVideoFrame;
+}
+
+static void _ffmpegSubmitVideoFrame(struct FFmpegEncoder* encoder, int64_t frame) {
 	if (encoder->video->codec->id == AV_CODEC_ID_WEBP) {
 		// TODO: Figure out why WebP is rescaling internally (should video frames not be rescaled externally?)
-		encoder->videoFrame->pts = encoder->currentVideoFrame;
+		encoder->videoFrame->pts = frame;
 	} else {
-		encoder->videoFrame->pts = av_rescale_q(encoder->currentVideoFrame, encoder->video->time_base, encoder->videoStream->time_base);
+		encoder->videoFrame->pts = av_rescale_q(frame, encoder->video->time_base, encoder->videoStream->time_base);
 	}
-	++encoder->currentVideoFrame;
-
-	sws_scale(encoder->scaleContext, (const uint8_t* const*) &pixels, (const int*) &stride, 0, encoder->iheight, encoder->videoFrame->data, encoder->videoFrame->linesize);
+	encoder->lastVideoFrame = frame;
 
 	if (encoder->graph) {
 		if (av_buffersrc_write_frame(encoder->source, encoder->videoFrame) < 0) {
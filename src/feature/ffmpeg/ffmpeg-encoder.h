@@ -63,6 +63,7 @@ struct FFmpegEncoder {
 	int skipResidue;
 	bool loop;
 	int64_t currentVideoFrame;
+	int64_t lastVideoFrame;
 	struct SwsContext* scaleContext;
 	struct AVStream* videoStream;
 
@@ -0,0 +1,571 @@
+/* Copyright (c) 2013-2024 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include <mgba/feature/job-server.h>
+
+#include <mgba/core/config.h>
+#include <mgba/core/core.h>
+#include <mgba/core/serialize.h>
+#include <mgba-util/memory.h>
+#include <mgba-util/vfs.h>
+
+#define DEFAULT_IDLE_LIMIT 16
+
+// A warmed core with its ROM loaded, kept between jobs on the same ROM
+struct mJobCore {
+	struct mCore* core;
+	color_t* video;
+	size_t videoSize;
+	char* path;
+	struct mJobCore* next;
+};
+
+static void _destroyCore(struct mJobCore* job) {
+	mCoreConfigDeinit(&job->core->config);
+	job->core->deinit(job->core);
+	mappedMemoryFree(job->video, job->videoSize);
+	free(job->path);
+	free(job);
+}
+
+static struct mJobCore* _createCore(struct mJobServer* server, const char* path) {
+	struct mCore* core = mCoreFind(path);
+	if (!core) {
+		return NULL;
+	}
+	core->init(core);
+	mCoreInitConfig(core, NULL);
+
+	struct mJobCore* job = calloc(1, sizeof(*job));
+	job->core = core;
+	job->path = strdup(path);
+
+	unsigned width, height;
+	core->baseVideoSize(core, &width, &height);
+	job->videoSize = width * height * BYTES_PER_PIXEL;
+	job->video = anonymousMemoryMap(job->videoSize);
+	core->setVideoBuffer(core, job->video, width);
+
+	if (!mCoreLoadFile(core, path)) {
+		_destroyCore(job);
+		return NULL;
+	}
+	if (server->config) {
+		mCoreLoadForeignConfig(core, server->config);
+	} else {
+		mCoreLoadConfig(core);
+	}
+	mCoreAutoloadPatch(core);
+	return job;
+}
+
+// Saves aren't loaded from disk, so a fresh core always starts with blank savedata
+static void _clearSavedata(struct mCore* core) {
+	void* sram = NULL;
+	size_t size = core->savedataClone(core, &sram);
+	if (size) {
+		memset(sram, 0xFF, size);
+		core->savedataRestore(core, sram, size, true);
+	}
+	free(sram);
+}
+
+static struct mJobCore* _checkout(struct mJobServer* server, const char* path) {
+	MutexLock(&server->mutex);
+	struct mJobCore* job = HashTableLookup(&server->idle, path);
+	if (job) {
+		if (job->next) {
+			HashTableInsert(&server->idle, path, job->next);
+		} else {
+			HashTableRemove(&server->idle, path);
+		}
+		job->next = NULL;
+		--server->idleCores;
+	}
+	MutexUnlock(&server->mutex);
+
+	if (!job) {
+		job = _createCore(server, path);
+		if (!job) {
+			return NULL;
+		}
+	} else {
+		_clearSavedata(job->core);
+	}
+	// Every job starts from power-on, as if the core had just been loaded
+	job->core->setKeys(job->core, 0);
+	job->core->reset(job->core);
+	return job;
+}
+
+static void _checkin(struct mJobServer* server, struct mJobCore* job) {
+	MutexLock(&server->mutex);
+	if (server->idleCores >= server->idleLimit) {
+		MutexUnlock(&server->mutex);
+		_destroyCore(job);
+		return;
+	}
+	job->next = HashTableLookup(&server->idle, job->path);
+	HashTableInsert(&server->idle, job->path, job);
+	++server->idleCores;
+	MutexUnlock(&server->mutex);
+}
+
+static void _destroyIdle(const char* key, void* value, void* user) {
+	UNUSED(key);
+	UNUSED(user);
+	struct mJobCore* job = value;
+	while (job) {
+		struct mJobCore* next = job->next;
+		_destroyCore(job);
+		job = next;
+	}
+}
+
+void mJobServerInit(struct mJobServer* server, const struct mCoreConfig* config) {
+	memset(server, 0, sizeof(*server));
+	server->config = config;
+	server->idleLimit = DEFAULT_IDLE_LIMIT;
+	MutexInit(&server->mutex);
+	HashTableInit(&server->idle, 0, NULL);
+#ifndef DISABLE_THREADING
+	ConditionInit(&server->queueCond);
+#endif
+}
+
+void mJobServerDeinit(struct mJobServer* server) {
+#ifndef DISABLE_THREADING
+	mJobServerStop(server);
+	ConditionDeinit(&server->queueCond);
+#endif
+	HashTableEnumerate(&server->idle, _destroyIdle, NULL);
+	HashTableDeinit(&server->idle);
+	MutexDeinit(&server->mutex);
+}
+
+bool mJobRecordRead(struct VFile* vf, struct mJobRecord* record) {
+	uint32_t header[4];
+	if (vf->read(vf, header, sizeof(header)) != sizeof(header)) {
+		return false;
+	}
+	LOAD_32LE(record->op, 0, header);
+	LOAD_32LE(record->arg0, 4, header);
+	LOAD_32LE(record->arg1, 8, header);
+	LOAD_32LE(record->size, 12, header);
+	return true;
+}
+
+bool mJobRecordWrite(struct VFile* vf, const struct mJobRecord* record, const void* payload) {
+	uint32_t header[4];
+	STORE_32LE(record->op, 0, header);
+	STORE_32LE(record->arg0, 4, header);
+	STORE_32LE(record->arg1, 8, header);
+	STORE_32LE(record->size, 12, header);
+	if (vf->write(vf, header, sizeof(header)) != sizeof(header)) {
+		return false;
+	}
+	if (record->size && vf->write(vf, payload, record->size) != (ssize_t) record->size) {
+		return false;
+	}
+	return true;
+}
+
+// Raw writes patch read-only regions such as ROM in place, which would outlive the job
+static bool _isWritable(struct mCore* core, uint32_t address, uint32_t size) {
+	const struct mCoreMemoryBlock* blocks;
+	size_t nBlocks = core->listMemoryBlocks(core, &blocks);
+	size_t i;
+	for (i = 0; i < nBlocks; ++i) {
+		if (blocks[i].flags & (mCORE_MEMORY_WRITE | mCORE_MEMORY_VIRTUAL)) {
+			continue;
+		}
+		if (address < blocks[i].end && (uint64_t) address + size > blocks[i].start) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static enum mJobStatus _runOp(struct mJobServer* server, struct mJobCore** job, const struct mJobRecord* record, void* payload, struct VFile* response) {
+	struct mJobRecord out = { .op = record->op };
+	if (record->op >= mJOB_OP_MAX) {
+		return mJOB_ERROR_UNKNOWN_OP;
+	}
+	if (record->op == mJOB_OP_LOAD_ROM) {
+		if (!record->size || ((char*) payload)[record->size - 1]) {
+			return mJOB_ERROR_MALFORMED;
+		}
+		if (*job) {
+			_checkin(server, *job);
+		}
+		*job = _checkout(server, payload);
+		return *job ? mJOB_OK : mJOB_ERROR_LOAD_ROM;
+	}
+	if (!*job) {
+		return mJOB_ERROR_NO_ROM;
+	}
+
+	struct mCore* core = (*job)->core;
+	struct VFile* vf;
+	uint32_t i;
+	switch (record->op) {
+	case mJOB_OP_RESET:
+		core->reset(core);
+		break;
+	case mJOB_OP_LOAD_STATE:
+		if (!record->size) {
+			return mJOB_ERROR_STATE;
+		}
+		vf = VFileFromConstMemory(payload, record->size);
+		if (!mCoreLoadStateNamed(core, vf, SAVESTATE_SCREENSHOT)) {
+			vf->close(vf);
+			return mJOB_ERROR_STATE;
+		}
+		vf->close(vf);
+		break;
+	case mJOB_OP_SAVE_STATE:
+		vf = VFileMemChunk(NULL, 0);
+		if (!mCoreSaveStateNamed(core, vf, SAVESTATE_SCREENSHOT)) {
+			vf->close(vf);
+			return mJOB_ERROR_STATE;
+		}
+		out.size = vf->size(vf);
+		mJobRecordWrite(response, &out, vf->map(vf, out.size, MAP_READ));
+		vf->close(vf);
+		break;
+	case mJOB_OP_SET_KEYS:
+		core->setKeys(core, record->arg0);
+		break;
+	case mJOB_OP_RUN_FRAMES:
+		for (i = 0; i < record->arg0; ++i) {
+			core->runFrame(core);
+		}
+		break;
+	case mJOB_OP_RUN_INPUTS:
+		for (i = 0; i + 1 < record->size; i += 2) {
+			uint16_t keys;
+			LOAD_16LE(keys, i, payload);
+			core->setKeys(core, keys);
+			core->runFrame(core);
+		}
+		break;
+	case mJOB_OP_READ_MEMORY:
+		if (record->arg1 > mJOB_MAX_MESSAGE) {
+			return mJOB_ERROR_RANGE;
+		} else {
+			uint8_t* memory = malloc(record->arg1);
+			if (!memory) {
+				return mJOB_ERROR_MEMORY;
+			}
+			for (i = 0; i < record->arg1; ++i) {
+				memory[i] = core->rawRead8(core, record->arg0 + i, -1);
+			}
+			out.arg0 = record->arg0;
+			out.arg1 = record->arg1;
+			out.size = record->arg1;
+			mJobRecordWrite(response, &out, memory);
+			free(memory);
+		}
+		break;
+	case mJOB_OP_WRITE_MEMORY:
+		if ((uint64_t) record->arg0 + record->size > 0x100000000ULL || !_isWritable(core, record->arg0, record->size)) {
+			return mJOB_ERROR_RANGE;
+		}
+		for (i = 0; i < record->size; ++i) {
+			core->rawWrite8(core, record->arg0 + i, -1, ((uint8_t*) payload)[i]);
+		}
+		break;
+	case mJOB_OP_GET_FRAME: {
+		unsigned width, height;
+		unsigned stride, baseHeight;
+		core->currentVideoSize(core, &width, &height);
+		core->baseVideoSize(core, &stride, &baseHeight);
+		out.arg0 = width;
+		out.arg1 = height;
+		out.size = width * height * BYTES_PER_PIXEL;
+		if (width == stride) {
+			mJobRecordWrite(response, &out, (*job)->video);
+		} else {
+			color_t* pixels = malloc(out.size);
+			if (!pixels) {
+				return mJOB_ERROR_MEMORY;
+			}
+			for (i = 0; i < height; ++i) {
+				memcpy(&pixels[width * i], &(*job)->video[stride * i], width * BYTES_PER_PIXEL);
+			}
+			mJobRecordWrite(response, &out, pixels);
+			free(pixels);
+		}
+		break;
+	}
+	default:
+		return mJOB_ERROR_UNKNOWN_OP;
+	}
+	return mJOB_OK;
+}
+
+enum mJobStatus mJobServerRun(struct mJobServer* server, struct VFile* request, struct VFile* response) {
+	struct mJobCore* job = NULL;
+	enum mJobStatus status = mJOB_OK;
+	struct mJobRecord record;
+	uint32_t index = 0;
+	while (status == mJOB_OK) {
+		if (request->seek(request, 0, SEEK_CUR) == request->size(request)) {
+			// A request may omit its terminator
+			break;
+		}
+		if (!mJobRecordRead(request, &record) || record.size > mJOB_MAX_MESSAGE) {
+			status = mJOB_ERROR_MALFORMED;
+			break;
+		}
+		if (record.op == mJOB_OP_END) {
+			break;
+		}
+		void* payload = NULL;
+		if (record.size) {
+			payload = malloc(record.size);
+			if (!payload) {
+				status = mJOB_ERROR_MEMORY;
+				break;
+			}
+			if (request->read(request, payload, record.size) != (ssize_t) record.size) {
+				free(payload);
+				status = mJOB_ERROR_MALFORMED;
+				break;
+			}
+		}
+		status = _runOp(server, &job, &record, payload, response);
+		free(payload);
+		if (status == mJOB_OK) {
+			++index;
+		}
+	}
+	if (job) {
+		_checkin(server, job);
+	}
+
+	struct mJobRecord end = {
+		.op = mJOB_OP_END,
+		.arg0 = status,
+		.arg1 = index,
+	};
+	mJobRecordWrite(response, &end, NULL);
+	return status;
+}
+
+#ifndef DISABLE_THREADING
+enum mJobRecv {
+	mJOB_RECV_OK,
+	mJOB_RECV_FAILED,
+	// Nothing arrived before another client started waiting for a worker
+	mJOB_RECV_IDLE,
+};
+
+static bool _isStopping(struct mJobServer* server, bool* othersWaiting) {
+	MutexLock(&server->mutex);
+	bool stopping = server->stopping;
+	*othersWaiting = server->queueSize > 0;
+	MutexUnlock(&server->mutex);
+	return stopping;
+}
+
+// Polls rather than blocking so that the worker notices when the server stops
+static enum mJobRecv _recvAll(struct mJobServer* server, Socket socket, void* buffer, size_t size, bool yield) {
+	uint8_t* bytes = buffer;
+	while (size) {
+		Socket reads = socket;
+		int ready = SocketPoll(1, &reads, NULL, NULL, 100);
+		if (ready < 0) {
+			return mJOB_RECV_FAILED;
+		}
+		if (!ready || SOCKET_FAILED(reads)) {
+			bool othersWaiting;
+			if (_isStopping(server, &othersWaiting)) {
+				return mJOB_RECV_FAILED;
+			}
+			if (yield && othersWaiting) {
+				return mJOB_RECV_IDLE;
+			}
+			continue;
+		}
+		// Once part of a message has arrived, the rest has to be waited for
+		yield = false;
+		ssize_t read = SocketRecv(socket, bytes, size);
+		if (read <= 0) {
+			return mJOB_RECV_FAILED;
+		}
+		bytes += read;
+		size -= read;
+	}
+	return mJOB_RECV_OK;
+}
+
+static bool _sendAll(Socket socket, const void* buffer, size_t size) {
+	const uint8_t* bytes = buffer;
+	while (size) {
+		ssize_t written = SocketSend(socket, bytes, size);
+		if (written <= 0) {
+			return false;
+		}
+		bytes += written;
+		size -= written;
+	}
+	return true;
+}
+
+// Returns true if the client went idle and should go back in the queue
+static bool _serveClient(struct mJobServer* server, Socket client) {
+	while (true) {
+		uint32_t length;
+		enum mJobRecv received = _recvAll(server, client, &length, sizeof(length), true);
+		if (received == mJOB_RECV_IDLE) {
+			return true;
+		}
+		if (received != mJOB_RECV_OK) {
+			break;
+		}
+		LOAD_32LE(length, 0, &length);
+		if (length > mJOB_MAX_MESSAGE) {
+			break;
+		}
+		void* message = malloc(length);
+		if (length && !message) {
+			break;
+		}
+		if (_recvAll(server, client, message, length, false) != mJOB_RECV_OK) {
+			free(message);
+			break;
+		}
+
+		// An empty message is an empty job, but there's no memory to wrap for it
+		struct VFile* request = length ? VFileFromConstMemory(message, length) : VFileMemChunk(NULL, 0);
+		if (!request) {
+			free(message);
+			break;
+		}
+		struct VFile* response = VFileMemChunk(NULL, 0);
+		mJobServerRun(server, request, response);
+		request->close(request);
+		free(message);
+
+		size_t size = response->size(response);
+		STORE_32LE(size, 0, &length);
+		bool sent = _sendAll(client, &length, sizeof(length)) && _sendAll(client, response->map(response, size, MAP_READ), size);
+		response->close(response);
+		if (!sent) {
+			break;
+		}
+	}
+	SocketClose(client);
+	return false;
+}
+
+static THREAD_ENTRY _workerThread(void* context) {
+	struct mJobServer* server = context;
+	ThreadSetName("Job Worker");
+
+	MutexLock(&server->mutex);
+	while (true) {
+		while (!server->stopping && !server->queueSize) {
+			ConditionWait(&server->queueCond, &server->mutex);
+		}
+		if (server->stopping) {
+			break;
+		}
+		Socket client = server->queue[0];
+		--server->queueSize;
+		memmove(&server->queue[0], &server->queue[1], server->queueSize * sizeof(*server->queue));
+		MutexUnlock(&server->mutex);
+
+		bool idle = _serveClient(server, client);
+
+		MutexLock(&server->mutex);
+		if (idle) {
+			// Let a waiting client have this worker; the idle one gets another turn after it
+			if (server->queueSize < server->queueCapacity && !server->stopping) {
+				server->queue[server->queueSize] = client;
+				++server->queueSize;
+			} else {
+				SocketClose(client);
+			}
+		}
+	}
+	MutexUnlock(&server->mutex);
+
+	THREAD_EXIT(0);
+}
+
+bool mJobServerStart(struct mJobServer* server, unsigned workers) {
+	if (server->workers || !workers) {
+		return false;
+	}
+	if (server->idleLimit < workers) {
+		server->idleLimit = workers;
+	}
+	server->stopping = false;
+	server->queueCapacity = workers * 4;
+	server->queue = calloc(server->queueCapacity, sizeof(*server->queue));
+	server->workers = calloc(workers, sizeof(*server->workers));
+	server->nWorkers = workers;
+	unsigned i;
+	for (i = 0; i < workers; ++i) {
+		ThreadCreate(&server->workers[i], _workerThread, server);
+	}
+	return true;
+}
+
+bool mJobServerServe(struct mJobServer* server, Socket listener, volatile bool* exiting) {
+	if (!server->workers) {
+		return false;
+	}
+	while (!exiting || !*exiting) {
+		Socket reads = listener;
+		// Wake up periodically so that exiting is noticed
+		if (SocketPoll(1, &reads, NULL, NULL, 100) <= 0 || SOCKET_FAILED(reads)) {
+			continue;
+		}
+		Socket client = SocketAccept(listener, NULL);
+		if (SOCKET_FAILED(client)) {
+			continue;
+		}
+		MutexLock(&server->mutex);
+		if (server->queueSize == server->queueCapacity) {
+			// Every worker is busy and the backlog is full; shed load rather than queue unboundedly
+			MutexUnlock(&server->mutex);
+			SocketClose(client);
+			continue;
+		}
+		server->queue[server->queueSize] = client;
+		++server->queueSize;
+		ConditionWake(&server->queueCond);
+		MutexUnlock(&server->mutex);
+	}
+	return true;
+}
+
+void mJobServerStop(struct mJobServer* server) {
+	if (!server->workers) {
+		return;
+	}
+	MutexLock(&server->mutex);
+	server->stopping = true;
+	ConditionWake(&server->queueCond);
+	MutexUnlock(&server->mutex);
+
+	unsigned i;
+	for (i = 0; i < server->nWorkers; ++i) {
+		ThreadJoin(&server->workers[i]);
+	}
+	for (i = 0; i < server->queueSize; ++i) {
+		SocketClose(server->queue[i]);
+	}
+	free(server->workers);
+	free(server->queue);
+	server->workers = NULL;
+	server->queue = NULL;
+	server->nWorkers = 0;
+	server->queueSize = 0;
+}
+#endif
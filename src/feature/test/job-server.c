@@ -0,0 +1,228 @@
+/* Copyright (c) 2013-2024 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "util/test/suite.h"
+
+#include <mgba/feature/job-server.h>
+#include <mgba-util/vfs.h>
+
+#ifdef M_CORE_GB
+#include <mgba/internal/gb/gb.h>
+
+#define TEST_ROM "job-server-test.gb"
+
+static const uint8_t _program[] = {
+	0x3E, 0x0A,       // $0150: LD A, $0A
+	0xEA, 0x00, 0x00, // $0152: LD [$0000], A
+	0x18, 0xFE,       // $0155: JR $0155
+};
+#endif
+
+static enum mJobStatus _run(struct VFile* request, struct mJobRecord* end) {
+	struct mJobServer server;
+	mJobServerInit(&server, NULL);
+	struct VFile* response = VFileMemChunk(NULL, 0);
+	request->seek(request, 0, SEEK_SET);
+	enum mJobStatus status = mJobServerRun(&server, request, response);
+	mJobServerDeinit(&server);
+
+	response->seek(response, 0, SEEK_SET);
+	assert_true(mJobRecordRead(response, end));
+	assert_int_equal(end->op, mJOB_OP_END);
+	assert_int_equal(end->size, 0);
+	assert_int_equal(response->seek(response, 0, SEEK_CUR), response->size(response));
+	response->close(response);
+	return status;
+}
+
+M_TEST_DEFINE(recordRoundTrip) {
+	struct VFile* vf = VFileMemChunk(NULL, 0);
+	struct mJobRecord record = {
+		.op = mJOB_OP_READ_MEMORY,
+		.arg0 = 0x03000000,
+		.arg1 = 0x12345678,
+		.size = 4
+	};
+	assert_true(mJobRecordWrite(vf, &record, "abcd"));
+	assert_int_equal(vf->size(vf), mJOB_RECORD_SIZE + 4);
+
+	uint8_t* bytes = vf->map(vf, mJOB_RECORD_SIZE, MAP_READ);
+	assert_int_equal(bytes[0], mJOB_OP_READ_MEMORY);
+	assert_int_equal(bytes[4], 0x00);
+	assert_int_equal(bytes[7], 0x03);
+	assert_int_equal(bytes[8], 0x78);
+	assert_int_equal(bytes[11], 0x12);
+	vf->unmap(vf, bytes, mJOB_RECORD_SIZE);
+
+	struct mJobRecord read;
+	vf->seek(vf, 0, SEEK_SET);
+	assert_true(mJobRecordRead(vf, &read));
+	assert_memory_equal(&read, &record, sizeof(read));
+	assert_false(mJobRecordRead(vf, &read));
+	vf->close(vf);
+}
+
+M_TEST_DEFINE(emptyJob) {
+	struct VFile* request = VFileMemChunk(NULL, 0);
+	struct mJobRecord end;
+	assert_int_equal(_run(request, &end), mJOB_OK);
+	assert_int_equal(end.arg0, mJOB_OK);
+	assert_int_equal(end.arg1, 0);
+
+	struct mJobRecord terminator = { .op = mJOB_OP_END };
+	mJobRecordWrite(request, &terminator, NULL);
+	assert_int_equal(_run(request, &end), mJOB_OK);
+	assert_int_equal(end.arg1, 0);
+	request->close(request);
+}
+
+M_TEST_DEFINE(noROM) {
+	struct VFile* request = VFileMemChunk(NULL, 0);
+	struct mJobRecord record = { .op = mJOB_OP_RUN_FRAMES, .arg0 = 1 };
+	mJobRecordWrite(request, &record, NULL);
+
+	struct mJobRecord end;
+	assert_int_equal(_run(request, &end), mJOB_ERROR_NO_ROM);
+	assert_int_equal(end.arg0, mJOB_ERROR_NO_ROM);
+	assert_int_equal(end.arg1, 0);
+	request->close(request);
+}
+
+M_TEST_DEFINE(badROM) {
+	static const char path[] = "/nonexistent/rom.gba";
+	struct VFile* request = VFileMemChunk(NULL, 0);
+	struct mJobRecord record = { .op = mJOB_OP_LOAD_ROM, .size = sizeof(path) };
+	mJobRecordWrite(request, &record, path);
+
+	struct mJobRecord end;
+	assert_int_equal(_run(request, &end), mJOB_ERROR_LOAD_ROM);
+	assert_int_equal(end.arg1, 0);
+
+	// The path must be terminated
+	request->truncate(request, 0);
+	request->seek(request, 0, SEEK_SET);
+	record.size = sizeof(path) - 1;
+	mJobRecordWrite(request, &record, path);
+	assert_int_equal(_run(request, &end), mJOB_ERROR_MALFORMED);
+	request->close(request);
+}
+
+M_TEST_DEFINE(unknownOp) {
+	struct VFile* request = VFileMemChunk(NULL, 0);
+	struct mJobRecord record = { .op = mJOB_OP_MAX };
+	mJobRecordWrite(request, &record, NULL);
+
+	struct mJobRecord end;
+	assert_int_equal(_run(request, &end), mJOB_ERROR_UNKNOWN_OP);
+	request->close(request);
+}
+
+M_TEST_DEFINE(truncated) {
+	struct VFile* request = VFileMemChunk(NULL, 0);
+	uint8_t savestate[64] = {0};
+	struct mJobRecord record = { .op = mJOB_OP_LOAD_STATE, .size = sizeof(savestate) };
+	mJobRecordWrite(request, &record, savestate);
+	request->truncate(request, mJOB_RECORD_SIZE + 5);
+
+	struct mJobRecord end;
+	assert_int_equal(_run(request, &end), mJOB_ERROR_MALFORMED);
+
+	request->truncate(request, 7);
+	assert_int_equal(_run(request, &end), mJOB_ERROR_MALFORMED);
+	request->close(request);
+}
+
+#ifdef M_CORE_GB
+static void _writeROM(void) {
+	struct VFile* vf = VFileOpen(TEST_ROM, O_CREAT | O_TRUNC | O_RDWR);
+	assert_non_null(vf);
+	vf->truncate(vf, GB_SIZE_CART_BANK0 * 2);
+	GBSynthesizeROM(vf);
+	// MBC1 with 8kiB of battery-backed RAM
+	static const uint8_t type[] = { 0x03, 0x00, 0x02 };
+	vf->seek(vf, 0x147, SEEK_SET);
+	vf->write(vf, type, sizeof(type));
+	static const uint8_t jump[] = { 0xC3, 0x50, 0x01 };
+	vf->seek(vf, 0x100, SEEK_SET);
+	vf->write(vf, jump, sizeof(jump));
+	vf->seek(vf, 0x150, SEEK_SET);
+	vf->write(vf, _program, sizeof(_program));
+	vf->close(vf);
+}
+
+static void _writeOp(struct VFile* request, enum mJobOp op, uint32_t arg0, uint32_t arg1, const void* payload, uint32_t size) {
+	struct mJobRecord record = { .op = op, .arg0 = arg0, .arg1 = arg1, .size = size };
+	assert_true(mJobRecordWrite(request, &record, payload));
+}
+
+static uint8_t _readByte(struct VFile* response) {
+	struct mJobRecord record;
+	uint8_t value;
+	assert_true(mJobRecordRead(response, &record));
+	assert_int_equal(record.op, mJOB_OP_READ_MEMORY);
+	assert_int_equal(record.size, 1);
+	assert_int_equal(response->read(response, &value, 1), 1);
+	return value;
+}
+
+M_TEST_DEFINE(reusedCore) {
+	_writeROM();
+	struct mJobServer server;
+	mJobServerInit(&server, NULL);
+	struct VFile* request = VFileMemChunk(NULL, 0);
+	struct VFile* response = VFileMemChunk(NULL, 0);
+	struct mJobRecord end;
+	uint8_t value = 0x42;
+
+	// The first job dirties the savedata and tries to patch the ROM
+	_writeOp(request, mJOB_OP_LOAD_ROM, 0, 0, TEST_ROM, sizeof(TEST_ROM));
+	_writeOp(request, mJOB_OP_RUN_FRAMES, 1, 0, NULL, 0);
+	_writeOp(request, mJOB_OP_WRITE_MEMORY, 0xA000, 0, &value, 1);
+	_writeOp(request, mJOB_OP_READ_MEMORY, 0xA000, 1, NULL, 0);
+	_writeOp(request, mJOB_OP_WRITE_MEMORY, 0x150, 0, &value, 1);
+	request->seek(request, 0, SEEK_SET);
+	assert_int_equal(mJobServerRun(&server, request, response), mJOB_ERROR_RANGE);
+	response->seek(response, 0, SEEK_SET);
+	assert_int_equal(_readByte(response), 0x42);
+	assert_true(mJobRecordRead(response, &end));
+	assert_int_equal(end.arg0, mJOB_ERROR_RANGE);
+	assert_int_equal(end.arg1, 4);
+	assert_int_equal(server.idleCores, 1);
+
+	// The second job gets the same core back, but must not see any of that
+	request->truncate(request, 0);
+	request->seek(request, 0, SEEK_SET);
+	response->truncate(response, 0);
+	response->seek(response, 0, SEEK_SET);
+	_writeOp(request, mJOB_OP_LOAD_ROM, 0, 0, TEST_ROM, sizeof(TEST_ROM));
+	_writeOp(request, mJOB_OP_RUN_FRAMES, 1, 0, NULL, 0);
+	_writeOp(request, mJOB_OP_READ_MEMORY, 0xA000, 1, NULL, 0);
+	_writeOp(request, mJOB_OP_READ_MEMORY, 0x150, 1, NULL, 0);
+	request->seek(request, 0, SEEK_SET);
+	assert_int_equal(mJobServerRun(&server, request, response), mJOB_OK);
+	assert_int_equal(server.idleCores, 1);
+	response->seek(response, 0, SEEK_SET);
+	assert_int_equal(_readByte(response), 0xFF);
+	assert_int_equal(_readByte(response), _program[0]);
+	assert_true(mJobRecordRead(response, &end));
+	assert_int_equal(end.arg0, mJOB_OK);
+
+	request->close(request);
+	response->close(response);
+	mJobServerDeinit(&server);
+}
+#endif
+
+M_TEST_SUITE_DEFINE(JobServer,
+	cmocka_unit_test(recordRoundTrip),
+	cmocka_unit_test(emptyJob),
+	cmocka_unit_test(noROM),
+	cmocka_unit_test(badROM),
+	cmocka_unit_test(unknownOp),
+	cmocka_unit_test(truncated),
+#ifdef M_CORE_GB
+	cmocka_unit_test(reusedCore),
+#endif
+	)
@@ -5,9 +5,12 @@
  * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
 #include <mgba/gb/core.h>
 
+#include <mgba/core/blip_buf.h>
 #include <mgba/core/core.h>
+#include <mgba/core/run-until.h>
 #include <mgba/internal/debugger/symbols.h>
 #include <mgba/internal/gb/cheats.h>
+#include <mgba/internal/gb/debugger/analysis.h>
 #include <mgba/internal/gb/debugger/cli.h>
 #include <mgba/internal/gb/debugger/debugger.h>
 #include <mgba/internal/gb/debugger/symbols.h>
@@ -104,6 +107,7 @@ struct GBCore {
 	struct mDebuggerPlatform* debuggerPlatform;
 	struct mCheatDevice* cheatDevice;
 	struct mCoreMemoryBlock memoryBlocks[8];
+	struct mVideoLayerOutput layerOutput;
 };
 
 static bool _GBCoreInit(struct mCore* core) {
@@ -127,6 +131,7 @@ static bool _GBCoreInit(struct mCore* core) {
 #endif
 	memcpy(gbcore->memoryBlocks, _GBMemoryBlocks, sizeof(_GBMemoryBlocks));
 	memset(&gbcore->override, 0, sizeof(gbcore->override));
+	gbcore->override.idleLoop = GB_IDLE_LOOP_NONE;
 	gbcore->hasOverride = false;
 
 	GBCreate(gb);
@@ -246,6 +251,27 @@ static void _GBCoreLoadConfig(struct mCore* core, const struct mCoreConfig* conf
 		GBVideoSetPalette(&gb->video, 11, color);
 	}
 
+	const char* idleOptimization = mCoreConfigGetValue(config, "idleOptimization");
+	if (idleOptimization) {
+		if (strcasecmp(idleOptimization, "ignore") == 0) {
+			gb->idleOptimization = GB_IDLE_LOOP_IGNORE;
+		} else if (strcasecmp(idleOptimization, "remove") == 0) {
+			gb->idleOptimization = GB_IDLE_LOOP_REMOVE;
+		} else if (strcasecmp(idleOptimization, "detect") == 0) {
+			if (gb->idleLoop == GB_IDLE_LOOP_NONE) {
+				gb->idleOptimization = GB_IDLE_LOOP_DETECT;
+			} else {
+				gb->idleOptimization = GB_IDLE_LOOP_REMOVE;
+			}
+		}
+	}
+
+	const char* accuracy = mCoreConfigGetValue(config, "accuracy");
+	if (!accuracy || !mCoreAccuracyParse(accuracy, &gb->accuracy)) {
+		gb->accuracy = mCORE_ACCURACY_ACCURATE;
+	}
+
+	mCoreConfigCopyValue(&core->config, config, "accuracy");
 	mCoreConfigCopyValue(&core->config, config, "gb.bios");
 	mCoreConfigCopyValue(&core->config, config, "sgb.bios");
 	mCoreConfigCopyValue(&core->config, config, "gbc.bios");
@@ -411,6 +437,7 @@ static void _GBCoreSetVideoBuffer(struct mCore* core, color_t* buffer, size_t st
 	struct GBCore* gbcore = (struct GBCore*) core;
 	gbcore->renderer.outputBuffer = buffer;
 	gbcore->renderer.outputBufferStride = stride;
+	gbcore->renderer.frameDirty = true;
 }
 
 static void _GBCoreSetVideoGLTex(struct mCore* core, unsigned texid) {
@@ -720,6 +747,54 @@ static void _GBCoreRunLoop(struct mCore* core) {
 	SM83Run(core->cpu);
 }
 
+static uint32_t _GBRunUntilPC(struct mRunUntil* ru) {
+	struct SM83Core* cpu = ru->core->cpu;
+	return cpu->pc;
+}
+
+static void _GBRunUntilStop(struct mRunUntil* ru) {
+	struct SM83Core* cpu = ru->core->cpu;
+	struct GB* gb = ru->core->board;
+	cpu->nextEvent = cpu->cycles;
+	gb->earlyExit = true;
+}
+
+static ssize_t _GBCoreRunUntil(struct mCore* core, const struct mRunPredicate* predicates, size_t nPredicates, uint64_t maxCycles, uint64_t* cyclesRun) {
+	struct GB* gb = core->board;
+	struct SM83Core* cpu = core->cpu;
+	struct mRunUntil ru;
+	// Timing runs at twice the rate reported by frequency
+	if (maxCycles > UINT64_MAX / 2) {
+		maxCycles = 0;
+	}
+	mRunUntilInit(&ru, core, predicates, nPredicates, maxCycles * 2);
+	ru.pc = _GBRunUntilPC;
+	ru.stop = _GBRunUntilStop;
+	mRunUntilInstall(&ru, &cpu->breakpointPages, &cpu->watchpointPages);
+	gb->runUntil = &ru;
+
+	while (!mRunUntilShouldStop(&ru)) {
+		SM83Run(cpu);
+	}
+
+	gb->runUntil = NULL;
+	mRunUntilUninstall(&ru);
+	if (cyclesRun) {
+		*cyclesRun = (mRunUntilElapsed(&ru) + 1) / 2;
+	}
+	ssize_t fired = ru.fired;
+	mRunUntilDeinit(&ru);
+	return fired;
+}
+
+static uint64_t _GBCoreRunCycles(struct mCore* core, uint64_t cycles) {
+	if (!cycles) {
+		return 0;
+	}
+	_GBCoreRunUntil(core, NULL, 0, cycles, &cycles);
+	return cycles;
+}
+
 static void _GBCoreStep(struct mCore* core) {
 	struct SM83Core* cpu = core->cpu;
 	do {
@@ -925,6 +1000,32 @@ void* _GBGetMemoryBlock(struct mCore* core, size_t id, size_t* sizeOut) {
 	}
 }
 
+static void _GBCoreMemoryUsage(struct mCore* core, struct mCoreMemoryUsage* usage) {
+	struct GBCore* gbcore = (struct GBCore*) core;
+	struct GB* gb = core->board;
+	struct GBVideoRenderer* renderer = gb->video.renderer;
+	memset(usage, 0, sizeof(*usage));
+	mCoreMemoryUsageAdd(usage, mCORE_MEMORY_USAGE_SYSTEM, gbcore, sizeof(*gbcore), false);
+	mCoreMemoryUsageAdd(usage, mCORE_MEMORY_USAGE_SYSTEM, core->cpu, sizeof(struct SM83Core), false);
+	mCoreMemoryUsageAdd(usage, mCORE_MEMORY_USAGE_SYSTEM, gb, sizeof(*gb), false);
+	mCoreMemoryUsageAdd(usage, mCORE_MEMORY_USAGE_RAM, gb->memory.wram, GB_SIZE_WORKING_RAM, false);
+	if (gb->isPristine) {
+		mCoreMemoryUsageAdd(usage, mCORE_MEMORY_USAGE_ROM, gb->memory.rom, gb->pristineRomSize, gb->romVf != NULL);
+	} else {
+		mCoreMemoryUsageAdd(usage, mCORE_MEMORY_USAGE_ROM, gb->memory.rom, GB_SIZE_CART_MAX, false);
+	}
+	mCoreMemoryUsageAdd(usage, mCORE_MEMORY_USAGE_SAVEDATA, gb->memory.sram, gb->sramSize, false);
+	mCoreMemoryUsageAdd(usage, mCORE_MEMORY_USAGE_VIDEO, gb->video.vram, GB_SIZE_VRAM, false);
+	if (renderer) {
+		mCoreMemoryUsageAdd(usage, mCORE_MEMORY_USAGE_VIDEO, renderer->sgbCharRam, SGB_SIZE_CHAR_RAM, false);
+		mCoreMemoryUsageAdd(usage, mCORE_MEMORY_USAGE_VIDEO, renderer->sgbMapRam, SGB_SIZE_MAP_RAM, false);
+		mCoreMemoryUsageAdd(usage, mCORE_MEMORY_USAGE_VIDEO, renderer->sgbPalRam, SGB_SIZE_PAL_RAM, false);
+		mCoreMemoryUsageAdd(usage, mCORE_MEMORY_USAGE_VIDEO, renderer->sgbAttributeFiles, SGB_SIZE_ATF_RAM, false);
+	}
+	mCoreMemoryUsageAdd(usage, mCORE_MEMORY_USAGE_AUDIO, gb->audio.left, blip_footprint(gb->audio.left), false);
+	mCoreMemoryUsageAdd(usage, mCORE_MEMORY_USAGE_AUDIO, gb->audio.right, blip_footprint(gb->audio.right), false);
+}
+
 static size_t _GBCoreListRegisters(const struct mCore* core, const struct mCoreRegisterInfo** list) {
 	UNUSED(core);
 	*list = _GBRegisters;
@@ -1134,6 +1235,11 @@ static bool _GBCoreLookupIdentifier(struct mCore* core, const char* name, int32_
 	}
 	return false;
 }
+
+static const struct mCodeAnalysisPlatform* _GBCoreCodeAnalysisPlatform(struct mCore* core) {
+	UNUSED(core);
+	return &GBCodeAnalysisPlatform;
+}
 #endif
 
 static struct mCheatDevice* _GBCoreCheatDevice(struct mCore* core) {
@@ -1201,7 +1307,9 @@ static size_t _GBCoreListAudioChannels(const struct mCore* core, const struct mC
 }
 
 static void _GBCoreEnableVideoLayer(struct mCore* core, size_t id, bool enable) {
+	struct GBCore* gbcore = (struct GBCore*) core;
 	struct GB* gb = core->board;
+	gbcore->renderer.frameDirty = true;
 	switch (id) {
 	case GB_LAYER_BACKGROUND:
 		gb->video.renderer->disableBG = !enable;
@@ -1249,6 +1357,17 @@ static void _GBCoreAdjustVideoLayer(struct mCore* core, size_t id, int32_t x, in
 	default:
 		return;
 	}
+	gbcore->renderer.frameDirty = true;
+}
+
+static void _GBCoreSetVideoLayerOutput(struct mCore* core, const struct mVideoLayerOutput* output) {
+	struct GBCore* gbcore = (struct GBCore*) core;
+	if (!output) {
+		gbcore->renderer.layerOutput = NULL;
+		return;
+	}
+	gbcore->layerOutput = *output;
+	gbcore->renderer.layerOutput = &gbcore->layerOutput;
 }
 
 #ifndef MINIMAL_CORE
@@ -1321,6 +1440,8 @@ struct mCore* GBCoreCreate(void) {
 	core->runFrame = _GBCoreRunFrame;
 	core->runLoop = _GBCoreRunLoop;
 	core->step = _GBCoreStep;
+	core->runCycles = _GBCoreRunCycles;
+	core->runUntil = _GBCoreRunUntil;
 	core->stateSize = _GBCoreStateSize;
 	core->loadState = _GBCoreLoadState;
 	core->saveState = _GBCoreSaveState;
@@ -1349,6 +1470,7 @@ struct mCore* GBCoreCreate(void) {
 	core->rawWrite32 = _GBCoreRawWrite32;
 	core->listMemoryBlocks = _GBListMemoryBlocks;
 	core->getMemoryBlock = _GBGetMemoryBlock;
+	core->memoryUsage = _GBCoreMemoryUsage;
 	core->listRegisters = _GBCoreListRegisters;
 	core->readRegister = _GBCoreReadRegister;
 	core->writeRegister = _GBCoreWriteRegister;
@@ -1360,6 +1482,7 @@ struct mCore* GBCoreCreate(void) {
 	core->detachDebugger = _GBCoreDetachDebugger;
 	core->loadSymbols = _GBCoreLoadSymbols;
 	core->lookupIdentifier = _GBCoreLookupIdentifier;
+	core->codeAnalysisPlatform = _GBCoreCodeAnalysisPlatform;
 #endif
 	core->cheatDevice = _GBCoreCheatDevice;
 	core->savedataClone = _GBCoreSavedataClone;
@@ -1369,6 +1492,7 @@ struct mCore* GBCoreCreate(void) {
 	core->enableVideoLayer = _GBCoreEnableVideoLayer;
 	core->enableAudioChannel = _GBCoreEnableAudioChannel;
 	core->adjustVideoLayer = _GBCoreAdjustVideoLayer;
+	core->setVideoLayerOutput = _GBCoreSetVideoLayerOutput;
 #ifndef MINIMAL_CORE
 	core->startVideoLog = _GBCoreStartVideoLog;
 	core->endVideoLog = _GBCoreEndVideoLog;
@@ -0,0 +1,203 @@
+/* Copyright (c) 2013-2024 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include <mgba/internal/gb/debugger/analysis.h>
+
+#include <mgba/core/core.h>
+#include <mgba/internal/gb/memory.h>
+#include <mgba/internal/sm83/decoder.h>
+
+enum {
+	GB_KNOWN_A = 0,
+	GB_KNOWN_HL,
+	GB_KNOWN_BANK,
+};
+
+static bool _isStatic(struct mCodeAnalysis* analysis, const struct mCodeLocation* location) {
+	if (location->address < GB_BASE_CART_BANK1) {
+		return location->segment < 0;
+	}
+	if (location->address < GB_BASE_VRAM) {
+		return location->segment >= 0 && (size_t) location->segment * GB_SIZE_CART_BANK0 < analysis->core->romSize(analysis->core);
+	}
+	return false;
+}
+
+static bool _getKnown(const struct mCodeAnalysis* analysis, unsigned index, uint32_t* value) {
+	if (!(analysis->knownMask & (1 << index))) {
+		return false;
+	}
+	*value = analysis->knownValues[index];
+	return true;
+}
+
+static void _setKnown(struct mCodeAnalysis* analysis, unsigned index, uint32_t value) {
+	analysis->knownValues[index] = value;
+	analysis->knownMask |= 1 << index;
+}
+
+// Switchable bank targets use the last bank the code selected, if any, and otherwise the caller's own bank
+static void _setTarget(struct mCodeAnalysis* analysis, const struct mCodeLocation* location, uint16_t address, struct mCodeLocation* target) {
+	uint32_t bank;
+	target->address = address;
+	target->mode = 0;
+	target->segment = -1;
+	if (address < GB_BASE_CART_BANK1 || address >= GB_BASE_VRAM) {
+		return;
+	}
+	if (_getKnown(analysis, GB_KNOWN_BANK, &bank)) {
+		target->segment = bank;
+	} else if (location->address >= GB_BASE_CART_BANK1 && location->address < GB_BASE_VRAM) {
+		target->segment = location->segment;
+	} else if (analysis->core->romSize(analysis->core) <= GB_SIZE_CART_BANK0 * 2) {
+		target->segment = 1;
+	}
+}
+
+static void _trackRegisters(struct mCodeAnalysis* analysis, const struct SM83InstructionInfo* info) {
+	uint32_t value;
+	if (info->mnemonic == SM83_MN_LD && !(info->op1.flags & SM83_OP_FLAG_MEMORY)) {
+		if (info->op1.reg == SM83_REG_A) {
+			if (!info->op2.reg && !(info->op2.flags & SM83_OP_FLAG_MEMORY)) {
+				_setKnown(analysis, GB_KNOWN_A, info->op2.immediate);
+			} else {
+				analysis->knownMask &= ~(1 << GB_KNOWN_A);
+			}
+		} else if (info->op1.reg == SM83_REG_HL && !info->op2.reg) {
+			_setKnown(analysis, GB_KNOWN_HL, info->op2.immediate);
+		} else if (info->op1.reg == SM83_REG_H || info->op1.reg == SM83_REG_L || info->op1.reg == SM83_REG_HL) {
+			analysis->knownMask &= ~(1 << GB_KNOWN_HL);
+		}
+		return;
+	}
+	if (info->mnemonic == SM83_MN_LD && info->op2.reg == SM83_REG_A && _getKnown(analysis, GB_KNOWN_A, &value)) {
+		// Writes to 0x2000-0x3FFF select the ROM bank on nearly every MBC
+		uint32_t address;
+		if (!info->op1.reg) {
+			address = info->op1.immediate;
+		} else if (info->op1.reg != SM83_REG_HL || !_getKnown(analysis, GB_KNOWN_HL, &address)) {
+			address = 0;
+		}
+		if (address >= 0x2000 && address < 0x4000) {
+			_setKnown(analysis, GB_KNOWN_BANK, value ? value : 1);
+		}
+	}
+	if (info->op1.flags & (SM83_OP_FLAG_INCREMENT | SM83_OP_FLAG_DECREMENT) || info->op2.flags & (SM83_OP_FLAG_INCREMENT | SM83_OP_FLAG_DECREMENT)) {
+		analysis->knownMask &= ~(1 << GB_KNOWN_HL);
+	}
+	switch (info->mnemonic) {
+	case SM83_MN_LD:
+	case SM83_MN_BIT:
+	case SM83_MN_CP:
+	case SM83_MN_DI:
+	case SM83_MN_EI:
+	case SM83_MN_HALT:
+	case SM83_MN_NOP:
+	case SM83_MN_PUSH:
+	case SM83_MN_JP:
+	case SM83_MN_JR:
+	case SM83_MN_RET:
+	case SM83_MN_RETI:
+	case SM83_MN_STOP:
+		break;
+	case SM83_MN_CALL:
+	case SM83_MN_RST:
+		// The callee may clobber anything but the selected bank
+		analysis->knownMask &= 1 << GB_KNOWN_BANK;
+		break;
+	default:
+		if (info->op1.reg == SM83_REG_A || !info->op1.reg) {
+			analysis->knownMask &= ~(1 << GB_KNOWN_A);
+		}
+		if (info->op1.reg == SM83_REG_H || info->op1.reg == SM83_REG_L || info->op1.reg == SM83_REG_HL || info->op1.reg == SM83_REG_AF) {
+			analysis->knownMask &= ~((1 << GB_KNOWN_HL) | (1 << GB_KNOWN_A));
+		}
+		break;
+	}
+}
+
+static bool _decode(struct mCodeAnalysis* analysis, const struct mCodeLocation* location, struct mCodeInstructionInfo* out) {
+	struct mCore* core = analysis->core;
+	struct SM83InstructionInfo info = {{0}};
+	memset(out, 0, sizeof(*out));
+	if (location->address > 0xFFFF || (location->address >= GB_BASE_CART_BANK1 && location->address < GB_BASE_VRAM && location->segment < 0)) {
+		return false;
+	}
+	uint16_t address = location->address;
+	size_t bytesRemaining;
+	for (bytesRemaining = 1; bytesRemaining; --bytesRemaining) {
+		bytesRemaining += SM83Decode(core->rawRead8(core, address, location->segment), &info);
+		++address;
+	}
+	if (info.mnemonic == SM83_MN_ILL) {
+		return false;
+	}
+	out->length = info.opcodeSize;
+	out->flow = mCODE_FLOW_CONTINUES;
+
+	uint32_t hl;
+	switch (info.mnemonic) {
+	case SM83_MN_JP:
+		if (info.op1.reg == SM83_REG_HL) {
+			if (_getKnown(analysis, GB_KNOWN_HL, &hl)) {
+				out->flow = mCODE_FLOW_JUMP;
+				_setTarget(analysis, location, hl, &out->target);
+			} else {
+				out->flow = mCODE_FLOW_JUMP | mCODE_FLOW_INDIRECT;
+			}
+			break;
+		}
+		out->flow = mCODE_FLOW_JUMP;
+		_setTarget(analysis, location, info.op1.immediate, &out->target);
+		break;
+	case SM83_MN_JR:
+		out->flow = mCODE_FLOW_JUMP;
+		_setTarget(analysis, location, address + (int8_t) info.op1.immediate, &out->target);
+		break;
+	case SM83_MN_CALL:
+		out->flow = mCODE_FLOW_CALL | mCODE_FLOW_CONTINUES;
+		_setTarget(analysis, location, info.op1.immediate, &out->target);
+		break;
+	case SM83_MN_RST:
+		out->flow = mCODE_FLOW_CALL | mCODE_FLOW_CONTINUES;
+		_setTarget(analysis, location, info.op1.immediate, &out->target);
+		break;
+	case SM83_MN_RET:
+	case SM83_MN_RETI:
+		out->flow = mCODE_FLOW_RETURN;
+		break;
+	default:
+		if ((info.op1.flags & SM83_OP_FLAG_MEMORY) && !info.op1.reg) {
+			out->flow |= mCODE_FLOW_DATA;
+			_setTarget(analysis, location, info.op1.immediate, &out->data);
+		} else if ((info.op2.flags & SM83_OP_FLAG_MEMORY) && !info.op2.reg) {
+			out->flow |= mCODE_FLOW_DATA;
+			_setTarget(analysis, location, info.op2.immediate, &out->data);
+		}
+		break;
+	}
+	if (info.condition != SM83_COND_NONE) {
+		out->flow |= mCODE_FLOW_CONTINUES;
+	}
+
+	_trackRegisters(analysis, &info);
+	return true;
+}
+
+static void _addEntryPoints(struct mCodeAnalysis* analysis) {
+	mCodeAnalysisAddEntryPoint(analysis, 0x100, -1, 0);
+	// VBlank, STAT, timer, serial and joypad interrupts
+	uint32_t vector;
+	for (vector = 0x40; vector <= 0x60; vector += 8) {
+		mCodeAnalysisAddEntryPoint(analysis, vector, -1, 0);
+	}
+}
+
+const struct mCodeAnalysisPlatform GBCodeAnalysisPlatform = {
+	.id = mPLATFORM_GB,
+	.decode = _decode,
+	.isStatic = _isStatic,
+	.addEntryPoints = _addEntryPoints,
+};
@@ -12,6 +12,7 @@
 
 #include <mgba/core/core.h>
 #include <mgba/core/cheats.h>
+#include <mgba/core/run-until.h>
 #include <mgba-util/crc32.h>
 #include <mgba-util/memory.h>
 #include <mgba-util/math.h>
@@ -89,10 +90,15 @@ static void GBInit(void* cpu, struct mCPUComponent* component) {
 
 	mCoreCallbacksListInit(&gb->coreCallbacks, 0);
 	gb->stream = NULL;
+	gb->runUntil = NULL;
 
 	mTimingInit(&gb->timing, &gb->cpu->cycles, &gb->cpu->nextEvent);
 	gb->audio.timing = &gb->timing;
 
+	gb->idleOptimization = GB_IDLE_LOOP_REMOVE;
+	gb->idleLoop = GB_IDLE_LOOP_NONE;
+	gb->accuracy = mCORE_ACCURACY_ACCURATE;
+
 	gb->eiPending.name = "GB EI";
 	gb->eiPending.callback = _enableInterrupts;
 	gb->eiPending.context = gb;
@@ -434,6 +440,7 @@ void GBUnloadROM(struct GB* gb) {
 	gb->memory.rom = NULL;
 	gb->memory.mbcType = GB_MBC_AUTODETECT;
 	gb->isPristine = false;
+	gb->idleLoop = GB_IDLE_LOOP_NONE;
 
 	if (!gb->sramDirty) {
 		gb->sramMaskWriteback = false;
@@ -589,6 +596,10 @@ void GBReset(struct SM83Core* cpu) {
 	gb->earlyExit = false;
 	gb->doubleSpeed = 0;
 
+	gb->lastJump = 0;
+	gb->idleDetectionStep = 0;
+	gb->idleDetectionFailures = 0;
+
 	if (gb->yankedRomSize) {
 		gb->memory.romSize = gb->yankedRomSize;
 		gb->memory.mbcType = gb->yankedMbc;
@@ -901,6 +912,13 @@ int GBValidModels(const uint8_t* bank0) {
 	return models;
 }
 
+void GBRaiseIRQ(struct GB* gb, enum GBIRQ irq) {
+	gb->memory.io[GB_REG_IF] |= 1 << irq;
+	if (UNLIKELY(gb->runUntil)) {
+		mRunUntilIRQ(gb->runUntil, irq);
+	}
+}
+
 void GBUpdateIRQs(struct GB* gb) {
 	int irqs = gb->memory.ie & gb->memory.io[GB_REG_IF] & 0x1F;
 	if (!irqs) {
@@ -1179,7 +1197,11 @@ void GBFrameEnded(struct GB* gb) {
 		const color_t* pixels;
 		size_t stride;
 		gb->video.renderer->getPixels(gb->video.renderer, &stride, (const void**) &pixels);
-		gb->stream->postVideoFrame(gb->stream, pixels, stride);
+		if (gb->video.renderer->repeatFrame && gb->stream->postVideoFrameRepeat) {
+			gb->stream->postVideoFrameRepeat(gb->stream, pixels, stride);
+		} else {
+			gb->stream->postVideoFrame(gb->stream, pixels, stride);
+		}
 	}
 
 	size_t c;
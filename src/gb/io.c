@@ -527,7 +527,7 @@ static uint8_t _readKeys(struct GB* gb) {
 	}
 	gb->memory.io[GB_REG_JOYP] = (0xCF | joyp) ^ (keys & 0xF);
 	if (joyp & ~gb->memory.io[GB_REG_JOYP] & 0xF) {
-		gb->memory.io[GB_REG_IF] |= (1 << GB_IRQ_KEYPAD);
+		GBRaiseIRQ(gb, GB_IRQ_KEYPAD);
 		GBUpdateIRQs(gb);
 	}
 	return gb->memory.io[GB_REG_JOYP];
@@ -548,6 +548,37 @@ static uint8_t _readKeysFiltered(struct GB* gb) {
 	return keys;
 }
 
+bool GBIOIsReadConstant(unsigned address) {
+	switch (address) {
+	default:
+		return false;
+	case GB_REG_SB:
+	case GB_REG_SC:
+	case GB_REG_DIV:
+	case GB_REG_TIMA:
+	case GB_REG_TMA:
+	case GB_REG_TAC:
+	case GB_REG_IF:
+	case GB_REG_LCDC:
+	case GB_REG_STAT:
+	case GB_REG_SCY:
+	case GB_REG_SCX:
+	case GB_REG_LY:
+	case GB_REG_LYC:
+	case GB_REG_BGP:
+	case GB_REG_OBP0:
+	case GB_REG_OBP1:
+	case GB_REG_WY:
+	case GB_REG_WX:
+	case GB_REG_KEY1:
+	case GB_REG_VBK:
+	case GB_REG_HDMA5:
+	case GB_REG_SVBK:
+	case GB_REG_IE:
+		return true;
+	}
+}
+
 uint8_t GBIORead(struct GB* gb, unsigned address) {
 	switch (address) {
 	case GB_REG_JOYP:
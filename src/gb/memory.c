@@ -11,13 +11,18 @@
 #include <mgba/internal/gb/io.h>
 #include <mgba/internal/gb/mbc.h>
 #include <mgba/internal/gb/serialize.h>
+#include <mgba/internal/sm83/decoder.h>
 #include <mgba/internal/sm83/sm83.h>
 
+#include <mgba-util/math.h>
 #include <mgba-util/memory.h>
 #include <mgba-util/vfs.h>
 
 mLOG_DEFINE_CATEGORY(GB_MEM, "GB Memory", "gb.memory");
 
+#define IDLE_LOOP_THRESHOLD 10000
+#define IDLE_LOOP_MAX_INSTRUCTIONS 16
+
 static const uint8_t _yankBuffer[] = { 0xFF };
 
 enum GBBus {
@@ -52,6 +57,8 @@ static const enum GBBus _oamBlockCGB[] = {
 static const uint8_t _blockedRegion[1] = { 0xFF };
 
 static void _pristineCow(struct GB* gba);
+// Loads without the watchpoint check, for instruction fetches and reads that aren't made by the CPU
+static uint8_t _GBLoad8(struct SM83Core* cpu, uint16_t address);
 
 static uint8_t GBCartLoad8(struct SM83Core* cpu, uint16_t address) {
 	if (UNLIKELY(address >= cpu->memory.activeRegionEnd)) {
@@ -66,16 +73,273 @@ static uint8_t GBCartLoad8(struct SM83Core* cpu, uint16_t address) {
 	return value;
 }
 
+static void _taintRegister(unsigned* tainted, int reg) {
+	*tainted |= 1 << reg;
+	switch (reg) {
+	case SM83_REG_B:
+	case SM83_REG_C:
+		*tainted |= 1 << SM83_REG_BC;
+		break;
+	case SM83_REG_D:
+	case SM83_REG_E:
+		*tainted |= 1 << SM83_REG_DE;
+		break;
+	case SM83_REG_H:
+	case SM83_REG_L:
+		*tainted |= 1 << SM83_REG_HL;
+		break;
+	case SM83_REG_A:
+	case SM83_REG_F:
+		*tainted |= 1 << SM83_REG_AF;
+		break;
+	case SM83_REG_BC:
+		*tainted |= (1 << SM83_REG_B) | (1 << SM83_REG_C);
+		break;
+	case SM83_REG_DE:
+		*tainted |= (1 << SM83_REG_D) | (1 << SM83_REG_E);
+		break;
+	case SM83_REG_HL:
+		*tainted |= (1 << SM83_REG_H) | (1 << SM83_REG_L);
+		break;
+	case SM83_REG_AF:
+		*tainted |= (1 << SM83_REG_A) | (1 << SM83_REG_F);
+		break;
+	}
+}
+
+static uint16_t _readRegister(const struct SM83Core* cpu, int reg) {
+	switch (reg) {
+	case SM83_REG_B:
+		return cpu->b;
+	case SM83_REG_C:
+		return cpu->c;
+	case SM83_REG_D:
+		return cpu->d;
+	case SM83_REG_E:
+		return cpu->e;
+	case SM83_REG_H:
+		return cpu->h;
+	case SM83_REG_L:
+		return cpu->l;
+	case SM83_REG_A:
+		return cpu->a;
+	case SM83_REG_BC:
+		return cpu->bc;
+	case SM83_REG_DE:
+		return cpu->de;
+	case SM83_REG_HL:
+		return cpu->hl;
+	case SM83_REG_SP:
+		return cpu->sp;
+	default:
+		return 0;
+	}
+}
+
+static bool _isPollable(struct GB* gb, uint16_t address) {
+	switch (address >> 12) {
+	case GB_REGION_CART_BANK0:
+	case GB_REGION_CART_BANK0 + 1:
+	case GB_REGION_CART_BANK0 + 2:
+	case GB_REGION_CART_BANK0 + 3:
+		return !gb->memory.mbcReadBank0;
+	case GB_REGION_CART_BANK1:
+	case GB_REGION_CART_BANK1 + 1:
+	case GB_REGION_CART_BANK1 + 2:
+	case GB_REGION_CART_BANK1 + 3:
+		return !gb->memory.mbcReadBank1;
+	case GB_REGION_VRAM:
+	case GB_REGION_VRAM + 1:
+	case GB_REGION_WORKING_RAM_BANK0:
+	case GB_REGION_WORKING_RAM_BANK1:
+	case GB_REGION_WORKING_RAM_BANK0 + 2:
+		return true;
+	case GB_REGION_EXTERNAL_RAM:
+	case GB_REGION_EXTERNAL_RAM + 1:
+		return false;
+	default:
+		if (address < GB_BASE_UNUSABLE) {
+			return true;
+		}
+		if (address < GB_BASE_IO) {
+			return false;
+		}
+		if (address < GB_BASE_HRAM) {
+			return GBIOIsReadConstant(address & (GB_SIZE_IO - 1));
+		}
+		return true;
+	}
+}
+
+static bool _analyzeForIdleLoop(struct GB* gb, struct SM83Core* cpu, uint16_t address) {
+	uint16_t nextAddress = address;
+	unsigned tainted = 0;
+	int i;
+	for (i = 0; i < IDLE_LOOP_MAX_INSTRUCTIONS; ++i) {
+		struct SM83InstructionInfo info = {{0}};
+		size_t bytesRemaining;
+		for (bytesRemaining = 1; bytesRemaining; --bytesRemaining) {
+			bytesRemaining += SM83Decode(GBView8(cpu, nextAddress, -1), &info);
+			++nextAddress;
+		}
+
+		const struct SM83Operand* load = NULL;
+		bool store = false;
+		switch (info.mnemonic) {
+		case SM83_MN_JP:
+		case SM83_MN_JR:
+			if (info.op1.reg) {
+				return false;
+			}
+			if (info.mnemonic == SM83_MN_JR) {
+				info.op1.immediate = nextAddress + (int8_t) info.op1.immediate;
+			}
+			if (info.op1.immediate == address) {
+				gb->idleLoop = address | (cpu->memory.currentSegment(cpu, address) << 16);
+				gb->idleOptimization = GB_IDLE_LOOP_REMOVE;
+				return true;
+			}
+			if (info.condition == SM83_COND_NONE) {
+				return false;
+			}
+			// This branch was not taken on the way back to the loop head
+			continue;
+		case SM83_MN_AND:
+		case SM83_MN_XOR:
+		case SM83_MN_OR:
+		case SM83_MN_CP:
+		case SM83_MN_ADD:
+		case SM83_MN_ADC:
+		case SM83_MN_SUB:
+		case SM83_MN_SBC:
+			if (info.op1.flags & SM83_OP_FLAG_MEMORY) {
+				load = &info.op1;
+			} else if (info.mnemonic != SM83_MN_CP) {
+				_taintRegister(&tainted, info.op1.reg);
+			}
+			break;
+		case SM83_MN_BIT:
+			if (info.op2.flags & SM83_OP_FLAG_MEMORY) {
+				load = &info.op2;
+			}
+			break;
+		case SM83_MN_RES:
+		case SM83_MN_SET:
+			if (info.op2.flags & SM83_OP_FLAG_MEMORY) {
+				store = true;
+			} else {
+				_taintRegister(&tainted, info.op2.reg);
+			}
+			break;
+		case SM83_MN_LD:
+			if (info.op2.flags & SM83_OP_FLAG_MEMORY) {
+				load = &info.op2;
+			}
+			// Fall through
+		case SM83_MN_INC:
+		case SM83_MN_DEC:
+		case SM83_MN_RL:
+		case SM83_MN_RLC:
+		case SM83_MN_RR:
+		case SM83_MN_RRC:
+		case SM83_MN_SLA:
+		case SM83_MN_SRA:
+		case SM83_MN_SRL:
+		case SM83_MN_SWAP:
+			if (info.op1.flags & SM83_OP_FLAG_MEMORY) {
+				store = true;
+			} else {
+				_taintRegister(&tainted, info.op1.reg);
+			}
+			break;
+		case SM83_MN_CPL:
+		case SM83_MN_DAA:
+		case SM83_MN_SCF:
+		case SM83_MN_CCF:
+		case SM83_MN_NOP:
+			break;
+		default:
+			return false;
+		}
+		if (store) {
+			return false;
+		}
+		if (load) {
+			if (load->reg && (tainted & (1 << load->reg))) {
+				return false;
+			}
+			uint16_t loadAddress = _readRegister(cpu, load->reg) + load->immediate;
+			if (!_isPollable(gb, loadAddress)) {
+				return false;
+			}
+			if (load->flags & (SM83_OP_FLAG_INCREMENT | SM83_OP_FLAG_DECREMENT)) {
+				_taintRegister(&tainted, load->reg);
+			}
+		}
+	}
+	return false;
+}
+
+static void _processIdleLoop(struct GB* gb, struct SM83Core* cpu, uint16_t address) {
+	if (address != gb->lastJump) {
+		gb->idleDetectionStep = 0;
+		return;
+	}
+	if (gb->memory.io[GB_REG_BANK] == 0xFF && gb->memory.romBase != gb->memory.rom) {
+		// Don't confuse loops in the BIOS with loops in the ROM
+		return;
+	}
+	bool isIdleLoop = address == (uint16_t) gb->idleLoop && gb->idleLoop != GB_IDLE_LOOP_NONE &&
+	                  cpu->memory.currentSegment(cpu, address) == (int) (gb->idleLoop >> 16);
+	if (!isIdleLoop && (gb->idleOptimization < GB_IDLE_LOOP_DETECT || gb->idleDetectionStep < 0)) {
+		return;
+	}
+	if (gb->idleDetectionStep > 0 && gb->cachedMasterCycles == gb->timing.masterCycles) {
+		// No events have fired since the previous iteration, so nothing the loop reads can have changed
+		if (memcmp(&gb->cachedRegisters, &cpu->regs, sizeof(gb->cachedRegisters)) != 0) {
+			if (!isIdleLoop) {
+				gb->idleDetectionStep = -1;
+				++gb->idleDetectionFailures;
+				if (gb->idleDetectionFailures > IDLE_LOOP_THRESHOLD) {
+					gb->idleOptimization = GB_IDLE_LOOP_IGNORE;
+				}
+				return;
+			}
+		} else {
+			if (!isIdleLoop && !_analyzeForIdleLoop(gb, cpu, address)) {
+				gb->idleDetectionStep = -1;
+				return;
+			}
+			// Every remaining iteration before the next event is identical, so skip all but the last
+			int32_t period = cpu->cycles - gb->cachedCycles;
+			if (period > 0) {
+				int32_t iterations = (cpu->nextEvent - cpu->cycles) / period - 1;
+				if (iterations > 0) {
+					cpu->cycles += iterations * period;
+				}
+			}
+		}
+	}
+	gb->idleDetectionStep = 1;
+	memcpy(&gb->cachedRegisters, &cpu->regs, sizeof(gb->cachedRegisters));
+	gb->cachedMasterCycles = gb->timing.masterCycles;
+	gb->cachedCycles = cpu->cycles;
+}
+
 static void GBSetActiveRegion(struct SM83Core* cpu, uint16_t address) {
 	struct GB* gb = (struct GB*) cpu->master;
 	struct GBMemory* memory = &gb->memory;
+	if (gb->idleOptimization >= GB_IDLE_LOOP_REMOVE) {
+		_processIdleLoop(gb, cpu, address);
+		gb->lastJump = address;
+	}
 	switch (address >> 12) {
 	case GB_REGION_CART_BANK0:
 	case GB_REGION_CART_BANK0 + 1:
 	case GB_REGION_CART_BANK0 + 2:
 	case GB_REGION_CART_BANK0 + 3:
 		if (gb->memory.mbcReadBank0) {
-			cpu->memory.cpuLoad8 = GBLoad8;
+			cpu->memory.cpuLoad8 = _GBLoad8;
 			break;
 		}
 		cpu->memory.cpuLoad8 = GBCartLoad8;
@@ -96,7 +360,7 @@ static void GBSetActiveRegion(struct SM83Core* cpu, uint16_t address) {
 	case GB_REGION_CART_BANK1 + 2:
 	case GB_REGION_CART_BANK1 + 3:
 		if (gb->memory.mbcReadBank1) {
-			cpu->memory.cpuLoad8 = GBLoad8;
+			cpu->memory.cpuLoad8 = _GBLoad8;
 			break;
 		}
 		cpu->memory.cpuLoad8 = GBCartLoad8;
@@ -124,10 +388,10 @@ static void GBSetActiveRegion(struct SM83Core* cpu, uint16_t address) {
 		}
 		break;
 	default:
-		cpu->memory.cpuLoad8 = GBLoad8;
+		cpu->memory.cpuLoad8 = _GBLoad8;
 		break;
 	}
-	if (gb->memory.dmaRemaining) {
+	if (gb->memory.dmaRemaining && gb->accuracy == mCORE_ACCURACY_ACCURATE) {
 		const enum GBBus* block = gb->model < GB_MODEL_CGB ? _oamBlockDMG : _oamBlockCGB;
 		enum GBBus dmaBus = block[memory->dmaSource >> 13];
 		enum GBBus accessBus = block[address >> 13];
@@ -138,14 +402,19 @@ static void GBSetActiveRegion(struct SM83Core* cpu, uint16_t address) {
 	}
 }
 
+static uint8_t _GBView8(struct SM83Core* cpu, uint16_t address) {
+	return GBView8(cpu, address, -1);
+}
+
 static void _GBMemoryDMAService(struct mTiming* timing, void* context, uint32_t cyclesLate);
 static void _GBMemoryHDMAService(struct mTiming* timing, void* context, uint32_t cyclesLate);
 
 void GBMemoryInit(struct GB* gb) {
 	struct SM83Core* cpu = gb->cpu;
-	cpu->memory.cpuLoad8 = GBLoad8;
+	cpu->memory.cpuLoad8 = _GBLoad8;
 	cpu->memory.load8 = GBLoad8;
 	cpu->memory.store8 = GBStore8;
+	cpu->memory.view8 = _GBView8;
 	cpu->memory.currentSegment = GBCurrentSegment;
 	cpu->memory.setActiveRegion = GBSetActiveRegion;
 
@@ -230,9 +499,14 @@ void GBMemorySwitchWramBank(struct GBMemory* memory, int bank) {
 }
 
 uint8_t GBLoad8(struct SM83Core* cpu, uint16_t address) {
+	mWatchpointPagesCheckRead(cpu->watchpointPages, address, 1);
+	return _GBLoad8(cpu, address);
+}
+
+static uint8_t _GBLoad8(struct SM83Core* cpu, uint16_t address) {
 	struct GB* gb = (struct GB*) cpu->master;
 	struct GBMemory* memory = &gb->memory;
-	if (gb->memory.dmaRemaining) {
+	if (gb->memory.dmaRemaining && gb->accuracy == mCORE_ACCURACY_ACCURATE) {
 		const enum GBBus* block = gb->model < GB_MODEL_CGB ? _oamBlockDMG : _oamBlockCGB;
 		enum GBBus dmaBus = block[memory->dmaSource >> 13];
 		enum GBBus accessBus = block[address >> 13];
@@ -333,9 +607,11 @@ uint8_t GBLoad8(struct SM83Core* cpu, uint16_t address) {
 }
 
 void GBStore8(struct SM83Core* cpu, uint16_t address, int8_t value) {
+	mWatchpointPagesCheckWrite(cpu->watchpointPages, address, (uint8_t) value, 1);
+
 	struct GB* gb = (struct GB*) cpu->master;
 	struct GBMemory* memory = &gb->memory;
-	if (gb->memory.dmaRemaining) {
+	if (gb->memory.dmaRemaining && gb->accuracy == mCORE_ACCURACY_ACCURATE) {
 		const enum GBBus* block = gb->model < GB_MODEL_CGB ? _oamBlockDMG : _oamBlockCGB;
 		enum GBBus dmaBus = block[memory->dmaSource >> 13];
 		enum GBBus accessBus = block[address >> 13];
@@ -576,7 +852,7 @@ void _GBMemoryDMAService(struct mTiming* timing, void* context, uint32_t cyclesL
 	struct GB* gb = context;
 	int dmaRemaining = gb->memory.dmaRemaining;
 	gb->memory.dmaRemaining = 0;
-	uint8_t b = GBLoad8(gb->cpu, gb->memory.dmaSource);
+	uint8_t b = _GBLoad8(gb->cpu, gb->memory.dmaSource);
 	// TODO: Can DMA write OAM during modes 2-3?
 	gb->video.oam.raw[gb->memory.dmaDest] = b;
 	gb->video.renderer->writeOAM(gb->video.renderer, gb->memory.dmaDest);
@@ -1011,7 +1287,15 @@ void _pristineCow(struct GB* gb) {
 	}
 	void* newRom = anonymousMemoryMap(GB_SIZE_CART_MAX);
 	memcpy(newRom, gb->memory.rom, gb->memory.romSize);
-	memset(((uint8_t*) newRom) + gb->memory.romSize, 0xFF, GB_SIZE_CART_MAX - gb->memory.romSize);
+	// Banks are only ever mapped within the next power of two, so leave the rest of the mapping untouched
+	size_t fillEnd = toPow2(gb->memory.romSize);
+	if (fillEnd < GB_SIZE_CART_BANK0 * 2) {
+		fillEnd = GB_SIZE_CART_BANK0 * 2;
+	}
+	if (fillEnd > GB_SIZE_CART_MAX) {
+		fillEnd = GB_SIZE_CART_MAX;
+	}
+	memset(((uint8_t*) newRom) + gb->memory.romSize, 0xFF, fillEnd - gb->memory.romSize);
 	if (gb->memory.rom == gb->memory.romBase) {
 		gb->memory.romBase = newRom;
 	}
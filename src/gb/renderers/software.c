@@ -36,6 +36,7 @@ static void GBVideoSoftwareRendererPutPixels(struct GBVideoRenderer* renderer, s
 
 static void GBVideoSoftwareRendererDrawBackground(struct GBVideoSoftwareRenderer* renderer, uint8_t* maps, int startX, int endX, int sx, int sy, bool highlight);
 static void GBVideoSoftwareRendererDrawObj(struct GBVideoSoftwareRenderer* renderer, struct GBVideoRendererSprite* obj, int startX, int endX, int y);
+static void _drawLayerOutput(struct GBVideoSoftwareRenderer* renderer, const uint16_t* background, int startX, int windowX, int endX, int y);
 
 static void _clearScreen(struct GBVideoSoftwareRenderer* renderer) {
 	size_t sgbOffset = 0;
@@ -220,6 +221,7 @@ void GBVideoSoftwareRendererCreate(struct GBVideoSoftwareRenderer* renderer) {
 	renderer->d.highlightAmount = 0;
 
 	renderer->temporaryBuffer = 0;
+	renderer->layerOutput = NULL;
 }
 
 static void GBVideoSoftwareRendererInit(struct GBVideoRenderer* renderer, enum GBModel model, bool sgbBorders) {
@@ -244,6 +246,9 @@ static void GBVideoSoftwareRendererInit(struct GBVideoRenderer* renderer, enum G
 	softwareRenderer->offsetScy = 0;
 	softwareRenderer->offsetWx = 0;
 	softwareRenderer->offsetWy = 0;
+	softwareRenderer->frameDirty = true;
+	softwareRenderer->frameDrawn = false;
+	softwareRenderer->outputCurrent = false;
 
 	size_t i;
 	for (i = 0; i < (sizeof(softwareRenderer->lookup) / sizeof(*softwareRenderer->lookup)); ++i) {
@@ -291,6 +296,10 @@ static void GBVideoSoftwareRendererUpdateWindow(struct GBVideoSoftwareRenderer*
 	}
 }
 
+static bool _lookupChanged(const uint8_t* lookup, uint8_t value) {
+	return lookup[0] != (value & 3) || lookup[1] != ((value >> 2) & 3) || lookup[2] != ((value >> 4) & 3) || lookup[3] != ((value >> 6) & 3);
+}
+
 static uint8_t GBVideoSoftwareRendererWriteVideoRegister(struct GBVideoRenderer* renderer, uint16_t address, uint8_t value) {
 	struct GBVideoSoftwareRenderer* softwareRenderer = (struct GBVideoSoftwareRenderer*) renderer;
 	if (renderer->cache) {
@@ -300,24 +309,30 @@ static uint8_t GBVideoSoftwareRendererWriteVideoRegister(struct GBVideoRenderer*
 	uint8_t wy = softwareRenderer->wy;
 	switch (address) {
 	case GB_REG_LCDC:
+		softwareRenderer->frameDirty |= softwareRenderer->lcdc != value;
 		softwareRenderer->lcdc = value;
 		GBVideoSoftwareRendererUpdateWindow(softwareRenderer, wasWindow, _inWindow(softwareRenderer), wy);
 		break;
 	case GB_REG_SCY:
+		softwareRenderer->frameDirty |= softwareRenderer->scy != value;
 		softwareRenderer->scy = value;
 		break;
 	case GB_REG_SCX:
+		softwareRenderer->frameDirty |= softwareRenderer->scx != value;
 		softwareRenderer->scx = value;
 		break;
 	case GB_REG_WY:
+		softwareRenderer->frameDirty |= softwareRenderer->wy != value;
 		softwareRenderer->wy = value;
 		GBVideoSoftwareRendererUpdateWindow(softwareRenderer, wasWindow, _inWindow(softwareRenderer), wy);
 		break;
 	case GB_REG_WX:
+		softwareRenderer->frameDirty |= softwareRenderer->wx != value;
 		softwareRenderer->wx = value;
 		GBVideoSoftwareRendererUpdateWindow(softwareRenderer, wasWindow, _inWindow(softwareRenderer), wy);
 		break;
 	case GB_REG_BGP:
+		softwareRenderer->frameDirty |= _lookupChanged(&softwareRenderer->lookup[0], value);
 		softwareRenderer->lookup[0] = value & 3;
 		softwareRenderer->lookup[1] = (value >> 2) & 3;
 		softwareRenderer->lookup[2] = (value >> 4) & 3;
@@ -328,6 +343,7 @@ static uint8_t GBVideoSoftwareRendererWriteVideoRegister(struct GBVideoRenderer*
 		softwareRenderer->lookup[PAL_HIGHLIGHT_BG + 3] = PAL_HIGHLIGHT + ((value >> 6) & 3);
 		break;
 	case GB_REG_OBP0:
+		softwareRenderer->frameDirty |= _lookupChanged(&softwareRenderer->lookup[PAL_OBJ], value);
 		softwareRenderer->lookup[PAL_OBJ + 0] = value & 3;
 		softwareRenderer->lookup[PAL_OBJ + 1] = (value >> 2) & 3;
 		softwareRenderer->lookup[PAL_OBJ + 2] = (value >> 4) & 3;
@@ -338,6 +354,7 @@ static uint8_t GBVideoSoftwareRendererWriteVideoRegister(struct GBVideoRenderer*
 		softwareRenderer->lookup[PAL_HIGHLIGHT_OBJ + 3] = PAL_HIGHLIGHT + ((value >> 6) & 3);
 		break;
 	case GB_REG_OBP1:
+		softwareRenderer->frameDirty |= _lookupChanged(&softwareRenderer->lookup[PAL_OBJ + 4], value);
 		softwareRenderer->lookup[PAL_OBJ + 4] = value & 3;
 		softwareRenderer->lookup[PAL_OBJ + 5] = (value >> 2) & 3;
 		softwareRenderer->lookup[PAL_OBJ + 6] = (value >> 4) & 3;
@@ -354,6 +371,7 @@ static uint8_t GBVideoSoftwareRendererWriteVideoRegister(struct GBVideoRenderer*
 static void GBVideoSoftwareRendererWriteSGBPacket(struct GBVideoRenderer* renderer, uint8_t* data) {
 	struct GBVideoSoftwareRenderer* softwareRenderer = (struct GBVideoSoftwareRenderer*) renderer;
 	memcpy(softwareRenderer->sgbPacket, data, sizeof(softwareRenderer->sgbPacket));
+	softwareRenderer->frameDirty = true;
 	int i;
 	softwareRenderer->sgbCommandHeader = data[0];
 	softwareRenderer->sgbTransfer = 0;
@@ -529,6 +547,7 @@ static void GBVideoSoftwareRendererWritePalette(struct GBVideoRenderer* renderer
 		color = r | (g << 8) | (b << 16);
 #endif
 	}
+	softwareRenderer->frameDirty |= softwareRenderer->palette[index] != color;
 	softwareRenderer->palette[index] = color;
 	if (index < PAL_SGB_BORDER && (index < PAL_OBJ || (index & 3))) {
 		softwareRenderer->palette[index + PAL_HIGHLIGHT] = mColorMix5Bit(0x10 - softwareRenderer->lastHighlightAmount, color, softwareRenderer->lastHighlightAmount, renderer->highlightColor);
@@ -551,15 +570,20 @@ static void GBVideoSoftwareRendererWritePalette(struct GBVideoRenderer* renderer
 }
 
 static void GBVideoSoftwareRendererWriteVRAM(struct GBVideoRenderer* renderer, uint16_t address) {
+	struct GBVideoSoftwareRenderer* softwareRenderer = (struct GBVideoSoftwareRenderer*) renderer;
 	if (renderer->cache) {
 		mCacheSetWriteVRAM(renderer->cache, address);
 	}
+	softwareRenderer->frameDirty = true;
 }
 
 static void GBVideoSoftwareRendererWriteOAM(struct GBVideoRenderer* renderer, uint16_t oam) {
-	UNUSED(renderer);
-	UNUSED(oam);
-	// Nothing to do
+	struct GBVideoSoftwareRenderer* softwareRenderer = (struct GBVideoSoftwareRenderer*) renderer;
+	// OAM DMA usually rewrites the same table every frame, so only count real changes
+	if (softwareRenderer->lastOam[oam] != renderer->oam->raw[oam]) {
+		softwareRenderer->lastOam[oam] = renderer->oam->raw[oam];
+		softwareRenderer->frameDirty = true;
+	}
 }
 
 static void _cleanOAM(struct GBVideoSoftwareRenderer* renderer, int y) {
@@ -612,6 +636,23 @@ static void GBVideoSoftwareRendererDrawRange(struct GBVideoRenderer* renderer, i
 	if (startX >= endX) {
 		return;
 	}
+	softwareRenderer->frameDrawn = true;
+	if (softwareRenderer->outputCurrent && !softwareRenderer->frameDirty && !softwareRenderer->sgbCommandHeader && !softwareRenderer->layerOutput &&
+	    softwareRenderer->lastHighlightAmount == (renderer->highlightAmount + 6) >> 4) {
+		// Nothing has changed since the output was last drawn, so only
+		// carry over the state that later ranges depend on
+		if (GBRegisterLCDCIsBgEnable(softwareRenderer->lcdc) || softwareRenderer->model >= GB_MODEL_CGB) {
+			int wy = softwareRenderer->wy + softwareRenderer->currentWy;
+			int wx = softwareRenderer->wx + softwareRenderer->currentWx - 7;
+			if (GBRegisterLCDCIsWindow(softwareRenderer->lcdc) && wy == y && wx <= endX) {
+				softwareRenderer->hasWindow = true;
+			}
+		}
+		if (startX == 0) {
+			_cleanOAM(softwareRenderer, y);
+		}
+		return;
+	}
 	uint8_t* maps = &softwareRenderer->d.vram[GB_BASE_MAP];
 	if (GBRegisterLCDCIsTileMap(softwareRenderer->lcdc)) {
 		maps += GB_SIZE_MAP;
@@ -619,6 +660,7 @@ static void GBVideoSoftwareRendererDrawRange(struct GBVideoRenderer* renderer, i
 	if (softwareRenderer->d.disableBG) {
 		memset(&softwareRenderer->row[startX], 0, (endX - startX) * sizeof(softwareRenderer->row[0]));
 	}
+	int windowX = endX;
 	if (GBRegisterLCDCIsBgEnable(softwareRenderer->lcdc) || softwareRenderer->model >= GB_MODEL_CGB) {
 		int wy = softwareRenderer->wy + softwareRenderer->currentWy;
 		int wx = softwareRenderer->wx + softwareRenderer->currentWx - 7;
@@ -626,6 +668,7 @@ static void GBVideoSoftwareRendererDrawRange(struct GBVideoRenderer* renderer, i
 			softwareRenderer->hasWindow = true;
 		}
 		if (GBRegisterLCDCIsWindow(softwareRenderer->lcdc) && softwareRenderer->hasWindow && wx <= endX && !softwareRenderer->d.disableWIN) {
+			windowX = wx > startX ? wx : startX;
 			if (wx > 0 && !softwareRenderer->d.disableBG) {
 				GBVideoSoftwareRendererDrawBackground(softwareRenderer, maps, startX, wx, softwareRenderer->scx - softwareRenderer->offsetScx, softwareRenderer->scy + y - softwareRenderer->offsetScy, renderer->highlightBG);
 			}
@@ -645,6 +688,10 @@ static void GBVideoSoftwareRendererDrawRange(struct GBVideoRenderer* renderer, i
 	if (startX == 0) {
 		_cleanOAM(softwareRenderer, y);
 	}
+	uint16_t background[GB_VIDEO_HORIZONTAL_PIXELS];
+	if (softwareRenderer->layerOutput) {
+		memcpy(&background[startX], &softwareRenderer->row[startX], (endX - startX) * sizeof(background[0]));
+	}
 	if (GBRegisterLCDCIsObjEnable(softwareRenderer->lcdc) && !softwareRenderer->d.disableOBJ) {
 		int i;
 		for (i = 0; i < softwareRenderer->objMax; ++i) {
@@ -787,6 +834,10 @@ static void GBVideoSoftwareRendererDrawRange(struct GBVideoRenderer* renderer, i
 		}
 		break;
 	}
+
+	if (softwareRenderer->layerOutput) {
+		_drawLayerOutput(softwareRenderer, background, startX, windowX, endX, y);
+	}
 }
 
 static void GBVideoSoftwareRendererFinishScanline(struct GBVideoRenderer* renderer, int y) {
@@ -855,6 +906,20 @@ static void GBVideoSoftwareRendererFinishFrame(struct GBVideoRenderer* renderer)
 		mappedMemoryFree(softwareRenderer->temporaryBuffer, GB_VIDEO_HORIZONTAL_PIXELS * GB_VIDEO_VERTICAL_PIXELS * 4);
 		softwareRenderer->temporaryBuffer = 0;
 	}
+	if (softwareRenderer->frameDirty || softwareRenderer->sgbCommandHeader) {
+		// The frame may differ from the last one; it can only be skipped once
+		// a full frame has been drawn from the new state
+		renderer->repeatFrame = false;
+		softwareRenderer->outputCurrent = false;
+		memcpy(softwareRenderer->lastOam, renderer->oam->raw, sizeof(softwareRenderer->lastOam));
+	} else if (softwareRenderer->frameDrawn || !GBRegisterLCDCIsEnable(softwareRenderer->lcdc)) {
+		renderer->repeatFrame = softwareRenderer->outputCurrent;
+		softwareRenderer->outputCurrent = true;
+	} else {
+		renderer->repeatFrame = true;
+	}
+	softwareRenderer->frameDirty = false;
+	softwareRenderer->frameDrawn = false;
 	if (!GBRegisterLCDCIsEnable(softwareRenderer->lcdc)) {
 		_clearScreen(softwareRenderer);
 	}
@@ -903,6 +968,7 @@ static void GBVideoSoftwareRendererEnableSGBBorder(struct GBVideoRenderer* rende
 			return;
 		}
 		softwareRenderer->sgbBorders = enable;
+		softwareRenderer->frameDirty = true;
 		if (softwareRenderer->sgbBorders && !renderer->sgbRenderMode) {
 			_regenerateSGBBorder(softwareRenderer);
 		}
@@ -1166,4 +1232,126 @@ static void GBVideoSoftwareRendererPutPixels(struct GBVideoRenderer* renderer, s
 	for (i = 0; i < GB_VIDEO_VERTICAL_PIXELS; ++i) {
 		memmove(&softwareRenderer->outputBuffer[softwareRenderer->outputBufferStride * i], &colorPixels[stride * i], GB_VIDEO_HORIZONTAL_PIXELS * BYTES_PER_PIXEL);
 	}
+	softwareRenderer->frameDirty = true;
+}
+
+static inline int _sgbAttributePalette(struct GBVideoSoftwareRenderer* renderer, int x, int y) {
+	if ((renderer->model & (GB_MODEL_SGB | GB_MODEL_CGB)) != GB_MODEL_SGB || renderer->d.sgbRenderMode != 0) {
+		return 0;
+	}
+	int p = renderer->d.sgbAttributes[(x >> 5) + 5 * (y >> 3)];
+	p >>= 6 - ((x / 4) & 0x6);
+	p &= 3;
+	return p << 2;
+}
+
+static inline color_t _layerColor(struct GBVideoSoftwareRenderer* renderer, uint16_t entry, int x, int y) {
+	return renderer->palette[_sgbAttributePalette(renderer, x, y) | renderer->lookup[entry & 0x3F]];
+}
+
+static void _drawLayerOutput(struct GBVideoSoftwareRenderer* renderer, const uint16_t* background, int startX, int windowX, int endX, int y) {
+	const struct mVideoLayerOutput* output = renderer->layerOutput;
+	size_t offset = output->stride * y;
+	size_t size = (endX - startX) * sizeof(renderer->row[0]);
+	bool objEnabled = GBRegisterLCDCIsObjEnable(renderer->lcdc) && !renderer->d.disableOBJ;
+	bool bgEnabled = (GBRegisterLCDCIsBgEnable(renderer->lcdc) || renderer->model >= GB_MODEL_CGB) && !renderer->d.disableBG;
+	uint16_t composed[GB_VIDEO_HORIZONTAL_PIXELS];
+	int8_t objects[GB_VIDEO_HORIZONTAL_PIXELS];
+	uint32_t* layer;
+	int x;
+	int i;
+	memcpy(&composed[startX], &renderer->row[startX], size);
+
+	// Objects only draw over pixels that no other object has claimed yet,
+	// so replaying them one at a time shows which one each pixel came from
+	memset(&objects[startX], -1, endX - startX);
+	if (objEnabled && output->provenance) {
+		memcpy(&renderer->row[startX], &background[startX], size);
+		for (i = 0; i < renderer->objMax; ++i) {
+			GBVideoSoftwareRendererDrawObj(renderer, &renderer->obj[i], startX, endX, y);
+			for (x = startX; x < endX; ++x) {
+				if (objects[x] < 0 && (renderer->row[x] & PAL_OBJ)) {
+					objects[x] = renderer->obj[i].index;
+				}
+			}
+		}
+	}
+
+	layer = output->layers[GB_LAYER_OBJ];
+	if (layer) {
+		memset(&renderer->row[startX], 0, size);
+		if (objEnabled) {
+			for (i = 0; i < renderer->objMax; ++i) {
+				GBVideoSoftwareRendererDrawObj(renderer, &renderer->obj[i], startX, endX, y);
+			}
+		}
+		for (x = startX; x < endX; ++x) {
+			uint16_t entry = renderer->row[x];
+			layer[offset + x] = entry & PAL_OBJ ? mColorConvert(_layerColor(renderer, entry, x, y), mCOLOR_NATIVE, mCOLOR_ABGR8) : 0;
+		}
+	}
+
+	layer = output->layers[GB_LAYER_BACKGROUND];
+	if (layer) {
+		if (bgEnabled) {
+			uint8_t* maps = &renderer->d.vram[GB_BASE_MAP];
+			if (GBRegisterLCDCIsTileMap(renderer->lcdc)) {
+				maps += GB_SIZE_MAP;
+			}
+			GBVideoSoftwareRendererDrawBackground(renderer, maps, startX, endX, renderer->scx - renderer->offsetScx, renderer->scy + y - renderer->offsetScy, false);
+			for (x = startX; x < endX; ++x) {
+				layer[offset + x] = mColorConvert(_layerColor(renderer, renderer->row[x], x, y), mCOLOR_NATIVE, mCOLOR_ABGR8);
+			}
+		} else {
+			memset(&layer[offset + startX], 0, (endX - startX) * sizeof(*layer));
+		}
+	}
+
+	layer = output->layers[GB_LAYER_WINDOW];
+	if (layer) {
+		memset(&layer[offset + startX], 0, (windowX - startX) * sizeof(*layer));
+		if (windowX < endX) {
+			int wy = renderer->wy + renderer->currentWy;
+			int wx = renderer->wx + renderer->currentWx - 7;
+			uint8_t* maps = &renderer->d.vram[GB_BASE_MAP];
+			if (GBRegisterLCDCIsWindowTileMap(renderer->lcdc)) {
+				maps += GB_SIZE_MAP;
+			}
+			GBVideoSoftwareRendererDrawBackground(renderer, maps, windowX, endX, -wx - renderer->offsetWx, y - wy - renderer->offsetWy, false);
+			for (x = windowX; x < endX; ++x) {
+				layer[offset + x] = mColorConvert(_layerColor(renderer, renderer->row[x], x, y), mCOLOR_NATIVE, mCOLOR_ABGR8);
+			}
+		}
+	}
+
+	if (output->provenance) {
+		size_t sgbOffset = 0;
+		if (renderer->model & GB_MODEL_SGB && renderer->sgbBorders) {
+			sgbOffset = renderer->outputBufferStride * 40 + 48;
+		}
+		const color_t* row = &renderer->outputBuffer[renderer->outputBufferStride * y + sgbOffset];
+		mPixelProvenance* provenance = &output->provenance[offset];
+		for (x = startX; x < endX; ++x) {
+			uint16_t entry = composed[x];
+			mPixelProvenance source = mPixelProvenanceSetPalette(0, entry & 0x3F);
+			source = mPixelProvenanceSetObject(source, mPROVENANCE_OBJECT_NONE);
+			if (objects[x] >= 0) {
+				source = mPixelProvenanceSetLayer(source, GB_LAYER_OBJ);
+				source = mPixelProvenanceSetObject(source, objects[x]);
+			} else if (x >= windowX) {
+				source = mPixelProvenanceSetLayer(source, GB_LAYER_WINDOW);
+			} else if (bgEnabled) {
+				source = mPixelProvenanceSetLayer(source, GB_LAYER_BACKGROUND);
+			} else {
+				source = mPixelProvenanceSetLayer(source, mPROVENANCE_LAYER_BACKDROP);
+			}
+			// Highlighting and the SGB border and masking modes all change the final color
+			if (row[x] != _layerColor(renderer, entry, x, y)) {
+				source = mPixelProvenanceFillBlended(source);
+			}
+			provenance[x] = source;
+		}
+	}
+
+	memcpy(&renderer->row[startX], &composed[startX], size);
 }
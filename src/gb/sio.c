@@ -72,7 +72,7 @@ void _GBSIOProcessEvents(struct mTiming* timing, void* context, uint32_t cyclesL
 	if (!sio->remainingBits) {
 		sio->p->memory.io[GB_REG_SC] = GBRegisterSCClearEnable(sio->p->memory.io[GB_REG_SC]);
 		if (doIRQ) {
-			sio->p->memory.io[GB_REG_IF] |= (1 << GB_IRQ_SIO);
+			GBRaiseIRQ(sio->p, GB_IRQ_SIO);
 			GBUpdateIRQs(sio->p);
 			sio->pendingSB = 0xFF;
 		}
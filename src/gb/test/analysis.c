@@ -0,0 +1,114 @@
+/* Copyright (c) 2013-2024 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "util/test/suite.h"
+
+#include <mgba/core/core.h>
+#include <mgba/gb/core.h>
+#include <mgba/internal/gb/debugger/analysis.h>
+#include <mgba/internal/gb/gb.h>
+#include <mgba/internal/gb/memory.h>
+#include <mgba-util/vfs.h>
+
+static const uint8_t _entry[] = {
+	0xC3, 0x50, 0x01, // JP $0150
+};
+
+static const uint8_t _program[] = {
+	0x3E, 0x02,       // $0150: LD A, $02
+	0xEA, 0x00, 0x20, // $0152: LD [$2000], A
+	0xCD, 0x00, 0x40, // $0155: CALL $4000
+	0x18, 0xFE,       // $0158: JR $0158
+};
+
+static const uint8_t _callee[] = {
+	0xC9, // $4000: RET
+};
+
+M_TEST_SUITE_SETUP(GBAnalysis) {
+	struct VFile* vf = VFileMemChunk(NULL, GB_SIZE_CART_BANK0 * 4);
+	GBSynthesizeROM(vf);
+	vf->seek(vf, 0x100, SEEK_SET);
+	vf->write(vf, _entry, sizeof(_entry));
+	vf->seek(vf, 0x150, SEEK_SET);
+	vf->write(vf, _program, sizeof(_program));
+	vf->seek(vf, GB_SIZE_CART_BANK0 * 2, SEEK_SET);
+	vf->write(vf, _callee, sizeof(_callee));
+
+	struct mCore* core = GBCoreCreate();
+	core->init(core);
+	mCoreInitConfig(core, NULL);
+	core->loadROM(core, vf);
+	core->reset(core);
+
+	struct mCodeAnalysis* analysis = malloc(sizeof(*analysis));
+	mCodeAnalysisInit(analysis, core, &GBCodeAnalysisPlatform);
+	mCodeAnalysisRun(analysis);
+	*state = analysis;
+	return 0;
+}
+
+M_TEST_SUITE_TEARDOWN(GBAnalysis) {
+	if (!*state) {
+		return 0;
+	}
+	struct mCodeAnalysis* analysis = *state;
+	struct mCore* core = analysis->core;
+	mCodeAnalysisDeinit(analysis);
+	free(analysis);
+	mCoreConfigDeinit(&core->config);
+	core->deinit(core);
+	return 0;
+}
+
+M_TEST_DEFINE(blocks) {
+	struct mCodeAnalysis* analysis = *state;
+
+	// Looking up the middle of a multi-byte instruction finds its block
+	const struct mCodeBlock* block = mCodeAnalysisBlockAt(analysis, 0x153, -1);
+	assert_non_null(block);
+	assert_int_equal(block->start.address, 0x150);
+	assert_int_equal(block->end, 0x158);
+	assert_int_equal(block->nInstructions, 3);
+
+	block = mCodeAnalysisBlockAt(analysis, 0x159, -1);
+	assert_non_null(block);
+	assert_int_equal(block->start.address, 0x158);
+	assert_int_equal(block->end, 0x15A);
+	assert_null(mCodeAnalysisBlockAt(analysis, 0x15A, -1));
+
+	const struct mCodeXref* xrefs;
+	assert_int_equal(mCodeAnalysisXrefsTo(analysis, 0x158, -1, &xrefs), 1);
+	assert_int_equal(xrefs[0].from.address, 0x158);
+	assert_int_equal(xrefs[0].type, mCODE_XREF_JUMP);
+}
+
+M_TEST_DEFINE(bankedCall) {
+	struct mCodeAnalysis* analysis = *state;
+
+	// The call lands in the bank selected just before it, not in bank 1
+	const struct mCodeInstruction* instruction = mCodeAnalysisInstructionAt(analysis, 0x155, -1);
+	assert_non_null(instruction);
+	assert_int_equal(instruction->info.length, 3);
+	assert_int_equal(instruction->info.flow, mCODE_FLOW_CALL | mCODE_FLOW_CONTINUES);
+	assert_int_equal(instruction->info.target.address, GB_BASE_CART_BANK1);
+	assert_int_equal(instruction->info.target.segment, 2);
+
+	const struct mCodeFunction* function = mCodeAnalysisFunctionAt(analysis, GB_BASE_CART_BANK1, 2);
+	assert_non_null(function);
+	assert_int_equal(function->entry.segment, 2);
+	assert_int_equal(function->size, 1);
+	assert_null(mCodeAnalysisFunctionAt(analysis, GB_BASE_CART_BANK1, 1));
+
+	const struct mCodeXref* xrefs;
+	assert_int_equal(mCodeAnalysisXrefsTo(analysis, GB_BASE_CART_BANK1, 2, &xrefs), 1);
+	assert_int_equal(xrefs[0].from.address, 0x155);
+	assert_int_equal(xrefs[0].type, mCODE_XREF_CALL);
+	assert_int_equal(mCodeAnalysisXrefsTo(analysis, GB_BASE_CART_BANK1, 1, &xrefs), 0);
+}
+
+M_TEST_SUITE_DEFINE_SETUP_TEARDOWN(GBAnalysis,
+	cmocka_unit_test(blocks),
+	cmocka_unit_test(bankedCall))
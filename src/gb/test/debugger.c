@@ -0,0 +1,212 @@
+/* Copyright (c) 2013-2024 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "util/test/suite.h"
+
+#include <mgba/core/core.h>
+#include <mgba/debugger/debugger.h>
+#include <mgba/gb/core.h>
+#include <mgba/internal/debugger/tracer.h>
+#include <mgba/internal/gb/gb.h>
+#include <mgba-util/vfs.h>
+
+#define WATCHED 0xC000
+#define ROUTINE 0xC100
+
+static const uint8_t _program[] = {
+	0x3E, 0x05,       // $0150: LD A, 5
+	0xEA, 0x00, 0xC0, // $0152: LD [$C000], A
+	0xFA, 0x00, 0xC0, // $0155: LD A, [$C000]
+	0x3C,             // $0158: INC A
+	0x18, 0xF7,       // $0159: JR $0152
+};
+
+static const uint8_t _routine[] = {
+	0x00,       // $C100: NOP
+	0x18, 0xFD, // $C101: JR $C100
+};
+
+struct mTestDebugger {
+	struct mDebugger d;
+	struct mDebuggerModule module;
+	int reads;
+	int writes;
+	uint32_t lastValue;
+};
+
+static void _entered(struct mDebuggerModule* module, enum mDebuggerEntryReason reason, struct mDebuggerEntryInfo* info) {
+	struct mTestDebugger* debugger = (struct mTestDebugger*) module->p;
+	module->isPaused = false;
+	if (reason != DEBUGGER_ENTER_WATCHPOINT) {
+		return;
+	}
+	if (info->type.wp.accessType == WATCHPOINT_READ) {
+		++debugger->reads;
+	} else {
+		++debugger->writes;
+		debugger->lastValue = info->type.wp.newValue;
+	}
+}
+
+static struct mCore* _setup(struct mTestDebugger* debugger, uint16_t entry) {
+	struct VFile* vf = VFileMemChunk(NULL, GB_SIZE_CART_BANK0 * 2);
+	GBSynthesizeROM(vf);
+	const uint8_t jump[] = { 0xC3, entry, entry >> 8 };
+	vf->seek(vf, 0x100, SEEK_SET);
+	vf->write(vf, jump, sizeof(jump));
+	vf->seek(vf, 0x150, SEEK_SET);
+	vf->write(vf, _program, sizeof(_program));
+
+	struct mCore* core = GBCoreCreate();
+	core->init(core);
+	mCoreInitConfig(core, NULL);
+	core->loadROM(core, vf);
+	core->reset(core);
+	size_t i;
+	for (i = 0; i < sizeof(_routine); ++i) {
+		core->rawWrite8(core, ROUTINE + i, -1, _routine[i]);
+	}
+
+	memset(debugger, 0, sizeof(*debugger));
+	mDebuggerInit(&debugger->d);
+	mDebuggerAttach(&debugger->d, core);
+	debugger->module.type = DEBUGGER_CUSTOM;
+	debugger->module.entered = _entered;
+	mDebuggerAttachModule(&debugger->d, &debugger->module);
+	debugger->d.state = DEBUGGER_RUNNING;
+	return core;
+}
+
+static void _teardown(struct mCore* core, struct mTestDebugger* debugger) {
+	core->detachDebugger(core);
+	mDebuggerDeinit(&debugger->d);
+	mCoreConfigDeinit(&core->config);
+	core->deinit(core);
+}
+
+static void _stepUntil(struct mCore* core, const int* hits, int count) {
+	int i;
+	for (i = 0; i < 100 && *hits < count; ++i) {
+		core->step(core);
+	}
+}
+
+static void _watch(struct mTestDebugger* debugger, uint32_t address, uint32_t size, enum mWatchpointType type) {
+	struct mWatchpoint watchpoint = {
+		.segment = -1,
+		.minAddress = address,
+		.maxAddress = address + size,
+		.type = type,
+	};
+	debugger->d.platform->setWatchpoint(debugger->d.platform, &debugger->module, &watchpoint);
+}
+
+M_TEST_DEFINE(watchpointWrite) {
+	struct mTestDebugger debugger;
+	struct mCore* core = _setup(&debugger, 0x150);
+	_watch(&debugger, WATCHED, 1, WATCHPOINT_WRITE);
+
+	// Each hit has to leave the watchpoint armed for the next iteration
+	_stepUntil(core, &debugger.writes, 3);
+	assert_int_equal(debugger.writes, 3);
+	assert_int_equal(debugger.reads, 0);
+	assert_int_equal(debugger.lastValue, 7);
+	_teardown(core, &debugger);
+}
+
+M_TEST_DEFINE(watchpointRead) {
+	struct mTestDebugger debugger;
+	struct mCore* core = _setup(&debugger, 0x150);
+	_watch(&debugger, WATCHED, 1, WATCHPOINT_READ);
+
+	_stepUntil(core, &debugger.reads, 2);
+	assert_int_equal(debugger.reads, 2);
+	assert_int_equal(debugger.writes, 0);
+
+	// Side-effect-free reads, e.g. from a memory viewer, must not hit
+	assert_int_equal(core->rawRead8(core, WATCHED, -1), 6);
+	assert_int_equal(core->rawRead16(core, WATCHED, -1) & 0xFF, 6);
+	assert_int_equal(debugger.reads, 2);
+	_teardown(core, &debugger);
+}
+
+M_TEST_DEFINE(watchpointFetch) {
+	struct mTestDebugger debugger;
+	struct mCore* core = _setup(&debugger, ROUTINE);
+	_watch(&debugger, ROUTINE, sizeof(_routine), WATCHPOINT_READ);
+
+	// Running code out of watched WRAM is not a data read
+	int i;
+	for (i = 0; i < 20; ++i) {
+		core->step(core);
+	}
+	struct GB* gb = core->board;
+	assert_true(gb->cpu->pc >= ROUTINE && gb->cpu->pc <= ROUTINE + sizeof(_routine));
+	assert_int_equal(debugger.reads, 0);
+	_teardown(core, &debugger);
+}
+
+M_TEST_DEFINE(traceRoundTrip) {
+	struct mTestDebugger debugger;
+	struct mCore* core = _setup(&debugger, 0x150);
+	struct mDebuggerTracer tracer;
+	mDebuggerTracerInit(&tracer);
+	mDebuggerAttachModule(&debugger.d, &tracer.d);
+
+	static uint8_t buffer[0x10000];
+	memset(buffer, 0, sizeof(buffer));
+	assert_true(mDebuggerTracerOpen(&tracer, VFileFromMemory(buffer, sizeof(buffer)), mDebuggerTracerFlagsFillMemory(0)));
+	// The instruction hook is only called from the run loop, not from single steps
+	int i;
+	for (i = 0; i < 100 && tracer.instructions < 40; ++i) {
+		core->runLoop(core);
+	}
+	uint64_t instructions = tracer.instructions;
+	assert_true(instructions >= 40);
+	assert_true(mDebuggerTracerClose(&tracer));
+	mDebuggerDetachModule(&debugger.d, &tracer.d);
+	mDebuggerTracerDeinit(&tracer);
+
+	struct mDebuggerTraceReader reader;
+	assert_true(mDebuggerTraceReaderOpen(&reader, VFileFromMemory(buffer, sizeof(buffer))));
+	assert_int_equal(reader.platform, mPLATFORM_GB);
+	struct mDebuggerTraceRecord record;
+	uint64_t cycles;
+	uint32_t pc = 0;
+	uint32_t stored = 5;
+	int read = 0;
+	while (mDebuggerTraceReaderNext(&reader, &record, &cycles)) {
+		switch (record.type) {
+		case mTRACE_RECORD_INSTRUCTION:
+			++read;
+			pc = record.address;
+			if (pc >= 0x150 && pc + 3 <= 0x150 + sizeof(_program)) {
+				const uint8_t* opcode = &_program[pc - 0x150];
+				assert_int_equal(record.value, opcode[0] | (opcode[1] << 8) | (opcode[2] << 16));
+			}
+			break;
+		case mTRACE_RECORD_MEMORY:
+			// Only the LD [$C000], A in the loop writes
+			assert_int_equal(pc, 0x152);
+			assert_int_equal(record.address, WATCHED);
+			assert_int_equal(record.index, 1);
+			assert_int_equal(record.value, stored);
+			++stored;
+			break;
+		default:
+			fail();
+		}
+	}
+	assert_int_equal(read, instructions);
+	assert_true(stored > 6);
+	mDebuggerTraceReaderClose(&reader);
+	_teardown(core, &debugger);
+}
+
+M_TEST_SUITE_DEFINE(GBDebugger,
+	cmocka_unit_test(watchpointWrite),
+	cmocka_unit_test(watchpointRead),
+	cmocka_unit_test(watchpointFetch),
+	cmocka_unit_test(traceRoundTrip))
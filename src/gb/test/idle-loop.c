@@ -0,0 +1,133 @@
+/* Copyright (c) 2013-2024 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "util/test/suite.h"
+
+#include <mgba/core/core.h>
+#include <mgba/gb/core.h>
+#include <mgba/gb/interface.h>
+#include <mgba/internal/gb/gb.h>
+#include <mgba/internal/sm83/sm83.h>
+#include <mgba-util/vfs.h>
+
+static const uint8_t _entry[] = {
+	0xC3, 0x50, 0x01, // JP $0150
+};
+
+// Counts frames in $C000 by waiting for LY to enter and then leave line $90
+static const uint8_t _waitVBlank[] = {
+	0xF0, 0x44,       // $0150: LDH A, [$44]
+	0xFE, 0x90,       // $0152: CP $90
+	0x20, 0xFA,       // $0154: JR NZ, $0150
+	0x21, 0x00, 0xC0, // $0156: LD HL, $C000
+	0x34,             // $0159: INC [HL]
+	0xF0, 0x44,       // $015A: LDH A, [$44]
+	0xFE, 0x90,       // $015C: CP $90
+	0x28, 0xFA,       // $015E: JR Z, $015A
+	0x18, 0xEE,       // $0160: JR $0150
+};
+
+// Stores on every iteration, so skipping iterations would be visible
+static const uint8_t _storeLoop[] = {
+	0x21, 0x00, 0xC0, // $0150: LD HL, $C000
+	0x77,             // $0153: LD [HL], A
+	0xF0, 0x44,       // $0154: LDH A, [$44]
+	0xFE, 0x90,       // $0156: CP $90
+	0x20, 0xF9,       // $0158: JR NZ, $0153
+	0x18, 0xF4,       // $015A: JR $0150
+};
+
+// Polls the joypad, which can change without any event firing
+static const uint8_t _joypadLoop[] = {
+	0xF0, 0x00,       // $0150: LDH A, [$00]
+	0xE6, 0x01,       // $0152: AND $01
+	0x20, 0xFA,       // $0154: JR NZ, $0150
+	0x18, 0xF8,       // $0156: JR $0150
+};
+
+static struct mCore* _createCore(const uint8_t* program, size_t size, const char* idleOptimization) {
+	struct VFile* vf = VFileMemChunk(NULL, GB_SIZE_CART_BANK0 * 2);
+	GBSynthesizeROM(vf);
+	vf->seek(vf, 0x100, SEEK_SET);
+	vf->write(vf, _entry, sizeof(_entry));
+	vf->seek(vf, 0x150, SEEK_SET);
+	vf->write(vf, program, size);
+
+	struct mCore* core = GBCoreCreate();
+	core->init(core);
+	mCoreInitConfig(core, NULL);
+	mCoreConfigSetValue(&core->config, "idleOptimization", idleOptimization);
+	core->loadROM(core, vf);
+	mCoreLoadConfig(core);
+	core->reset(core);
+	return core;
+}
+
+static void _destroyCore(struct mCore* core) {
+	mCoreConfigDeinit(&core->config);
+	core->deinit(core);
+}
+
+static void _runFrames(struct mCore* core, int frames) {
+	int i;
+	for (i = 0; i < frames; ++i) {
+		core->runFrame(core);
+	}
+}
+
+M_TEST_DEFINE(detectPolling) {
+	struct mCore* core = _createCore(_waitVBlank, sizeof(_waitVBlank), "detect");
+	struct GB* gb = core->board;
+	_runFrames(core, 2);
+	assert_int_equal(gb->idleLoop, 0x0150);
+	assert_int_equal(gb->idleOptimization, GB_IDLE_LOOP_REMOVE);
+	_destroyCore(core);
+}
+
+M_TEST_DEFINE(removalMatchesInterpreter) {
+	struct mCore* interpreted = _createCore(_waitVBlank, sizeof(_waitVBlank), "ignore");
+	struct mCore* removed = _createCore(_waitVBlank, sizeof(_waitVBlank), "detect");
+	struct GB* interpretedGB = interpreted->board;
+	struct GB* removedGB = removed->board;
+
+	// Skipped iterations must leave the machine exactly where interpreting them would
+	int i;
+	for (i = 0; i < 10; ++i) {
+		interpreted->runFrame(interpreted);
+		removed->runFrame(removed);
+		assert_int_equal(interpreted->rawRead8(interpreted, 0xC000, -1), removed->rawRead8(removed, 0xC000, -1));
+		assert_memory_equal(&interpretedGB->cpu->regs, &removedGB->cpu->regs, sizeof(interpretedGB->cpu->regs));
+		assert_int_equal(interpretedGB->timing.masterCycles + interpretedGB->cpu->cycles, removedGB->timing.masterCycles + removedGB->cpu->cycles);
+	}
+	assert_int_equal(interpretedGB->idleLoop, GB_IDLE_LOOP_NONE);
+	assert_int_equal(removedGB->idleLoop, 0x0150);
+	assert_true(interpreted->rawRead8(interpreted, 0xC000, -1) >= 9);
+
+	_destroyCore(interpreted);
+	_destroyCore(removed);
+}
+
+M_TEST_DEFINE(rejectStores) {
+	struct mCore* core = _createCore(_storeLoop, sizeof(_storeLoop), "detect");
+	struct GB* gb = core->board;
+	_runFrames(core, 2);
+	assert_int_equal(gb->idleLoop, GB_IDLE_LOOP_NONE);
+	assert_int_equal(gb->idleOptimization, GB_IDLE_LOOP_DETECT);
+	_destroyCore(core);
+}
+
+M_TEST_DEFINE(rejectJoypad) {
+	struct mCore* core = _createCore(_joypadLoop, sizeof(_joypadLoop), "detect");
+	struct GB* gb = core->board;
+	_runFrames(core, 2);
+	assert_int_equal(gb->idleLoop, GB_IDLE_LOOP_NONE);
+	_destroyCore(core);
+}
+
+M_TEST_SUITE_DEFINE(GBIdleLoop,
+	cmocka_unit_test(detectPolling),
+	cmocka_unit_test(removalMatchesInterpreter),
+	cmocka_unit_test(rejectStores),
+	cmocka_unit_test(rejectJoypad))
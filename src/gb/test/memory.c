@@ -74,7 +74,26 @@ M_TEST_DEFINE(patchROMBank2) {
 	assert_int_equal(GBView8(gb->cpu, GB_SIZE_CART_BANK0, 2), newExpected);
 }
 
+M_TEST_DEFINE(dmaBusConflict) {
+	struct mCore* core = *state;
+	struct GB* gb = core->board;
+
+	core->reset(core);
+	uint8_t expected = GBView8(gb->cpu, 0x0100, 0);
+	assert_int_not_equal(expected, 0xFF);
+	gb->memory.dmaSource = GB_BASE_CART_BANK0;
+	gb->memory.dmaRemaining = 0xA0;
+	assert_int_equal((uint8_t) GBLoad8(gb->cpu, 0x0100), 0xFF);
+
+	gb->accuracy = mCORE_ACCURACY_RELAXED;
+	assert_int_equal((uint8_t) GBLoad8(gb->cpu, 0x0100), expected);
+
+	gb->memory.dmaRemaining = 0;
+	gb->accuracy = mCORE_ACCURACY_ACCURATE;
+}
+
 M_TEST_SUITE_DEFINE_SETUP_TEARDOWN(GBMemory,
 	cmocka_unit_test(patchROMBank0),
 	cmocka_unit_test(patchROMBank1),
-	cmocka_unit_test(patchROMBank2))
+	cmocka_unit_test(patchROMBank2),
+	cmocka_unit_test(dmaBusConflict))
@@ -0,0 +1,123 @@
+/* Copyright (c) 2013-2024 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "util/test/suite.h"
+
+#include <mgba/core/core.h>
+#include <mgba/gb/core.h>
+#include <mgba/internal/gb/gb.h>
+#include <mgba/internal/gb/io.h>
+#include <mgba-util/vfs.h>
+
+#define OBJ_X 40
+#define OBJ_Y 72
+
+struct mTestCore {
+	struct mCore* core;
+	color_t* video;
+	unsigned width;
+	unsigned height;
+};
+
+// The top 64 lines of the background are solid, and a single object sits below them
+static void _createCore(struct mTestCore* test) {
+	struct VFile* vf = VFileMemChunk(NULL, GB_SIZE_CART_BANK0 * 2);
+	GBSynthesizeROM(vf);
+	// JR $0100
+	static const uint8_t loop[] = { 0x18, 0xFE };
+	vf->seek(vf, 0x100, SEEK_SET);
+	vf->write(vf, loop, sizeof(loop));
+
+	struct mCore* core = GBCoreCreate();
+	core->init(core);
+	mCoreInitConfig(core, NULL);
+	core->baseVideoSize(core, &test->width, &test->height);
+	test->video = calloc(test->width * test->height, BYTES_PER_PIXEL);
+	core->setVideoBuffer(core, test->video, test->width);
+	core->loadROM(core, vf);
+	core->reset(core);
+	test->core = core;
+
+	unsigned i;
+	for (i = 0; i < 0x30; ++i) {
+		// Tile 0 is blank, tile 1 is color 3 and tile 2 is color 1
+		uint8_t value = 0;
+		if (i >= 0x10) {
+			value = (i >= 0x20 && (i & 1)) ? 0 : 0xFF;
+		}
+		core->rawWrite8(core, GB_BASE_VRAM + i, -1, value);
+	}
+	for (i = 0; i < GB_SIZE_MAP; ++i) {
+		core->rawWrite8(core, GB_BASE_VRAM + GB_BASE_MAP + i, -1, i < 32 * 8);
+	}
+	for (i = 0; i < GB_SIZE_OAM; ++i) {
+		core->rawWrite8(core, GB_BASE_OAM + i, -1, 0);
+	}
+	core->rawWrite8(core, GB_BASE_OAM, -1, OBJ_Y + 16);
+	core->rawWrite8(core, GB_BASE_OAM + 1, -1, OBJ_X + 8);
+	core->rawWrite8(core, GB_BASE_OAM + 2, -1, 2);
+
+	struct GB* gb = core->board;
+	GBIOWrite(gb, GB_REG_BGP, 0xE4);
+	GBIOWrite(gb, GB_REG_OBP0, 0xE4);
+	GBIOWrite(gb, GB_REG_LCDC, 0x93);
+}
+
+static void _destroyCore(struct mTestCore* test) {
+	mCoreConfigDeinit(&test->core->config);
+	test->core->deinit(test->core);
+	free(test->video);
+}
+
+M_TEST_DEFINE(layerOutput) {
+	struct mTestCore plain;
+	struct mTestCore layered;
+	_createCore(&plain);
+	_createCore(&layered);
+
+	size_t pixels = layered.width * layered.height;
+	uint32_t* background = calloc(pixels, sizeof(uint32_t));
+	uint32_t* obj = calloc(pixels, sizeof(uint32_t));
+	mPixelProvenance* provenance = calloc(pixels, sizeof(mPixelProvenance));
+	struct mVideoLayerOutput output = {
+		.layers = {
+			[GB_LAYER_BACKGROUND] = background,
+			[GB_LAYER_OBJ] = obj,
+		},
+		.provenance = provenance,
+		.stride = layered.width,
+	};
+	layered.core->setVideoLayerOutput(layered.core, &output);
+
+	int i;
+	for (i = 0; i < 2; ++i) {
+		plain.core->runFrame(plain.core);
+		layered.core->runFrame(layered.core);
+	}
+
+	// Writing out the layers mustn't change the frame itself
+	assert_memory_equal(plain.video, layered.video, pixels * BYTES_PER_PIXEL);
+
+	size_t bgPixel = 10 * layered.width + 10;
+	size_t objPixel = (OBJ_Y + 2) * layered.width + OBJ_X + 2;
+	assert_int_equal(mPixelProvenanceGetLayer(provenance[bgPixel]), GB_LAYER_BACKGROUND);
+	assert_int_equal(mPixelProvenanceGetObject(provenance[bgPixel]), mPROVENANCE_OBJECT_NONE);
+	assert_int_equal(mPixelProvenanceGetLayer(provenance[objPixel]), GB_LAYER_OBJ);
+	assert_int_equal(mPixelProvenanceGetObject(provenance[objPixel]), 0);
+	assert_false(mPixelProvenanceIsBlended(provenance[objPixel]));
+	assert_int_not_equal(background[bgPixel], 0);
+	assert_int_equal(obj[bgPixel], 0);
+	assert_int_not_equal(obj[objPixel], 0);
+
+	layered.core->setVideoLayerOutput(layered.core, NULL);
+	free(background);
+	free(obj);
+	free(provenance);
+	_destroyCore(&plain);
+	_destroyCore(&layered);
+}
+
+M_TEST_SUITE_DEFINE(GBRenderer,
+	cmocka_unit_test(layerOutput))
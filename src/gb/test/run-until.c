@@ -0,0 +1,133 @@
+/* Copyright (c) 2013-2024 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "util/test/suite.h"
+
+#include <mgba/core/core.h>
+#include <mgba/core/run-until.h>
+#include <mgba/gb/core.h>
+#include <mgba/internal/gb/gb.h>
+#include <mgba/internal/gb/io.h>
+#include <mgba-util/vfs.h>
+
+// The longest instruction takes 6 M-cycles
+#define MAX_OVERRUN 24
+
+static const uint8_t _entry[] = {
+	0xC3, 0x50, 0x01, // JP $0150
+};
+
+static const uint8_t _program[] = {
+	0xAF,             // $0150: XOR A
+	0x3C,             // $0151: INC A
+	0xEA, 0x00, 0xC0, // $0152: LD [$C000], A
+	0x18, 0xFA,       // $0155: JR $0151
+};
+
+M_TEST_SUITE_SETUP(GBRunUntil) {
+	struct VFile* vf = VFileMemChunk(NULL, GB_SIZE_CART_BANK0 * 2);
+	GBSynthesizeROM(vf);
+	vf->seek(vf, 0x100, SEEK_SET);
+	vf->write(vf, _entry, sizeof(_entry));
+	vf->seek(vf, 0x150, SEEK_SET);
+	vf->write(vf, _program, sizeof(_program));
+
+	struct mCore* core = GBCoreCreate();
+	core->init(core);
+	mCoreInitConfig(core, NULL);
+	core->loadROM(core, vf);
+	*state = core;
+	return 0;
+}
+
+M_TEST_SUITE_TEARDOWN(GBRunUntil) {
+	if (!*state) {
+		return 0;
+	}
+	struct mCore* core = *state;
+	mCoreConfigDeinit(&core->config);
+	core->deinit(core);
+	return 0;
+}
+
+M_TEST_DEFINE(runCycles) {
+	struct mCore* core = *state;
+	core->reset(core);
+	assert_int_equal(core->runCycles(core, 0), 0);
+
+	int i;
+	for (i = 1; i < 2000; i += 37) {
+		uint64_t ran = core->runCycles(core, i);
+		assert_true(ran >= (uint64_t) i);
+		assert_true(ran < (uint64_t) i + MAX_OVERRUN);
+	}
+	uint64_t ran = core->runCycles(core, 0x180000000ULL);
+	assert_true(ran >= 0x180000000ULL);
+	assert_true(ran < 0x180000000ULL + MAX_OVERRUN);
+}
+
+M_TEST_DEFINE(runUntilPC) {
+	struct mCore* core = *state;
+	core->reset(core);
+	struct mRunPredicate predicates[] = {
+		{ .type = mRUN_UNTIL_PC, .address = 0x4000 },
+		{ .type = mRUN_UNTIL_PC, .address = 0x0155 },
+	};
+	uint64_t ran;
+	int i;
+	for (i = 0; i < 4; ++i) {
+		assert_int_equal(core->runUntil(core, predicates, 2, 0, &ran), 1);
+		assert_true(ran > 0);
+		int32_t pc;
+		assert_true(core->readRegister(core, "pc", &pc));
+		assert_int_equal(pc, 0x0155);
+	}
+
+	// Unreachable targets run out the limit instead
+	assert_int_equal(core->runUntil(core, predicates, 1, 1000, &ran), -1);
+	assert_true(ran >= 1000);
+	assert_true(ran < 1000 + MAX_OVERRUN);
+}
+
+M_TEST_DEFINE(runUntilMemoryChange) {
+	struct mCore* core = *state;
+	core->reset(core);
+	struct mRunPredicate predicate = { .type = mRUN_UNTIL_MEMORY_CHANGE, .address = 0xC000 };
+	uint64_t ran;
+	int i;
+	for (i = 0; i < 3; ++i) {
+		uint8_t value = core->rawRead8(core, 0xC000, -1);
+		assert_int_equal(core->runUntil(core, &predicate, 1, 0, &ran), 0);
+		assert_int_not_equal(core->rawRead8(core, 0xC000, -1), value);
+		assert_true(ran < 256 * 40);
+	}
+
+	// Neighbouring bytes aren't touched
+	predicate.address = 0xC001;
+	assert_int_equal(core->runUntil(core, &predicate, 1, 10000, &ran), -1);
+}
+
+M_TEST_DEFINE(runUntilIRQ) {
+	struct mCore* core = *state;
+	core->reset(core);
+	struct mRunPredicate predicate = { .type = mRUN_UNTIL_IRQ, .irqMask = 1 << GB_IRQ_VBLANK };
+	uint64_t ran;
+	assert_int_equal(core->runUntil(core, &predicate, 1, 0, &ran), 0);
+	assert_true(core->rawRead8(core, GB_BASE_IO | GB_REG_IF, -1) & (1 << GB_IRQ_VBLANK));
+
+	core->rawWrite8(core, GB_BASE_IO | GB_REG_IF, -1, 0);
+	assert_int_equal(core->runUntil(core, &predicate, 1, 0, &ran), 0);
+	assert_true(ran + MAX_OVERRUN > GB_VIDEO_TOTAL_LENGTH);
+	assert_true(ran < GB_VIDEO_TOTAL_LENGTH + MAX_OVERRUN);
+
+	predicate.irqMask = 1 << GB_IRQ_SIO;
+	assert_int_equal(core->runUntil(core, &predicate, 1, GB_VIDEO_TOTAL_LENGTH * 2, &ran), -1);
+}
+
+M_TEST_SUITE_DEFINE_SETUP_TEARDOWN(GBRunUntil,
+	cmocka_unit_test(runCycles),
+	cmocka_unit_test(runUntilPC),
+	cmocka_unit_test(runUntilMemoryChange),
+	cmocka_unit_test(runUntilIRQ))
@@ -15,7 +15,7 @@ void _GBTimerIRQ(struct mTiming* timing, void* context, uint32_t cyclesLate) {
 	UNUSED(cyclesLate);
 	struct GBTimer* timer = context;
 	timer->p->memory.io[GB_REG_TIMA] = timer->p->memory.io[GB_REG_TMA];
-	timer->p->memory.io[GB_REG_IF] |= (1 << GB_IRQ_TIMER);
+	GBRaiseIRQ(timer->p, GB_IRQ_TIMER);
 	GBUpdateIRQs(timer->p);
 }
 
@@ -320,7 +320,7 @@ void GBVideoReset(struct GBVideo* video) {
 	video->frameskipCounter = 0;
 
 	GBVideoSwitchBank(video, 0);
-	memset(video->vram, 0, GB_SIZE_VRAM);
+	mappedMemoryClear(video->vram, GB_SIZE_VRAM);
 	video->renderer->vram = video->vram;
 	memset(&video->oam, 0, sizeof(video->oam));
 	video->renderer->oam = &video->oam;
@@ -484,6 +484,7 @@ void GBVideoAssociateRenderer(struct GBVideo* video, struct GBVideoRenderer* ren
 		renderer->sgbAttributes = NULL;
 	}
 	video->renderer = renderer;
+	renderer->repeatFrame = false;
 	renderer->vram = video->vram;
 	video->renderer->init(video->renderer, video->p->model, video->sgbBorders);
 }
@@ -537,7 +538,7 @@ void GBVideoSkipBIOS(struct GBVideo* video) {
 	}
 	video->stat = GBRegisterSTATSetMode(video->stat, video->mode);
 
-	video->p->memory.io[GB_REG_IF] |= (1 << GB_IRQ_VBLANK);
+	GBRaiseIRQ(video->p, GB_IRQ_VBLANK);
 	GBUpdateIRQs(video->p);
 	video->p->memory.io[GB_REG_STAT] = video->stat;
 	mTimingDeschedule(&video->p->timing, &video->modeEvent);
@@ -567,20 +568,20 @@ void _endMode0(struct mTiming* timing, void* context, uint32_t cyclesLate) {
 		mTimingSchedule(&video->p->timing, &video->frameEvent, -cyclesLate);
 
 		if (!_statIRQAsserted(oldStat) && GBRegisterSTATIsOAMIRQ(video->stat)) {
-			video->p->memory.io[GB_REG_IF] |= (1 << GB_IRQ_LCDSTAT);
+			GBRaiseIRQ(video->p, GB_IRQ_LCDSTAT);
 		}
-		video->p->memory.io[GB_REG_IF] |= (1 << GB_IRQ_VBLANK);
+		GBRaiseIRQ(video->p, GB_IRQ_VBLANK);
 	}
 	video->stat = GBRegisterSTATSetMode(video->stat, video->mode);
 	if (!_statIRQAsserted(oldStat) && _statIRQAsserted(video->stat)) {
-		video->p->memory.io[GB_REG_IF] |= (1 << GB_IRQ_LCDSTAT);
+		GBRaiseIRQ(video->p, GB_IRQ_LCDSTAT);
 	}
 
 	// LYC stat is delayed 1 T-cycle
 	oldStat = video->stat;
 	video->stat = GBRegisterSTATSetLYC(video->stat, lyc == video->ly);
 	if (!_statIRQAsserted(oldStat) && _statIRQAsserted(video->stat)) {
-		video->p->memory.io[GB_REG_IF] |= (1 << GB_IRQ_LCDSTAT);
+		GBRaiseIRQ(video->p, GB_IRQ_LCDSTAT);
 	}
 
 	GBUpdateIRQs(video->p);
@@ -618,7 +619,7 @@ void _endMode1(struct mTiming* timing, void* context, uint32_t cyclesLate) {
 	video->stat = GBRegisterSTATSetMode(video->stat, video->mode);
 	video->stat = GBRegisterSTATSetLYC(video->stat, lyc == video->p->memory.io[GB_REG_LY]);
 	if (!_statIRQAsserted(oldStat) && _statIRQAsserted(video->stat)) {
-		video->p->memory.io[GB_REG_IF] |= (1 << GB_IRQ_LCDSTAT);
+		GBRaiseIRQ(video->p, GB_IRQ_LCDSTAT);
 		GBUpdateIRQs(video->p);
 	}
 	video->p->memory.io[GB_REG_STAT] = video->stat;
@@ -636,7 +637,7 @@ void _endMode2(struct mTiming* timing, void* context, uint32_t cyclesLate) {
 	GBRegisterSTAT oldStat = video->stat;
 	video->stat = GBRegisterSTATSetMode(video->stat, video->mode);
 	if (!_statIRQAsserted(oldStat) && _statIRQAsserted(video->stat)) {
-		video->p->memory.io[GB_REG_IF] |= (1 << GB_IRQ_LCDSTAT);
+		GBRaiseIRQ(video->p, GB_IRQ_LCDSTAT);
 		GBUpdateIRQs(video->p);
 	}
 	video->p->memory.io[GB_REG_STAT] = video->stat;
@@ -657,7 +658,7 @@ void _endMode3(struct mTiming* timing, void* context, uint32_t cyclesLate) {
 	GBRegisterSTAT oldStat = video->stat;
 	video->stat = GBRegisterSTATSetMode(video->stat, video->mode);
 	if (!_statIRQAsserted(oldStat) && _statIRQAsserted(video->stat)) {
-		video->p->memory.io[GB_REG_IF] |= (1 << GB_IRQ_LCDSTAT);
+		GBRaiseIRQ(video->p, GB_IRQ_LCDSTAT);
 		GBUpdateIRQs(video->p);
 	}
 	video->p->memory.io[GB_REG_STAT] = video->stat;
@@ -680,7 +681,7 @@ void _updateFrameCount(struct mTiming* timing, void* context, uint32_t cyclesLat
 	--video->frameskipCounter;
 	if (video->frameskipCounter < 0) {
 		video->renderer->finishFrame(video->renderer);
-		video->frameskipCounter = video->frameskip;
+		video->frameskipCounter = mCoreSyncFrameskip(video->p->sync, video->frameskip);
 	}
 	GBFrameEnded(video->p);
 	mCoreSyncPostFrame(video->p->sync);
@@ -740,7 +741,7 @@ void GBVideoWriteLCDC(struct GBVideo* video, GBRegisterLCDC value) {
 		video->stat = GBRegisterSTATSetMode(video->stat, 0);
 		video->stat = GBRegisterSTATSetLYC(video->stat, video->ly == video->p->memory.io[GB_REG_LYC]);
 		if (!_statIRQAsserted(oldStat) && _statIRQAsserted(video->stat)) {
-			video->p->memory.io[GB_REG_IF] |= (1 << GB_IRQ_LCDSTAT);
+			GBRaiseIRQ(video->p, GB_IRQ_LCDSTAT);
 			GBUpdateIRQs(video->p);
 		}
 		video->p->memory.io[GB_REG_STAT] = video->stat;
@@ -775,7 +776,7 @@ void GBVideoWriteSTAT(struct GBVideo* video, GBRegisterSTAT value) {
 	// one cycle, which we don't handle yet. TODO: Handle it.
 	if (!_statIRQAsserted(oldStat) && (video->mode < 2 || GBRegisterSTATIsLYC(video->stat))) {
 		// TODO: variable for the IRQ line value?
-		video->p->memory.io[GB_REG_IF] |= (1 << GB_IRQ_LCDSTAT);
+		GBRaiseIRQ(video->p, GB_IRQ_LCDSTAT);
 		GBUpdateIRQs(video->p);
 	}
 }
@@ -785,7 +786,7 @@ void GBVideoWriteLYC(struct GBVideo* video, uint8_t value) {
 	if (GBRegisterLCDCIsEnable(video->p->memory.io[GB_REG_LCDC])) {
 		video->stat = GBRegisterSTATSetLYC(video->stat, value == video->ly);
 		if (!_statIRQAsserted(oldStat) && _statIRQAsserted(video->stat)) {
-			video->p->memory.io[GB_REG_IF] |= (1 << GB_IRQ_LCDSTAT);
+			GBRaiseIRQ(video->p, GB_IRQ_LCDSTAT);
 			GBUpdateIRQs(video->p);
 		}
 	}
@@ -142,7 +142,7 @@ void GBAAudioScheduleFifoDma(struct GBAAudio* audio, int number, struct GBADMA*
 			if (source >= GBA_BASE_IO + offsets[i]) {
 				continue;
 			}
-			uint32_t value = GBALoad32(audio->p->cpu, source - offsets[i], NULL);
+			uint32_t value = GBAView32(audio->p->cpu, source - offsets[i]);
 			if (value - MP2K_MAGIC <= MP2K_LOCK_MAX) {
 				audio->mixer->engage(audio->mixer, source - offsets[i]);
 				break;
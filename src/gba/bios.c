@@ -18,10 +18,12 @@ const uint32_t GBA_DS_BIOS_CHECKSUM = 0xBAAE1880;
 mLOG_DEFINE_CATEGORY(GBA_BIOS, "GBA BIOS", "gba.bios");
 
 static void _unLz77(struct GBA* gba, int width);
-static void _unHuffman(struct GBA* gba);
-static void _unRl(struct GBA* gba, int width);
-static void _unFilter(struct GBA* gba, int inwidth, int outwidth);
-static void _unBitPack(struct GBA* gba);
+static void _unHuffman(struct GBA* gba, int* cycles);
+static void _unRl(struct GBA* gba, int width, int* cycles);
+static void _unFilter(struct GBA* gba, int inwidth, int outwidth, int* cycles);
+static void _unBitPack(struct GBA* gba, int* cycles);
+
+static bool _hleSwi(struct GBA* gba, int immediate);
 
 static int _mulWait(int32_t r) {
 	if ((r & 0xFFFFFF00) == 0xFFFFFF00 || !(r & 0xFFFFFF00)) {
@@ -438,7 +440,9 @@ void GBASwi16(struct ARMCore* cpu, int immediate) {
 	}
 
 	if (gba->memory.fullBios) {
-		ARMRaiseSWI(cpu);
+		if (!gba->hleBiosCalls || !_hleSwi(gba, immediate)) {
+			ARMRaiseSWI(cpu);
+		}
 		return;
 	}
 
@@ -521,7 +525,7 @@ void GBASwi16(struct ARMCore* cpu, int immediate) {
 		case GBA_REGION_EWRAM:
 		case GBA_REGION_IWRAM:
 		case GBA_REGION_VRAM:
-			_unBitPack(gba);
+			_unBitPack(gba, NULL);
 			break;
 		}
 		break;
@@ -555,7 +559,7 @@ void GBASwi16(struct ARMCore* cpu, int immediate) {
 		case GBA_REGION_EWRAM:
 		case GBA_REGION_IWRAM:
 		case GBA_REGION_VRAM:
-			_unHuffman(gba);
+			_unHuffman(gba, NULL);
 			break;
 		}
 		break;
@@ -572,7 +576,7 @@ void GBASwi16(struct ARMCore* cpu, int immediate) {
 		case GBA_REGION_EWRAM:
 		case GBA_REGION_IWRAM:
 		case GBA_REGION_VRAM:
-			_unRl(gba, immediate == GBA_SWI_RL_UNCOMP_WRAM ? 1 : 2);
+			_unRl(gba, immediate == GBA_SWI_RL_UNCOMP_WRAM ? 1 : 2, NULL);
 			break;
 		}
 		break;
@@ -590,7 +594,7 @@ void GBASwi16(struct ARMCore* cpu, int immediate) {
 		case GBA_REGION_EWRAM:
 		case GBA_REGION_IWRAM:
 		case GBA_REGION_VRAM:
-			_unFilter(gba, immediate == GBA_SWI_DIFF_16BIT_UNFILTER ? 2 : 1, immediate == GBA_SWI_DIFF_8BIT_UNFILTER_WRAM ? 1 : 2);
+			_unFilter(gba, immediate == GBA_SWI_DIFF_16BIT_UNFILTER ? 2 : 1, immediate == GBA_SWI_DIFF_8BIT_UNFILTER_WRAM ? 1 : 2, NULL);
 			break;
 		}
 		break;
@@ -630,6 +634,243 @@ void GBASwi16(struct ARMCore* cpu, int immediate) {
 	gba->memory.biosPrefetch = 0xE3A02004;
 }
 
+static void _CpuSet(struct GBA* gba) {
+	struct ARMCore* cpu = gba->cpu;
+	uint32_t source = cpu->gprs[0];
+	uint32_t dest = cpu->gprs[1];
+	uint32_t mode = cpu->gprs[2];
+	int count = mode & 0x001FFFFF;
+	int cycles = 20;
+	int i;
+	if (mode & 0x04000000) {
+		if (mode & 0x01000000) {
+			uint32_t word = cpu->memory.load32(cpu, source, &cycles);
+			source += 4;
+			for (i = 0; i < count; ++i, dest += 4) {
+				cpu->memory.store32(cpu, dest, word, &cycles);
+				cycles += 4;
+			}
+		} else {
+			for (i = 0; i < count; ++i, source += 4, dest += 4) {
+				uint32_t word = cpu->memory.load32(cpu, source, &cycles);
+				cpu->memory.store32(cpu, dest, word, &cycles);
+				cycles += 4;
+			}
+		}
+		cpu->gprs[0] = source;
+		cpu->gprs[1] = dest;
+	} else {
+		source &= ~1;
+		dest &= ~1;
+		if (mode & 0x01000000) {
+			uint16_t halfword = cpu->memory.load16(cpu, source, &cycles);
+			for (i = 0; i < count; ++i, dest += 2) {
+				cpu->memory.store16(cpu, dest, halfword, &cycles);
+				cycles += 4;
+			}
+		} else {
+			for (i = 0; i < count; ++i, source += 2, dest += 2) {
+				uint16_t halfword = cpu->memory.load16(cpu, source, &cycles);
+				cpu->memory.store16(cpu, dest, halfword, &cycles);
+				cycles += 4;
+			}
+		}
+	}
+	cpu->gprs[3] = 0x170;
+	gba->biosStall = cycles;
+}
+
+static void _CpuFastSet(struct GBA* gba) {
+	struct ARMCore* cpu = gba->cpu;
+	uint32_t source = cpu->gprs[0];
+	uint32_t dest = cpu->gprs[1];
+	uint32_t mode = cpu->gprs[2];
+	uint32_t end = dest + ((mode & 0x001FFFFF) << 2);
+	uint32_t words[8];
+	int cycles = 30;
+	int i;
+
+	// Copies that stay within VRAM are stored directly and reported to the
+	// renderer as one range, instead of one notification per word. Stalls and
+	// watchpoints need each store to go through the bus.
+	uint32_t vramOffset = dest & 0x0001FFFF;
+	uint32_t size = (((mode & 0x001FFFFF) + 7) & ~7) << 2;
+	bool directVRAM = dest >> BASE_OFFSET == GBA_REGION_VRAM && vramOffset + size <= GBA_SIZE_VRAM &&
+	    !gba->video.shouldStall && !cpu->watchpointPages;
+	uint32_t dirtyStart = GBA_SIZE_VRAM;
+	uint32_t dirtyEnd = 0;
+	if (mode & 0x01000000) {
+		uint32_t word = cpu->memory.load32(cpu, source, &cycles);
+		for (i = 0; i < 8; ++i) {
+			words[i] = word;
+		}
+	}
+	while (dest < end) {
+		if (!(mode & 0x01000000)) {
+			for (i = 0; i < 8; ++i, source += 4) {
+				words[i] = cpu->memory.load32(cpu, source, &cycles);
+			}
+		}
+		if (directVRAM) {
+			for (i = 0; i < 8; ++i, dest += 4, vramOffset += 4) {
+				uint32_t oldValue;
+				LOAD_32(oldValue, vramOffset, gba->video.vram);
+				if (oldValue != words[i]) {
+					STORE_32(words[i], vramOffset, gba->video.vram);
+					if (vramOffset < dirtyStart) {
+						dirtyStart = vramOffset;
+					}
+					dirtyEnd = vramOffset + 4;
+				}
+				// The same as a store32 to VRAM from the BIOS
+				cycles += 2;
+			}
+		} else {
+			for (i = 0; i < 8; ++i, dest += 4) {
+				cpu->memory.store32(cpu, dest, words[i], &cycles);
+			}
+		}
+		cycles += 4;
+	}
+	if (dirtyEnd > dirtyStart) {
+		gba->video.renderer->writeVRAMRange(gba->video.renderer, dirtyStart, dirtyEnd - dirtyStart);
+	}
+	cpu->gprs[0] = source;
+	cpu->gprs[1] = dest;
+	cpu->gprs[2] = end;
+	cpu->gprs[3] = words[0];
+	gba->biosStall = cycles;
+}
+
+static bool _isDecompressionTarget(uint32_t source, uint32_t dest) {
+	if (!(source & 0x0E000000)) {
+		return false;
+	}
+	switch (dest >> BASE_OFFSET) {
+	case GBA_REGION_EWRAM:
+	case GBA_REGION_IWRAM:
+	case GBA_REGION_VRAM:
+		return true;
+	default:
+		return false;
+	}
+}
+
+static bool _hleSwi(struct GBA* gba, int immediate) {
+	// Only handle well-formed calls to pure compute and copy functions natively.
+	// Anything else, including edge cases, is left to the real BIOS.
+	struct ARMCore* cpu = gba->cpu;
+	uint32_t source = cpu->gprs[0];
+	uint32_t dest = cpu->gprs[1];
+	switch (immediate) {
+	case GBA_SWI_DIV:
+		if (!cpu->gprs[1]) {
+			return false;
+		}
+		break;
+	case GBA_SWI_DIV_ARM:
+		if (!cpu->gprs[0]) {
+			return false;
+		}
+		break;
+	case GBA_SWI_SQRT:
+	case GBA_SWI_ARCTAN:
+	case GBA_SWI_ARCTAN2:
+		break;
+	case GBA_SWI_CPU_SET:
+	case GBA_SWI_CPU_FAST_SET:
+		if (source >> BASE_OFFSET < GBA_REGION_EWRAM) {
+			return false;
+		}
+		if ((source | dest) & ((immediate == GBA_SWI_CPU_FAST_SET || (cpu->gprs[2] & (1 << 26))) ? 3 : 1)) {
+			return false;
+		}
+		break;
+	case GBA_SWI_BIT_UNPACK:
+		if (source < GBA_BASE_EWRAM || !_isDecompressionTarget(source, dest)) {
+			return false;
+		}
+		break;
+	case GBA_SWI_LZ77_UNCOMP_WRAM:
+	case GBA_SWI_LZ77_UNCOMP_VRAM:
+	case GBA_SWI_HUFFMAN_UNCOMP:
+	case GBA_SWI_RL_UNCOMP_WRAM:
+	case GBA_SWI_RL_UNCOMP_VRAM:
+	case GBA_SWI_DIFF_8BIT_UNFILTER_WRAM:
+	case GBA_SWI_DIFF_8BIT_UNFILTER_VRAM:
+	case GBA_SWI_DIFF_16BIT_UNFILTER:
+		if (!_isDecompressionTarget(source, dest)) {
+			return false;
+		}
+		break;
+	default:
+		return false;
+	}
+
+	int oldRegion = gba->memory.activeRegion;
+	gba->memory.activeRegion = GBA_REGION_BIOS;
+	// Same setup cost as the LZ77 decoder
+	int cycles = 20;
+	switch (immediate) {
+	case GBA_SWI_DIV:
+		_Div(gba, cpu->gprs[0], cpu->gprs[1]);
+		break;
+	case GBA_SWI_DIV_ARM:
+		_Div(gba, cpu->gprs[1], cpu->gprs[0]);
+		break;
+	case GBA_SWI_SQRT:
+		cpu->gprs[0] = _Sqrt(cpu->gprs[0], &gba->biosStall);
+		break;
+	case GBA_SWI_ARCTAN:
+		cpu->gprs[0] = _ArcTan(cpu->gprs[0], &cpu->gprs[1], &cpu->gprs[3], &gba->biosStall);
+		break;
+	case GBA_SWI_ARCTAN2:
+		cpu->gprs[0] = (uint16_t) _ArcTan2(cpu->gprs[0], cpu->gprs[1], &cpu->gprs[1], &gba->biosStall);
+		cpu->gprs[3] = 0x170;
+		break;
+	case GBA_SWI_CPU_SET:
+		_CpuSet(gba);
+		break;
+	case GBA_SWI_CPU_FAST_SET:
+		_CpuFastSet(gba);
+		break;
+	case GBA_SWI_BIT_UNPACK:
+		_unBitPack(gba, &cycles);
+		gba->biosStall = cycles;
+		break;
+	case GBA_SWI_LZ77_UNCOMP_WRAM:
+	case GBA_SWI_LZ77_UNCOMP_VRAM:
+		_unLz77(gba, immediate == GBA_SWI_LZ77_UNCOMP_WRAM ? 1 : 2);
+		break;
+	case GBA_SWI_HUFFMAN_UNCOMP:
+		_unHuffman(gba, &cycles);
+		gba->biosStall = cycles;
+		break;
+	case GBA_SWI_RL_UNCOMP_WRAM:
+	case GBA_SWI_RL_UNCOMP_VRAM:
+		_unRl(gba, immediate == GBA_SWI_RL_UNCOMP_WRAM ? 1 : 2, &cycles);
+		gba->biosStall = cycles;
+		break;
+	case GBA_SWI_DIFF_8BIT_UNFILTER_WRAM:
+	case GBA_SWI_DIFF_8BIT_UNFILTER_VRAM:
+	case GBA_SWI_DIFF_16BIT_UNFILTER:
+		_unFilter(gba, immediate == GBA_SWI_DIFF_16BIT_UNFILTER ? 2 : 1, immediate == GBA_SWI_DIFF_8BIT_UNFILTER_WRAM ? 1 : 2, &cycles);
+		gba->biosStall = cycles;
+		break;
+	}
+	gba->memory.activeRegion = oldRegion;
+
+	// Entry and exit cost matches the non-stalling HLE path
+	cpu->cycles += gba->biosStall + 45 + cpu->memory.activeNonseqCycles16;
+	if (cpu->executionMode == MODE_ARM) {
+		cpu->cycles += cpu->memory.activeNonseqCycles32 + cpu->memory.activeSeqCycles32;
+	} else {
+		cpu->cycles += cpu->memory.activeNonseqCycles16 + cpu->memory.activeSeqCycles16;
+	}
+	gba->memory.biosPrefetch = 0xE3A02004;
+	return true;
+}
+
 void GBASwi32(struct ARMCore* cpu, int immediate) {
 	GBASwi16(cpu, immediate >> 16);
 }
@@ -728,16 +969,25 @@ static void _unLz77(struct GBA* gba, int width) {
 	gba->biosStall = cycles;
 }
 
+// The other decoders haven't been timed on their own, so their loops are charged
+// like the matching steps of the LZ77 one above: 14 per pass of the outer loop,
+// 18 per header or symbol decoded and 10 per unit copied, plus the accesses
+static void _addCycles(int* cycles, int amount) {
+	if (cycles) {
+		*cycles += amount;
+	}
+}
+
 DECL_BITFIELD(HuffmanNode, uint8_t);
 DECL_BITS(HuffmanNode, Offset, 0, 6);
 DECL_BIT(HuffmanNode, RTerm, 6);
 DECL_BIT(HuffmanNode, LTerm, 7);
 
-static void _unHuffman(struct GBA* gba) {
+static void _unHuffman(struct GBA* gba, int* cycles) {
 	struct ARMCore* cpu = gba->cpu;
 	uint32_t source = cpu->gprs[0] & 0xFFFFFFFC;
 	uint32_t dest = cpu->gprs[1];
-	uint32_t header = cpu->memory.load32(cpu, source, 0);
+	uint32_t header = cpu->memory.load32(cpu, source, cycles);
 	int remaining = header >> 8;
 	unsigned bits = header & 0xF;
 	if (bits == 0) {
@@ -749,7 +999,7 @@ static void _unHuffman(struct GBA* gba) {
 		return;
 	}
 	// We assume the signature byte (0x20) is correct
-	int treesize = (cpu->memory.load8(cpu, source + 4, 0) << 1) + 1;
+	int treesize = (cpu->memory.load8(cpu, source + 4, cycles) << 1) + 1;
 	int block = 0;
 	uint32_t treeBase = source + 5;
 	source += 5 + treesize;
@@ -758,39 +1008,42 @@ static void _unHuffman(struct GBA* gba) {
 	int bitsRemaining;
 	int readBits;
 	int bitsSeen = 0;
-	node = cpu->memory.load8(cpu, nPointer, 0);
+	node = cpu->memory.load8(cpu, nPointer, cycles);
 	while (remaining > 0) {
-		uint32_t bitstream = cpu->memory.load32(cpu, source, 0);
+		_addCycles(cycles, 14);
+		uint32_t bitstream = cpu->memory.load32(cpu, source, cycles);
 		source += 4;
 		for (bitsRemaining = 32; bitsRemaining > 0 && remaining > 0; --bitsRemaining, bitstream <<= 1) {
+			_addCycles(cycles, 10);
 			uint32_t next = (nPointer & ~1) + HuffmanNodeGetOffset(node) * 2 + 2;
 			if (bitstream & 0x80000000) {
 				// Go right
 				if (HuffmanNodeIsRTerm(node)) {
-					readBits = cpu->memory.load8(cpu, next + 1, 0);
+					readBits = cpu->memory.load8(cpu, next + 1, cycles);
 				} else {
 					nPointer = next + 1;
-					node = cpu->memory.load8(cpu, nPointer, 0);
+					node = cpu->memory.load8(cpu, nPointer, cycles);
 					continue;
 				}
 			} else {
 				// Go left
 				if (HuffmanNodeIsLTerm(node)) {
-					readBits = cpu->memory.load8(cpu, next, 0);
+					readBits = cpu->memory.load8(cpu, next, cycles);
 				} else {
 					nPointer = next;
-					node = cpu->memory.load8(cpu, nPointer, 0);
+					node = cpu->memory.load8(cpu, nPointer, cycles);
 					continue;
 				}
 			}
 
+			_addCycles(cycles, 18);
 			block |= (readBits & ((1 << bits) - 1)) << bitsSeen;
 			bitsSeen += bits;
 			nPointer = treeBase;
-			node = cpu->memory.load8(cpu, nPointer, 0);
+			node = cpu->memory.load8(cpu, nPointer, cycles);
 			if (bitsSeen == 32) {
 				bitsSeen = 0;
-				cpu->memory.store32(cpu, dest, block, 0);
+				cpu->memory.store32(cpu, dest, block, cycles);
 				dest += 4;
 				remaining -= 4;
 				block = 0;
@@ -801,10 +1054,10 @@ static void _unHuffman(struct GBA* gba) {
 	cpu->gprs[1] = dest;
 }
 
-static void _unRl(struct GBA* gba, int width) {
+static void _unRl(struct GBA* gba, int width, int* cycles) {
 	struct ARMCore* cpu = gba->cpu;
 	uint32_t source = cpu->gprs[0];
-	int remaining = (cpu->memory.load32(cpu, source & 0xFFFFFFFC, 0) & 0xFFFFFF00) >> 8;
+	int remaining = (cpu->memory.load32(cpu, source & 0xFFFFFFFC, cycles) & 0xFFFFFF00) >> 8;
 	int padding = (4 - remaining) & 0x3;
 	// We assume the signature byte (0x30) is correct
 	int blockheader;
@@ -813,25 +1066,28 @@ static void _unRl(struct GBA* gba, int width) {
 	uint32_t dest = cpu->gprs[1];
 	int halfword = 0;
 	while (remaining > 0) {
-		blockheader = cpu->memory.load8(cpu, source, 0);
+		_addCycles(cycles, 14 + 18);
+		blockheader = cpu->memory.load8(cpu, source, cycles);
 		++source;
 		if (blockheader & 0x80) {
 			// Compressed
 			blockheader &= 0x7F;
 			blockheader += 3;
-			block = cpu->memory.load8(cpu, source, 0);
+			block = cpu->memory.load8(cpu, source, cycles);
 			++source;
 			while (blockheader-- && remaining) {
+				// Halfword output costs the same extra as in the LZ77 decoder
+				_addCycles(cycles, width == 2 ? 14 : 10);
 				--remaining;
 				if (width == 2) {
 					if (dest & 1) {
 						halfword |= block << 8;
-						cpu->memory.store16(cpu, dest ^ 1, halfword, 0);
+						cpu->memory.store16(cpu, dest ^ 1, halfword, cycles);
 					} else {
 						halfword = block;
 					}
 				} else {
-					cpu->memory.store8(cpu, dest, block, 0);
+					cpu->memory.store8(cpu, dest, block, cycles);
 				}
 				++dest;
 			}
@@ -839,18 +1095,19 @@ static void _unRl(struct GBA* gba, int width) {
 			// Uncompressed
 			blockheader++;
 			while (blockheader-- && remaining) {
+				_addCycles(cycles, width == 2 ? 14 : 10);
 				--remaining;
-				int byte = cpu->memory.load8(cpu, source, 0);
+				int byte = cpu->memory.load8(cpu, source, cycles);
 				++source;
 				if (width == 2) {
 					if (dest & 1) {
 						halfword |= byte << 8;
-						cpu->memory.store16(cpu, dest ^ 1, halfword, 0);
+						cpu->memory.store16(cpu, dest ^ 1, halfword, cycles);
 					} else {
 						halfword = byte;
 					}
 				} else {
-					cpu->memory.store8(cpu, dest, byte, 0);
+					cpu->memory.store8(cpu, dest, byte, cycles);
 				}
 				++dest;
 			}
@@ -862,11 +1119,11 @@ static void _unRl(struct GBA* gba, int width) {
 			++dest;
 		}
 		for (; padding > 0; padding -= 2, dest += 2) {
-			cpu->memory.store16(cpu, dest, 0, 0);
+			cpu->memory.store16(cpu, dest, 0, cycles);
 		}
 	} else {
 		while (padding--) {
-			cpu->memory.store8(cpu, dest, 0, 0);
+			cpu->memory.store8(cpu, dest, 0, cycles);
 			++dest;
 		}
 	}
@@ -874,38 +1131,39 @@ static void _unRl(struct GBA* gba, int width) {
 	cpu->gprs[1] = dest;
 }
 
-static void _unFilter(struct GBA* gba, int inwidth, int outwidth) {
+static void _unFilter(struct GBA* gba, int inwidth, int outwidth, int* cycles) {
 	struct ARMCore* cpu = gba->cpu;
 	uint32_t source = cpu->gprs[0] & 0xFFFFFFFC;
 	uint32_t dest = cpu->gprs[1];
-	uint32_t header = cpu->memory.load32(cpu, source, 0);
+	uint32_t header = cpu->memory.load32(cpu, source, cycles);
 	int remaining = header >> 8;
 	// We assume the signature nybble (0x8) is correct
 	uint16_t halfword = 0;
 	uint16_t old = 0;
 	source += 4;
 	while (remaining > 0) {
+		_addCycles(cycles, 10);
 		uint16_t new;
 		if (inwidth == 1) {
-			new = cpu->memory.load8(cpu, source, 0);
+			new = cpu->memory.load8(cpu, source, cycles);
 		} else {
-			new = cpu->memory.load16(cpu, source, 0);
+			new = cpu->memory.load16(cpu, source, cycles);
 		}
 		new += old;
 		if (outwidth > inwidth) {
 			halfword >>= 8;
 			halfword |= (new << 8);
 			if (source & 1) {
-				cpu->memory.store16(cpu, dest, halfword, 0);
+				cpu->memory.store16(cpu, dest, halfword, cycles);
 				dest += outwidth;
 				remaining -= outwidth;
 			}
 		} else if (outwidth == 1) {
-			cpu->memory.store8(cpu, dest, new, 0);
+			cpu->memory.store8(cpu, dest, new, cycles);
 			dest += outwidth;
 			remaining -= outwidth;
 		} else {
-			cpu->memory.store16(cpu, dest, new, 0);
+			cpu->memory.store16(cpu, dest, new, cycles);
 			dest += outwidth;
 			remaining -= outwidth;
 		}
@@ -916,14 +1174,14 @@ static void _unFilter(struct GBA* gba, int inwidth, int outwidth) {
 	cpu->gprs[1] = dest;
 }
 
-static void _unBitPack(struct GBA* gba) {
+static void _unBitPack(struct GBA* gba, int* cycles) {
 	struct ARMCore* cpu = gba->cpu;
 	uint32_t source = cpu->gprs[0];
 	uint32_t dest = cpu->gprs[1];
 	uint32_t info = cpu->gprs[2];
-	unsigned sourceLen = cpu->memory.load16(cpu, info, 0);
-	unsigned sourceWidth = cpu->memory.load8(cpu, info + 2, 0);
-	unsigned destWidth = cpu->memory.load8(cpu, info + 3, 0);
+	unsigned sourceLen = cpu->memory.load16(cpu, info, cycles);
+	unsigned sourceWidth = cpu->memory.load8(cpu, info + 2, cycles);
+	unsigned destWidth = cpu->memory.load8(cpu, info + 3, cycles);
 	switch (sourceWidth) {
 	case 1:
 	case 2:
@@ -946,14 +1204,16 @@ static void _unBitPack(struct GBA* gba) {
 		mLOG(GBA_BIOS, GAME_ERROR, "Bad BitUnPack destination width: %u", destWidth);
 		return;
 	}
-	uint32_t bias = cpu->memory.load32(cpu, info + 4, 0);
+	uint32_t bias = cpu->memory.load32(cpu, info + 4, cycles);
 	uint8_t in = 0;
 	uint32_t out = 0;
 	int bitsRemaining = 0;
 	int bitsEaten = 0;
 	while (sourceLen > 0 || bitsRemaining) {
+		_addCycles(cycles, 10);
 		if (!bitsRemaining) {
-			in = cpu->memory.load8(cpu, source, 0);
+			_addCycles(cycles, 14);
+			in = cpu->memory.load8(cpu, source, cycles);
 			bitsRemaining = 8;
 			++source;
 			--sourceLen;
@@ -967,7 +1227,7 @@ static void _unBitPack(struct GBA* gba) {
 		out |= scaled << bitsEaten;
 		bitsEaten += destWidth;
 		if (bitsEaten == 32) {
-			cpu->memory.store32(cpu, dest, out, 0);
+			cpu->memory.store32(cpu, dest, out, cycles);
 			bitsEaten = 0;
 			out = 0;
 			dest += 4;
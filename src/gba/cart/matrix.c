@@ -33,8 +33,19 @@ static void _remapMatrix(struct GBA* gba) {
 		gba->memory.matrix.mappings[(start + i) & MAPPING_MASK] = gba->memory.matrix.paddr + (i << 9);
 	}
 
-	gba->romVf->seek(gba->romVf, gba->memory.matrix.paddr, SEEK_SET);
-	gba->romVf->read(gba->romVf, &gba->memory.rom[gba->memory.matrix.vaddr >> 2], gba->memory.matrix.size);
+	if (!gba->memory.matrixRom) {
+		gba->romVf->seek(gba->romVf, gba->memory.matrix.paddr, SEEK_SET);
+		gba->romVf->read(gba->romVf, &gba->memory.rom[gba->memory.matrix.vaddr >> 2], gba->memory.matrix.size);
+		return;
+	}
+	if (gba->memory.matrix.paddr >= gba->memory.matrixRomSize) {
+		return;
+	}
+	size_t length = gba->memory.matrix.size;
+	if (length > gba->memory.matrixRomSize - gba->memory.matrix.paddr) {
+		length = gba->memory.matrixRomSize - gba->memory.matrix.paddr;
+	}
+	memcpy(&gba->memory.rom[gba->memory.matrix.vaddr >> 2], &gba->memory.matrixRom[gba->memory.matrix.paddr], length);
 }
 
 void GBAMatrixReset(struct GBA* gba) {
@@ -5,12 +5,15 @@
  * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
 #include <mgba/gba/core.h>
 
+#include <mgba/core/blip_buf.h>
 #include <mgba/core/core.h>
 #include <mgba/core/log.h>
+#include <mgba/core/run-until.h>
 #include <mgba/internal/arm/debugger/debugger.h>
 #include <mgba/internal/arm/isa-inlines.h>
 #include <mgba/internal/debugger/symbols.h>
 #include <mgba/internal/gba/cheats.h>
+#include <mgba/internal/gba/debugger/analysis.h>
 #include <mgba/internal/gba/gba.h>
 #include <mgba/internal/gba/io.h>
 #include <mgba/internal/gba/debugger/cli.h>
@@ -22,6 +25,7 @@
 #ifdef BUILD_GLES3
 #include <mgba/internal/gba/renderers/gl.h>
 #endif
+#include <mgba/internal/gba/renderers/parallel.h>
 #include <mgba/internal/gba/renderers/proxy.h>
 #include <mgba/internal/gba/renderers/video-software.h>
 #include <mgba/internal/gba/savedata.h>
@@ -209,6 +213,7 @@ struct GBACore {
 	struct mCoreCallbacks logCallbacks;
 #ifndef DISABLE_THREADING
 	struct mVideoThreadProxy threadProxy;
+	struct GBAVideoParallelRenderer parallelRenderer;
 #endif
 	struct mCPUComponent* components[CPU_COMPONENT_MAX];
 	const struct Configuration* overrides;
@@ -220,6 +225,7 @@ struct GBACore {
 	struct mCoreMemoryBlock memoryBlocks[12];
 	size_t nMemoryBlocks;
 	int memoryBlockType;
+	struct mVideoLayerOutput layerOutput;
 };
 
 #define _MAX(A, B) ((A > B) ? (A) : (B))
@@ -382,9 +388,21 @@ static void _GBACoreLoadConfig(struct mCore* core, const struct mCoreConfig* con
 		}
 	}
 
+	const char* accuracy = mCoreConfigGetValue(config, "accuracy");
+	enum mCoreAccuracy oldAccuracy = gba->accuracy;
+	if (!accuracy || !mCoreAccuracyParse(accuracy, &gba->accuracy)) {
+		gba->accuracy = mCORE_ACCURACY_ACCURATE;
+	}
+	if (gba->accuracy != oldAccuracy) {
+		GBAAdjustWaitstates(gba, gba->memory.io[GBA_REG(WAITCNT)]);
+	}
+
 	mCoreConfigGetBoolValue(config, "allowOpposingDirections", &gba->allowOpposingDirections);
+	mCoreConfigGetBoolValue(config, "gba.hleBiosCalls", &gba->hleBiosCalls);
 
+	mCoreConfigCopyValue(&core->config, config, "accuracy");
 	mCoreConfigCopyValue(&core->config, config, "allowOpposingDirections");
+	mCoreConfigCopyValue(&core->config, config, "gba.hleBiosCalls");
 	mCoreConfigCopyValue(&core->config, config, "gba.bios");
 	mCoreConfigCopyValue(&core->config, config, "gba.forceGbp");
 	mCoreConfigCopyValue(&core->config, config, "gba.audioHle");
@@ -392,11 +410,24 @@ static void _GBACoreLoadConfig(struct mCore* core, const struct mCoreConfig* con
 
 #ifndef DISABLE_THREADING
 	mCoreConfigCopyValue(&core->config, config, "threadedVideo");
+	mCoreConfigCopyValue(&core->config, config, "gba.videoBands");
 #endif
 	mCoreConfigCopyValue(&core->config, config, "hwaccelVideo");
 	mCoreConfigCopyValue(&core->config, config, "videoScale");
 }
 
+#ifndef DISABLE_THREADING
+static struct GBAVideoRenderer* _GBACoreParallelRenderer(struct mCore* core) {
+	struct GBACore* gbacore = (struct GBACore*) core;
+	int bands;
+	if (!mCoreConfigGetIntValue(&core->config, "gba.videoBands", &bands) || bands < 2) {
+		return &gbacore->renderer.d;
+	}
+	GBAVideoParallelRendererCreate(&gbacore->parallelRenderer, &gbacore->renderer, bands);
+	return &gbacore->parallelRenderer.d;
+}
+#endif
+
 static void _GBACoreReloadConfigOption(struct mCore* core, const char* option, const struct mCoreConfig* config) {
 	struct GBA* gba = core->board;
 	if (!config) {
@@ -443,6 +474,13 @@ static void _GBACoreReloadConfigOption(struct mCore* core, const char* option, c
 		mCoreConfigGetBoolValue(config, "allowOpposingDirections", &gba->allowOpposingDirections);
 		return;
 	}
+	if (strcmp("gba.hleBiosCalls", option) == 0) {
+		if (config != &core->config) {
+			mCoreConfigCopyValue(&core->config, config, "gba.hleBiosCalls");
+		}
+		mCoreConfigGetBoolValue(config, "gba.hleBiosCalls", &gba->hleBiosCalls);
+		return;
+	}
 
 	struct GBACore* gbacore = (struct GBACore*) core;
 #ifdef BUILD_GLES3
@@ -473,6 +511,11 @@ static void _GBACoreReloadConfigOption(struct mCore* core, const char* option, c
 			gbacore->glRenderer.scale = 1;
 		}
 #endif
+#ifndef DISABLE_THREADING
+		if (renderer == &gbacore->renderer.d) {
+			renderer = _GBACoreParallelRenderer(core);
+		}
+#endif
 #ifndef MINIMAL_CORE
 		if (renderer && core->videoLogger) {
 			gbacore->proxyRenderer.logger = core->videoLogger;
@@ -711,6 +754,9 @@ static void _GBACoreReset(struct mCore* core) {
 		}
 #endif
 #ifndef DISABLE_THREADING
+		if (renderer == &gbacore->renderer.d) {
+			renderer = _GBACoreParallelRenderer(core);
+		}
 		if (mCoreConfigGetBoolValue(&core->config, "threadedVideo", &value) && value) {
 			if (!core->videoLogger) {
 				core->videoLogger = &gbacore->threadProxy.d;
@@ -836,6 +882,50 @@ static void _GBACoreStep(struct mCore* core) {
 	ARMRun(core->cpu);
 }
 
+static uint32_t _GBARunUntilPC(struct mRunUntil* ru) {
+	struct ARMCore* cpu = ru->core->cpu;
+	return cpu->gprs[ARM_PC] - _ARMInstructionLength(cpu);
+}
+
+static void _GBARunUntilStop(struct mRunUntil* ru) {
+	struct ARMCore* cpu = ru->core->cpu;
+	struct GBA* gba = ru->core->board;
+	cpu->nextEvent = cpu->cycles;
+	gba->earlyExit = true;
+}
+
+static ssize_t _GBACoreRunUntil(struct mCore* core, const struct mRunPredicate* predicates, size_t nPredicates, uint64_t maxCycles, uint64_t* cyclesRun) {
+	struct GBA* gba = core->board;
+	struct ARMCore* cpu = core->cpu;
+	struct mRunUntil ru;
+	mRunUntilInit(&ru, core, predicates, nPredicates, maxCycles);
+	ru.pc = _GBARunUntilPC;
+	ru.stop = _GBARunUntilStop;
+	mRunUntilInstall(&ru, &cpu->breakpointPages, &cpu->watchpointPages);
+	gba->runUntil = &ru;
+
+	while (!mRunUntilShouldStop(&ru)) {
+		ARMRunLoop(cpu);
+	}
+
+	gba->runUntil = NULL;
+	mRunUntilUninstall(&ru);
+	if (cyclesRun) {
+		*cyclesRun = mRunUntilElapsed(&ru);
+	}
+	ssize_t fired = ru.fired;
+	mRunUntilDeinit(&ru);
+	return fired;
+}
+
+static uint64_t _GBACoreRunCycles(struct mCore* core, uint64_t cycles) {
+	if (!cycles) {
+		return 0;
+	}
+	_GBACoreRunUntil(core, NULL, 0, cycles, &cycles);
+	return cycles;
+}
+
 static size_t _GBACoreStateSize(struct mCore* core) {
 	UNUSED(core);
 	return sizeof(struct GBASerializedState);
@@ -1087,6 +1177,29 @@ void* _GBACoreGetMemoryBlock(struct mCore* core, size_t id, size_t* sizeOut) {
 	}
 }
 
+static void _GBACoreMemoryUsage(struct mCore* core, struct mCoreMemoryUsage* usage) {
+	struct GBACore* gbacore = (struct GBACore*) core;
+	struct GBA* gba = core->board;
+	memset(usage, 0, sizeof(*usage));
+	mCoreMemoryUsageAdd(usage, mCORE_MEMORY_USAGE_SYSTEM, gbacore, sizeof(*gbacore), false);
+	mCoreMemoryUsageAdd(usage, mCORE_MEMORY_USAGE_SYSTEM, core->cpu, sizeof(struct ARMCore), false);
+	mCoreMemoryUsageAdd(usage, mCORE_MEMORY_USAGE_SYSTEM, gba, sizeof(*gba), false);
+	mCoreMemoryUsageAdd(usage, mCORE_MEMORY_USAGE_RAM, gba->memory.wram, GBA_SIZE_EWRAM + GBA_SIZE_IWRAM, false);
+	if (gba->biosVf) {
+		mCoreMemoryUsageAdd(usage, mCORE_MEMORY_USAGE_ROM, gba->memory.bios, GBA_SIZE_BIOS, true);
+	}
+	if (gba->isPristine) {
+		mCoreMemoryUsageAdd(usage, mCORE_MEMORY_USAGE_ROM, gba->memory.rom, gba->pristineRomSize, gba->romVf != NULL);
+	} else {
+		mCoreMemoryUsageAdd(usage, mCORE_MEMORY_USAGE_ROM, gba->memory.rom, GBA_SIZE_ROM0, false);
+	}
+	mCoreMemoryUsageAdd(usage, mCORE_MEMORY_USAGE_SAVEDATA, gba->memory.savedata.data, GBASavedataSize(&gba->memory.savedata), false);
+	mCoreMemoryUsageAdd(usage, mCORE_MEMORY_USAGE_VIDEO, gba->video.vram, GBA_SIZE_VRAM, false);
+	mCoreMemoryUsageAdd(usage, mCORE_MEMORY_USAGE_AUDIO, gba->audio.psg.left, blip_footprint(gba->audio.psg.left), false);
+	mCoreMemoryUsageAdd(usage, mCORE_MEMORY_USAGE_AUDIO, gba->audio.psg.right, blip_footprint(gba->audio.psg.right), false);
+	mCoreMemoryUsageAdd(usage, mCORE_MEMORY_USAGE_AUDIO, gbacore->audioMixer, sizeof(*gbacore->audioMixer), false);
+}
+
 static size_t _GBACoreListRegisters(const struct mCore* core, const struct mCoreRegisterInfo** list) {
 	UNUSED(core);
 	*list = _GBARegisters;
@@ -1307,6 +1420,11 @@ static bool _GBACoreLookupIdentifier(struct mCore* core, const char* name, int32
 	}
 	return false;
 }
+
+static const struct mCodeAnalysisPlatform* _GBACoreCodeAnalysisPlatform(struct mCore* core) {
+	UNUSED(core);
+	return &GBACodeAnalysisPlatform;
+}
 #endif
 
 static struct mCheatDevice* _GBACoreCheatDevice(struct mCore* core) {
@@ -1461,6 +1579,18 @@ static void _GBACoreAdjustVideoLayer(struct mCore* core, size_t id, int32_t x, i
 	memset(gbacore->renderer.scanlineDirty, 0xFFFFFFFF, sizeof(gbacore->renderer.scanlineDirty));
 }
 
+#ifndef COLOR_16_BIT
+static void _GBACoreSetVideoLayerOutput(struct mCore* core, const struct mVideoLayerOutput* output) {
+	struct GBACore* gbacore = (struct GBACore*) core;
+	if (!output) {
+		gbacore->renderer.layerOutput = NULL;
+		return;
+	}
+	gbacore->layerOutput = *output;
+	gbacore->renderer.layerOutput = &gbacore->layerOutput;
+}
+#endif
+
 #ifndef MINIMAL_CORE
 static void _GBACoreStartVideoLog(struct mCore* core, struct mVideoLogContext* context) {
 	struct GBACore* gbacore = (struct GBACore*) core;
@@ -1534,6 +1664,8 @@ struct mCore* GBACoreCreate(void) {
 	core->runFrame = _GBACoreRunFrame;
 	core->runLoop = _GBACoreRunLoop;
 	core->step = _GBACoreStep;
+	core->runCycles = _GBACoreRunCycles;
+	core->runUntil = _GBACoreRunUntil;
 	core->stateSize = _GBACoreStateSize;
 	core->loadState = _GBACoreLoadState;
 	core->saveState = _GBACoreSaveState;
@@ -1562,6 +1694,7 @@ struct mCore* GBACoreCreate(void) {
 	core->rawWrite32 = _GBACoreRawWrite32;
 	core->listMemoryBlocks = _GBACoreListMemoryBlocks;
 	core->getMemoryBlock = _GBACoreGetMemoryBlock;
+	core->memoryUsage = _GBACoreMemoryUsage;
 	core->listRegisters = _GBACoreListRegisters;
 	core->readRegister = _GBACoreReadRegister;
 	core->writeRegister = _GBACoreWriteRegister;
@@ -1573,6 +1706,7 @@ struct mCore* GBACoreCreate(void) {
 	core->detachDebugger = _GBACoreDetachDebugger;
 	core->loadSymbols = _GBACoreLoadSymbols;
 	core->lookupIdentifier = _GBACoreLookupIdentifier;
+	core->codeAnalysisPlatform = _GBACoreCodeAnalysisPlatform;
 #endif
 	core->cheatDevice = _GBACoreCheatDevice;
 	core->savedataClone = _GBACoreSavedataClone;
@@ -1582,6 +1716,11 @@ struct mCore* GBACoreCreate(void) {
 	core->enableVideoLayer = _GBACoreEnableVideoLayer;
 	core->enableAudioChannel = _GBACoreEnableAudioChannel;
 	core->adjustVideoLayer = _GBACoreAdjustVideoLayer;
+#ifndef COLOR_16_BIT
+	core->setVideoLayerOutput = _GBACoreSetVideoLayerOutput;
+#else
+	core->setVideoLayerOutput = NULL;
+#endif
 #ifndef MINIMAL_CORE
 	core->startVideoLog = _GBACoreStartVideoLog;
 	core->endVideoLog = _GBACoreEndVideoLog;
@@ -1634,6 +1773,9 @@ static void _GBAVLPReset(struct mCore* core) {
 		GBAVideoProxyRendererUnshim(&gba->video, &gbacore->vlProxy);
 	} else if (gbacore->renderer.outputBuffer) {
 		struct GBAVideoRenderer* renderer = &gbacore->renderer.d;
+#ifndef DISABLE_THREADING
+		renderer = _GBACoreParallelRenderer(core);
+#endif
 		GBAVideoAssociateRenderer(&gba->video, renderer);
 	}
 
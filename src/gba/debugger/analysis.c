@@ -0,0 +1,254 @@
+/* Copyright (c) 2013-2024 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include <mgba/internal/gba/debugger/analysis.h>
+
+#include <mgba/core/core.h>
+#include <mgba/internal/arm/decoder.h>
+#include <mgba/internal/gba/memory.h>
+
+#define LINK_REGISTERS 0x500F
+
+static bool _isStatic(struct mCodeAnalysis* analysis, const struct mCodeLocation* location) {
+	if (location->address < GBA_SIZE_BIOS) {
+		return true;
+	}
+	if (location->address >= GBA_BASE_ROM0 && location->address < GBA_BASE_SRAM) {
+		return (location->address & (GBA_SIZE_ROM0 - 1)) < analysis->core->romSize(analysis->core);
+	}
+	return false;
+}
+
+static bool _isExecutable(struct mCodeAnalysis* analysis, const struct mCodeLocation* location) {
+	switch (location->address >> BASE_OFFSET) {
+	case GBA_REGION_EWRAM:
+	case GBA_REGION_IWRAM:
+		return true;
+	default:
+		return _isStatic(analysis, location);
+	}
+}
+
+static void _setKnown(struct mCodeAnalysis* analysis, unsigned reg, uint32_t value) {
+	analysis->knownValues[reg] = value;
+	analysis->knownMask |= 1 << reg;
+}
+
+static bool _getKnown(const struct mCodeAnalysis* analysis, unsigned reg, uint32_t pc, uint32_t* value) {
+	if (reg == ARM_PC) {
+		*value = pc;
+		return true;
+	}
+	if (!(analysis->knownMask & (1 << reg))) {
+		return false;
+	}
+	*value = analysis->knownValues[reg];
+	return true;
+}
+
+static uint32_t _writtenRegisters(const struct ARMInstructionInfo* info) {
+	uint32_t mask = 0;
+	if ((info->operandFormat & (ARM_OPERAND_REGISTER_1 | ARM_OPERAND_AFFECTED_1)) == (ARM_OPERAND_REGISTER_1 | ARM_OPERAND_AFFECTED_1)) {
+		mask |= 1 << info->op1.reg;
+	}
+	if ((info->operandFormat & (ARM_OPERAND_REGISTER_2 | ARM_OPERAND_AFFECTED_2)) == (ARM_OPERAND_REGISTER_2 | ARM_OPERAND_AFFECTED_2)) {
+		mask |= 1 << info->op2.reg;
+	}
+	if (info->mnemonic == ARM_MN_LDM) {
+		mask |= info->op1.immediate;
+	}
+	if ((info->operandFormat & ARM_OPERAND_MEMORY) && (info->memory.format & (ARM_MEMORY_WRITEBACK | ARM_MEMORY_POST_INCREMENT))) {
+		mask |= 1 << info->memory.baseReg;
+	}
+	if (info->mnemonic == ARM_MN_BL || info->mnemonic == ARM_MN_SWI) {
+		mask |= LINK_REGISTERS;
+	}
+	return mask;
+}
+
+static bool _literalAddress(const struct ARMInstructionInfo* info, uint32_t pc, uint32_t* address) {
+	if (!(info->operandFormat & ARM_OPERAND_MEMORY_2) || info->memory.baseReg != ARM_PC) {
+		return false;
+	}
+	if ((info->memory.format & (ARM_MEMORY_IMMEDIATE_OFFSET | ARM_MEMORY_LOAD | ARM_MEMORY_POST_INCREMENT | ARM_MEMORY_WRITEBACK)) != (ARM_MEMORY_IMMEDIATE_OFFSET | ARM_MEMORY_LOAD)) {
+		return false;
+	}
+	*address = pc & ~3;
+	if (info->memory.format & ARM_MEMORY_OFFSET_SUBTRACT) {
+		*address -= info->memory.offset.immediate;
+	} else {
+		*address += info->memory.offset.immediate;
+	}
+	return true;
+}
+
+// Infers constant register values, such as pointers loaded from literal pools
+static void _trackRegisters(struct mCodeAnalysis* analysis, const struct ARMInstructionInfo* info, const struct mCodeLocation* location, uint32_t pc, struct mCodeInstructionInfo* out) {
+	uint32_t value = 0;
+	bool known = false;
+	uint32_t literal;
+	if (info->mnemonic == ARM_MN_LDR && _literalAddress(info, pc, &literal)) {
+		out->flow |= mCODE_FLOW_DATA;
+		out->data.address = literal;
+		out->data.segment = -1;
+		out->data.mode = 0;
+		if (info->memory.width == ARM_ACCESS_WORD) {
+			value = analysis->core->rawRead32(analysis->core, literal, -1);
+			known = true;
+		}
+	} else if (info->mnemonic == ARM_MN_MOV && !(info->operandFormat & (ARM_OPERAND_SHIFT_REGISTER_2 | ARM_OPERAND_SHIFT_IMMEDIATE_2))) {
+		if (info->operandFormat & ARM_OPERAND_IMMEDIATE_2) {
+			value = info->op2.immediate;
+			known = true;
+		} else if (info->operandFormat & ARM_OPERAND_REGISTER_2) {
+			known = _getKnown(analysis, info->op2.reg, pc, &value);
+		}
+	} else if ((info->mnemonic == ARM_MN_ADD || info->mnemonic == ARM_MN_SUB) &&
+	           (info->operandFormat & (ARM_OPERAND_REGISTER_2 | ARM_OPERAND_IMMEDIATE_3)) == (ARM_OPERAND_REGISTER_2 | ARM_OPERAND_IMMEDIATE_3)) {
+		known = _getKnown(analysis, info->op2.reg, pc, &value);
+		if (info->op2.reg == ARM_PC && location->mode == MODE_THUMB) {
+			value &= ~3;
+		}
+		if (info->mnemonic == ARM_MN_ADD) {
+			value += info->op3.immediate;
+		} else {
+			value -= info->op3.immediate;
+		}
+	}
+
+	analysis->knownMask &= ~_writtenRegisters(info);
+	if (known && info->condition == ARM_CONDITION_AL && (info->operandFormat & ARM_OPERAND_AFFECTED_1) && info->op1.reg != ARM_PC) {
+		_setKnown(analysis, info->op1.reg, value);
+	}
+}
+
+static void _setTarget(struct mCodeInstructionInfo* out, uint32_t address, int mode) {
+	out->target.address = address & (mode == MODE_THUMB ? ~1 : ~3);
+	out->target.segment = -1;
+	out->target.mode = mode;
+}
+
+static bool _decode(struct mCodeAnalysis* analysis, const struct mCodeLocation* location, struct mCodeInstructionInfo* out) {
+	struct mCore* core = analysis->core;
+	struct ARMInstructionInfo info;
+	uint32_t address = location->address;
+	uint32_t pc;
+	memset(out, 0, sizeof(*out));
+	if (!_isExecutable(analysis, location)) {
+		return false;
+	}
+	if (location->mode == MODE_THUMB) {
+		if (address & 1) {
+			return false;
+		}
+		pc = address + WORD_SIZE_THUMB * 2;
+		out->length = WORD_SIZE_THUMB;
+		ARMDecodeThumb(core->rawRead16(core, address, -1), &info);
+		if (info.mnemonic == ARM_MN_BL && !info.branchType) {
+			struct ARMInstructionInfo info2;
+			struct ARMInstructionInfo combined;
+			ARMDecodeThumb(core->rawRead16(core, address + WORD_SIZE_THUMB, -1), &info2);
+			if (ARMDecodeThumbCombine(&info, &info2, &combined)) {
+				info = combined;
+				out->length = WORD_SIZE_THUMB * 2;
+			}
+		}
+	} else {
+		if (address & 3) {
+			return false;
+		}
+		pc = address + WORD_SIZE_ARM * 2;
+		out->length = WORD_SIZE_ARM;
+		ARMDecodeARM(core->rawRead32(core, address, -1), &info);
+	}
+	if (info.mnemonic == ARM_MN_ILL) {
+		return false;
+	}
+
+	// Remember whether LR points just past this instruction before it's clobbered
+	uint32_t lr;
+	bool linked = _getKnown(analysis, ARM_LR, pc, &lr) && lr == address + out->length;
+	uint32_t target = 0;
+	bool knownTarget = false;
+	out->flow = mCODE_FLOW_CONTINUES;
+
+	switch (info.branchType) {
+	case ARM_BRANCH:
+	case ARM_BRANCH_LINKED:
+		if (info.operandFormat & ARM_OPERAND_IMMEDIATE_1) {
+			_setTarget(out, pc + info.op1.immediate, location->mode);
+			out->flow = info.branchType == ARM_BRANCH_LINKED ? mCODE_FLOW_CALL | mCODE_FLOW_CONTINUES : mCODE_FLOW_JUMP;
+		} else {
+			// An unpaired second half of a Thumb BL
+			out->flow = mCODE_FLOW_CALL | mCODE_FLOW_INDIRECT | mCODE_FLOW_CONTINUES;
+		}
+		break;
+	case ARM_BRANCH_INDIRECT:
+		if (info.mnemonic == ARM_MN_STM) {
+			// Storing PC doesn't branch
+			break;
+		}
+		if (info.mnemonic == ARM_MN_LDM) {
+			out->flow = mCODE_FLOW_RETURN;
+			break;
+		}
+		if (info.mnemonic == ARM_MN_BX) {
+			if (info.op1.reg == ARM_LR) {
+				out->flow = mCODE_FLOW_RETURN;
+				break;
+			}
+			knownTarget = _getKnown(analysis, info.op1.reg, pc, &target);
+			if (knownTarget) {
+				_setTarget(out, target, target & 1 ? MODE_THUMB : MODE_ARM);
+			}
+		} else if (info.mnemonic == ARM_MN_MOV && (info.operandFormat & ARM_OPERAND_REGISTER_2) &&
+		           !(info.operandFormat & (ARM_OPERAND_SHIFT_REGISTER_2 | ARM_OPERAND_SHIFT_IMMEDIATE_2))) {
+			if (info.op2.reg == ARM_LR) {
+				out->flow = mCODE_FLOW_RETURN;
+				break;
+			}
+			knownTarget = _getKnown(analysis, info.op2.reg, pc, &target);
+			if (knownTarget) {
+				_setTarget(out, target, location->mode);
+			}
+		} else if (info.mnemonic == ARM_MN_LDR && info.memory.width == ARM_ACCESS_WORD && _literalAddress(&info, pc, &target)) {
+			target = core->rawRead32(core, target, -1);
+			knownTarget = true;
+			_setTarget(out, target, location->mode);
+		}
+		if (linked) {
+			out->flow = mCODE_FLOW_CALL | mCODE_FLOW_CONTINUES;
+		} else {
+			out->flow = mCODE_FLOW_JUMP;
+		}
+		if (!knownTarget) {
+			out->flow |= mCODE_FLOW_INDIRECT;
+		}
+		break;
+	default:
+		break;
+	}
+	if (info.condition != ARM_CONDITION_AL) {
+		out->flow |= mCODE_FLOW_CONTINUES;
+	}
+
+	_trackRegisters(analysis, &info, location, pc, out);
+	return true;
+}
+
+static void _addEntryPoints(struct mCodeAnalysis* analysis) {
+	mCodeAnalysisAddEntryPoint(analysis, GBA_BASE_ROM0, -1, MODE_ARM);
+	// Reset, SWI and IRQ vectors
+	mCodeAnalysisAddEntryPoint(analysis, 0x00, -1, MODE_ARM);
+	mCodeAnalysisAddEntryPoint(analysis, 0x08, -1, MODE_ARM);
+	mCodeAnalysisAddEntryPoint(analysis, 0x18, -1, MODE_ARM);
+}
+
+const struct mCodeAnalysisPlatform GBACodeAnalysisPlatform = {
+	.id = mPLATFORM_GBA,
+	.decode = _decode,
+	.isStatic = _isStatic,
+	.addEntryPoints = _addEntryPoints,
+};
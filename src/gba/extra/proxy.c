@@ -15,6 +15,7 @@ static void GBAVideoProxyRendererReset(struct GBAVideoRenderer* renderer);
 static void GBAVideoProxyRendererDeinit(struct GBAVideoRenderer* renderer);
 static uint16_t GBAVideoProxyRendererWriteVideoRegister(struct GBAVideoRenderer* renderer, uint32_t address, uint16_t value);
 static void GBAVideoProxyRendererWriteVRAM(struct GBAVideoRenderer* renderer, uint32_t address);
+static void GBAVideoProxyRendererWriteVRAMRange(struct GBAVideoRenderer* renderer, uint32_t address, uint32_t size);
 static void GBAVideoProxyRendererWritePalette(struct GBAVideoRenderer* renderer, uint32_t address, uint16_t value);
 static void GBAVideoProxyRendererWriteOAM(struct GBAVideoRenderer* renderer, uint32_t oam);
 static void GBAVideoProxyRendererDrawScanline(struct GBAVideoRenderer* renderer, int y);
@@ -32,6 +33,7 @@ void GBAVideoProxyRendererCreate(struct GBAVideoProxyRenderer* renderer, struct
 	renderer->d.deinit = GBAVideoProxyRendererDeinit;
 	renderer->d.writeVideoRegister = GBAVideoProxyRendererWriteVideoRegister;
 	renderer->d.writeVRAM = GBAVideoProxyRendererWriteVRAM;
+	renderer->d.writeVRAMRange = GBAVideoProxyRendererWriteVRAMRange;
 	renderer->d.writeOAM = GBAVideoProxyRendererWriteOAM;
 	renderer->d.writePalette = GBAVideoProxyRendererWritePalette;
 	renderer->d.drawScanline = GBAVideoProxyRendererDrawScanline;
@@ -213,7 +215,7 @@ static bool _parsePacket(struct mVideoLogger* logger, const struct mVideoLoggerD
 	case DIRTY_VRAM:
 		if (item->address <= GBA_SIZE_VRAM - 0x1000) {
 			logger->readData(logger, &logger->vram[item->address >> 1], 0x1000, true);
-			proxyRenderer->backend->writeVRAM(proxyRenderer->backend, item->address);
+			proxyRenderer->backend->writeVRAMRange(proxyRenderer->backend, item->address, 0x1000);
 		} else {
 			logger->readData(logger, NULL, 0x1000, true);
 		}
@@ -290,6 +292,23 @@ void GBAVideoProxyRendererWriteVRAM(struct GBAVideoRenderer* renderer, uint32_t
 	}
 }
 
+void GBAVideoProxyRendererWriteVRAMRange(struct GBAVideoRenderer* renderer, uint32_t address, uint32_t size) {
+	struct GBAVideoProxyRenderer* proxyRenderer = (struct GBAVideoProxyRenderer*) renderer;
+	if (!size) {
+		return;
+	}
+	uint32_t block;
+	for (block = address & ~0xFFF; block < address + size; block += 0x1000) {
+		mVideoLoggerRendererWriteVRAM(proxyRenderer->logger, block);
+	}
+	if (!proxyRenderer->logger->block) {
+		proxyRenderer->backend->writeVRAMRange(proxyRenderer->backend, address, size);
+	}
+	if (renderer->cache) {
+		mCacheSetWriteVRAMRange(renderer->cache, address, size);
+	}
+}
+
 void GBAVideoProxyRendererWritePalette(struct GBAVideoRenderer* renderer, uint32_t address, uint16_t value) {
 	struct GBAVideoProxyRenderer* proxyRenderer = (struct GBAVideoProxyRenderer*) renderer;
 	mVideoLoggerRendererWritePalette(proxyRenderer->logger, address, value);
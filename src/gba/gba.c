@@ -5,6 +5,7 @@
  * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
 #include <mgba/internal/gba/gba.h>
 
+#include <mgba/core/run-until.h>
 #include <mgba/internal/arm/isa-inlines.h>
 #include <mgba/internal/arm/debugger/debugger.h>
 #include <mgba/internal/arm/decoder.h>
@@ -105,6 +106,7 @@ static void GBAInit(void* cpu, struct mCPUComponent* component) {
 	gba->biosVf = NULL;
 
 	gba->stream = NULL;
+	gba->runUntil = NULL;
 	gba->keyCallback = NULL;
 	mCoreCallbacksListInit(&gba->coreCallbacks, 0);
 
@@ -116,6 +118,8 @@ static void GBAInit(void* cpu, struct mCPUComponent* component) {
 	gba->vbaBugCompat = false;
 	gba->hardCrash = true;
 	gba->allowOpposingDirections = true;
+	gba->hleBiosCalls = false;
+	gba->accuracy = mCORE_ACCURACY_ACCURATE;
 
 	gba->performingDMA = false;
 
@@ -148,12 +152,17 @@ void GBAUnloadROM(struct GBA* gba) {
 			gba->romVf->unmap(gba->romVf, gba->memory.rom, gba->pristineRomSize);
 		}
 #endif
+		if (gba->memory.matrixRom) {
+			gba->romVf->unmap(gba->romVf, gba->memory.matrixRom, gba->memory.matrixRomSize);
+		}
 		gba->romVf->close(gba->romVf);
 		gba->romVf = NULL;
 	}
 	gba->memory.rom = NULL;
 	gba->memory.romSize = 0;
 	gba->memory.romMask = 0;
+	gba->memory.matrixRom = NULL;
+	gba->memory.matrixRomSize = 0;
 	gba->isPristine = false;
 
 	if (!gba->memory.savedata.dirty) {
@@ -418,6 +427,11 @@ bool GBALoadROM(struct GBA* gba, struct VFile* vf) {
 #else
 			gba->memory.rom = anonymousMemoryMap(GBA_SIZE_ROM0);
 #endif
+			// Map the whole backing image once so remaps don't need to seek
+			gba->memory.matrixRom = vf->map(vf, gba->pristineRomSize, MAP_READ);
+			if (gba->memory.matrixRom) {
+				gba->memory.matrixRomSize = gba->pristineRomSize;
+			}
 		} else {
 			gba->memory.rom = vf->map(vf, GBA_SIZE_ROM0, MAP_READ);
 			gba->memory.romSize = GBA_SIZE_ROM0;
@@ -549,6 +563,9 @@ void GBAApplyPatch(struct GBA* gba, struct Patch* patch) {
 
 void GBARaiseIRQ(struct GBA* gba, enum GBAIRQ irq, uint32_t cyclesLate) {
 	gba->memory.io[GBA_REG(IF)] |= 1 << irq;
+	if (UNLIKELY(gba->runUntil)) {
+		mRunUntilIRQ(gba->runUntil, irq);
+	}
 	GBATestIRQ(gba, cyclesLate);
 }
 
@@ -960,7 +977,11 @@ void GBAFrameEnded(struct GBA* gba) {
 		const color_t* pixels;
 		size_t stride;
 		gba->video.renderer->getPixels(gba->video.renderer, &stride, (const void**) &pixels);
-		gba->stream->postVideoFrame(gba->stream, pixels, stride);
+		if (gba->video.renderer->repeatFrame && gba->stream->postVideoFrameRepeat) {
+			gba->stream->postVideoFrameRepeat(gba->stream, pixels, stride);
+		} else {
+			gba->stream->postVideoFrame(gba->stream, pixels, stride);
+		}
 	}
 
 	if (gba->memory.hw.devices & (HW_GB_PLAYER | HW_GB_PLAYER_DETECTION)) {
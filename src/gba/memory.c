@@ -23,6 +23,7 @@
 mLOG_DEFINE_CATEGORY(GBA_MEM, "GBA Memory", "gba.memory");
 
 static void _pristineCow(struct GBA* gba);
+static void _growRom(struct GBA* gba, uint32_t size);
 static void _agbPrintStore(struct GBA* gba, uint32_t address, int16_t value);
 static int16_t  _agbPrintLoad(struct GBA* gba, uint32_t address);
 static uint8_t _deadbeef[4] = { 0x10, 0xB7, 0x10, 0xE7 }; // Illegal instruction on both ARM and Thumb
@@ -32,6 +33,11 @@ static void GBASetActiveRegion(struct ARMCore* cpu, uint32_t region);
 static int32_t GBAMemoryStall(struct ARMCore* cpu, int32_t wait);
 static int32_t GBAMemoryStallVRAM(struct GBA* gba, int32_t wait, int extra);
 
+// Loads without the watchpoint check, for reads that aren't made by the CPU
+static uint32_t _GBALoad32(struct ARMCore* cpu, uint32_t address, int* cycleCounter);
+static uint32_t _GBALoad16(struct ARMCore* cpu, uint32_t address, int* cycleCounter);
+static uint32_t _GBALoad8(struct ARMCore* cpu, uint32_t address, int* cycleCounter);
+
 static const char GBA_BASE_WAITSTATES[16] = { 0, 0, 2, 0, 0, 0, 0, 0, 4, 4, 4, 4, 4, 4, 4 };
 static const char GBA_BASE_WAITSTATES_32[16] = { 0, 0, 5, 0, 0, 1, 1, 0, 7, 7, 9, 9, 13, 13, 9 };
 static const char GBA_BASE_WAITSTATES_SEQ[16] = { 0, 0, 2, 0, 0, 0, 0, 0, 2, 2, 4, 4, 8, 8, 4 };
@@ -56,6 +62,8 @@ void GBAMemoryInit(struct GBA* gba) {
 	gba->memory.wram = 0;
 	gba->memory.iwram = 0;
 	gba->memory.rom = 0;
+	gba->memory.matrixRom = 0;
+	gba->memory.matrixRomSize = 0;
 	gba->memory.romSize = 0;
 	gba->memory.romMask = 0;
 	gba->memory.hw.p = gba;
@@ -117,11 +125,11 @@ void GBAMemoryDeinit(struct GBA* gba) {
 
 void GBAMemoryReset(struct GBA* gba) {
 	if (gba->memory.wram && gba->memory.rom) {
-		memset(gba->memory.wram, 0, GBA_SIZE_EWRAM);
+		mappedMemoryClear(gba->memory.wram, GBA_SIZE_EWRAM);
 	}
 
 	if (gba->memory.iwram) {
-		memset(gba->memory.iwram, 0, GBA_SIZE_IWRAM);
+		mappedMemoryClear(gba->memory.iwram, GBA_SIZE_IWRAM);
 	}
 
 	memset(gba->memory.io, 0, sizeof(gba->memory.io));
@@ -199,13 +207,13 @@ static void _analyzeForIdleLoop(struct GBA* gba, struct ARMCore* cpu, uint32_t a
 					} else {
 						switch (info.memory.width) {
 						case 1:
-							gba->cachedRegisters[info.op1.reg] = GBALoad8(cpu, loadAddress, 0);
+							gba->cachedRegisters[info.op1.reg] = _GBALoad8(cpu, loadAddress, 0);
 							break;
 						case 2:
-							gba->cachedRegisters[info.op1.reg] = GBALoad16(cpu, loadAddress, 0);
+							gba->cachedRegisters[info.op1.reg] = _GBALoad16(cpu, loadAddress, 0);
 							break;
 						case 4:
-							gba->cachedRegisters[info.op1.reg] = GBALoad32(cpu, loadAddress, 0);
+							gba->cachedRegisters[info.op1.reg] = _GBALoad32(cpu, loadAddress, 0);
 							break;
 						}
 					}
@@ -421,7 +429,7 @@ static void GBASetActiveRegion(struct ARMCore* cpu, uint32_t address) {
 
 #define LOAD_SRAM \
 	wait = memory->waitstatesNonseq16[address >> BASE_OFFSET]; \
-	value = GBALoad8(cpu, address, 0); \
+	value = _GBALoad8(cpu, address, 0); \
 	value |= value << 8; \
 	value |= value << 16;
 
@@ -459,6 +467,11 @@ uint32_t GBALoadBad(struct ARMCore* cpu) {
 }
 
 uint32_t GBALoad32(struct ARMCore* cpu, uint32_t address, int* cycleCounter) {
+	mWatchpointPagesCheckRead(cpu->watchpointPages, address, 4);
+	return _GBALoad32(cpu, address, cycleCounter);
+}
+
+static uint32_t _GBALoad32(struct ARMCore* cpu, uint32_t address, int* cycleCounter) {
 	struct GBA* gba = (struct GBA*) cpu->master;
 	struct GBAMemory* memory = &gba->memory;
 	uint32_t value = 0;
@@ -518,6 +531,11 @@ uint32_t GBALoad32(struct ARMCore* cpu, uint32_t address, int* cycleCounter) {
 }
 
 uint32_t GBALoad16(struct ARMCore* cpu, uint32_t address, int* cycleCounter) {
+	mWatchpointPagesCheckRead(cpu->watchpointPages, address, 2);
+	return _GBALoad16(cpu, address, cycleCounter);
+}
+
+static uint32_t _GBALoad16(struct ARMCore* cpu, uint32_t address, int* cycleCounter) {
 	struct GBA* gba = (struct GBA*) cpu->master;
 	struct GBAMemory* memory = &gba->memory;
 	uint32_t value = 0;
@@ -611,7 +629,7 @@ uint32_t GBALoad16(struct ARMCore* cpu, uint32_t address, int* cycleCounter) {
 	case GBA_REGION_SRAM:
 	case GBA_REGION_SRAM_MIRROR:
 		wait = memory->waitstatesNonseq16[address >> BASE_OFFSET];
-		value = GBALoad8(cpu, address, 0);
+		value = _GBALoad8(cpu, address, 0);
 		value |= value << 8;
 		break;
 	default:
@@ -633,6 +651,11 @@ uint32_t GBALoad16(struct ARMCore* cpu, uint32_t address, int* cycleCounter) {
 }
 
 uint32_t GBALoad8(struct ARMCore* cpu, uint32_t address, int* cycleCounter) {
+	mWatchpointPagesCheckRead(cpu->watchpointPages, address, 1);
+	return _GBALoad8(cpu, address, cycleCounter);
+}
+
+static uint32_t _GBALoad8(struct ARMCore* cpu, uint32_t address, int* cycleCounter) {
 	struct GBA* gba = (struct GBA*) cpu->master;
 	struct GBAMemory* memory = &gba->memory;
 	uint32_t value = 0;
@@ -768,16 +791,14 @@ uint32_t GBALoad8(struct ARMCore* cpu, uint32_t address, int* cycleCounter) {
 			LOAD_32(oldValue, address & 0x00017FFC, gba->video.vram); \
 			if (oldValue != value) { \
 				STORE_32(value, address & 0x00017FFC, gba->video.vram); \
-				gba->video.renderer->writeVRAM(gba->video.renderer, (address & 0x00017FFC) + 2); \
-				gba->video.renderer->writeVRAM(gba->video.renderer, (address & 0x00017FFC)); \
+				gba->video.renderer->writeVRAMRange(gba->video.renderer, address & 0x00017FFC, 4); \
 			} \
 		} \
 	} else { \
 		LOAD_32(oldValue, address & 0x0001FFFC, gba->video.vram); \
 		if (oldValue != value) { \
 			STORE_32(value, address & 0x0001FFFC, gba->video.vram); \
-			gba->video.renderer->writeVRAM(gba->video.renderer, (address & 0x0001FFFC) + 2); \
-			gba->video.renderer->writeVRAM(gba->video.renderer, (address & 0x0001FFFC)); \
+			gba->video.renderer->writeVRAMRange(gba->video.renderer, address & 0x0001FFFC, 4); \
 		} \
 	} \
 	++wait; \
@@ -815,6 +836,8 @@ uint32_t GBALoad8(struct ARMCore* cpu, uint32_t address, int* cycleCounter) {
 	mLOG(GBA_MEM, GAME_ERROR, "Bad memory Store32: 0x%08X", address);
 
 void GBAStore32(struct ARMCore* cpu, uint32_t address, int32_t value, int* cycleCounter) {
+	mWatchpointPagesCheckWrite(cpu->watchpointPages, address, value, 4);
+
 	struct GBA* gba = (struct GBA*) cpu->master;
 	struct GBAMemory* memory = &gba->memory;
 	int wait = 0;
@@ -867,6 +890,8 @@ void GBAStore32(struct ARMCore* cpu, uint32_t address, int32_t value, int* cycle
 }
 
 void GBAStore16(struct ARMCore* cpu, uint32_t address, int16_t value, int* cycleCounter) {
+	mWatchpointPagesCheckWrite(cpu->watchpointPages, address, (uint16_t) value, 2);
+
 	struct GBA* gba = (struct GBA*) cpu->master;
 	struct GBAMemory* memory = &gba->memory;
 	int wait = 0;
@@ -1009,6 +1034,8 @@ void GBAStore16(struct ARMCore* cpu, uint32_t address, int16_t value, int* cycle
 }
 
 void GBAStore8(struct ARMCore* cpu, uint32_t address, int8_t value, int* cycleCounter) {
+	mWatchpointPagesCheckWrite(cpu->watchpointPages, address, (uint8_t) value, 1);
+
 	struct GBA* gba = (struct GBA*) cpu->master;
 	struct GBAMemory* memory = &gba->memory;
 	int wait = 0;
@@ -1115,7 +1142,7 @@ uint32_t GBAView32(struct ARMCore* cpu, uint32_t address) {
 	case GBA_REGION_ROM1_EX:
 	case GBA_REGION_ROM2:
 	case GBA_REGION_ROM2_EX:
-		value = GBALoad32(cpu, address, 0);
+		value = _GBALoad32(cpu, address, 0);
 		break;
 	case GBA_REGION_IO:
 		if ((address & OFFSET_MASK) < GBA_REG_MAX) {
@@ -1124,10 +1151,10 @@ uint32_t GBAView32(struct ARMCore* cpu, uint32_t address) {
 		}
 		break;
 	case GBA_REGION_SRAM:
-		value = GBALoad8(cpu, address, 0);
-		value |= GBALoad8(cpu, address + 1, 0) << 8;
-		value |= GBALoad8(cpu, address + 2, 0) << 16;
-		value |= GBALoad8(cpu, address + 3, 0) << 24;
+		value = _GBALoad8(cpu, address, 0);
+		value |= _GBALoad8(cpu, address + 1, 0) << 8;
+		value |= _GBALoad8(cpu, address + 2, 0) << 16;
+		value |= _GBALoad8(cpu, address + 3, 0) << 24;
 		break;
 	default:
 		break;
@@ -1156,7 +1183,7 @@ uint16_t GBAView16(struct ARMCore* cpu, uint32_t address) {
 	case GBA_REGION_ROM1_EX:
 	case GBA_REGION_ROM2:
 	case GBA_REGION_ROM2_EX:
-		value = GBALoad16(cpu, address, 0);
+		value = _GBALoad16(cpu, address, 0);
 		break;
 	case GBA_REGION_IO:
 		if ((address & OFFSET_MASK) < GBA_REG_MAX) {
@@ -1164,8 +1191,8 @@ uint16_t GBAView16(struct ARMCore* cpu, uint32_t address) {
 		}
 		break;
 	case GBA_REGION_SRAM:
-		value = GBALoad8(cpu, address, 0);
-		value |= GBALoad8(cpu, address + 1, 0) << 8;
+		value = _GBALoad8(cpu, address, 0);
+		value |= _GBALoad8(cpu, address + 1, 0) << 8;
 		break;
 	default:
 		break;
@@ -1191,7 +1218,7 @@ uint8_t GBAView8(struct ARMCore* cpu, uint32_t address) {
 	case GBA_REGION_ROM2:
 	case GBA_REGION_ROM2_EX:
 	case GBA_REGION_SRAM:
-		value = GBALoad8(cpu, address, 0);
+		value = _GBALoad8(cpu, address, 0);
 		break;
 	case GBA_REGION_IO:
 	case GBA_REGION_PALETTE_RAM:
@@ -1232,13 +1259,11 @@ void GBAPatch32(struct ARMCore* cpu, uint32_t address, int32_t value, int32_t* o
 		if ((address & 0x0001FFFF) < GBA_SIZE_VRAM) {
 			LOAD_32(oldValue, address & 0x0001FFFC, gba->video.vram);
 			STORE_32(value, address & 0x0001FFFC, gba->video.vram);
-			gba->video.renderer->writeVRAM(gba->video.renderer, address & 0x0001FFFC);
-			gba->video.renderer->writeVRAM(gba->video.renderer, (address & 0x0001FFFC) | 2);
+			gba->video.renderer->writeVRAMRange(gba->video.renderer, address & 0x0001FFFC, 4);
 		} else {
 			LOAD_32(oldValue, address & 0x00017FFC, gba->video.vram);
 			STORE_32(value, address & 0x00017FFC, gba->video.vram);
-			gba->video.renderer->writeVRAM(gba->video.renderer, address & 0x00017FFC);
-			gba->video.renderer->writeVRAM(gba->video.renderer, (address & 0x00017FFC) | 2);
+			gba->video.renderer->writeVRAMRange(gba->video.renderer, address & 0x00017FFC, 4);
 		}
 		break;
 	case GBA_REGION_OAM:
@@ -1255,8 +1280,7 @@ void GBAPatch32(struct ARMCore* cpu, uint32_t address, int32_t value, int32_t* o
 	case GBA_REGION_ROM2_EX:
 		_pristineCow(gba);
 		if ((address & (GBA_SIZE_ROM0 - 4)) >= gba->memory.romSize) {
-			gba->memory.romSize = (address & (GBA_SIZE_ROM0 - 4)) + 4;
-			gba->memory.romMask = toPow2(gba->memory.romSize) - 1;
+			_growRom(gba, (address & (GBA_SIZE_ROM0 - 4)) + 4);
 		}
 		LOAD_32(oldValue, address & (GBA_SIZE_ROM0 - 4), gba->memory.rom);
 		STORE_32(value, address & (GBA_SIZE_ROM0 - 4), gba->memory.rom);
@@ -1325,8 +1349,7 @@ void GBAPatch16(struct ARMCore* cpu, uint32_t address, int16_t value, int16_t* o
 	case GBA_REGION_ROM2_EX:
 		_pristineCow(gba);
 		if ((address & (GBA_SIZE_ROM0 - 2)) >= gba->memory.romSize) {
-			gba->memory.romSize = (address & (GBA_SIZE_ROM0 - 2)) + 2;
-			gba->memory.romMask = toPow2(gba->memory.romSize) - 1;
+			_growRom(gba, (address & (GBA_SIZE_ROM0 - 2)) + 2);
 		}
 		LOAD_16(oldValue, address & (GBA_SIZE_ROM0 - 2), gba->memory.rom);
 		STORE_16(value, address & (GBA_SIZE_ROM0 - 2), gba->memory.rom);
@@ -1383,8 +1406,7 @@ void GBAPatch8(struct ARMCore* cpu, uint32_t address, int8_t value, int8_t* old)
 	case GBA_REGION_ROM2_EX:
 		_pristineCow(gba);
 		if ((address & (GBA_SIZE_ROM0 - 1)) >= gba->memory.romSize) {
-			gba->memory.romSize = (address & (GBA_SIZE_ROM0 - 2)) + 2;
-			gba->memory.romMask = toPow2(gba->memory.romSize) - 1;
+			_growRom(gba, (address & (GBA_SIZE_ROM0 - 2)) + 2);
 		}
 		oldValue = ((int8_t*) memory->rom)[address & (GBA_SIZE_ROM0 - 1)];
 		((int8_t*) memory->rom)[address & (GBA_SIZE_ROM0 - 1)] = value;
@@ -1407,6 +1429,34 @@ void GBAPatch8(struct ARMCore* cpu, uint32_t address, int8_t value, int8_t* old)
 	}
 }
 
+static void _checkWatchpointsMultiple(struct ARMCore* cpu, uint32_t address, int mask, bool store) {
+	if (!mask) {
+		uint32_t value = cpu->gprs[ARM_PC] + (cpu->executionMode == MODE_ARM ? WORD_SIZE_ARM : WORD_SIZE_THUMB);
+		if (store) {
+			mWatchpointPagesCheckWrite(cpu->watchpointPages, address, value, 4);
+		} else {
+			mWatchpointPagesCheckRead(cpu->watchpointPages, address, 4);
+		}
+		return;
+	}
+	int i;
+	for (i = 0; i < 16; ++i) {
+		if (!(mask & (1 << i))) {
+			continue;
+		}
+		if (store) {
+			uint32_t value = cpu->gprs[i];
+			if (i == ARM_PC) {
+				value += WORD_SIZE_ARM;
+			}
+			mWatchpointPagesCheckWrite(cpu->watchpointPages, address, value, 4);
+		} else {
+			mWatchpointPagesCheckRead(cpu->watchpointPages, address, 4);
+		}
+		address += 4;
+	}
+}
+
 #define LDM_LOOP(LDM) \
 	if (UNLIKELY(!mask)) { \
 		LDM; \
@@ -1460,6 +1510,10 @@ uint32_t GBALoadMultiple(struct ARMCore* cpu, uint32_t address, int mask, enum L
 		address += offset;
 	}
 
+	if (UNLIKELY(cpu->watchpointPages)) {
+		_checkWatchpointsMultiple(cpu, address, mask, false);
+	}
+
 	uint32_t addressMisalign = address & 0x3;
 	int region = address >> BASE_OFFSET;
 	if (region < GBA_REGION_SRAM) {
@@ -1582,6 +1636,10 @@ uint32_t GBAStoreMultiple(struct ARMCore* cpu, uint32_t address, int mask, enum
 		address += offset;
 	}
 
+	if (UNLIKELY(cpu->watchpointPages)) {
+		_checkWatchpointsMultiple(cpu, address, mask, true);
+	}
+
 	uint32_t addressMisalign = address & 0x3;
 	int region = address >> BASE_OFFSET;
 	if (region < GBA_REGION_SRAM) {
@@ -1678,6 +1736,22 @@ void GBAAdjustWaitstates(struct GBA* gba, uint16_t parameters) {
 
 	memory->prefetch = prefetch;
 
+	if (gba->accuracy >= mCORE_ACCURACY_RELAXED) {
+		// Fold prefetch into flat sequential costs instead of tracking the buffer in GBAMemoryStall
+		int i;
+		for (i = GBA_REGION_ROM0; i <= GBA_REGION_ROM2_EX; ++i) {
+			if (prefetch) {
+				memory->waitstatesSeq16[i] = 0;
+				memory->waitstatesSeq32[i] = 1;
+			}
+			if (gba->accuracy >= mCORE_ACCURACY_FAST) {
+				memory->waitstatesNonseq16[i] = memory->waitstatesSeq16[i];
+				memory->waitstatesNonseq32[i] = memory->waitstatesSeq32[i];
+			}
+		}
+		memory->prefetch = false;
+	}
+
 	cpu->memory.activeSeqCycles32 = memory->waitstatesSeq32[memory->activeRegion];
 	cpu->memory.activeSeqCycles16 = memory->waitstatesSeq16[memory->activeRegion];
 
@@ -1808,6 +1882,14 @@ void GBAMemoryDeserialize(struct GBAMemory* memory, const struct GBASerializedSt
 	memcpy(memory->iwram, state->iwram, GBA_SIZE_IWRAM);
 }
 
+// Space past the end of the ROM is only filled in when a patch reaches it,
+// so the unused remainder of the mapping is never touched
+static void _growRom(struct GBA* gba, uint32_t size) {
+	memset(&((uint8_t*) gba->memory.rom)[gba->memory.romSize], 0xFF, size - gba->memory.romSize);
+	gba->memory.romSize = size;
+	gba->memory.romMask = toPow2(size) - 1;
+}
+
 void _pristineCow(struct GBA* gba) {
 	if (!gba->isPristine) {
 		return;
@@ -1815,7 +1897,6 @@ void _pristineCow(struct GBA* gba) {
 #if !defined(FIXED_ROM_BUFFER) && !defined(__wii__)
 	void* newRom = anonymousMemoryMap(GBA_SIZE_ROM0);
 	memcpy(newRom, gba->memory.rom, gba->memory.romSize);
-	memset(((uint8_t*) newRom) + gba->memory.romSize, 0xFF, GBA_SIZE_ROM0 - gba->memory.romSize);
 	if (gba->cpu->memory.activeRegion == gba->memory.rom) {
 		gba->cpu->memory.activeRegion = newRom;
 	}
@@ -17,6 +17,7 @@ static void GBAVideoGLRendererInit(struct GBAVideoRenderer* renderer);
 static void GBAVideoGLRendererDeinit(struct GBAVideoRenderer* renderer);
 static void GBAVideoGLRendererReset(struct GBAVideoRenderer* renderer);
 static void GBAVideoGLRendererWriteVRAM(struct GBAVideoRenderer* renderer, uint32_t address);
+static void GBAVideoGLRendererWriteVRAMRange(struct GBAVideoRenderer* renderer, uint32_t address, uint32_t size);
 static void GBAVideoGLRendererWriteOAM(struct GBAVideoRenderer* renderer, uint32_t oam);
 static void GBAVideoGLRendererWritePalette(struct GBAVideoRenderer* renderer, uint32_t address, uint16_t value);
 static uint16_t GBAVideoGLRendererWriteVideoRegister(struct GBAVideoRenderer* renderer, uint32_t address, uint16_t value);
@@ -650,6 +651,7 @@ void GBAVideoGLRendererCreate(struct GBAVideoGLRenderer* renderer) {
 	renderer->d.deinit = GBAVideoGLRendererDeinit;
 	renderer->d.writeVideoRegister = GBAVideoGLRendererWriteVideoRegister;
 	renderer->d.writeVRAM = GBAVideoGLRendererWriteVRAM;
+	renderer->d.writeVRAMRange = GBAVideoGLRendererWriteVRAMRange;
 	renderer->d.writeOAM = GBAVideoGLRendererWriteOAM;
 	renderer->d.writePalette = GBAVideoGLRendererWritePalette;
 	renderer->d.drawScanline = GBAVideoGLRendererDrawScanline;
@@ -950,6 +952,20 @@ void GBAVideoGLRendererWriteVRAM(struct GBAVideoRenderer* renderer, uint32_t add
 	glRenderer->vramDirty |= 1 << (address >> 12);
 }
 
+void GBAVideoGLRendererWriteVRAMRange(struct GBAVideoRenderer* renderer, uint32_t address, uint32_t size) {
+	struct GBAVideoGLRenderer* glRenderer = (struct GBAVideoGLRenderer*) renderer;
+	if (!size) {
+		return;
+	}
+	if (renderer->cache) {
+		mCacheSetWriteVRAMRange(renderer->cache, address, size);
+	}
+	uint32_t block;
+	for (block = address >> 12; block <= (address + size - 1) >> 12; ++block) {
+		glRenderer->vramDirty |= 1 << block;
+	}
+}
+
 void GBAVideoGLRendererWriteOAM(struct GBAVideoRenderer* renderer, uint32_t oam) {
 	UNUSED(oam);
 	struct GBAVideoGLRenderer* glRenderer = (struct GBAVideoGLRenderer*) renderer;
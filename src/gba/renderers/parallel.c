@@ -0,0 +1,409 @@
+/* Copyright (c) 2013-2024 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include <mgba/internal/gba/renderers/parallel.h>
+
+#include <mgba/core/cache-set.h>
+#include <mgba/internal/gba/memory.h>
+#include <mgba/internal/gba/renderers/cache-set.h>
+#include <mgba-util/memory.h>
+
+#ifndef DISABLE_THREADING
+
+#define VRAM_BLOCK_SIZE 0x1000
+
+DEFINE_VECTOR(GBAVideoParallelDeltaList, struct GBAVideoParallelDelta);
+DEFINE_VECTOR(GBAVideoParallelBlockList, uint16_t);
+
+static void GBAVideoParallelRendererInit(struct GBAVideoRenderer* renderer);
+static void GBAVideoParallelRendererDeinit(struct GBAVideoRenderer* renderer);
+static void GBAVideoParallelRendererReset(struct GBAVideoRenderer* renderer);
+static uint16_t GBAVideoParallelRendererWriteVideoRegister(struct GBAVideoRenderer* renderer, uint32_t address, uint16_t value);
+static void GBAVideoParallelRendererWriteVRAM(struct GBAVideoRenderer* renderer, uint32_t address);
+static void GBAVideoParallelRendererWriteVRAMRange(struct GBAVideoRenderer* renderer, uint32_t address, uint32_t size);
+static void GBAVideoParallelRendererWritePalette(struct GBAVideoRenderer* renderer, uint32_t address, uint16_t value);
+static void GBAVideoParallelRendererWriteOAM(struct GBAVideoRenderer* renderer, uint32_t oam);
+static void GBAVideoParallelRendererDrawScanline(struct GBAVideoRenderer* renderer, int y);
+static void GBAVideoParallelRendererFinishFrame(struct GBAVideoRenderer* renderer);
+static void GBAVideoParallelRendererGetPixels(struct GBAVideoRenderer* renderer, size_t* stride, const void** pixels);
+static void GBAVideoParallelRendererPutPixels(struct GBAVideoRenderer* renderer, size_t stride, const void* pixels);
+
+static THREAD_ENTRY _bandThread(void* context);
+
+void GBAVideoParallelRendererCreate(struct GBAVideoParallelRenderer* renderer, struct GBAVideoSoftwareRenderer* primary, int bands) {
+	renderer->d.init = GBAVideoParallelRendererInit;
+	renderer->d.reset = GBAVideoParallelRendererReset;
+	renderer->d.deinit = GBAVideoParallelRendererDeinit;
+	renderer->d.writeVideoRegister = GBAVideoParallelRendererWriteVideoRegister;
+	renderer->d.writeVRAM = GBAVideoParallelRendererWriteVRAM;
+	renderer->d.writeVRAMRange = GBAVideoParallelRendererWriteVRAMRange;
+	renderer->d.writeOAM = GBAVideoParallelRendererWriteOAM;
+	renderer->d.writePalette = GBAVideoParallelRendererWritePalette;
+	renderer->d.drawScanline = GBAVideoParallelRendererDrawScanline;
+	renderer->d.finishFrame = GBAVideoParallelRendererFinishFrame;
+	renderer->d.getPixels = GBAVideoParallelRendererGetPixels;
+	renderer->d.putPixels = GBAVideoParallelRendererPutPixels;
+
+	renderer->d.disableBG[0] = false;
+	renderer->d.disableBG[1] = false;
+	renderer->d.disableBG[2] = false;
+	renderer->d.disableBG[3] = false;
+	renderer->d.disableOBJ = false;
+	renderer->d.disableWIN[0] = false;
+	renderer->d.disableWIN[1] = false;
+	renderer->d.disableOBJWIN = false;
+
+	renderer->d.highlightBG[0] = false;
+	renderer->d.highlightBG[1] = false;
+	renderer->d.highlightBG[2] = false;
+	renderer->d.highlightBG[3] = false;
+	int i;
+	for (i = 0; i < 128; ++i) {
+		renderer->d.highlightOBJ[i] = false;
+	}
+	renderer->d.highlightColor = M_COLOR_WHITE;
+	renderer->d.highlightAmount = 0;
+
+	renderer->primary = primary;
+	renderer->requestedBands = bands;
+}
+
+static void _syncMemory(struct GBAVideoParallelRenderer* parallelRenderer, struct GBAVideoParallelBand* band) {
+	memcpy(band->vram, parallelRenderer->d.vram, GBA_SIZE_VRAM);
+	memcpy(band->palette, parallelRenderer->d.palette, GBA_SIZE_PALETTE_RAM);
+	memcpy(band->oam.raw, parallelRenderer->d.oam->raw, GBA_SIZE_OAM);
+}
+
+static void _resetPrimary(struct GBAVideoParallelRenderer* parallelRenderer) {
+	// The primary renderer never draws, but it holds state that the core
+	// adjusts directly and that would otherwise be cleared on reset
+	struct GBAVideoSoftwareRenderer* primary = parallelRenderer->primary;
+	primary->d.palette = parallelRenderer->d.palette;
+	primary->d.vram = parallelRenderer->d.vram;
+	primary->d.oam = parallelRenderer->d.oam;
+	primary->d.cache = NULL;
+	primary->d.reset(&primary->d);
+}
+
+static void _copyExtraState(struct GBAVideoParallelRenderer* parallelRenderer, struct GBAVideoParallelBand* band) {
+	struct GBAVideoSoftwareRenderer* primary = parallelRenderer->primary;
+	struct GBAVideoSoftwareRenderer* backend = &band->renderer;
+	backend->d.disableBG[0] = parallelRenderer->d.disableBG[0];
+	backend->d.disableBG[1] = parallelRenderer->d.disableBG[1];
+	backend->d.disableBG[2] = parallelRenderer->d.disableBG[2];
+	backend->d.disableBG[3] = parallelRenderer->d.disableBG[3];
+	backend->d.disableOBJ = parallelRenderer->d.disableOBJ;
+	backend->d.disableWIN[0] = parallelRenderer->d.disableWIN[0];
+	backend->d.disableWIN[1] = parallelRenderer->d.disableWIN[1];
+	backend->d.disableOBJWIN = parallelRenderer->d.disableOBJWIN;
+	backend->d.highlightBG[0] = parallelRenderer->d.highlightBG[0];
+	backend->d.highlightBG[1] = parallelRenderer->d.highlightBG[1];
+	backend->d.highlightBG[2] = parallelRenderer->d.highlightBG[2];
+	backend->d.highlightBG[3] = parallelRenderer->d.highlightBG[3];
+	memcpy(backend->d.highlightOBJ, parallelRenderer->d.highlightOBJ, sizeof(backend->d.highlightOBJ));
+	backend->d.highlightAmount = parallelRenderer->d.highlightAmount;
+	backend->d.highlightColor = parallelRenderer->d.highlightColor;
+
+	// The core adjusts the primary renderer directly, so pick up any changes it made
+	backend->outputBuffer = primary->outputBuffer;
+	backend->outputBufferStride = primary->outputBufferStride;
+	int i;
+	for (i = 0; i < 4; ++i) {
+		backend->bg[i].offsetX = primary->bg[i].offsetX;
+		backend->bg[i].offsetY = primary->bg[i].offsetY;
+	}
+	backend->winN[0].offsetX = primary->winN[0].offsetX;
+	backend->winN[0].offsetY = primary->winN[0].offsetY;
+	backend->winN[1].offsetX = primary->winN[1].offsetX;
+	backend->winN[1].offsetY = primary->winN[1].offsetY;
+	backend->objOffsetX = primary->objOffsetX;
+	backend->objOffsetY = primary->objOffsetY;
+	backend->layerOutput = primary->layerOutput;
+	if (primary->oamDirty) {
+		backend->oamDirty = true;
+	}
+	for (i = 0; i < 5; ++i) {
+		backend->scanlineDirty[i] |= primary->scanlineDirty[i];
+	}
+}
+
+static void _replay(struct GBAVideoParallelBand* band) {
+	struct GBAVideoParallelDeltaList* deltas = &band->p->deltas;
+	struct GBAVideoRenderer* backend = &band->renderer.d;
+	const uint16_t* block = band->p->blocks.vector;
+	size_t i;
+	for (i = 0; i < GBAVideoParallelDeltaListSize(deltas); ++i) {
+		const struct GBAVideoParallelDelta* delta = GBAVideoParallelDeltaListGetPointer(deltas, i);
+		switch (delta->type) {
+		case PARALLEL_DELTA_REGISTER:
+			backend->writeVideoRegister(backend, delta->address, delta->value);
+			break;
+		case PARALLEL_DELTA_VRAM:
+			band->vram[delta->address >> 1] = delta->value;
+			backend->writeVRAM(backend, delta->address);
+			break;
+		case PARALLEL_DELTA_VRAM_BLOCK:
+			memcpy(&band->vram[delta->address >> 1], block, VRAM_BLOCK_SIZE);
+			block += VRAM_BLOCK_SIZE >> 1;
+			backend->writeVRAMRange(backend, delta->address, VRAM_BLOCK_SIZE);
+			break;
+		case PARALLEL_DELTA_PALETTE:
+			STORE_16LE(delta->value, delta->address, band->palette);
+			backend->writePalette(backend, delta->address, delta->value);
+			break;
+		case PARALLEL_DELTA_OAM:
+			band->oam.raw[delta->address] = delta->value;
+			backend->writeOAM(backend, delta->address);
+			break;
+		case PARALLEL_DELTA_SCANLINE:
+			backend->drawScanline(backend, delta->address);
+			break;
+		case PARALLEL_DELTA_FRAME:
+			backend->finishFrame(backend);
+			break;
+		}
+	}
+}
+
+static void _flush(struct GBAVideoParallelRenderer* parallelRenderer) {
+	if (!GBAVideoParallelDeltaListSize(&parallelRenderer->deltas)) {
+		return;
+	}
+	int i;
+	for (i = 0; i < parallelRenderer->nBands; ++i) {
+		_copyExtraState(parallelRenderer, &parallelRenderer->bands[i]);
+	}
+	memset(parallelRenderer->primary->scanlineDirty, 0, sizeof(parallelRenderer->primary->scanlineDirty));
+	parallelRenderer->primary->oamDirty = false;
+
+	MutexLock(&parallelRenderer->mutex);
+	parallelRenderer->pending = parallelRenderer->nBands - 1;
+	++parallelRenderer->generation;
+	ConditionWake(&parallelRenderer->toThreadCond);
+	MutexUnlock(&parallelRenderer->mutex);
+
+	// The first band is rendered on the calling thread
+	_replay(&parallelRenderer->bands[0]);
+
+	MutexLock(&parallelRenderer->mutex);
+	while (parallelRenderer->pending) {
+		ConditionWait(&parallelRenderer->fromThreadCond, &parallelRenderer->mutex);
+	}
+	MutexUnlock(&parallelRenderer->mutex);
+
+	GBAVideoParallelDeltaListClear(&parallelRenderer->deltas);
+	GBAVideoParallelBlockListClear(&parallelRenderer->blocks);
+}
+
+static void _appendDelta(struct GBAVideoParallelRenderer* parallelRenderer, enum GBAVideoParallelDeltaType type, uint32_t address, uint16_t value) {
+	struct GBAVideoParallelDelta* delta = GBAVideoParallelDeltaListAppend(&parallelRenderer->deltas);
+	delta->type = type;
+	delta->address = address;
+	delta->value = value;
+}
+
+static void GBAVideoParallelRendererInit(struct GBAVideoRenderer* renderer) {
+	struct GBAVideoParallelRenderer* parallelRenderer = (struct GBAVideoParallelRenderer*) renderer;
+
+	int nBands = parallelRenderer->requestedBands;
+	if (nBands < 1) {
+		nBands = 1;
+	} else if (nBands > GBA_VIDEO_PARALLEL_MAX_BANDS) {
+		nBands = GBA_VIDEO_PARALLEL_MAX_BANDS;
+	}
+	parallelRenderer->nBands = nBands;
+	parallelRenderer->bands = calloc(nBands, sizeof(*parallelRenderer->bands));
+	GBAVideoParallelDeltaListInit(&parallelRenderer->deltas, 0x1000);
+	GBAVideoParallelBlockListInit(&parallelRenderer->blocks, 0);
+
+	MutexInit(&parallelRenderer->mutex);
+	ConditionInit(&parallelRenderer->toThreadCond);
+	ConditionInit(&parallelRenderer->fromThreadCond);
+	parallelRenderer->generation = 0;
+	parallelRenderer->pending = 0;
+	parallelRenderer->stopping = false;
+	_resetPrimary(parallelRenderer);
+
+	int i;
+	for (i = 0; i < nBands; ++i) {
+		struct GBAVideoParallelBand* band = &parallelRenderer->bands[i];
+		band->p = parallelRenderer;
+		band->vram = anonymousMemoryMap(GBA_SIZE_VRAM);
+		band->generation = 0;
+		_syncMemory(parallelRenderer, band);
+
+		GBAVideoSoftwareRendererCreate(&band->renderer);
+		band->renderer.d.vram = band->vram;
+		band->renderer.d.palette = band->palette;
+		band->renderer.d.oam = &band->oam;
+		band->renderer.d.cache = NULL;
+		band->renderer.outputBuffer = parallelRenderer->primary->outputBuffer;
+		band->renderer.outputBufferStride = parallelRenderer->primary->outputBufferStride;
+		band->renderer.bandStart = GBA_VIDEO_VERTICAL_PIXELS * i / nBands;
+		band->renderer.bandEnd = GBA_VIDEO_VERTICAL_PIXELS * (i + 1) / nBands;
+		band->renderer.d.init(&band->renderer.d);
+		if (i) {
+			ThreadCreate(&band->thread, _bandThread, band);
+		}
+	}
+}
+
+static void GBAVideoParallelRendererReset(struct GBAVideoRenderer* renderer) {
+	struct GBAVideoParallelRenderer* parallelRenderer = (struct GBAVideoParallelRenderer*) renderer;
+	_flush(parallelRenderer);
+	_resetPrimary(parallelRenderer);
+
+	int i;
+	for (i = 0; i < parallelRenderer->nBands; ++i) {
+		struct GBAVideoParallelBand* band = &parallelRenderer->bands[i];
+		_syncMemory(parallelRenderer, band);
+		band->renderer.d.reset(&band->renderer.d);
+	}
+}
+
+static void GBAVideoParallelRendererDeinit(struct GBAVideoRenderer* renderer) {
+	struct GBAVideoParallelRenderer* parallelRenderer = (struct GBAVideoParallelRenderer*) renderer;
+
+	MutexLock(&parallelRenderer->mutex);
+	parallelRenderer->stopping = true;
+	ConditionWake(&parallelRenderer->toThreadCond);
+	MutexUnlock(&parallelRenderer->mutex);
+
+	int i;
+	for (i = 0; i < parallelRenderer->nBands; ++i) {
+		struct GBAVideoParallelBand* band = &parallelRenderer->bands[i];
+		if (i) {
+			ThreadJoin(&band->thread);
+		}
+		band->renderer.d.deinit(&band->renderer.d);
+		mappedMemoryFree(band->vram, GBA_SIZE_VRAM);
+	}
+	free(parallelRenderer->bands);
+	parallelRenderer->bands = NULL;
+	parallelRenderer->nBands = 0;
+
+	GBAVideoParallelDeltaListDeinit(&parallelRenderer->deltas);
+	GBAVideoParallelBlockListDeinit(&parallelRenderer->blocks);
+	ConditionDeinit(&parallelRenderer->toThreadCond);
+	ConditionDeinit(&parallelRenderer->fromThreadCond);
+	MutexDeinit(&parallelRenderer->mutex);
+}
+
+static uint16_t GBAVideoParallelRendererWriteVideoRegister(struct GBAVideoRenderer* renderer, uint32_t address, uint16_t value) {
+	struct GBAVideoParallelRenderer* parallelRenderer = (struct GBAVideoParallelRenderer*) renderer;
+	value = GBAVideoSoftwareRendererMaskVideoRegister(address, value);
+	if (address > GBA_REG_BLDY) {
+		return value;
+	}
+	if (renderer->cache) {
+		GBAVideoCacheWriteVideoRegister(renderer->cache, address, value);
+	}
+	_appendDelta(parallelRenderer, PARALLEL_DELTA_REGISTER, address, value);
+	return value;
+}
+
+static void GBAVideoParallelRendererWriteVRAM(struct GBAVideoRenderer* renderer, uint32_t address) {
+	struct GBAVideoParallelRenderer* parallelRenderer = (struct GBAVideoParallelRenderer*) renderer;
+	_appendDelta(parallelRenderer, PARALLEL_DELTA_VRAM, address, renderer->vram[address >> 1]);
+	if (renderer->cache) {
+		mCacheSetWriteVRAM(renderer->cache, address);
+	}
+}
+
+static void GBAVideoParallelRendererWriteVRAMRange(struct GBAVideoRenderer* renderer, uint32_t address, uint32_t size) {
+	struct GBAVideoParallelRenderer* parallelRenderer = (struct GBAVideoParallelRenderer*) renderer;
+	if (renderer->cache) {
+		mCacheSetWriteVRAMRange(renderer->cache, address, size);
+	}
+	uint32_t end = address + size;
+	address &= ~1;
+	while (address < end) {
+		if (!(address & (VRAM_BLOCK_SIZE - 1)) && end - address >= VRAM_BLOCK_SIZE && address <= GBA_SIZE_VRAM - VRAM_BLOCK_SIZE) {
+			size_t blocks = GBAVideoParallelBlockListSize(&parallelRenderer->blocks);
+			GBAVideoParallelBlockListResize(&parallelRenderer->blocks, VRAM_BLOCK_SIZE >> 1);
+			memcpy(GBAVideoParallelBlockListGetPointer(&parallelRenderer->blocks, blocks), &renderer->vram[address >> 1], VRAM_BLOCK_SIZE);
+			_appendDelta(parallelRenderer, PARALLEL_DELTA_VRAM_BLOCK, address, 0);
+			address += VRAM_BLOCK_SIZE;
+		} else {
+			_appendDelta(parallelRenderer, PARALLEL_DELTA_VRAM, address, renderer->vram[address >> 1]);
+			address += 2;
+		}
+	}
+}
+
+static void GBAVideoParallelRendererWritePalette(struct GBAVideoRenderer* renderer, uint32_t address, uint16_t value) {
+	struct GBAVideoParallelRenderer* parallelRenderer = (struct GBAVideoParallelRenderer*) renderer;
+	_appendDelta(parallelRenderer, PARALLEL_DELTA_PALETTE, address, value);
+	if (renderer->cache) {
+		mCacheSetWritePalette(renderer->cache, address >> 1, mColorFrom555(value));
+	}
+}
+
+static void GBAVideoParallelRendererWriteOAM(struct GBAVideoRenderer* renderer, uint32_t oam) {
+	struct GBAVideoParallelRenderer* parallelRenderer = (struct GBAVideoParallelRenderer*) renderer;
+	_appendDelta(parallelRenderer, PARALLEL_DELTA_OAM, oam, renderer->oam->raw[oam]);
+}
+
+static void GBAVideoParallelRendererDrawScanline(struct GBAVideoRenderer* renderer, int y) {
+	struct GBAVideoParallelRenderer* parallelRenderer = (struct GBAVideoParallelRenderer*) renderer;
+	_appendDelta(parallelRenderer, PARALLEL_DELTA_SCANLINE, y, 0);
+}
+
+static void GBAVideoParallelRendererFinishFrame(struct GBAVideoRenderer* renderer) {
+	struct GBAVideoParallelRenderer* parallelRenderer = (struct GBAVideoParallelRenderer*) renderer;
+	_appendDelta(parallelRenderer, PARALLEL_DELTA_FRAME, 0, 0);
+	_flush(parallelRenderer);
+
+	// Pixels put through the primary renderer land in the shared output buffer too
+	renderer->repeatFrame = !parallelRenderer->primary->outputDirty;
+	parallelRenderer->primary->outputDirty = false;
+	int i;
+	for (i = 0; i < parallelRenderer->nBands; ++i) {
+		if (!parallelRenderer->bands[i].renderer.d.repeatFrame) {
+			renderer->repeatFrame = false;
+		}
+	}
+}
+
+static void GBAVideoParallelRendererGetPixels(struct GBAVideoRenderer* renderer, size_t* stride, const void** pixels) {
+	struct GBAVideoParallelRenderer* parallelRenderer = (struct GBAVideoParallelRenderer*) renderer;
+	_flush(parallelRenderer);
+	parallelRenderer->primary->d.getPixels(&parallelRenderer->primary->d, stride, pixels);
+}
+
+static void GBAVideoParallelRendererPutPixels(struct GBAVideoRenderer* renderer, size_t stride, const void* pixels) {
+	struct GBAVideoParallelRenderer* parallelRenderer = (struct GBAVideoParallelRenderer*) renderer;
+	_flush(parallelRenderer);
+	parallelRenderer->primary->d.putPixels(&parallelRenderer->primary->d, stride, pixels);
+}
+
+static THREAD_ENTRY _bandThread(void* context) {
+	struct GBAVideoParallelBand* band = context;
+	struct GBAVideoParallelRenderer* parallelRenderer = band->p;
+	ThreadSetName("Band Rendering");
+
+	MutexLock(&parallelRenderer->mutex);
+	while (true) {
+		while (!parallelRenderer->stopping && band->generation == parallelRenderer->generation) {
+			ConditionWait(&parallelRenderer->toThreadCond, &parallelRenderer->mutex);
+		}
+		if (parallelRenderer->stopping) {
+			break;
+		}
+		band->generation = parallelRenderer->generation;
+		MutexUnlock(&parallelRenderer->mutex);
+
+		_replay(band);
+
+		MutexLock(&parallelRenderer->mutex);
+		--parallelRenderer->pending;
+		ConditionWake(&parallelRenderer->fromThreadCond);
+	}
+	MutexUnlock(&parallelRenderer->mutex);
+
+	THREAD_EXIT(0);
+}
+
+#endif
@@ -19,6 +19,7 @@ static void GBAVideoSoftwareRendererInit(struct GBAVideoRenderer* renderer);
 static void GBAVideoSoftwareRendererDeinit(struct GBAVideoRenderer* renderer);
 static void GBAVideoSoftwareRendererReset(struct GBAVideoRenderer* renderer);
 static void GBAVideoSoftwareRendererWriteVRAM(struct GBAVideoRenderer* renderer, uint32_t address);
+static void GBAVideoSoftwareRendererWriteVRAMRange(struct GBAVideoRenderer* renderer, uint32_t address, uint32_t size);
 static void GBAVideoSoftwareRendererWriteOAM(struct GBAVideoRenderer* renderer, uint32_t oam);
 static void GBAVideoSoftwareRendererWritePalette(struct GBAVideoRenderer* renderer, uint32_t address, uint16_t value);
 static uint16_t GBAVideoSoftwareRendererWriteVideoRegister(struct GBAVideoRenderer* renderer, uint32_t address, uint16_t value);
@@ -40,17 +41,29 @@ static void GBAVideoSoftwareRendererPostprocessBuffer(struct GBAVideoSoftwareRen
 static int GBAVideoSoftwareRendererPreprocessSpriteLayer(struct GBAVideoSoftwareRenderer* renderer, int y);
 
 static void _updatePalettes(struct GBAVideoSoftwareRenderer* renderer);
+static void _invalidateVRAM(struct GBAVideoSoftwareRenderer* renderer, uint32_t address, uint32_t size);
+static void _referenceVRAM(struct GBAVideoSoftwareRenderer* renderer, int y, uint32_t start, uint32_t end);
+static void _referenceBackgrounds(struct GBAVideoSoftwareRenderer* renderer, int y);
+static void _referenceSprite(struct GBAVideoSoftwareRenderer* renderer, int y, const struct GBAObj* sprite);
 static void _updateFlags(struct GBAVideoSoftwareRenderer* renderer, struct GBAVideoSoftwareBackground* bg);
 
 static void _breakWindow(struct GBAVideoSoftwareRenderer* softwareRenderer, struct WindowN* win, int y);
+static void _skipScanline(struct GBAVideoSoftwareRenderer* softwareRenderer);
 static void _breakWindowInner(struct GBAVideoSoftwareRenderer* softwareRenderer, struct WindowN* win);
 
+#ifndef COLOR_16_BIT
+static void _drawLayerOutput(struct GBAVideoSoftwareRenderer* softwareRenderer, int y);
+static void _clearLayerOutput(struct GBAVideoSoftwareRenderer* softwareRenderer, int y);
+static void _tagObjPalette(struct GBAVideoSoftwareRenderer* renderer, const struct GBAVideoRendererSprite* sprite);
+#endif
+
 void GBAVideoSoftwareRendererCreate(struct GBAVideoSoftwareRenderer* renderer) {
 	renderer->d.init = GBAVideoSoftwareRendererInit;
 	renderer->d.reset = GBAVideoSoftwareRendererReset;
 	renderer->d.deinit = GBAVideoSoftwareRendererDeinit;
 	renderer->d.writeVideoRegister = GBAVideoSoftwareRendererWriteVideoRegister;
 	renderer->d.writeVRAM = GBAVideoSoftwareRendererWriteVRAM;
+	renderer->d.writeVRAMRange = GBAVideoSoftwareRendererWriteVRAMRange;
 	renderer->d.writeOAM = GBAVideoSoftwareRendererWriteOAM;
 	renderer->d.writePalette = GBAVideoSoftwareRendererWritePalette;
 	renderer->d.drawScanline = GBAVideoSoftwareRendererDrawScanline;
@@ -79,6 +92,9 @@ void GBAVideoSoftwareRendererCreate(struct GBAVideoSoftwareRenderer* renderer) {
 	renderer->d.highlightAmount = 0;
 
 	renderer->temporaryBuffer = 0;
+	renderer->bandStart = 0;
+	renderer->bandEnd = GBA_VIDEO_VERTICAL_PIXELS;
+	renderer->layerOutput = NULL;
 }
 
 static void GBAVideoSoftwareRendererInit(struct GBAVideoRenderer* renderer) {
@@ -134,8 +150,10 @@ static void GBAVideoSoftwareRendererReset(struct GBAVideoRenderer* renderer) {
 	softwareRenderer->objOffsetY = 0;
 
 	memset(softwareRenderer->scanlineDirty, 0xFFFFFFFF, sizeof(softwareRenderer->scanlineDirty));
+	memset(softwareRenderer->vramLines, 0, sizeof(softwareRenderer->vramLines));
 	memset(softwareRenderer->cache, 0, sizeof(softwareRenderer->cache));
 	memset(softwareRenderer->nextIo, 0, sizeof(softwareRenderer->nextIo));
+	softwareRenderer->outputDirty = true;
 
 	softwareRenderer->lastHighlightAmount = 0;
 
@@ -154,15 +172,54 @@ static void GBAVideoSoftwareRendererDeinit(struct GBAVideoRenderer* renderer) {
 	UNUSED(softwareRenderer);
 }
 
+uint16_t GBAVideoSoftwareRendererMaskVideoRegister(uint32_t address, uint16_t value) {
+	switch (address) {
+	case GBA_REG_DISPCNT:
+		value &= 0xFFF7;
+		break;
+	case GBA_REG_BG0CNT:
+	case GBA_REG_BG1CNT:
+		value &= 0xDFFF;
+		break;
+	case GBA_REG_BG0HOFS:
+	case GBA_REG_BG0VOFS:
+	case GBA_REG_BG1HOFS:
+	case GBA_REG_BG1VOFS:
+	case GBA_REG_BG2HOFS:
+	case GBA_REG_BG2VOFS:
+	case GBA_REG_BG3HOFS:
+	case GBA_REG_BG3VOFS:
+		value &= 0x01FF;
+		break;
+	case GBA_REG_BLDCNT:
+		value &= 0x3FFF;
+		break;
+	case GBA_REG_BLDALPHA:
+		value &= 0x1F1F;
+		break;
+	case GBA_REG_BLDY:
+		value &= 0x1F;
+		if (value > 0x10) {
+			value = 0x10;
+		}
+		break;
+	case GBA_REG_WININ:
+	case GBA_REG_WINOUT:
+		value &= 0x3F3F;
+		break;
+	}
+	return value;
+}
+
 static uint16_t GBAVideoSoftwareRendererWriteVideoRegister(struct GBAVideoRenderer* renderer, uint32_t address, uint16_t value) {
 	struct GBAVideoSoftwareRenderer* softwareRenderer = (struct GBAVideoSoftwareRenderer*) renderer;
 	if (renderer->cache) {
 		GBAVideoCacheWriteVideoRegister(renderer->cache, address, value);
 	}
+	value = GBAVideoSoftwareRendererMaskVideoRegister(address, value);
 
 	switch (address) {
 	case GBA_REG_DISPCNT:
-		value &= 0xFFF7;
 		softwareRenderer->dispcnt = value;
 		GBAVideoSoftwareRendererUpdateDISPCNT(softwareRenderer);
 		break;
@@ -170,51 +227,39 @@ static uint16_t GBAVideoSoftwareRendererWriteVideoRegister(struct GBAVideoRender
 		softwareRenderer->greenswap = value & 1;
 		break;
 	case GBA_REG_BG0CNT:
-		value &= 0xDFFF;
 		GBAVideoSoftwareRendererWriteBGCNT(softwareRenderer, &softwareRenderer->bg[0], value);
 		break;
 	case GBA_REG_BG1CNT:
-		value &= 0xDFFF;
 		GBAVideoSoftwareRendererWriteBGCNT(softwareRenderer, &softwareRenderer->bg[1], value);
 		break;
 	case GBA_REG_BG2CNT:
-		value &= 0xFFFF;
 		GBAVideoSoftwareRendererWriteBGCNT(softwareRenderer, &softwareRenderer->bg[2], value);
 		break;
 	case GBA_REG_BG3CNT:
-		value &= 0xFFFF;
 		GBAVideoSoftwareRendererWriteBGCNT(softwareRenderer, &softwareRenderer->bg[3], value);
 		break;
 	case GBA_REG_BG0HOFS:
-		value &= 0x01FF;
 		softwareRenderer->bg[0].x = value;
 		break;
 	case GBA_REG_BG0VOFS:
-		value &= 0x01FF;
 		softwareRenderer->bg[0].y = value;
 		break;
 	case GBA_REG_BG1HOFS:
-		value &= 0x01FF;
 		softwareRenderer->bg[1].x = value;
 		break;
 	case GBA_REG_BG1VOFS:
-		value &= 0x01FF;
 		softwareRenderer->bg[1].y = value;
 		break;
 	case GBA_REG_BG2HOFS:
-		value &= 0x01FF;
 		softwareRenderer->bg[2].x = value;
 		break;
 	case GBA_REG_BG2VOFS:
-		value &= 0x01FF;
 		softwareRenderer->bg[2].y = value;
 		break;
 	case GBA_REG_BG3HOFS:
-		value &= 0x01FF;
 		softwareRenderer->bg[3].x = value;
 		break;
 	case GBA_REG_BG3VOFS:
-		value &= 0x01FF;
 		softwareRenderer->bg[3].y = value;
 		break;
 	case GBA_REG_BG2PA:
@@ -291,7 +336,6 @@ static uint16_t GBAVideoSoftwareRendererWriteVideoRegister(struct GBAVideoRender
 		break;
 	case GBA_REG_BLDCNT:
 		GBAVideoSoftwareRendererWriteBLDCNT(softwareRenderer, value);
-		value &= 0x3FFF;
 		break;
 	case GBA_REG_BLDALPHA:
 		softwareRenderer->blda = value & 0x1F;
@@ -302,13 +346,8 @@ static uint16_t GBAVideoSoftwareRendererWriteVideoRegister(struct GBAVideoRender
 		if (softwareRenderer->bldb > 0x10) {
 			softwareRenderer->bldb = 0x10;
 		}
-		value &= 0x1F1F;
 		break;
 	case GBA_REG_BLDY:
-		value &= 0x1F;
-		if (value > 0x10) {
-			value = 0x10;
-		}
 		if (softwareRenderer->bldy != value) {
 			softwareRenderer->bldy = value;
 			softwareRenderer->blendDirty = true;
@@ -367,12 +406,10 @@ static uint16_t GBAVideoSoftwareRendererWriteVideoRegister(struct GBAVideoRender
 		}
 		break;
 	case GBA_REG_WININ:
-		value &= 0x3F3F;
 		softwareRenderer->winN[0].control.packed = value;
 		softwareRenderer->winN[1].control.packed = value >> 8;
 		break;
 	case GBA_REG_WINOUT:
-		value &= 0x3F3F;
 		softwareRenderer->winout.packed = value;
 		softwareRenderer->objwin.packed = value >> 8;
 		break;
@@ -395,11 +432,15 @@ static void GBAVideoSoftwareRendererWriteVRAM(struct GBAVideoRenderer* renderer,
 	if (renderer->cache) {
 		mCacheSetWriteVRAM(renderer->cache, address);
 	}
-	memset(softwareRenderer->scanlineDirty, 0xFFFFFFFF, sizeof(softwareRenderer->scanlineDirty));
-	softwareRenderer->bg[0].yCache = -1;
-	softwareRenderer->bg[1].yCache = -1;
-	softwareRenderer->bg[2].yCache = -1;
-	softwareRenderer->bg[3].yCache = -1;
+	_invalidateVRAM(softwareRenderer, address, 2);
+}
+
+static void GBAVideoSoftwareRendererWriteVRAMRange(struct GBAVideoRenderer* renderer, uint32_t address, uint32_t size) {
+	struct GBAVideoSoftwareRenderer* softwareRenderer = (struct GBAVideoSoftwareRenderer*) renderer;
+	if (renderer->cache) {
+		mCacheSetWriteVRAMRange(renderer->cache, address, size);
+	}
+	_invalidateVRAM(softwareRenderer, address, size);
 }
 
 static void GBAVideoSoftwareRendererWriteOAM(struct GBAVideoRenderer* renderer, uint32_t oam) {
@@ -566,6 +607,11 @@ static void GBAVideoSoftwareRendererDrawScanline(struct GBAVideoRenderer* render
 		softwareRenderer->nextY = y + 1;
 	}
 
+	if (y < softwareRenderer->bandStart || y >= softwareRenderer->bandEnd) {
+		_skipScanline(softwareRenderer);
+		return;
+	}
+
 	bool dirty = softwareRenderer->scanlineDirty[y >> 5] & (1U << (y & 0x1F));
 	if (memcmp(softwareRenderer->nextIo, softwareRenderer->cache[y].io, sizeof(softwareRenderer->nextIo))) {
 		memcpy(softwareRenderer->cache[y].io, softwareRenderer->nextIo, sizeof(softwareRenderer->nextIo));
@@ -585,8 +631,14 @@ static void GBAVideoSoftwareRendererDrawScanline(struct GBAVideoRenderer* render
 	softwareRenderer->cache[y].scale[1][0] = softwareRenderer->bg[3].sx;
 	softwareRenderer->cache[y].scale[1][1] = softwareRenderer->bg[3].sy;
 
+	if (softwareRenderer->layerOutput) {
+		// The layer output isn't cached, so every line has to be redrawn
+		dirty = true;
+	}
+
 	if (!dirty) {
-		if (GBARegisterDISPCNTGetMode(softwareRenderer->dispcnt) != 0) {
+		// A cached line has to leave the same state behind as redrawing it would
+		if (GBARegisterDISPCNTGetMode(softwareRenderer->dispcnt) != 0 && !GBARegisterDISPCNTIsForcedBlank(softwareRenderer->dispcnt)) {
 			if (softwareRenderer->bg[2].enabled == ENABLED_MAX) {
 				softwareRenderer->bg[2].sx += softwareRenderer->bg[2].dmx;
 				softwareRenderer->bg[2].sy += softwareRenderer->bg[2].dmy;
@@ -600,6 +652,11 @@ static void GBAVideoSoftwareRendererDrawScanline(struct GBAVideoRenderer* render
 	}
 
 	CLEAN_SCANLINE(softwareRenderer, y);
+	softwareRenderer->outputDirty = true;
+	int block;
+	for (block = 0; block < VRAM_REFERENCE_BLOCKS; ++block) {
+		softwareRenderer->vramLines[block][y >> 5] &= ~(1U << (y & 0x1F));
+	}
 
 	color_t* row = &softwareRenderer->outputBuffer[softwareRenderer->outputBufferStride * y];
 	if (GBARegisterDISPCNTIsForcedBlank(softwareRenderer->dispcnt)) {
@@ -607,9 +664,15 @@ static void GBAVideoSoftwareRendererDrawScanline(struct GBAVideoRenderer* render
 		for (x = 0; x < GBA_VIDEO_HORIZONTAL_PIXELS; ++x) {
 			row[x] = M_COLOR_WHITE;
 		}
+#ifndef COLOR_16_BIT
+		if (softwareRenderer->layerOutput) {
+			_clearLayerOutput(softwareRenderer, y);
+		}
+#endif
 		return;
 	}
 
+	_referenceBackgrounds(softwareRenderer, y);
 	GBAVideoSoftwareRendererPreprocessBuffer(softwareRenderer, y);
 	softwareRenderer->spriteCyclesRemaining = GBARegisterDISPCNTIsHblankIntervalFree(softwareRenderer->dispcnt) ? OBJ_HBLANK_FREE_LENGTH : OBJ_LENGTH;
 	int spriteLayers = GBAVideoSoftwareRendererPreprocessSpriteLayer(softwareRenderer, y);
@@ -667,6 +730,12 @@ static void GBAVideoSoftwareRendererDrawScanline(struct GBAVideoRenderer* render
 
 	GBAVideoSoftwareRendererPostprocessBuffer(softwareRenderer);
 
+#ifndef COLOR_16_BIT
+	if (softwareRenderer->layerOutput) {
+		_drawLayerOutput(softwareRenderer, y);
+	}
+#endif
+
 	if (GBARegisterDISPCNTGetMode(softwareRenderer->dispcnt) != 0) {
 		if (softwareRenderer->bg[2].enabled == ENABLED_MAX) {
 			softwareRenderer->bg[2].sx += softwareRenderer->bg[2].dmx;
@@ -722,6 +791,31 @@ static void GBAVideoSoftwareRendererDrawScanline(struct GBAVideoRenderer* render
 	}
 }
 
+static void _skipScanline(struct GBAVideoSoftwareRenderer* softwareRenderer) {
+	// Lines outside of this renderer's band are not drawn, but any state carried
+	// between scanlines still needs to advance as if they had been
+	if (GBARegisterDISPCNTIsForcedBlank(softwareRenderer->dispcnt)) {
+		return;
+	}
+	if (GBARegisterDISPCNTGetMode(softwareRenderer->dispcnt) != 0) {
+		if (softwareRenderer->bg[2].enabled == ENABLED_MAX) {
+			softwareRenderer->bg[2].sx += softwareRenderer->bg[2].dmx;
+			softwareRenderer->bg[2].sy += softwareRenderer->bg[2].dmy;
+		}
+		if (softwareRenderer->bg[3].enabled == ENABLED_MAX) {
+			softwareRenderer->bg[3].sx += softwareRenderer->bg[3].dmx;
+			softwareRenderer->bg[3].sy += softwareRenderer->bg[3].dmy;
+		}
+	}
+
+	int i;
+	for (i = 0; i < 4; ++i) {
+		if (softwareRenderer->bg[i].enabled != 0 && softwareRenderer->bg[i].enabled < ENABLED_MAX) {
+			++softwareRenderer->bg[i].enabled;
+		}
+	}
+}
+
 static void GBAVideoSoftwareRendererFinishFrame(struct GBAVideoRenderer* renderer) {
 	struct GBAVideoSoftwareRenderer* softwareRenderer = (struct GBAVideoSoftwareRenderer*) renderer;
 
@@ -747,6 +841,10 @@ static void GBAVideoSoftwareRendererFinishFrame(struct GBAVideoRenderer* rendere
 	if (softwareRenderer->bg[3].enabled > 0) {
 		softwareRenderer->bg[3].enabled = ENABLED_MAX;
 	}
+
+	// Every scanline was served from the cache, so the output is unchanged
+	renderer->repeatFrame = !softwareRenderer->outputDirty;
+	softwareRenderer->outputDirty = false;
 }
 
 static void GBAVideoSoftwareRendererGetPixels(struct GBAVideoRenderer* renderer, size_t* stride, const void** pixels) {
@@ -763,6 +861,7 @@ static void GBAVideoSoftwareRendererPutPixels(struct GBAVideoRenderer* renderer,
 	for (i = 0; i < GBA_VIDEO_VERTICAL_PIXELS; ++i) {
 		memmove(&softwareRenderer->outputBuffer[softwareRenderer->outputBufferStride * i], &colorPixels[stride * i], GBA_VIDEO_HORIZONTAL_PIXELS * BYTES_PER_PIXEL);
 	}
+	softwareRenderer->outputDirty = true;
 }
 
 static void _enableBg(struct GBAVideoSoftwareRenderer* renderer, int bg, bool active) {
@@ -980,33 +1079,44 @@ void GBAVideoSoftwareRendererPostprocessBuffer(struct GBAVideoSoftwareRenderer*
 	}
 }
 
-int GBAVideoSoftwareRendererPreprocessSpriteLayer(struct GBAVideoSoftwareRenderer* renderer, int y) {
-	int w;
+// Isolated sprites are drawn for the layer output: their palettes are tagged,
+// and everything but the object window is drawn in full, ignoring windows
+static int _preprocessSprites(struct GBAVideoSoftwareRenderer* renderer, int y, bool isolated) {
 	int spriteLayers = 0;
-	if (GBARegisterDISPCNTIsObjEnable(renderer->dispcnt) && !renderer->d.disableOBJ) {
-		if (renderer->oamDirty) {
-			renderer->oamMax = GBAVideoRendererCleanOAM(renderer->d.oam->obj, renderer->sprites, renderer->objOffsetY);
-			renderer->oamDirty = false;
-		}
-		int mosaicV = GBAMosaicControlGetObjV(renderer->mosaic) + 1;
-		int mosaicY = y - (y % mosaicV);
-		int i;
-		for (i = 0; i < renderer->oamMax; ++i) {
-			struct GBAVideoRendererSprite* sprite = &renderer->sprites[i];
-			int localY = y;
-			renderer->end = 0;
-			if ((y < sprite->y && (sprite->endY - 256 < 0 || y >= sprite->endY - 256)) || y >= sprite->endY) {
-				continue;
+	int mosaicV = GBAMosaicControlGetObjV(renderer->mosaic) + 1;
+	int mosaicY = y - (y % mosaicV);
+	int i;
+	for (i = 0; i < renderer->oamMax; ++i) {
+		struct GBAVideoRendererSprite* sprite = &renderer->sprites[i];
+		int localY = y;
+		if ((y < sprite->y && (sprite->endY - 256 < 0 || y >= sprite->endY - 256)) || y >= sprite->endY) {
+			continue;
+		}
+		if (GBAObjAttributesAIsMosaic(sprite->obj.a) && mosaicV > 1) {
+			localY = mosaicY;
+			if (localY < sprite->y && sprite->y < GBA_VIDEO_VERTICAL_PIXELS) {
+				localY = sprite->y;
 			}
-			if (GBAObjAttributesAIsMosaic(sprite->obj.a) && mosaicV > 1) {
-				localY = mosaicY;
-				if (localY < sprite->y && sprite->y < GBA_VIDEO_VERTICAL_PIXELS) {
-					localY = sprite->y;
-				}
-				if (localY >= (sprite->endY & 0xFF)) {
-					localY = sprite->endY - 1;
-				}
+			if (localY >= (sprite->endY & 0xFF)) {
+				localY = sprite->endY - 1;
 			}
+		}
+		if (isolated) {
+#ifndef COLOR_16_BIT
+			_tagObjPalette(renderer, sprite);
+#endif
+		} else {
+			_referenceSprite(renderer, y, &sprite->obj);
+		}
+		if (isolated && GBAObjAttributesAGetMode(sprite->obj.a) != OBJ_MODE_OBJWIN) {
+			renderer->currentWindow.packed = 0xFF;
+			renderer->start = 0;
+			renderer->end = GBA_VIDEO_HORIZONTAL_PIXELS;
+			int drawn = GBAVideoSoftwareRendererPreprocessSprite(renderer, &sprite->obj, sprite->index, localY);
+			spriteLayers |= drawn << GBAObjAttributesCGetPriority(sprite->obj.c);
+		} else {
+			int w;
+			renderer->end = 0;
 			for (w = 0; w < renderer->nWindows; ++w) {
 				renderer->currentWindow = renderer->windows[w].control;
 				renderer->start = renderer->end;
@@ -1019,15 +1129,26 @@ int GBAVideoSoftwareRendererPreprocessSpriteLayer(struct GBAVideoSoftwareRendere
 				int drawn = GBAVideoSoftwareRendererPreprocessSprite(renderer, &sprite->obj, sprite->index, localY);
 				spriteLayers |= drawn << GBAObjAttributesCGetPriority(sprite->obj.c);
 			}
-			renderer->spriteCyclesRemaining -= sprite->cycles;
-			if (renderer->spriteCyclesRemaining <= 0) {
-				break;
-			}
+		}
+		renderer->spriteCyclesRemaining -= sprite->cycles;
+		if (renderer->spriteCyclesRemaining <= 0) {
+			break;
 		}
 	}
 	return spriteLayers;
 }
 
+int GBAVideoSoftwareRendererPreprocessSpriteLayer(struct GBAVideoSoftwareRenderer* renderer, int y) {
+	if (!GBARegisterDISPCNTIsObjEnable(renderer->dispcnt) || renderer->d.disableOBJ) {
+		return 0;
+	}
+	if (renderer->oamDirty) {
+		renderer->oamMax = GBAVideoRendererCleanOAM(renderer->d.oam->obj, renderer->sprites, renderer->objOffsetY);
+		renderer->oamDirty = false;
+	}
+	return _preprocessSprites(renderer, y, false);
+}
+
 static void _updatePalettes(struct GBAVideoSoftwareRenderer* renderer) {
 	int i;
 	if (renderer->blendEffect == BLEND_BRIGHTEN) {
@@ -1053,6 +1174,117 @@ static void _updatePalettes(struct GBAVideoSoftwareRenderer* renderer) {
 	}
 }
 
+static void _invalidateVRAM(struct GBAVideoSoftwareRenderer* renderer, uint32_t address, uint32_t size) {
+	if (!size) {
+		return;
+	}
+	uint32_t end = address + size;
+	uint32_t block;
+	for (block = address >> VRAM_REFERENCE_SHIFT; block <= (end - 1) >> VRAM_REFERENCE_SHIFT && block < VRAM_REFERENCE_BLOCKS; ++block) {
+		renderer->scanlineDirty[0] |= renderer->vramLines[block][0];
+		renderer->scanlineDirty[1] |= renderer->vramLines[block][1];
+		renderer->scanlineDirty[2] |= renderer->vramLines[block][2];
+		renderer->scanlineDirty[3] |= renderer->vramLines[block][3];
+		renderer->scanlineDirty[4] |= renderer->vramLines[block][4];
+	}
+	int i;
+	for (i = 0; i < 4; ++i) {
+		// The map cache holds one row of a text screen, which spans at most 8 KiB
+		struct GBAVideoSoftwareBackground* bg = &renderer->bg[i];
+		if (address < bg->screenBase + 0x2000 && end > bg->screenBase) {
+			bg->yCache = -1;
+		}
+	}
+}
+
+static void _referenceVRAM(struct GBAVideoSoftwareRenderer* renderer, int y, uint32_t start, uint32_t end) {
+	uint32_t block;
+	for (block = start >> VRAM_REFERENCE_SHIFT; block < VRAM_REFERENCE_BLOCKS && block << VRAM_REFERENCE_SHIFT < end; ++block) {
+		renderer->vramLines[block][y >> 5] |= 1U << (y & 0x1F);
+	}
+}
+
+static void _referenceBackgrounds(struct GBAVideoSoftwareRenderer* renderer, int y) {
+	int mode = GBARegisterDISPCNTGetMode(renderer->dispcnt);
+	uint16_t* vram = renderer->d.vram;
+	int i;
+	for (i = 0; i < 4; ++i) {
+		struct GBAVideoSoftwareBackground* bg = &renderer->bg[i];
+		if (!bg->enabled) {
+			continue;
+		}
+		if (mode == 0 || (mode == 1 && i < 2)) {
+			// Mirrors the map addressing in GBAVideoSoftwareRendererDrawBackgroundMode0
+			int inY = y;
+			if (bg->mosaic) {
+				int mosaicV = GBAMosaicControlGetBgV(renderer->mosaic) + 1;
+				inY -= inY % mosaicV;
+			}
+			inY += bg->y - bg->offsetY;
+			unsigned yBase = inY & 0xF8;
+			if (bg->size == 2) {
+				yBase += inY & 0x100;
+			} else if (bg->size == 3) {
+				yBase += (inY & 0x100) << 1;
+			}
+			yBase = (bg->screenBase >> 1) + (yBase << 2);
+			_referenceVRAM(renderer, y, yBase << 1, (yBase + 0x20) << 1);
+			if (bg->size & 1) {
+				_referenceVRAM(renderer, y, (yBase + 0x400) << 1, (yBase + 0x420) << 1);
+			}
+
+			unsigned tileSize = bg->multipalette ? 64 : 32;
+			int tiles = bg->size & 1 ? 64 : 32;
+			int tileX;
+			for (tileX = 0; tileX < tiles; ++tileX) {
+				uint16_t mapData;
+				LOAD_16(mapData, (yBase + (tileX & 0x1F) + ((tileX & 0x20) << 5)) << 1, vram);
+				uint32_t charBase = bg->charBase + GBA_TEXT_MAP_TILE(mapData) * tileSize;
+				_referenceVRAM(renderer, y, charBase, charBase + tileSize);
+			}
+		} else if (mode == 2 || (mode == 1 && i == 2)) {
+			_referenceVRAM(renderer, y, bg->screenBase, bg->screenBase + (0x100 << (bg->size * 2)));
+			_referenceVRAM(renderer, y, bg->charBase, bg->charBase + 0x4000);
+		} else if (i == 2) {
+			uint32_t page = GBARegisterDISPCNTIsFrameSelect(renderer->dispcnt) ? 0xA000 : 0;
+			switch (mode) {
+			case 3:
+				_referenceVRAM(renderer, y, 0, GBA_VIDEO_HORIZONTAL_PIXELS * GBA_VIDEO_VERTICAL_PIXELS * 2);
+				break;
+			case 4:
+				_referenceVRAM(renderer, y, page, page + GBA_VIDEO_HORIZONTAL_PIXELS * GBA_VIDEO_VERTICAL_PIXELS);
+				break;
+			case 5:
+				_referenceVRAM(renderer, y, page, page + 0xA000);
+				break;
+			}
+		}
+	}
+}
+
+static void _referenceSprite(struct GBAVideoSoftwareRenderer* renderer, int y, const struct GBAObj* sprite) {
+	int width = GBAVideoObjSizes[GBAObjAttributesAGetShape(sprite->a) * 4 + GBAObjAttributesBGetSize(sprite->b)][0];
+	int height = GBAVideoObjSizes[GBAObjAttributesAGetShape(sprite->a) * 4 + GBAObjAttributesBGetSize(sprite->b)][1];
+	bool is256 = GBAObjAttributesAIs256Color(sprite->a);
+	// Character data wraps around within the 32 KiB of OBJ VRAM
+	if (GBARegisterDISPCNTIsObjCharacterMapping(renderer->dispcnt)) {
+		uint32_t charBase = GBAObjAttributesCGetTile(sprite->c) * 0x20;
+		uint32_t end = charBase + ((width * height) >> (is256 ? 0 : 1));
+		if (end > 0x8000) {
+			_referenceVRAM(renderer, y, BASE_TILE, BASE_TILE + end - 0x8000);
+			end = 0x8000;
+		}
+		_referenceVRAM(renderer, y, BASE_TILE + charBase, BASE_TILE + end);
+	} else {
+		// Each row of tiles occupies its own 1 KiB in 2D mapping
+		uint32_t row = GBAObjAttributesCGetTile(sprite->c) * 0x20 & 0x7C00;
+		int tileY;
+		for (tileY = 0; tileY < height; tileY += 8, row = (row + 0x400) & 0x7C00) {
+			_referenceVRAM(renderer, y, BASE_TILE + row, BASE_TILE + row + 0x400);
+		}
+	}
+}
+
 void _updateFlags(struct GBAVideoSoftwareRenderer* renderer, struct GBAVideoSoftwareBackground* background) {
 	uint32_t flags = (background->priority << OFFSET_PRIORITY) | (background->index << OFFSET_INDEX) | FLAG_IS_BACKGROUND;
 	if (background->target2) {
@@ -1076,3 +1308,275 @@ void _updateFlags(struct GBAVideoSoftwareRenderer* renderer, struct GBAVideoSoft
 	background->objwinFlags = objwinFlags;
 	background->variant = background->target1 && GBAWindowControlIsBlendEnable(renderer->currentWindow.packed) && (renderer->blendEffect == BLEND_BRIGHTEN || renderer->blendEffect == BLEND_DARKEN);
 }
+
+#ifndef COLOR_16_BIT
+// The layer output is generated by replaying the scanline with the palette
+// swapped out for tags naming where each entry came from. A red channel of
+// exactly 1 can't be expanded from a 15-bit color, so direct colors from the
+// bitmap modes can still be told apart from tags.
+#define LAYER_TAG_MARKER 0x01
+#define LAYER_TAG_OBJ 0x8000
+#define LAYER_TAG_BACKDROP 7
+
+static inline uint32_t _layerTagBackground(unsigned layer, unsigned index) {
+	return LAYER_TAG_MARKER | (((layer << 8) | index) << 8);
+}
+
+static inline uint32_t _layerTagObj(unsigned object, unsigned index) {
+	return LAYER_TAG_MARKER | ((LAYER_TAG_OBJ | (object << 8) | index) << 8);
+}
+
+static void _tagBackgroundPalette(struct GBAVideoSoftwareRenderer* renderer, unsigned layer) {
+	int i;
+	for (i = 0; i < 0x100; ++i) {
+		renderer->normalPalette[i] = _layerTagBackground(layer, i);
+	}
+}
+
+static void _tagObjPalette(struct GBAVideoSoftwareRenderer* renderer, const struct GBAVideoRendererSprite* sprite) {
+	int i = 0;
+	int end = 0x100;
+	if (!GBAObjAttributesAIs256Color(sprite->obj.a)) {
+		i = GBAObjAttributesCGetPalette(sprite->obj.c) << 4;
+		end = i + 0x10;
+	}
+	for (; i < end; ++i) {
+		renderer->normalPalette[0x100 + i] = _layerTagObj(sprite->index, i);
+	}
+}
+
+static uint32_t _untagColor(uint32_t pixel, const color_t* palette) {
+	if ((pixel & FLAG_UNWRITTEN) == FLAG_UNWRITTEN) {
+		return 0;
+	}
+	uint32_t color = pixel & 0x00FFFFFF;
+	if ((color & 0xFF) == LAYER_TAG_MARKER) {
+		unsigned tag = color >> 8;
+		if (tag & LAYER_TAG_OBJ) {
+			color = palette[0x100 | (tag & 0xFF)];
+		} else {
+			color = palette[tag & 0xFF];
+		}
+	}
+	return color | 0xFF000000;
+}
+
+static bool _layerBackgroundEnabled(struct GBAVideoSoftwareRenderer* renderer, int index, unsigned priority) {
+	if (renderer->d.disableBG[index] || renderer->bg[index].enabled != ENABLED_MAX || renderer->bg[index].priority != priority) {
+		return false;
+	}
+	if (renderer->currentWindow.packed & (1 << index)) {
+		return true;
+	}
+	return GBARegisterDISPCNTIsObjwinEnable(renderer->dispcnt) && (renderer->objwin.packed & (1 << index));
+}
+
+static void _drawLayerBackground(struct GBAVideoSoftwareRenderer* renderer, int index, int y) {
+	struct GBAVideoSoftwareBackground* background = &renderer->bg[index];
+	switch (GBARegisterDISPCNTGetMode(renderer->dispcnt)) {
+	case 0:
+		GBAVideoSoftwareRendererDrawBackgroundMode0(renderer, background, y);
+		break;
+	case 1:
+		if (index < 2) {
+			GBAVideoSoftwareRendererDrawBackgroundMode0(renderer, background, y);
+		} else if (index == 2) {
+			GBAVideoSoftwareRendererDrawBackgroundMode2(renderer, background, y);
+		}
+		break;
+	case 2:
+		if (index >= 2) {
+			GBAVideoSoftwareRendererDrawBackgroundMode2(renderer, background, y);
+		}
+		break;
+	case 3:
+		if (index == 2) {
+			GBAVideoSoftwareRendererDrawBackgroundMode3(renderer, background, y);
+		}
+		break;
+	case 4:
+		if (index == 2) {
+			GBAVideoSoftwareRendererDrawBackgroundMode4(renderer, background, y);
+		}
+		break;
+	case 5:
+		if (index == 2) {
+			GBAVideoSoftwareRendererDrawBackgroundMode5(renderer, background, y);
+		}
+		break;
+	}
+}
+
+static int _preprocessLayerSprites(struct GBAVideoSoftwareRenderer* renderer, int y) {
+	if (!GBARegisterDISPCNTIsObjEnable(renderer->dispcnt) || renderer->d.disableOBJ) {
+		return 0;
+	}
+	renderer->spriteCyclesRemaining = GBARegisterDISPCNTIsHblankIntervalFree(renderer->dispcnt) ? OBJ_HBLANK_FREE_LENGTH : OBJ_LENGTH;
+	return _preprocessSprites(renderer, y, true);
+}
+
+static void _drawLayerOutput(struct GBAVideoSoftwareRenderer* softwareRenderer, int y) {
+	const struct mVideoLayerOutput* output = softwareRenderer->layerOutput;
+	size_t offset = output->stride * y;
+	color_t palette[512];
+	uint32_t composed[GBA_VIDEO_HORIZONTAL_PIXELS];
+	memcpy(palette, softwareRenderer->normalPalette, sizeof(palette));
+	memcpy(composed, softwareRenderer->row, sizeof(composed));
+
+	// Blending and highlighting would mangle the tags, so turn them off for now
+	GBARegisterDISPCNT dispcnt = softwareRenderer->dispcnt;
+	enum GBAVideoBlendEffect blendEffect = softwareRenderer->blendEffect;
+	unsigned target1Obj = softwareRenderer->target1Obj;
+	unsigned target2Obj = softwareRenderer->target2Obj;
+	unsigned target2Bd = softwareRenderer->target2Bd;
+	uint8_t highlightAmount = softwareRenderer->d.highlightAmount;
+	struct WindowControl currentWindow = softwareRenderer->currentWindow;
+	bool forceTarget1 = softwareRenderer->forceTarget1;
+	int target1[4];
+	int target2[4];
+	int i;
+	for (i = 0; i < 4; ++i) {
+		target1[i] = softwareRenderer->bg[i].target1;
+		target2[i] = softwareRenderer->bg[i].target2;
+		softwareRenderer->bg[i].target1 = 0;
+		softwareRenderer->bg[i].target2 = 0;
+	}
+	softwareRenderer->blendEffect = BLEND_NONE;
+	softwareRenderer->target1Obj = 0;
+	softwareRenderer->target2Obj = 0;
+	softwareRenderer->target2Bd = 0;
+	softwareRenderer->d.highlightAmount = 0;
+
+	int x;
+	int w;
+	unsigned priority;
+	uint32_t backdrop = FLAG_UNWRITTEN | FLAG_PRIORITY | FLAG_IS_BACKGROUND;
+
+	// Each background on its own, outside of any windows
+	softwareRenderer->dispcnt = GBARegisterDISPCNTClearObjwinEnable(dispcnt);
+	softwareRenderer->currentWindow.packed = 0xFF;
+	softwareRenderer->start = 0;
+	softwareRenderer->end = GBA_VIDEO_HORIZONTAL_PIXELS;
+	GBAVideoSoftwareRendererPrepareWindow(softwareRenderer);
+	for (i = 0; i < 4; ++i) {
+		uint32_t* layer = output->layers[GBA_LAYER_BG0 + i];
+		if (!layer) {
+			continue;
+		}
+		layer = &layer[offset];
+		for (x = 0; x < GBA_VIDEO_HORIZONTAL_PIXELS; ++x) {
+			softwareRenderer->row[x] = backdrop;
+		}
+		if (!softwareRenderer->d.disableBG[i] && softwareRenderer->bg[i].enabled == ENABLED_MAX) {
+			_tagBackgroundPalette(softwareRenderer, i);
+			_drawLayerBackground(softwareRenderer, i, y);
+		}
+		for (x = 0; x < GBA_VIDEO_HORIZONTAL_PIXELS; ++x) {
+			layer[x] = _untagColor(softwareRenderer->row[x], palette);
+		}
+	}
+
+	// Then the whole scanline again, composited as before but with tags
+	softwareRenderer->dispcnt = dispcnt;
+	for (x = 0; x < GBA_VIDEO_HORIZONTAL_PIXELS; ++x) {
+		softwareRenderer->row[x] = backdrop | _layerTagBackground(LAYER_TAG_BACKDROP, 0);
+		softwareRenderer->spriteLayer[x] = FLAG_UNWRITTEN;
+	}
+	int spriteLayers = _preprocessLayerSprites(softwareRenderer, y);
+	if (output->layers[GBA_LAYER_OBJ]) {
+		uint32_t* layer = &output->layers[GBA_LAYER_OBJ][offset];
+		for (x = 0; x < GBA_VIDEO_HORIZONTAL_PIXELS; ++x) {
+			layer[x] = _untagColor(softwareRenderer->spriteLayer[x], palette);
+		}
+	}
+
+	if (output->provenance) {
+		int tagged = -1;
+		softwareRenderer->end = 0;
+		for (w = 0; w < softwareRenderer->nWindows; ++w) {
+			softwareRenderer->start = softwareRenderer->end;
+			softwareRenderer->end = softwareRenderer->windows[w].endX;
+			softwareRenderer->currentWindow = softwareRenderer->windows[w].control;
+			GBAVideoSoftwareRendererPrepareWindow(softwareRenderer);
+			for (priority = 0; priority < 4; ++priority) {
+				if (spriteLayers & (1 << priority)) {
+					GBAVideoSoftwareRendererPostprocessSprite(softwareRenderer, priority);
+				}
+				for (i = 0; i < 4; ++i) {
+					if (!_layerBackgroundEnabled(softwareRenderer, i, priority)) {
+						continue;
+					}
+					if (tagged != i) {
+						_tagBackgroundPalette(softwareRenderer, i);
+						tagged = i;
+					}
+					_drawLayerBackground(softwareRenderer, i, y);
+				}
+			}
+		}
+
+		mPixelProvenance* provenance = &output->provenance[offset];
+		for (x = 0; x < GBA_VIDEO_HORIZONTAL_PIXELS; ++x) {
+			uint32_t color = softwareRenderer->row[x] & 0x00FFFFFF;
+			mPixelProvenance source = mPixelProvenanceSetObject(0, mPROVENANCE_OBJECT_NONE);
+			if ((color & 0xFF) == LAYER_TAG_MARKER) {
+				unsigned tag = color >> 8;
+				if (tag & LAYER_TAG_OBJ) {
+					source = mPixelProvenanceSetLayer(source, GBA_LAYER_OBJ);
+					source = mPixelProvenanceSetPalette(source, 0x100 | (tag & 0xFF));
+					source = mPixelProvenanceSetObject(source, (tag >> 8) & 0x7F);
+				} else if ((tag >> 8) == LAYER_TAG_BACKDROP) {
+					source = mPixelProvenanceSetLayer(source, mPROVENANCE_LAYER_BACKDROP);
+				} else {
+					source = mPixelProvenanceSetLayer(source, tag >> 8);
+					source = mPixelProvenanceSetPalette(source, tag & 0xFF);
+				}
+				color = palette[mPixelProvenanceGetPalette(source)];
+			} else {
+				// Bitmap modes write their colors directly
+				source = mPixelProvenanceSetLayer(source, GBA_LAYER_BG2);
+				source = mPixelProvenanceSetPalette(source, mPROVENANCE_PALETTE_NONE);
+			}
+			if ((composed[x] & 0x00FFFFFF) != color) {
+				source = mPixelProvenanceFillBlended(source);
+			}
+			provenance[x] = source;
+		}
+	}
+
+	memcpy(softwareRenderer->normalPalette, palette, sizeof(palette));
+	memcpy(softwareRenderer->row, composed, sizeof(composed));
+	softwareRenderer->dispcnt = dispcnt;
+	softwareRenderer->blendEffect = blendEffect;
+	softwareRenderer->target1Obj = target1Obj;
+	softwareRenderer->target2Obj = target2Obj;
+	softwareRenderer->target2Bd = target2Bd;
+	softwareRenderer->d.highlightAmount = highlightAmount;
+	softwareRenderer->currentWindow = currentWindow;
+	softwareRenderer->forceTarget1 = forceTarget1;
+	for (i = 0; i < 4; ++i) {
+		softwareRenderer->bg[i].target1 = target1[i];
+		softwareRenderer->bg[i].target2 = target2[i];
+	}
+}
+
+static void _clearLayerOutput(struct GBAVideoSoftwareRenderer* softwareRenderer, int y) {
+	const struct mVideoLayerOutput* output = softwareRenderer->layerOutput;
+	size_t offset = output->stride * y;
+	int i;
+	for (i = 0; i < mVIDEO_LAYER_OUTPUT_MAX; ++i) {
+		if (output->layers[i]) {
+			memset(&output->layers[i][offset], 0, GBA_VIDEO_HORIZONTAL_PIXELS * sizeof(uint32_t));
+		}
+	}
+	if (output->provenance) {
+		mPixelProvenance source = mPixelProvenanceSetLayer(0, mPROVENANCE_LAYER_BACKDROP);
+		source = mPixelProvenanceSetPalette(source, mPROVENANCE_PALETTE_NONE);
+		source = mPixelProvenanceSetObject(source, mPROVENANCE_OBJECT_NONE);
+		int x;
+		for (x = 0; x < GBA_VIDEO_HORIZONTAL_PIXELS; ++x) {
+			output->provenance[offset + x] = source;
+		}
+	}
+}
+#endif
@@ -0,0 +1,115 @@
+/* Copyright (c) 2013-2024 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "util/test/suite.h"
+
+#include <mgba/core/core.h>
+#include <mgba/gba/core.h>
+#include <mgba/internal/arm/arm.h>
+#include <mgba/internal/gba/debugger/analysis.h>
+#include <mgba/internal/gba/memory.h>
+#include <mgba-util/vfs.h>
+
+#define ROM(X) (GBA_BASE_ROM0 + (X))
+
+static const uint32_t _arm[] = {
+	0xE28F0001, // $00: add r0, pc, #1
+	0xE12FFF10, // $04: bx r0
+};
+
+static const uint16_t _thumb[] = {
+	0xF000, 0xF802, // $08: bl $10
+	0xE7FE,         // $0C: b $0C
+	0x0000,
+	0x4770,         // $10: bx lr
+};
+
+M_TEST_SUITE_SETUP(GBAAnalysis) {
+	struct VFile* vf = VFileMemChunk(NULL, 0x1000);
+	vf->write(vf, _arm, sizeof(_arm));
+	vf->write(vf, _thumb, sizeof(_thumb));
+	struct mCore* core = GBACoreCreate();
+	core->init(core);
+	mCoreInitConfig(core, NULL);
+	core->loadROM(core, vf);
+	core->reset(core);
+
+	struct mCodeAnalysis* analysis = malloc(sizeof(*analysis));
+	mCodeAnalysisInit(analysis, core, &GBACodeAnalysisPlatform);
+	mCodeAnalysisRun(analysis);
+	*state = analysis;
+	return 0;
+}
+
+M_TEST_SUITE_TEARDOWN(GBAAnalysis) {
+	if (!*state) {
+		return 0;
+	}
+	struct mCodeAnalysis* analysis = *state;
+	struct mCore* core = analysis->core;
+	mCodeAnalysisDeinit(analysis);
+	free(analysis);
+	mCoreConfigDeinit(&core->config);
+	core->deinit(core);
+	return 0;
+}
+
+M_TEST_DEFINE(interworking) {
+	struct mCodeAnalysis* analysis = *state;
+
+	// The target of the bx is inferred from the add, including the switch to Thumb
+	const struct mCodeInstruction* instruction = mCodeAnalysisInstructionAt(analysis, ROM(0x04), -1);
+	assert_non_null(instruction);
+	assert_int_equal(instruction->location.mode, MODE_ARM);
+	assert_int_equal(instruction->info.flow, mCODE_FLOW_JUMP);
+	assert_int_equal(instruction->info.target.address, ROM(0x08));
+	assert_int_equal(instruction->info.target.mode, MODE_THUMB);
+
+	const struct mCodeBlock* block = mCodeAnalysisBlockAt(analysis, ROM(0x04), -1);
+	assert_non_null(block);
+	assert_int_equal(block->start.address, ROM(0x00));
+	assert_int_equal(block->end, ROM(0x08));
+}
+
+M_TEST_DEFINE(thumbCall) {
+	struct mCodeAnalysis* analysis = *state;
+
+	// Both halves of the bl decode as one instruction
+	const struct mCodeInstruction* instruction = mCodeAnalysisInstructionAt(analysis, ROM(0x08), -1);
+	assert_non_null(instruction);
+	assert_int_equal(instruction->location.mode, MODE_THUMB);
+	assert_int_equal(instruction->info.length, 4);
+	assert_int_equal(instruction->info.flow, mCODE_FLOW_CALL | mCODE_FLOW_CONTINUES);
+	assert_int_equal(instruction->info.target.address, ROM(0x10));
+	assert_int_equal(instruction->info.target.mode, MODE_THUMB);
+	assert_null(mCodeAnalysisInstructionAt(analysis, ROM(0x0A), -1));
+	assert_null(mCodeAnalysisInstructionAt(analysis, ROM(0x0E), -1));
+
+	// The call ends its block, and execution picks up after it in a new one
+	const struct mCodeBlock* block = mCodeAnalysisBlockAt(analysis, ROM(0x0A), -1);
+	assert_non_null(block);
+	assert_int_equal(block->start.address, ROM(0x08));
+	assert_int_equal(block->start.mode, MODE_THUMB);
+	assert_int_equal(block->end, ROM(0x0C));
+	block = mCodeAnalysisBlockAt(analysis, ROM(0x0C), -1);
+	assert_non_null(block);
+	assert_int_equal(block->start.address, ROM(0x0C));
+	assert_int_equal(block->start.mode, MODE_THUMB);
+
+	const struct mCodeFunction* function = mCodeAnalysisFunctionAt(analysis, ROM(0x10), -1);
+	assert_non_null(function);
+	assert_int_equal(function->entry.address, ROM(0x10));
+	assert_int_equal(function->entry.mode, MODE_THUMB);
+	assert_int_equal(function->size, 2);
+
+	const struct mCodeXref* xrefs;
+	assert_int_equal(mCodeAnalysisXrefsTo(analysis, ROM(0x10), -1, &xrefs), 1);
+	assert_int_equal(xrefs[0].from.address, ROM(0x08));
+	assert_int_equal(xrefs[0].type, mCODE_XREF_CALL);
+}
+
+M_TEST_SUITE_DEFINE_SETUP_TEARDOWN(GBAAnalysis,
+	cmocka_unit_test(interworking),
+	cmocka_unit_test(thumbCall))
@@ -0,0 +1,340 @@
+/* Copyright (c) 2013-2024 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "util/test/suite.h"
+
+#include <mgba/core/core.h>
+#include <mgba/core/run-until.h>
+#include <mgba/gba/core.h>
+#include <mgba/internal/arm/isa-inlines.h>
+#include <mgba/internal/gba/bios.h>
+#include <mgba/internal/gba/gba.h>
+#include <mgba/internal/gba/io.h>
+#include <mgba/internal/gba/memory.h>
+#include <mgba-util/vfs.h>
+
+#include "gba/hle-bios.h"
+
+#define CALL GBA_BASE_EWRAM
+#define SOURCE (GBA_BASE_EWRAM + 0x1000)
+#define DEST (GBA_BASE_EWRAM + 0x2000)
+
+struct BIOSTest {
+	struct mCore* native;
+	struct mCore* interpreted;
+};
+
+static int _vramRanges;
+static void (*_writeVRAMRange)(struct GBAVideoRenderer*, uint32_t address, uint32_t length);
+
+static void _countVRAMRange(struct GBAVideoRenderer* renderer, uint32_t address, uint32_t length) {
+	++_vramRanges;
+	_writeVRAMRange(renderer, address, length);
+}
+
+static struct mCore* _createCore(bool hleBiosCalls) {
+	struct VFile* vf = VFileMemChunk(NULL, 0x1000);
+	vf->write(vf, &(uint32_t) { 0xEAFFFFFE }, 4); // b $00
+
+	struct mCore* core = GBACoreCreate();
+	core->init(core);
+	mCoreInitConfig(core, NULL);
+	mCoreConfigSetIntValue(&core->config, "gba.hleBiosCalls", hleBiosCalls);
+	core->loadROM(core, vf);
+	// The HLE BIOS implements the copy calls in ARM code, so it can stand in for a real
+	// one. Its reserved vector isn't a branch, so it has to skip the format check.
+	GBALoadBIOS(core->board, VFileFromConstMemory(hleBios, GBA_SIZE_BIOS));
+	mCoreLoadConfig(core);
+	core->reset(core);
+
+	struct mRunPredicate boot = { .type = mRUN_UNTIL_PC, .address = GBA_BASE_ROM0 };
+	assert_int_equal(core->runUntil(core, &boot, 1, 0x100000, NULL), 0);
+	return core;
+}
+
+static void _destroyCore(struct mCore* core) {
+	mCoreConfigDeinit(&core->config);
+	core->deinit(core);
+}
+
+// Returns whether the call entered the BIOS, and how many cycles it took to return
+static bool _call(struct mCore* core, int immediate, uint32_t r0, uint32_t r1, uint32_t r2, uint64_t* cycles) {
+	struct ARMCore* cpu = ((struct GBA*) core->board)->cpu;
+	core->rawWrite32(core, CALL, -1, 0xEF000000 | (immediate << 16)); // swi immediate
+	core->rawWrite32(core, CALL + 4, -1, 0xEAFFFFFE); // b $04
+	cpu->gprs[0] = r0;
+	cpu->gprs[1] = r1;
+	cpu->gprs[2] = r2;
+	cpu->gprs[ARM_PC] = CALL;
+	ARMWritePC(cpu);
+
+	struct mRunPredicate predicates[] = {
+		{ .type = mRUN_UNTIL_PC, .address = CALL + 4 },
+		{ .type = mRUN_UNTIL_PC, .address = GBA_BASE_BIOS + 0x08 },
+	};
+	uint64_t ran;
+	uint64_t total = 0;
+	bool enteredBios = false;
+	ssize_t hit;
+	while ((hit = core->runUntil(core, predicates, 2, 0x100000, &ran)) == 1) {
+		enteredBios = true;
+		total += ran;
+	}
+	assert_int_equal(hit, 0);
+	*cycles = total + ran;
+	return enteredBios;
+}
+
+// VRAM accesses only stall during HDraw, so this avoids them
+static void _waitForVBlank(struct mCore* core) {
+	struct GBA* gba = core->board;
+	GBAIOWrite(gba, GBA_REG_DISPSTAT, 0x0008);
+	gba->memory.io[GBA_REG(IF)] = 0;
+	struct mRunPredicate predicate = { .type = mRUN_UNTIL_IRQ, .irqMask = 1 << GBA_IRQ_VBLANK };
+	assert_int_equal(core->runUntil(core, &predicate, 1, 0, NULL), 0);
+}
+
+static void _fillSource(struct mCore* core) {
+	int i;
+	for (i = 0; i < 0x400; i += 4) {
+		core->rawWrite32(core, SOURCE + i, -1, 0x01020304U * (i + 1));
+	}
+}
+
+static void _assertMemoryEqual(struct BIOSTest* test, uint32_t address, uint32_t size) {
+	uint32_t i;
+	for (i = 0; i < size; i += 4) {
+		assert_int_equal(test->native->rawRead32(test->native, address + i, -1), test->interpreted->rawRead32(test->interpreted, address + i, -1));
+	}
+}
+
+// The calibrated costs are approximations, but shouldn't drift far from the BIOS code they replace
+static void _assertCyclesClose(uint64_t native, uint64_t interpreted) {
+	assert_true(native * 4 > interpreted * 3);
+	assert_true(native * 3 < interpreted * 4);
+}
+
+static void _writeBytes(struct mCore* core, uint32_t address, const uint8_t* data, size_t size) {
+	size_t i;
+	for (i = 0; i < size; ++i) {
+		core->rawWrite8(core, address + i, -1, data[i]);
+	}
+}
+
+static void _assertBytes(struct mCore* core, uint32_t address, const uint8_t* expected, size_t size) {
+	size_t i;
+	for (i = 0; i < size; ++i) {
+		assert_int_equal(core->rawRead8(core, address + i, -1), expected[i]);
+	}
+}
+
+M_TEST_SUITE_SETUP(GBABIOS) {
+	struct BIOSTest* test = malloc(sizeof(*test));
+	test->native = _createCore(true);
+	test->interpreted = _createCore(false);
+	*state = test;
+	return 0;
+}
+
+M_TEST_SUITE_TEARDOWN(GBABIOS) {
+	if (!*state) {
+		return 0;
+	}
+	struct BIOSTest* test = *state;
+	_destroyCore(test->native);
+	_destroyCore(test->interpreted);
+	free(test);
+	return 0;
+}
+
+M_TEST_DEFINE(cpuSet) {
+	struct BIOSTest* test = *state;
+	static const uint32_t modes[] = {
+		0x00000041, // Halfword copy
+		0x01000041, // Halfword fill
+		0x04000041, // Word copy
+		0x05000041, // Word fill
+	};
+	size_t i;
+	for (i = 0; i < sizeof(modes) / sizeof(*modes); ++i) {
+		_fillSource(test->native);
+		_fillSource(test->interpreted);
+		uint64_t nativeCycles;
+		uint64_t interpretedCycles;
+		assert_false(_call(test->native, GBA_SWI_CPU_SET, SOURCE, DEST + i * 0x200, modes[i], &nativeCycles));
+		assert_true(_call(test->interpreted, GBA_SWI_CPU_SET, SOURCE, DEST + i * 0x200, modes[i], &interpretedCycles));
+		_assertMemoryEqual(test, DEST + i * 0x200, 0x200);
+		_assertCyclesClose(nativeCycles, interpretedCycles);
+	}
+}
+
+M_TEST_DEFINE(cpuFastSet) {
+	struct BIOSTest* test = *state;
+	_fillSource(test->native);
+	_fillSource(test->interpreted);
+	uint64_t nativeCycles;
+	uint64_t interpretedCycles;
+
+	// Counts are rounded up to whole blocks of 8 words
+	assert_false(_call(test->native, GBA_SWI_CPU_FAST_SET, SOURCE, DEST, 0x00000043, &nativeCycles));
+	assert_true(_call(test->interpreted, GBA_SWI_CPU_FAST_SET, SOURCE, DEST, 0x00000043, &interpretedCycles));
+	_assertMemoryEqual(test, DEST, 0x200);
+	_assertCyclesClose(nativeCycles, interpretedCycles);
+
+	assert_false(_call(test->native, GBA_SWI_CPU_FAST_SET, SOURCE + 4, DEST, 0x01000040, &nativeCycles));
+	assert_true(_call(test->interpreted, GBA_SWI_CPU_FAST_SET, SOURCE + 4, DEST, 0x01000040, &interpretedCycles));
+	_assertMemoryEqual(test, DEST, 0x200);
+	_assertCyclesClose(nativeCycles, interpretedCycles);
+}
+
+M_TEST_DEFINE(cpuFastSetVRAM) {
+	struct BIOSTest* test = *state;
+	struct GBA* gba = test->native->board;
+	_fillSource(test->native);
+	_fillSource(test->interpreted);
+
+	_writeVRAMRange = gba->video.renderer->writeVRAMRange;
+	gba->video.renderer->writeVRAMRange = _countVRAMRange;
+	_vramRanges = 0;
+	_waitForVBlank(test->native);
+	_waitForVBlank(test->interpreted);
+	uint64_t nativeCycles;
+	uint64_t interpretedCycles;
+	assert_false(_call(test->native, GBA_SWI_CPU_FAST_SET, SOURCE, GBA_BASE_VRAM + 0x100, 0x00000100, &nativeCycles));
+	gba->video.renderer->writeVRAMRange = _writeVRAMRange;
+	assert_true(_call(test->interpreted, GBA_SWI_CPU_FAST_SET, SOURCE, GBA_BASE_VRAM + 0x100, 0x00000100, &interpretedCycles));
+
+	// The whole copy is reported to the renderer at once
+	assert_int_equal(_vramRanges, 1);
+	_assertMemoryEqual(test, GBA_BASE_VRAM, 0x600);
+	_assertCyclesClose(nativeCycles, interpretedCycles);
+}
+
+M_TEST_DEFINE(fallBack) {
+	struct BIOSTest* test = *state;
+	struct ARMCore* cpu = ((struct GBA*) test->native->board)->cpu;
+	uint64_t cycles;
+
+	assert_false(_call(test->native, GBA_SWI_DIV, -7, 2, 0, &cycles));
+	assert_int_equal(cpu->gprs[0], -3);
+	assert_int_equal(cpu->gprs[1], -1);
+	assert_int_equal(cpu->gprs[3], 3);
+
+	// Edge cases and calls that aren't pure computation are left to the BIOS
+	assert_true(_call(test->native, GBA_SWI_DIV, 1, 0, 0, &cycles));
+	assert_true(_call(test->native, GBA_SWI_CPU_SET, GBA_BASE_BIOS, DEST, 0x04000010, &cycles));
+	assert_true(_call(test->native, GBA_SWI_CPU_FAST_SET, SOURCE + 2, DEST, 0x00000008, &cycles));
+	assert_true(_call(test->native, GBA_SWI_GET_BIOS_CHECKSUM, 0, 0, 0, &cycles));
+}
+
+// The real BIOS decompressors can't be run here, so the outputs are checked against
+// hand-encoded data and the cycles against what the LZ77 cost model works out to
+M_TEST_DEFINE(bitUnPack) {
+	struct BIOSTest* test = *state;
+	static const uint8_t packed[] = { 0xE4, 0x1B };
+	static const uint8_t info[] = {
+		0x02, 0x00, // Length
+		0x02, // Source width
+		0x08, // Destination width
+		0x01, 0x00, 0x00, 0x00, // Bias, not applied to zeroes
+	};
+	static const uint8_t unpacked[] = { 0x00, 0x02, 0x03, 0x04, 0x04, 0x03, 0x02, 0x00 };
+	_writeBytes(test->native, SOURCE, packed, sizeof(packed));
+	_writeBytes(test->native, SOURCE + 0x100, info, sizeof(info));
+	uint64_t cycles;
+	assert_false(_call(test->native, GBA_SWI_BIT_UNPACK, SOURCE, DEST, SOURCE + 0x100, &cycles));
+	_assertBytes(test->native, DEST, unpacked, sizeof(unpacked));
+	_assertCyclesClose(cycles, 230);
+}
+
+M_TEST_DEFINE(lz77) {
+	struct BIOSTest* test = *state;
+	static const uint8_t compressed[] = {
+		0x10, 0x0C, 0x00, 0x00,
+		0x10, // Three literals, then a match
+		'A', 'B', 'C',
+		0x60, 0x02, // Nine bytes from three back
+	};
+	_writeBytes(test->native, SOURCE, compressed, sizeof(compressed));
+	uint64_t cycles;
+	assert_false(_call(test->native, GBA_SWI_LZ77_UNCOMP_WRAM, SOURCE, DEST, 0, &cycles));
+	_assertBytes(test->native, DEST, (const uint8_t*) "ABCABCABCABC", 12);
+	_assertCyclesClose(cycles, 420);
+}
+
+M_TEST_DEFINE(huffman) {
+	struct BIOSTest* test = *state;
+	static const uint8_t compressed[] = {
+		0x28, 0x04, 0x00, 0x00,
+		0x01, // Tree size
+		0xC0, 'a', 'b', // Root with two leaves
+		0x00, 0x00, 0x00, 0x60, // 0110
+	};
+	_writeBytes(test->native, SOURCE, compressed, sizeof(compressed));
+	uint64_t cycles;
+	assert_false(_call(test->native, GBA_SWI_HUFFMAN_UNCOMP, SOURCE, DEST, 0, &cycles));
+	_assertBytes(test->native, DEST, (const uint8_t*) "abba", 4);
+	_assertCyclesClose(cycles, 270);
+}
+
+M_TEST_DEFINE(rl) {
+	struct BIOSTest* test = *state;
+	static const uint8_t compressed[] = {
+		0x30, 0x0A, 0x00, 0x00,
+		0x82, 'x', // Run of five
+		0x02, 'a', 'b', 'c', // Three literals
+		0x01, 'd', 'e', // Two literals
+	};
+	// The output is padded out to a whole word
+	static const uint8_t decompressed[] = { 'x', 'x', 'x', 'x', 'x', 'a', 'b', 'c', 'd', 'e', 0, 0 };
+	_writeBytes(test->native, SOURCE, compressed, sizeof(compressed));
+	uint64_t wramCycles;
+	uint64_t vramCycles;
+	assert_false(_call(test->native, GBA_SWI_RL_UNCOMP_WRAM, SOURCE, DEST, 0, &wramCycles));
+	_assertBytes(test->native, DEST, decompressed, sizeof(decompressed));
+	assert_false(_call(test->native, GBA_SWI_RL_UNCOMP_VRAM, SOURCE, DEST + 0x100, 0, &vramCycles));
+	_assertBytes(test->native, DEST + 0x100, decompressed, sizeof(decompressed));
+	_assertCyclesClose(wramCycles, 360);
+	_assertCyclesClose(vramCycles, 380);
+}
+
+M_TEST_DEFINE(diff) {
+	struct BIOSTest* test = *state;
+	static const uint8_t filtered8[] = {
+		0x81, 0x04, 0x00, 0x00,
+		0x10, 0x01, 0x01, 0xFE,
+	};
+	static const uint8_t filtered16[] = {
+		0x82, 0x06, 0x00, 0x00,
+		0x00, 0x01, 0x01, 0x00, 0xFF, 0xFF,
+	};
+	static const uint8_t unfiltered8[] = { 0x10, 0x11, 0x12, 0x10 };
+	static const uint8_t unfiltered16[] = { 0x00, 0x01, 0x01, 0x01, 0x00, 0x01 };
+	uint64_t cycles;
+
+	_writeBytes(test->native, SOURCE, filtered8, sizeof(filtered8));
+	assert_false(_call(test->native, GBA_SWI_DIFF_8BIT_UNFILTER_WRAM, SOURCE, DEST, 0, &cycles));
+	_assertBytes(test->native, DEST, unfiltered8, sizeof(unfiltered8));
+	_assertCyclesClose(cycles, 160);
+	assert_false(_call(test->native, GBA_SWI_DIFF_8BIT_UNFILTER_VRAM, SOURCE, DEST + 0x100, 0, &cycles));
+	_assertBytes(test->native, DEST + 0x100, unfiltered8, sizeof(unfiltered8));
+	_assertCyclesClose(cycles, 150);
+
+	_writeBytes(test->native, SOURCE, filtered16, sizeof(filtered16));
+	assert_false(_call(test->native, GBA_SWI_DIFF_16BIT_UNFILTER, SOURCE, DEST, 0, &cycles));
+	_assertBytes(test->native, DEST, unfiltered16, sizeof(unfiltered16));
+	_assertCyclesClose(cycles, 140);
+}
+
+M_TEST_SUITE_DEFINE_SETUP_TEARDOWN(GBABIOS,
+	cmocka_unit_test(cpuSet),
+	cmocka_unit_test(cpuFastSet),
+	cmocka_unit_test(cpuFastSetVRAM),
+	cmocka_unit_test(fallBack),
+	cmocka_unit_test(bitUnPack),
+	cmocka_unit_test(lz77),
+	cmocka_unit_test(huffman),
+	cmocka_unit_test(rl),
+	cmocka_unit_test(diff))
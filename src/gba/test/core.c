@@ -7,6 +7,9 @@
 
 #include <mgba/core/core.h>
 #include <mgba/gba/core.h>
+#include <mgba/internal/gba/gba.h>
+#include <mgba/internal/gba/io.h>
+#include <mgba-util/vfs.h>
 
 M_TEST_DEFINE(create) {
 	struct mCore* core = GBACoreCreate();
@@ -44,8 +47,78 @@ M_TEST_DEFINE(loadNullROM) {
 	core->deinit(core);
 }
 
+static void _assertRomWaitstates(struct GBA* gba, int nonseq16, int seq16, int nonseq32, int seq32) {
+	assert_int_equal(gba->memory.waitstatesNonseq16[GBA_REGION_ROM0], nonseq16);
+	assert_int_equal(gba->memory.waitstatesSeq16[GBA_REGION_ROM0], seq16);
+	assert_int_equal(gba->memory.waitstatesNonseq32[GBA_REGION_ROM0], nonseq32);
+	assert_int_equal(gba->memory.waitstatesSeq32[GBA_REGION_ROM0], seq32);
+}
+
+M_TEST_DEFINE(accuracy) {
+	static const struct {
+		const char* name;
+		enum mCoreAccuracy accuracy;
+		int nonseq16;
+		int seq16;
+		int nonseq32;
+		int seq32;
+		bool prefetch;
+		bool stall;
+	} tiers[] = {
+		{ "accurate", mCORE_ACCURACY_ACCURATE, 3, 1, 5, 3, true, true },
+		// Prefetch is folded into flat sequential costs
+		{ "relaxed", mCORE_ACCURACY_RELAXED, 3, 0, 5, 1, false, false },
+		// And non-sequential accesses cost the same as sequential ones
+		{ "fast", mCORE_ACCURACY_FAST, 0, 0, 1, 1, false, false },
+	};
+	size_t i;
+	for (i = 0; i < sizeof(tiers) / sizeof(*tiers); ++i) {
+		struct VFile* vf = VFileMemChunk(NULL, 0x1000);
+		vf->write(vf, &(uint32_t) { 0xEAFFFFFE }, 4); // b $00
+		struct mCore* core = GBACoreCreate();
+		assert_true(core->init(core));
+		mCoreInitConfig(core, NULL);
+		assert_true(core->loadROM(core, vf));
+		struct mCoreConfig config;
+		mCoreConfigInit(&config, NULL);
+		mCoreConfigSetValue(&config, "accuracy", tiers[i].name);
+		mCoreLoadForeignConfig(core, &config);
+		core->reset(core);
+
+		struct GBA* gba = core->board;
+		assert_int_equal(gba->accuracy, tiers[i].accuracy);
+		// 3/1 waitstates in ROM0, with prefetch
+		GBAIOWrite(gba, GBA_REG_WAITCNT, 0x4014);
+		_assertRomWaitstates(gba, tiers[i].nonseq16, tiers[i].seq16, tiers[i].nonseq32, tiers[i].seq32);
+		assert_int_equal(!!gba->memory.prefetch, tiers[i].prefetch);
+
+		// VRAM accesses only stall during HDraw of visible lines
+		while (gba->video.vcount != 1 || (gba->memory.io[GBA_REG(DISPSTAT)] & 0x0002)) {
+			core->runCycles(core, 32);
+		}
+		assert_int_equal(!!gba->video.shouldStall, tiers[i].stall);
+
+		// A missing or unknown setting goes back to the default
+		mCoreConfigSetValue(&config, "accuracy", "bogus");
+		mCoreLoadForeignConfig(core, &config);
+		assert_int_equal(gba->accuracy, mCORE_ACCURACY_ACCURATE);
+		mCoreConfigSetValue(&config, "accuracy", tiers[i].name);
+		mCoreLoadForeignConfig(core, &config);
+		mCoreConfigSetValue(&config, "accuracy", NULL);
+		mCoreLoadForeignConfig(core, &config);
+		assert_int_equal(gba->accuracy, mCORE_ACCURACY_ACCURATE);
+		_assertRomWaitstates(gba, 3, 1, 5, 3);
+		assert_true(gba->memory.prefetch);
+
+		mCoreConfigDeinit(&config);
+		mCoreConfigDeinit(&core->config);
+		core->deinit(core);
+	}
+}
+
 M_TEST_SUITE_DEFINE(GBACore,
 	cmocka_unit_test(create),
 	cmocka_unit_test(platform),
 	cmocka_unit_test(reset),
-	cmocka_unit_test(loadNullROM))
+	cmocka_unit_test(loadNullROM),
+	cmocka_unit_test(accuracy))
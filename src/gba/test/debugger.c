@@ -0,0 +1,255 @@
+/* Copyright (c) 2013-2024 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "util/test/suite.h"
+
+#include <mgba/core/core.h>
+#include <mgba/debugger/debugger.h>
+#include <mgba/gba/core.h>
+#include <mgba/internal/debugger/tracer.h>
+#include <mgba/internal/gba/gba.h>
+#include <mgba-util/vfs.h>
+
+#define WATCHED 0x03000100
+
+static const uint32_t _program[] = {
+	0xE3A00403, // mov r0, #0x03000000
+	0xE2800C01, // add r0, #0x100
+	0xE3A01005, // mov r1, #5
+	0xE5801000, // loop: str r1, [r0]
+	0xE5902000, // ldr r2, [r0]
+	0xE2811001, // add r1, #1
+	0xEAFFFFFB, // b loop
+};
+
+struct mTestDebugger {
+	struct mDebugger d;
+	struct mDebuggerModule module;
+	int reads;
+	int writes;
+	uint32_t lastValue;
+};
+
+static void _entered(struct mDebuggerModule* module, enum mDebuggerEntryReason reason, struct mDebuggerEntryInfo* info) {
+	struct mTestDebugger* debugger = (struct mTestDebugger*) module->p;
+	module->isPaused = false;
+	if (reason != DEBUGGER_ENTER_WATCHPOINT) {
+		return;
+	}
+	if (info->type.wp.accessType == WATCHPOINT_READ) {
+		++debugger->reads;
+	} else {
+		++debugger->writes;
+		debugger->lastValue = info->type.wp.newValue;
+	}
+}
+
+static struct mCore* _setup(struct mTestDebugger* debugger) {
+	struct VFile* vf = VFileMemChunk(NULL, 0x1000);
+	vf->write(vf, _program, sizeof(_program));
+	struct mCore* core = GBACoreCreate();
+	core->init(core);
+	mCoreInitConfig(core, NULL);
+	core->loadROM(core, vf);
+	core->reset(core);
+
+	memset(debugger, 0, sizeof(*debugger));
+	mDebuggerInit(&debugger->d);
+	mDebuggerAttach(&debugger->d, core);
+	debugger->module.type = DEBUGGER_CUSTOM;
+	debugger->module.entered = _entered;
+	mDebuggerAttachModule(&debugger->d, &debugger->module);
+	debugger->d.state = DEBUGGER_RUNNING;
+	return core;
+}
+
+static void _teardown(struct mCore* core, struct mTestDebugger* debugger) {
+	core->detachDebugger(core);
+	mDebuggerDeinit(&debugger->d);
+	mCoreConfigDeinit(&core->config);
+	core->deinit(core);
+}
+
+// Steps until enough watchpoint hits arrive, allowing for the BIOS boot sequence
+static void _stepUntil(struct mCore* core, const int* hits, int count) {
+	int i;
+	for (i = 0; i < 100 && *hits < count; ++i) {
+		core->step(core);
+	}
+}
+
+M_TEST_DEFINE(watchpointWrite) {
+	struct mTestDebugger debugger;
+	struct mCore* core = _setup(&debugger);
+	struct mWatchpoint watchpoint = {
+		.segment = -1,
+		.minAddress = WATCHED,
+		.maxAddress = WATCHED + 4,
+		.type = WATCHPOINT_WRITE,
+	};
+	debugger.d.platform->setWatchpoint(debugger.d.platform, &debugger.module, &watchpoint);
+
+	// Each hit has to leave the watchpoint armed for the next iteration
+	_stepUntil(core, &debugger.writes, 3);
+	assert_int_equal(debugger.writes, 3);
+	assert_int_equal(debugger.reads, 0);
+	assert_int_equal(debugger.lastValue, 7);
+	_teardown(core, &debugger);
+}
+
+M_TEST_DEFINE(watchpointRead) {
+	struct mTestDebugger debugger;
+	struct mCore* core = _setup(&debugger);
+	struct mWatchpoint watchpoint = {
+		.segment = -1,
+		.minAddress = WATCHED,
+		.maxAddress = WATCHED + 4,
+		.type = WATCHPOINT_READ,
+	};
+	debugger.d.platform->setWatchpoint(debugger.d.platform, &debugger.module, &watchpoint);
+
+	_stepUntil(core, &debugger.reads, 2);
+	assert_int_equal(debugger.reads, 2);
+	assert_int_equal(debugger.writes, 0);
+
+	// Side-effect-free reads, e.g. from a memory viewer, must not hit
+	assert_int_equal(core->rawRead32(core, WATCHED, -1), 6);
+	assert_int_equal(core->rawRead16(core, WATCHED, -1), 6);
+	assert_int_equal(core->rawRead8(core, WATCHED, -1), 6);
+	assert_int_equal(debugger.reads, 2);
+	_teardown(core, &debugger);
+}
+
+M_TEST_DEFINE(traceRoundTrip) {
+	struct mTestDebugger debugger;
+	struct mCore* core = _setup(&debugger);
+	struct mDebuggerTracer tracer;
+	mDebuggerTracerInit(&tracer);
+	mDebuggerAttachModule(&debugger.d, &tracer.d);
+
+	// Closing the tracer closes its file, but not the memory behind it
+	static uint8_t buffer[0x10000];
+	memset(buffer, 0, sizeof(buffer));
+	mDebuggerTracerFlags flags = mDebuggerTracerFlagsFillRegisters(mDebuggerTracerFlagsFillMemory(0));
+	assert_true(mDebuggerTracerOpen(&tracer, VFileFromMemory(buffer, sizeof(buffer)), flags));
+	// The instruction hook is only called from the run loop, not from single steps
+	int i;
+	for (i = 0; i < 100 && tracer.instructions < 40; ++i) {
+		core->runLoop(core);
+	}
+	uint64_t instructions = tracer.instructions;
+	assert_true(instructions >= 40);
+	assert_true(mDebuggerTracerClose(&tracer));
+	mDebuggerDetachModule(&debugger.d, &tracer.d);
+	mDebuggerTracerDeinit(&tracer);
+
+	struct mDebuggerTraceReader reader;
+	assert_true(mDebuggerTraceReaderOpen(&reader, VFileFromMemory(buffer, sizeof(buffer))));
+	assert_int_equal(reader.platform, mPLATFORM_GBA);
+	assert_int_equal(reader.flags, flags);
+
+	struct mDebuggerTraceRecord record;
+	uint64_t cycles = 0;
+	uint64_t lastCycles = 0;
+	uint32_t pc = 0;
+	uint32_t r1 = 0;
+	uint32_t stored = 5;
+	int read = 0;
+	while (mDebuggerTraceReaderNext(&reader, &record, &cycles)) {
+		assert_true(cycles >= lastCycles);
+		lastCycles = cycles;
+		switch (record.type) {
+		case mTRACE_RECORD_INSTRUCTION:
+			++read;
+			pc = record.address;
+			if (pc >= GBA_BASE_ROM0 && pc < GBA_BASE_ROM0 + sizeof(_program)) {
+				assert_int_equal(record.value, _program[(pc - GBA_BASE_ROM0) / 4]);
+			}
+			break;
+		case mTRACE_RECORD_REGISTER:
+			if (record.index == 1) {
+				r1 = record.value;
+			}
+			break;
+		case mTRACE_RECORD_MEMORY:
+			// Only the str in the loop writes, and it stores the current r1
+			assert_int_equal(pc, GBA_BASE_ROM0 + 12);
+			assert_int_equal(record.address, WATCHED);
+			assert_int_equal(record.index, 4);
+			assert_int_equal(record.value, stored);
+			assert_int_equal(record.value, r1);
+			++stored;
+			break;
+		default:
+			fail();
+		}
+	}
+	assert_int_equal(read, instructions);
+	assert_true(stored > 6);
+	mDebuggerTraceReaderClose(&reader);
+	// Tracing doesn't use watchpoints
+	assert_int_equal(debugger.writes, 0);
+	_teardown(core, &debugger);
+}
+
+M_TEST_DEFINE(traceWriteFailure) {
+	struct mTestDebugger debugger;
+	struct mCore* core = _setup(&debugger);
+	struct mDebuggerTracer tracer;
+	mDebuggerTracerInit(&tracer);
+	mDebuggerAttachModule(&debugger.d, &tracer.d);
+
+	// Room for the file header and a block header, but not a block
+	static uint8_t buffer[0x40];
+	mDebuggerTracerFlags flags = mDebuggerTracerFlagsFillRegisters(mDebuggerTracerFlagsFillMemory(0));
+	assert_true(mDebuggerTracerOpen(&tracer, VFileFromMemory(buffer, sizeof(buffer)), flags));
+	int i;
+	for (i = 0; i < 1000 && !tracer.failed; ++i) {
+		core->runLoop(core);
+	}
+	assert_true(tracer.failed);
+
+	// Nothing more is recorded once a block is lost
+	uint64_t instructions = tracer.instructions;
+	core->runLoop(core);
+	assert_int_equal(tracer.instructions, instructions);
+	assert_false(mDebuggerTracerClose(&tracer));
+	mDebuggerDetachModule(&debugger.d, &tracer.d);
+	mDebuggerTracerDeinit(&tracer);
+	_teardown(core, &debugger);
+}
+
+M_TEST_DEFINE(traceCorruptBlock) {
+	struct mTestDebugger debugger;
+	struct mCore* core = _setup(&debugger);
+	struct mDebuggerTracer tracer;
+	mDebuggerTracerInit(&tracer);
+	mDebuggerAttachModule(&debugger.d, &tracer.d);
+
+	static uint8_t buffer[0x40];
+	memset(buffer, 0, sizeof(buffer));
+	assert_true(mDebuggerTracerOpen(&tracer, VFileFromMemory(buffer, sizeof(buffer)), 0));
+	assert_true(mDebuggerTracerClose(&tracer));
+	mDebuggerDetachModule(&debugger.d, &tracer.d);
+	mDebuggerTracerDeinit(&tracer);
+
+	// A compressed block claiming to be far longer than one can be
+	STORE_32LE(0xFFFFFFF0, 0x20, buffer);
+	STORE_32LE(1, 0x24, buffer);
+	STORE_32LE(1, 0x28, buffer);
+	struct mDebuggerTraceReader reader;
+	assert_true(mDebuggerTraceReaderOpen(&reader, VFileFromMemory(buffer, sizeof(buffer))));
+	struct mDebuggerTraceRecord record;
+	assert_false(mDebuggerTraceReaderNext(&reader, &record, NULL));
+	mDebuggerTraceReaderClose(&reader);
+	_teardown(core, &debugger);
+}
+
+M_TEST_SUITE_DEFINE(GBADebugger,
+	cmocka_unit_test(watchpointWrite),
+	cmocka_unit_test(watchpointRead),
+	cmocka_unit_test(traceRoundTrip),
+	cmocka_unit_test(traceWriteFailure),
+	cmocka_unit_test(traceCorruptBlock))
@@ -0,0 +1,360 @@
+/* Copyright (c) 2013-2024 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "util/test/suite.h"
+
+#include <mgba/core/core.h>
+#include <mgba/gba/core.h>
+#include <mgba/internal/gba/gba.h>
+#include <mgba/internal/gba/io.h>
+#include <mgba/internal/gba/memory.h>
+#include <mgba/internal/gba/renderers/parallel.h>
+#include <mgba/internal/gba/renderers/video-software.h>
+#include <mgba-util/memory.h>
+#include <mgba-util/vfs.h>
+
+#define STRIDE GBA_VIDEO_HORIZONTAL_PIXELS
+#define OBJ_X 40
+#define OBJ_Y 80
+// The last OAM entry, so its index can't be mistaken for mPROVENANCE_OBJECT_NONE
+#define OBJ_INDEX 127
+
+struct mTestMemory {
+	uint16_t* vram;
+	uint16_t palette[GBA_SIZE_PALETTE_RAM >> 1];
+	union GBAOAM oam;
+};
+
+static void _initMemory(struct mTestMemory* memory) {
+	memory->vram = anonymousMemoryMap(GBA_SIZE_VRAM);
+	memset(memory->palette, 0, sizeof(memory->palette));
+	memset(&memory->oam, 0, sizeof(memory->oam));
+
+	// A 128x128 affine BG2 using 256-color tiles 0-63, with its map at screen block 8
+	uint8_t* vram = (uint8_t*) memory->vram;
+	int i;
+	for (i = 0; i < 64 * 64; ++i) {
+		vram[i] = ((i >> 6) * 7 + i) | 1;
+	}
+	for (i = 0; i < 16 * 16; ++i) {
+		vram[0x4000 + i] = i & 63;
+	}
+	for (i = 0; i < 256; ++i) {
+		memory->palette[i] = (i * 0x111) & 0x7FFF;
+	}
+}
+
+static void _attach(struct GBAVideoRenderer* renderer, struct mTestMemory* memory) {
+	renderer->vram = memory->vram;
+	renderer->palette = memory->palette;
+	renderer->oam = &memory->oam;
+	renderer->cache = NULL;
+	renderer->init(renderer);
+	renderer->reset(renderer);
+	int i;
+	for (i = 0; i < 256; ++i) {
+		renderer->writePalette(renderer, i << 1, memory->palette[i]);
+	}
+	renderer->writeVRAMRange(renderer, 0, GBA_SIZE_VRAM);
+}
+
+static void _createSoftware(struct GBAVideoSoftwareRenderer* renderer) {
+	GBAVideoSoftwareRendererCreate(renderer);
+	renderer->outputBuffer = calloc(STRIDE * GBA_VIDEO_VERTICAL_PIXELS, sizeof(color_t));
+	renderer->outputBufferStride = STRIDE;
+}
+
+static void _writeDISPCNT(struct GBAVideoRenderer* renderer, uint16_t value) {
+	renderer->writeVideoRegister(renderer, GBA_REG_DISPCNT, value);
+}
+
+// Draws a frame in mode 1 with a sheared affine BG2. Forced blank covers a band
+// boundary, and BG0 is enabled while it's on, so both the affine reference
+// points and the BG enable delay have to be carried through skipped lines.
+static void _drawFrame(struct GBAVideoRenderer* renderer) {
+	int y;
+	for (y = 0; y < GBA_VIDEO_VERTICAL_PIXELS; ++y) {
+		switch (y) {
+		case 0:
+			renderer->writeVideoRegister(renderer, GBA_REG_BG0CNT, 0x0A00);
+			renderer->writeVideoRegister(renderer, GBA_REG_BG2CNT, 0x0801);
+			renderer->writeVideoRegister(renderer, GBA_REG_BG2PA, 0x0100);
+			renderer->writeVideoRegister(renderer, GBA_REG_BG2PB, 0x0030);
+			renderer->writeVideoRegister(renderer, GBA_REG_BG2PC, 0x0000);
+			renderer->writeVideoRegister(renderer, GBA_REG_BG2PD, 0x0100);
+			_writeDISPCNT(renderer, 0x0401);
+			break;
+		case 30:
+			_writeDISPCNT(renderer, 0x0481);
+			break;
+		case 36:
+			_writeDISPCNT(renderer, 0x0581);
+			break;
+		case 50:
+			_writeDISPCNT(renderer, 0x0501);
+			break;
+		case 100:
+			// A new reference point mid-frame
+			renderer->writeVideoRegister(renderer, GBA_REG_BG2X_LO, 0x0400);
+			renderer->writeVideoRegister(renderer, GBA_REG_BG2X_HI, 0x0000);
+			break;
+		case 130:
+			_writeDISPCNT(renderer, 0x0481);
+			break;
+		case 150:
+			_writeDISPCNT(renderer, 0x0401);
+			break;
+		}
+		renderer->drawScanline(renderer, y);
+	}
+	renderer->finishFrame(renderer);
+	_writeDISPCNT(renderer, 0x0080);
+	renderer->writeVideoRegister(renderer, GBA_REG_BG2X_LO, 0);
+}
+
+#ifndef DISABLE_THREADING
+M_TEST_DEFINE(parallelMatchesSerial) {
+	struct mTestMemory memory;
+	_initMemory(&memory);
+
+	struct GBAVideoSoftwareRenderer serial;
+	_createSoftware(&serial);
+	_attach(&serial.d, &memory);
+
+	struct GBAVideoSoftwareRenderer primary;
+	_createSoftware(&primary);
+	struct GBAVideoParallelRenderer parallel;
+	GBAVideoParallelRendererCreate(&parallel, &primary, 4);
+	_attach(&parallel.d, &memory);
+
+	// The second frame is served partly from each renderer's scanline cache
+	int frame;
+	for (frame = 0; frame < 2; ++frame) {
+		_drawFrame(&serial.d);
+		_drawFrame(&parallel.d);
+		size_t stride;
+		const void* pixels;
+		parallel.d.getPixels(&parallel.d, &stride, &pixels);
+		assert_int_equal(stride, STRIDE);
+		const color_t* expected = serial.outputBuffer;
+		const color_t* actual = pixels;
+		int y;
+		for (y = 0; y < GBA_VIDEO_VERTICAL_PIXELS; ++y) {
+			assert_memory_equal(&actual[STRIDE * y], &expected[STRIDE * y], GBA_VIDEO_HORIZONTAL_PIXELS * sizeof(color_t));
+		}
+	}
+
+	parallel.d.deinit(&parallel.d);
+	serial.d.deinit(&serial.d);
+	free(serial.outputBuffer);
+	free(primary.outputBuffer);
+	mappedMemoryFree(memory.vram, GBA_SIZE_VRAM);
+}
+#endif
+
+static bool _isDirty(const struct GBAVideoSoftwareRenderer* renderer, int y) {
+	return renderer->scanlineDirty[y >> 5] & (1U << (y & 0x1F));
+}
+
+static void _fillTile(struct GBAVideoRenderer* renderer, unsigned tile, uint16_t value) {
+	unsigned i;
+	for (i = 0; i < 16; ++i) {
+		renderer->vram[tile * 16 + i] = value;
+	}
+	renderer->writeVRAMRange(renderer, tile * 32, 32);
+}
+
+static void _drawTextFrame(struct GBAVideoRenderer* renderer) {
+	int y;
+	for (y = 0; y < GBA_VIDEO_VERTICAL_PIXELS; ++y) {
+		renderer->drawScanline(renderer, y);
+	}
+	renderer->finishFrame(renderer);
+}
+
+M_TEST_DEFINE(vramReferences) {
+	struct mTestMemory memory;
+	_initMemory(&memory);
+
+	// A text BG0 with its map at screen block 8, scrolled down 5 rows. The top
+	// 64 lines use tile 16, the rest tile 32, and tile 48 isn't used. Each is in
+	// its own 512 bytes.
+	unsigned i;
+	for (i = 0; i < 32 * 32; ++i) {
+		memory.vram[0x2000 + i] = i >= 32 * 5 && i < 32 * 13 ? 16 : 32;
+	}
+	struct GBAVideoSoftwareRenderer incremental;
+	_createSoftware(&incremental);
+	_attach(&incremental.d, &memory);
+	_fillTile(&incremental.d, 16, 0x1111);
+	_fillTile(&incremental.d, 32, 0x2222);
+	_fillTile(&incremental.d, 48, 0x3333);
+	incremental.d.writeVideoRegister(&incremental.d, GBA_REG_BG0CNT, 0x0800);
+	incremental.d.writeVideoRegister(&incremental.d, GBA_REG_BG0VOFS, 40);
+	_writeDISPCNT(&incremental.d, 0x0100);
+	_drawTextFrame(&incremental.d);
+
+	int y;
+	for (y = 0; y < GBA_VIDEO_VERTICAL_PIXELS; ++y) {
+		assert_false(_isDirty(&incremental, y));
+	}
+
+	// Data nothing on screen reads doesn't dirty any lines
+	_fillTile(&incremental.d, 48, 0x4444);
+	for (y = 0; y < GBA_VIDEO_VERTICAL_PIXELS; ++y) {
+		assert_false(_isDirty(&incremental, y));
+	}
+
+	// Map row 24 is still cached from the end of the last frame, and it's the
+	// only row in its block on screen, so only lines 152-159 read it
+	memory.vram[0x2000 + 32 * 24 + 4] = 48;
+	incremental.d.writeVRAMRange(&incremental.d, 0x4000 + (32 * 24 + 4) * 2, 2);
+	for (y = 0; y < GBA_VIDEO_VERTICAL_PIXELS; ++y) {
+		assert_int_equal(_isDirty(&incremental, y), y >= 152);
+	}
+	_drawTextFrame(&incremental.d);
+
+	// A tile only dirties the lines that show it
+	_fillTile(&incremental.d, 16, 0x5555);
+	for (y = 0; y < GBA_VIDEO_VERTICAL_PIXELS; ++y) {
+		assert_int_equal(_isDirty(&incremental, y), y < 64);
+	}
+	_drawTextFrame(&incremental.d);
+
+	// Redrawing only the dirty lines matches drawing everything from scratch
+	struct GBAVideoSoftwareRenderer full;
+	_createSoftware(&full);
+	_attach(&full.d, &memory);
+	full.d.writeVideoRegister(&full.d, GBA_REG_BG0CNT, 0x0800);
+	full.d.writeVideoRegister(&full.d, GBA_REG_BG0VOFS, 40);
+	_writeDISPCNT(&full.d, 0x0100);
+	_drawTextFrame(&full.d);
+	for (y = 0; y < GBA_VIDEO_VERTICAL_PIXELS; ++y) {
+		assert_memory_equal(&incremental.outputBuffer[STRIDE * y], &full.outputBuffer[STRIDE * y], GBA_VIDEO_HORIZONTAL_PIXELS * sizeof(color_t));
+	}
+
+	incremental.d.deinit(&incremental.d);
+	full.d.deinit(&full.d);
+	free(incremental.outputBuffer);
+	free(full.outputBuffer);
+	mappedMemoryFree(memory.vram, GBA_SIZE_VRAM);
+}
+
+#ifndef COLOR_16_BIT
+struct mTestCore {
+	struct mCore* core;
+	color_t* video;
+};
+
+// BG0 covers the top 64 lines, and a single object sits below them over the backdrop
+static void _createCore(struct mTestCore* test) {
+	struct VFile* vf = VFileMemChunk(NULL, 0x1000);
+	// b .
+	static const uint8_t loop[] = { 0xFE, 0xFF, 0xFF, 0xEA };
+	vf->write(vf, loop, sizeof(loop));
+	struct mCore* core = GBACoreCreate();
+	core->init(core);
+	mCoreInitConfig(core, NULL);
+	test->video = calloc(STRIDE * GBA_VIDEO_VERTICAL_PIXELS, BYTES_PER_PIXEL);
+	core->setVideoBuffer(core, test->video, STRIDE);
+	core->loadROM(core, vf);
+	core->reset(core);
+	test->core = core;
+
+	uint32_t i;
+	// Tile 1 of BG0 is color 1, and tile 0 of the objects is color 2
+	for (i = 0; i < 0x20; i += 2) {
+		core->rawWrite16(core, GBA_BASE_VRAM + i, -1, 0);
+		core->rawWrite16(core, GBA_BASE_VRAM + 0x20 + i, -1, 0x1111);
+		core->rawWrite16(core, GBA_BASE_VRAM + 0x10000 + i, -1, 0x2222);
+	}
+	for (i = 0; i < 32 * 32; ++i) {
+		core->rawWrite16(core, GBA_BASE_VRAM + 0x4000 + i * 2, -1, i < 32 * 8);
+	}
+	for (i = 0; i < GBA_SIZE_OAM; i += 8) {
+		// Disabled
+		core->rawWrite16(core, GBA_BASE_OAM + i, -1, 0x0200);
+	}
+	core->rawWrite16(core, GBA_BASE_OAM + OBJ_INDEX * 8, -1, OBJ_Y);
+	core->rawWrite16(core, GBA_BASE_OAM + OBJ_INDEX * 8 + 2, -1, OBJ_X);
+	core->rawWrite16(core, GBA_BASE_OAM + OBJ_INDEX * 8 + 4, -1, 0);
+	core->rawWrite16(core, GBA_BASE_PALETTE_RAM, -1, 0x7FFF);
+	core->rawWrite16(core, GBA_BASE_PALETTE_RAM + 2, -1, 0x001F);
+	core->rawWrite16(core, GBA_BASE_PALETTE_RAM + 0x200 + 4, -1, 0x03E0);
+
+	struct GBA* gba = core->board;
+	GBAIOWrite(gba, GBA_REG_BG0CNT, 0x0800);
+	GBAIOWrite(gba, GBA_REG_DISPCNT, 0x1140);
+}
+
+static void _destroyCore(struct mTestCore* test) {
+	mCoreConfigDeinit(&test->core->config);
+	test->core->deinit(test->core);
+	free(test->video);
+}
+
+M_TEST_DEFINE(layerOutput) {
+	struct mTestCore plain;
+	struct mTestCore layered;
+	_createCore(&plain);
+	_createCore(&layered);
+
+	size_t pixels = STRIDE * GBA_VIDEO_VERTICAL_PIXELS;
+	uint32_t* bg0 = calloc(pixels, sizeof(uint32_t));
+	uint32_t* obj = calloc(pixels, sizeof(uint32_t));
+	mPixelProvenance* provenance = calloc(pixels, sizeof(mPixelProvenance));
+	struct mVideoLayerOutput output = {
+		.layers = {
+			[GBA_LAYER_BG0] = bg0,
+			[GBA_LAYER_OBJ] = obj,
+		},
+		.provenance = provenance,
+		.stride = STRIDE,
+	};
+	layered.core->setVideoLayerOutput(layered.core, &output);
+
+	int i;
+	for (i = 0; i < 2; ++i) {
+		plain.core->runFrame(plain.core);
+		layered.core->runFrame(layered.core);
+	}
+
+	// Writing out the layers mustn't change the frame itself
+	assert_memory_equal(plain.video, layered.video, pixels * BYTES_PER_PIXEL);
+
+	size_t bgPixel = 10 * STRIDE + 10;
+	size_t objPixel = (OBJ_Y + 2) * STRIDE + OBJ_X + 2;
+	size_t backdropPixel = 120 * STRIDE + 120;
+	assert_int_equal(mPixelProvenanceGetLayer(provenance[bgPixel]), GBA_LAYER_BG0);
+	assert_int_equal(mPixelProvenanceGetPalette(provenance[bgPixel]), 1);
+	assert_int_equal(mPixelProvenanceGetObject(provenance[bgPixel]), mPROVENANCE_OBJECT_NONE);
+	assert_int_equal(mPixelProvenanceGetLayer(provenance[objPixel]), GBA_LAYER_OBJ);
+	assert_int_equal(mPixelProvenanceGetPalette(provenance[objPixel]), 0x102);
+	assert_int_equal(mPixelProvenanceGetObject(provenance[objPixel]), OBJ_INDEX);
+	assert_false(mPixelProvenanceIsBlended(provenance[objPixel]));
+	assert_int_equal(mPixelProvenanceGetLayer(provenance[backdropPixel]), mPROVENANCE_LAYER_BACKDROP);
+	assert_int_not_equal(bg0[bgPixel], 0);
+	assert_int_equal(bg0[objPixel], 0);
+	assert_int_equal(obj[bgPixel], 0);
+	assert_int_not_equal(obj[objPixel], 0);
+
+	layered.core->setVideoLayerOutput(layered.core, NULL);
+	free(bg0);
+	free(obj);
+	free(provenance);
+	_destroyCore(&plain);
+	_destroyCore(&layered);
+}
+#endif
+
+M_TEST_SUITE_DEFINE(GBARenderer,
+#ifndef DISABLE_THREADING
+	cmocka_unit_test(parallelMatchesSerial),
+#endif
+	cmocka_unit_test(vramReferences),
+#ifndef COLOR_16_BIT
+	cmocka_unit_test(layerOutput),
+#endif
+)
@@ -0,0 +1,136 @@
+/* Copyright (c) 2013-2024 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "util/test/suite.h"
+
+#include <mgba/core/core.h>
+#include <mgba/core/run-until.h>
+#include <mgba/gba/core.h>
+#include <mgba/internal/gba/gba.h>
+#include <mgba/internal/gba/io.h>
+#include <mgba/internal/gba/memory.h>
+#include <mgba/internal/gba/video.h>
+#include <mgba-util/vfs.h>
+
+// A store from ROM with default waitstates, plus a refill of the prefetch buffer
+#define MAX_OVERRUN 32
+
+#define COUNTER GBA_BASE_IWRAM
+
+static const uint32_t _program[] = {
+	0xE3A00403, // $00: mov r0, #0x03000000
+	0xE3A01000, // $04: mov r1, #0
+	0xE2811001, // $08: add r1, #1
+	0xE5C01000, // $0C: strb r1, [r0]
+	0xEAFFFFFC, // $10: b $08
+};
+
+M_TEST_SUITE_SETUP(GBARunUntil) {
+	struct VFile* vf = VFileMemChunk(NULL, 0x1000);
+	vf->write(vf, _program, sizeof(_program));
+
+	struct mCore* core = GBACoreCreate();
+	core->init(core);
+	mCoreInitConfig(core, NULL);
+	core->loadROM(core, vf);
+	*state = core;
+	return 0;
+}
+
+M_TEST_SUITE_TEARDOWN(GBARunUntil) {
+	if (!*state) {
+		return 0;
+	}
+	struct mCore* core = *state;
+	mCoreConfigDeinit(&core->config);
+	core->deinit(core);
+	return 0;
+}
+
+M_TEST_DEFINE(runCycles) {
+	struct mCore* core = *state;
+	core->reset(core);
+	assert_int_equal(core->runCycles(core, 0), 0);
+
+	int i;
+	for (i = 1; i < 2000; i += 37) {
+		uint64_t ran = core->runCycles(core, i);
+		assert_true(ran >= (uint64_t) i);
+		assert_true(ran < (uint64_t) i + MAX_OVERRUN);
+	}
+	// Longer than the 32-bit cycle counter can represent
+	uint64_t ran = core->runCycles(core, 0x180000000ULL);
+	assert_true(ran >= 0x180000000ULL);
+	assert_true(ran < 0x180000000ULL + MAX_OVERRUN);
+}
+
+M_TEST_DEFINE(runUntilPC) {
+	struct mCore* core = *state;
+	core->reset(core);
+	struct mRunPredicate predicates[] = {
+		{ .type = mRUN_UNTIL_PC, .address = GBA_BASE_EWRAM },
+		{ .type = mRUN_UNTIL_PC, .address = GBA_BASE_ROM0 + 0x0C },
+	};
+	uint64_t ran;
+	int i;
+	for (i = 0; i < 4; ++i) {
+		assert_int_equal(core->runUntil(core, predicates, 2, 0, &ran), 1);
+		assert_true(ran > 0);
+		int32_t pc;
+		assert_true(core->readRegister(core, "pc", &pc));
+		// The PC register holds the address of the next fetch
+		assert_int_equal(pc, GBA_BASE_ROM0 + 0x0C + 4);
+		assert_int_equal(core->rawRead8(core, COUNTER, -1), i);
+	}
+
+	// Unreachable targets run out the limit instead
+	assert_int_equal(core->runUntil(core, predicates, 1, 1000, &ran), -1);
+	assert_true(ran >= 1000);
+	assert_true(ran < 1000 + MAX_OVERRUN);
+}
+
+M_TEST_DEFINE(runUntilMemoryChange) {
+	struct mCore* core = *state;
+	core->reset(core);
+	struct mRunPredicate predicate = { .type = mRUN_UNTIL_MEMORY_CHANGE, .address = COUNTER };
+	uint64_t ran;
+	int i;
+	for (i = 0; i < 3; ++i) {
+		uint8_t value = core->rawRead8(core, COUNTER, -1);
+		assert_int_equal(core->runUntil(core, &predicate, 1, 0, &ran), 0);
+		assert_int_equal(core->rawRead8(core, COUNTER, -1), (uint8_t) (value + 1));
+		assert_true(ran < 100);
+	}
+
+	// Neighbouring bytes aren't touched
+	predicate.address = COUNTER + 1;
+	assert_int_equal(core->runUntil(core, &predicate, 1, 10000, &ran), -1);
+}
+
+M_TEST_DEFINE(runUntilIRQ) {
+	struct mCore* core = *state;
+	core->reset(core);
+	struct GBA* gba = core->board;
+	// Only request VBlank; IE is left clear so the CPU never takes it
+	GBAIOWrite(gba, GBA_REG_DISPSTAT, 0x0008);
+	struct mRunPredicate predicate = { .type = mRUN_UNTIL_IRQ, .irqMask = 1 << GBA_IRQ_VBLANK };
+	uint64_t ran;
+	assert_int_equal(core->runUntil(core, &predicate, 1, 0, &ran), 0);
+	assert_true(gba->memory.io[GBA_REG(IF)] & (1 << GBA_IRQ_VBLANK));
+
+	gba->memory.io[GBA_REG(IF)] = 0;
+	assert_int_equal(core->runUntil(core, &predicate, 1, 0, &ran), 0);
+	assert_true(ran + MAX_OVERRUN > VIDEO_TOTAL_LENGTH);
+	assert_true(ran < VIDEO_TOTAL_LENGTH + MAX_OVERRUN);
+
+	predicate.irqMask = 1 << GBA_IRQ_SIO;
+	assert_int_equal(core->runUntil(core, &predicate, 1, VIDEO_TOTAL_LENGTH * 2, &ran), -1);
+}
+
+M_TEST_SUITE_DEFINE_SETUP_TEARDOWN(GBARunUntil,
+	cmocka_unit_test(runCycles),
+	cmocka_unit_test(runUntilPC),
+	cmocka_unit_test(runUntilMemoryChange),
+	cmocka_unit_test(runUntilIRQ))
@@ -23,6 +23,7 @@ static void GBAVideoDummyRendererReset(struct GBAVideoRenderer* renderer);
 static void GBAVideoDummyRendererDeinit(struct GBAVideoRenderer* renderer);
 static uint16_t GBAVideoDummyRendererWriteVideoRegister(struct GBAVideoRenderer* renderer, uint32_t address, uint16_t value);
 static void GBAVideoDummyRendererWriteVRAM(struct GBAVideoRenderer* renderer, uint32_t address);
+static void GBAVideoDummyRendererWriteVRAMRange(struct GBAVideoRenderer* renderer, uint32_t address, uint32_t size);
 static void GBAVideoDummyRendererWritePalette(struct GBAVideoRenderer* renderer, uint32_t address, uint16_t value);
 static void GBAVideoDummyRendererWriteOAM(struct GBAVideoRenderer* renderer, uint32_t oam);
 static void GBAVideoDummyRendererDrawScanline(struct GBAVideoRenderer* renderer, int y);
@@ -103,6 +104,7 @@ void GBAVideoDummyRendererCreate(struct GBAVideoRenderer* renderer) {
 		.deinit = GBAVideoDummyRendererDeinit,
 		.writeVideoRegister = GBAVideoDummyRendererWriteVideoRegister,
 		.writeVRAM = GBAVideoDummyRendererWriteVRAM,
+		.writeVRAMRange = GBAVideoDummyRendererWriteVRAMRange,
 		.writePalette = GBAVideoDummyRendererWritePalette,
 		.writeOAM = GBAVideoDummyRendererWriteOAM,
 		.drawScanline = GBAVideoDummyRendererDrawScanline,
@@ -121,6 +123,7 @@ void GBAVideoAssociateRenderer(struct GBAVideo* video, struct GBAVideoRenderer*
 		renderer->cache = NULL;
 	}
 	video->renderer = renderer;
+	renderer->repeatFrame = false;
 	renderer->palette = video->palette;
 	renderer->vram = video->vram;
 	renderer->oam = &video->oam;
@@ -148,7 +151,7 @@ void _startHdraw(struct mTiming* timing, void* context, uint32_t cyclesLate) {
 	}
 	video->p->memory.io[GBA_REG(VCOUNT)] = video->vcount;
 
-	if (video->vcount < GBA_VIDEO_VERTICAL_PIXELS) {
+	if (video->vcount < GBA_VIDEO_VERTICAL_PIXELS && video->p->accuracy == mCORE_ACCURACY_ACCURATE) {
 		video->shouldStall = 1;
 	}
 
@@ -182,7 +185,7 @@ void _startHdraw(struct mTiming* timing, void* context, uint32_t cyclesLate) {
 		mCoreSyncPostFrame(video->p->sync);
 		--video->frameskipCounter;
 		if (video->frameskipCounter < 0) {
-			video->frameskipCounter = video->frameskip;
+			video->frameskipCounter = mCoreSyncFrameskip(video->p->sync, video->frameskip);
 		}
 		++video->frameCounter;
 		video->p->earlyExit = true;
@@ -287,6 +290,12 @@ static void GBAVideoDummyRendererWriteVRAM(struct GBAVideoRenderer* renderer, ui
 	}
 }
 
+static void GBAVideoDummyRendererWriteVRAMRange(struct GBAVideoRenderer* renderer, uint32_t address, uint32_t size) {
+	if (renderer->cache) {
+		mCacheSetWriteVRAMRange(renderer->cache, address, size);
+	}
+}
+
 static void GBAVideoDummyRendererWritePalette(struct GBAVideoRenderer* renderer, uint32_t address, uint16_t value) {
 	if (renderer->cache) {
 		mCacheSetWritePalette(renderer->cache, address >> 1, mColorFrom555(value));
@@ -341,6 +350,9 @@ void GBAVideoSerialize(const struct GBAVideo* video, struct GBASerializedState*
 
 void GBAVideoDeserialize(struct GBAVideo* video, const struct GBASerializedState* state) {
 	memcpy(video->vram, state->vram, GBA_SIZE_VRAM);
+	// Loading a state isn't an access by the game, so it shouldn't trip watchpoints
+	struct mWatchpointPages* watchpointPages = video->p->cpu->watchpointPages;
+	video->p->cpu->watchpointPages = NULL;
 	uint16_t value;
 	int i;
 	for (i = 0; i < GBA_SIZE_OAM; i += 2) {
@@ -351,6 +363,7 @@ void GBAVideoDeserialize(struct GBAVideo* video, const struct GBASerializedState
 		LOAD_16(value, i, state->pram);
 		GBAStore16(video->p->cpu, GBA_BASE_PALETTE_RAM | i, value, 0);
 	}
+	video->p->cpu->watchpointPages = watchpointPages;
 	LOAD_32(video->frameCounter, 0, &state->video.frameCounter);
 
 	video->shouldStall = 0;
@@ -370,7 +383,7 @@ void GBAVideoDeserialize(struct GBAVideo* video, const struct GBASerializedState
 		break;
 	case 2:
 		video->event.callback = _startHblank;
-		video->shouldStall = 1;
+		video->shouldStall = video->p->accuracy == mCORE_ACCURACY_ACCURATE;
 		break;
 	case 3:
 		video->event.callback = _startHdraw;
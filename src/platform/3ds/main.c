@@ -836,6 +836,7 @@ int main(int argc, char* argv[]) {
 
 	stream.videoDimensionsChanged = 0;
 	stream.postVideoFrame = 0;
+	stream.postVideoFrameRepeat = 0;
 	stream.postAudioFrame = 0;
 	stream.postAudioBuffer = _postAudioBuffer;
 
@@ -17,13 +17,183 @@
 
 #ifndef DISABLE_ANON_MMAP
 #include <sys/mman.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+
+#define HUGE_PAGE_SIZE 0x200000
+
+#ifdef __linux__
+#ifndef MAP_HUGETLB
+#define MAP_HUGETLB 0x40000
+#endif
+#ifndef MPOL_PREFERRED
+#define MPOL_PREFERRED 1
+#endif
+#ifndef MPOL_MF_MOVE
+#define MPOL_MF_MOVE (1 << 1)
+#endif
+#endif
+
+static enum mHugePageMode _hugePages = mHUGE_PAGES_NONE;
+
+// Mappings that are large enough to hold a huge page are always sized in
+// whole huge pages so they can be unmapped the same way regardless of how
+// they ended up being backed
+static size_t _mappedSize(size_t size) {
+	if (size < HUGE_PAGE_SIZE) {
+		return size;
+	}
+	return (size + HUGE_PAGE_SIZE - 1) & ~(size_t) (HUGE_PAGE_SIZE - 1);
+}
+
+static void* _hugeMemoryMap(size_t size) {
+	void* memory;
+#ifdef __linux__
+	if (_hugePages == mHUGE_PAGES_EXPLICIT) {
+		memory = mmap(0, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANON | MAP_HUGETLB, -1, 0);
+		if (memory != MAP_FAILED) {
+			return memory;
+		}
+		// No huge pages reserved, fall back to transparent huge pages
+	}
+#endif
+
+	// Over-allocate so the mapping can be trimmed to a huge page boundary
+	uint8_t* base = mmap(0, size + HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANON, -1, 0);
+	if ((void*) base == MAP_FAILED) {
+		return MAP_FAILED;
+	}
+	uintptr_t aligned = ((uintptr_t) base + HUGE_PAGE_SIZE - 1) & ~(uintptr_t) (HUGE_PAGE_SIZE - 1);
+	size_t head = aligned - (uintptr_t) base;
+	if (head) {
+		munmap(base, head);
+	}
+	munmap((void*) (aligned + size), HUGE_PAGE_SIZE - head);
+	memory = (void*) aligned;
+#ifdef MADV_HUGEPAGE
+	madvise(memory, size, MADV_HUGEPAGE);
+#endif
+	return memory;
+}
 
 void* anonymousMemoryMap(size_t size) {
-	return mmap(0, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANON, -1, 0);
+	size = _mappedSize(size);
+	void* memory;
+	if (_hugePages != mHUGE_PAGES_NONE && size >= HUGE_PAGE_SIZE) {
+		memory = _hugeMemoryMap(size);
+	} else {
+		memory = mmap(0, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANON, -1, 0);
+	}
+	// Fail the same way as the other platforms
+	if (memory == MAP_FAILED) {
+		return NULL;
+	}
+	return memory;
 }
 
 void mappedMemoryFree(void* memory, size_t size) {
-	munmap(memory, size);
+	munmap(memory, _mappedSize(size));
+}
+
+void* mappedMemoryResize(void* memory, size_t oldSize, size_t newSize) {
+	oldSize = _mappedSize(oldSize);
+	newSize = _mappedSize(newSize);
+	if (oldSize == newSize) {
+		return memory;
+	}
+	void* newMemory;
+#ifdef MREMAP_MAYMOVE
+	newMemory = mremap(memory, oldSize, newSize, MREMAP_MAYMOVE);
+	if (newMemory != MAP_FAILED) {
+		return newMemory;
+	}
+	// Explicit huge page mappings can't always be remapped, so copy instead
+#endif
+	newMemory = anonymousMemoryMap(newSize);
+	if (!newMemory) {
+		return NULL;
+	}
+	memcpy(newMemory, memory, oldSize < newSize ? oldSize : newSize);
+	munmap(memory, oldSize);
+	return newMemory;
+}
+
+// Whole pages are handed back to the system rather than zeroed in place, so
+// clearing memory that was never used doesn't make it resident
+void mappedMemoryClear(void* memory, size_t size) {
+	long pageSize = sysconf(_SC_PAGESIZE);
+	uintptr_t start = ((uintptr_t) memory + pageSize - 1) & ~(uintptr_t) (pageSize - 1);
+	uintptr_t end = ((uintptr_t) memory + size) & ~(uintptr_t) (pageSize - 1);
+	if (end <= start || madvise((void*) start, end - start, MADV_DONTNEED) != 0) {
+		memset(memory, 0, size);
+		return;
+	}
+	memset(memory, 0, start - (uintptr_t) memory);
+	memset((void*) end, 0, (uintptr_t) memory + size - end);
+}
+
+size_t mappedMemoryResident(const void* memory, size_t size) {
+	if (!size) {
+		return 0;
+	}
+	long pageSize = sysconf(_SC_PAGESIZE);
+	uintptr_t start = (uintptr_t) memory & ~(uintptr_t) (pageSize - 1);
+	uintptr_t end = ((uintptr_t) memory + size + pageSize - 1) & ~(uintptr_t) (pageSize - 1);
+	size_t pages = (end - start) / pageSize;
+	unsigned char* vec = malloc(pages);
+	if (!vec) {
+		return size;
+	}
+	size_t resident = size;
+	if (mincore((void*) start, end - start, (void*) vec) == 0) {
+		resident = 0;
+		size_t i;
+		for (i = 0; i < pages; ++i) {
+			if (vec[i] & 1) {
+				resident += pageSize;
+			}
+		}
+		if (resident > size) {
+			resident = size;
+		}
+	}
+	free(vec);
+	return resident;
+}
+
+void mappedMemorySetHugePages(enum mHugePageMode mode) {
+	_hugePages = mode;
+}
+
+enum mHugePageMode mappedMemoryGetHugePages(void) {
+	return _hugePages;
+}
+
+bool mappedMemoryBindLocal(void* memory, size_t size) {
+#if defined(__linux__) && defined(SYS_mbind) && defined(SYS_getcpu)
+	unsigned cpu;
+	unsigned node;
+	if (syscall(SYS_getcpu, &cpu, &node, NULL) < 0) {
+		return false;
+	}
+	if (node >= sizeof(unsigned long) * 8) {
+		return false;
+	}
+	long pageSize = sysconf(_SC_PAGESIZE);
+	uintptr_t start = ((uintptr_t) memory + pageSize - 1) & ~(uintptr_t) (pageSize - 1);
+	uintptr_t end = ((uintptr_t) memory + size) & ~(uintptr_t) (pageSize - 1);
+	if (end <= start) {
+		return false;
+	}
+	unsigned long nodemask = 1UL << node;
+	// Prefer the current node for new pages and move any that were already touched elsewhere
+	return syscall(SYS_mbind, start, end - start, MPOL_PREFERRED, &nodemask, sizeof(nodemask) * 8, MPOL_MF_MOVE) == 0;
+#else
+	UNUSED(memory);
+	UNUSED(size);
+	return false;
+#endif
 }
 #else
 void* anonymousMemoryMap(size_t size) {
@@ -34,4 +204,35 @@ void mappedMemoryFree(void* memory, size_t size) {
 	UNUSED(size);
 	free(memory);
 }
+
+void* mappedMemoryResize(void* memory, size_t oldSize, size_t newSize) {
+	void* newMemory = realloc(memory, newSize);
+	if (newMemory && newSize > oldSize) {
+		memset((void*) ((uintptr_t) newMemory + oldSize), 0, newSize - oldSize);
+	}
+	return newMemory;
+}
+
+void mappedMemoryClear(void* memory, size_t size) {
+	memset(memory, 0, size);
+}
+
+size_t mappedMemoryResident(const void* memory, size_t size) {
+	UNUSED(memory);
+	return size;
+}
+
+void mappedMemorySetHugePages(enum mHugePageMode mode) {
+	UNUSED(mode);
+}
+
+enum mHugePageMode mappedMemoryGetHugePages(void) {
+	return mHUGE_PAGES_NONE;
+}
+
+bool mappedMemoryBindLocal(void* memory, size_t size) {
+	UNUSED(memory);
+	UNUSED(size);
+	return false;
+}
 #endif
@@ -357,6 +357,7 @@ void mPSP2Setup(struct mGUIRunner* runner) {
 	stream.postAudioFrame = NULL;
 	stream.postAudioBuffer = _postAudioBuffer;
 	stream.postVideoFrame = NULL;
+	stream.postVideoFrameRepeat = NULL;
 	runner->core->setAVStream(runner->core, &stream);
 
 	frameLimiter = true;
@@ -30,3 +30,36 @@ void mappedMemoryFree(void* memory, size_t size) {
 		sceKernelFreeMemBlock(uid);
 	}
 }
+
+void* mappedMemoryResize(void* memory, size_t oldSize, size_t newSize) {
+	void* newMemory = anonymousMemoryMap(newSize);
+	if (!newMemory) {
+		return NULL;
+	}
+	memcpy(newMemory, memory, oldSize < newSize ? oldSize : newSize);
+	mappedMemoryFree(memory, oldSize);
+	return newMemory;
+}
+
+void mappedMemoryClear(void* memory, size_t size) {
+	memset(memory, 0, size);
+}
+
+size_t mappedMemoryResident(const void* memory, size_t size) {
+	UNUSED(memory);
+	return size;
+}
+
+void mappedMemorySetHugePages(enum mHugePageMode mode) {
+	UNUSED(mode);
+}
+
+enum mHugePageMode mappedMemoryGetHugePages(void) {
+	return mHUGE_PAGES_NONE;
+}
+
+bool mappedMemoryBindLocal(void* memory, size_t size) {
+	UNUSED(memory);
+	UNUSED(size);
+	return false;
+}
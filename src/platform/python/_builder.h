@@ -40,6 +40,7 @@ void free(void*);
 #include <mgba/core/cache-set.h>
 #include <mgba/core/core.h>
 #include <mgba/core/map-cache.h>
+#include <mgba/core/mem-diff.h>
 #include <mgba/core/mem-search.h>
 #include <mgba/core/thread.h>
 #include <mgba/core/version.h>
@@ -27,6 +27,7 @@ ffi.set_source("mgba._pylib", """
 #include <mgba/core/core.h>
 #include <mgba/core/map-cache.h>
 #include <mgba/core/log.h>
+#include <mgba/core/mem-diff.h>
 #include <mgba/core/mem-search.h>
 #include <mgba/core/thread.h>
 #include <mgba/core/version.h>
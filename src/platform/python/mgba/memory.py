@@ -100,6 +100,34 @@ class MemorySearchResult(object):
         self._memory[self.address] = v // self.guessDivisor
 
 
+class MemoryChange(object):
+    def __init__(self, change):
+        self.block = change.blockId
+        self.offset = change.offset
+        self.address = change.address
+        self.segment = change.segment
+        self.length = change.length
+
+
+class MemoryDiff(object):
+    def __init__(self, core, flags=lib.mCORE_MEMORY_WRITE):
+        self._core = core
+        self._native = ffi.gc(ffi.new("struct mCoreMemoryDiff*"), lib.mCoreMemoryDiffDeinit)
+        lib.mCoreMemoryDiffInit(self._native, core)
+        if flags:
+            lib.mCoreMemoryDiffAddBlocks(self._native, flags)
+
+    def add_block(self, block_id):
+        return bool(lib.mCoreMemoryDiffAddBlock(self._native, block_id))
+
+    def snapshot(self):
+        lib.mCoreMemoryDiffSnapshot(self._native)
+
+    def update(self):
+        changes = self._native.changes
+        return [MemoryChange(lib.mCoreMemoryChangesGetPointer(ffi.addressof(changes), i)) for i in range(lib.mCoreMemoryDiffUpdate(self._native))]
+
+
 class Memory(object):
     SEARCH_INT = lib.mCORE_MEMORY_SEARCH_INT
     SEARCH_STRING = lib.mCORE_MEMORY_SEARCH_STRING
@@ -152,6 +180,9 @@ class Memory(object):
         lib.mCoreMemorySearchResultsDeinit(results)
         return new_results
 
+    def diff(self, flags=lib.mCORE_MEMORY_WRITE):
+        return MemoryDiff(self._core, flags)
+
     def __getitem__(self, address):
         if isinstance(address, slice):
             return bytearray(self.u8[address])
@@ -206,6 +206,7 @@ void MemorySearch::refresh() {
 				}
 				break;
 			case mCORE_MEMORY_SEARCH_STRING:
+			case mCORE_MEMORY_SEARCH_TEXT:
 				string.reserve(result->width);
 				for (int i = 0; i < result->width; ++i) {
 					string.append(core->rawRead8(core, result->address + i, result->segment));
@@ -235,6 +236,9 @@ void MemorySearch::refresh() {
 		case mCORE_MEMORY_SEARCH_STRING:
 			type = new QTableWidgetItem("string");
 			break;
+		case mCORE_MEMORY_SEARCH_TEXT:
+			type = new QTableWidgetItem("text");
+			break;
 		case mCORE_MEMORY_SEARCH_GUESS:
 			break;
 		}
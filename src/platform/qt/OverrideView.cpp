@@ -210,6 +210,7 @@ void OverrideView::updateOverrides() {
 		auto gb = std::make_unique<GBOverride>();
 		gb->override.mbc = static_cast<GBMemoryBankControllerType>(m_ui.mbc->currentData().toInt());
 		gb->override.model = static_cast<GBModel>(m_ui.gbModel->currentData().toInt());
+		gb->override.idleLoop = GB_IDLE_LOOP_NONE;
 		hasOverride = gb->override.mbc != GB_MBC_AUTODETECT || gb->override.model != GB_MODEL_AUTODETECT;
 		for (int i = 0; i < 12; ++i) {
 			gb->override.gbColors[i] = m_gbColors[i];
@@ -46,6 +46,8 @@ bool mSDLInitAudio(struct mSDLAudio* context, struct mCoreThread* threadContext)
 		return false;
 	}
 	context->core = 0;
+	mAudioResamplerInit(&context->resampler, 2);
+	mAudioResamplerSetRates(&context->resampler, context->obtainedSpec.freq, context->obtainedSpec.freq);
 
 	if (threadContext) {
 		context->core = threadContext->core;
@@ -71,6 +73,7 @@ void mSDLDeinitAudio(struct mSDLAudio* context) {
 	SDL_CloseAudio();
 #endif
 	SDL_QuitSubSystem(SDL_INIT_AUDIO);
+	mAudioResamplerDeinit(&context->resampler);
 }
 
 void mSDLPauseAudio(struct mSDLAudio* context) {
@@ -112,22 +115,37 @@ static void _mSDLAudioCallback(void* context, Uint8* data, int len) {
 		}
 		mCoreSyncLockAudio(audioContext->sync);
 	}
-	blip_set_rates(left, clockRate, audioContext->obtainedSpec.freq * fauxClock);
-	blip_set_rates(right, clockRate, audioContext->obtainedSpec.freq * fauxClock);
-	len /= 2 * audioContext->obtainedSpec.channels;
-	int available = blip_samples_avail(left);
-	if (available > len) {
-		available = len;
-	}
-	blip_read_samples(left, (short*) data, available, audioContext->obtainedSpec.channels == 2);
-	if (audioContext->obtainedSpec.channels == 2) {
-		blip_read_samples(right, ((short*) data) + 1, available, 1);
+	// Synthesize at the device rate and let the resampler take up any
+	// difference in speed, keeping the pitch steady when running fast
+	blip_set_rates(left, clockRate, audioContext->obtainedSpec.freq);
+	blip_set_rates(right, clockRate, audioContext->obtainedSpec.freq);
+	mAudioResamplerSetStretch(&audioContext->resampler, 1 / fauxClock);
+
+	unsigned channels = audioContext->obtainedSpec.channels;
+	size_t frames = len / (sizeof(short) * channels);
+	size_t available = 0;
+	short buffer[BUFFER_SIZE * 2];
+	while (true) {
+		available += mAudioResamplerRead(&audioContext->resampler, ((short*) data) + channels * available, frames - available, channels);
+		if (available >= frames) {
+			break;
+		}
+		int samples = blip_samples_avail(left);
+		if (!samples) {
+			break;
+		}
+		if (samples > BUFFER_SIZE) {
+			samples = BUFFER_SIZE;
+		}
+		blip_read_samples(left, buffer, samples, true);
+		blip_read_samples(right, buffer + 1, samples, true);
+		mAudioResamplerWrite(&audioContext->resampler, buffer, samples);
 	}
 
 	if (audioContext->sync) {
 		mCoreSyncConsumeAudio(audioContext->sync);
 	}
-	if (available < len) {
-		memset(((short*) data) + audioContext->obtainedSpec.channels * available, 0, (len - available) * audioContext->obtainedSpec.channels * sizeof(short));
+	if (available < frames) {
+		memset(((short*) data) + channels * available, 0, (frames - available) * channels * sizeof(short));
 	}
 }
@@ -11,6 +11,7 @@
 CXX_GUARD_START
 
 #include <mgba/core/log.h>
+#include <mgba-util/audio-resampler.h>
 
 #include <SDL.h>
 // Altivec sometimes defines this
@@ -36,6 +37,8 @@ struct mSDLAudio {
 	SDL_AudioDeviceID deviceId;
 #endif
 
+	struct mAudioResampler resampler;
+
 	struct mCore* core;
 	struct mCoreSync* sync;
 };
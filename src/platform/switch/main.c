@@ -885,6 +885,7 @@ int main(int argc, char* argv[]) {
 
 	stream.videoDimensionsChanged = NULL;
 	stream.postVideoFrame = NULL;
+	stream.postVideoFrameRepeat = NULL;
 	stream.postAudioFrame = NULL;
 	stream.postAudioBuffer = _postAudioBuffer;
 
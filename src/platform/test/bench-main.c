@@ -0,0 +1,994 @@
+/* Copyright (c) 2013-2024 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include <mgba/core/config.h>
+#include <mgba/core/core.h>
+#include <mgba/core/log.h>
+#include <mgba/core/version.h>
+#ifdef M_CORE_GBA
+#include <mgba/internal/gba/io.h>
+#include <mgba/internal/gba/memory.h>
+#include <mgba/internal/gba/video.h>
+#endif
+#ifdef M_CORE_GB
+#include <mgba/internal/gb/io.h>
+#include <mgba/internal/gb/memory.h>
+#include <mgba/internal/gb/video.h>
+#endif
+
+#include <mgba-util/string.h>
+#include <mgba-util/vfs.h>
+
+#ifdef _MSC_VER
+#include <mgba-util/platform/windows/getopt.h>
+#else
+#include <getopt.h>
+#endif
+
+#include <signal.h>
+#include <sys/time.h>
+
+// Generates small ROMs that each hammer one hot path of the emulator and
+// times them. The machine code is assembled here directly so that the suite
+// doesn't need a cross toolchain and runs from a clean checkout.
+
+#define BENCH_GBA_ROM_SIZE 0x40000
+#define BENCH_GBA_DATA 0x1000
+#define BENCH_GB_ROM_SIZE 0x8000
+#define BENCH_GB_DATA 0x1000
+
+static const struct option longOpts[] = {
+	{ "csv",      no_argument, 0, 'P' },
+	{ "frames",   required_argument, 0, 'F' },
+	{ "help",     no_argument, 0, 'h' },
+	{ "list",     no_argument, 0, 'l' },
+	{ "no-video", no_argument, 0, 'N' },
+	{ "outdir",   required_argument, 0, 'o' },
+	{ "version",  no_argument, 0, '\0' },
+	{ 0, 0, 0, 0 }
+};
+
+static const char shortOpts[] = "F:hlNo:P";
+
+struct BenchAssembler {
+	uint8_t* rom;
+	uint32_t base;
+	uint32_t offset;
+};
+
+struct BenchROM {
+	const char* name;
+	const char* description;
+	enum mPlatform platform;
+	void (*build)(struct BenchAssembler*);
+};
+
+static bool _dispatchExiting = false;
+static uint32_t _random;
+
+static void _benchShutdown(int signal) {
+	UNUSED(signal);
+	_dispatchExiting = true;
+}
+
+static void _log(struct mLogger* log, int category, enum mLogLevel level, const char* format, va_list args) {
+	UNUSED(log);
+	UNUSED(category);
+	UNUSED(level);
+	UNUSED(format);
+	UNUSED(args);
+}
+
+static void _seed(const char* name) {
+	_random = 0x12345678;
+	for (; *name; ++name) {
+		_random = _random * 31 + *name;
+	}
+}
+
+static uint32_t _next(void) {
+	_random = _random * 1103515245 + 12345;
+	return _random >> 8;
+}
+
+static uint32_t _here(const struct BenchAssembler* a) {
+	return a->base + a->offset;
+}
+
+static void _emit8(struct BenchAssembler* a, uint8_t value) {
+	a->rom[a->offset] = value;
+	++a->offset;
+}
+
+static void _emit16(struct BenchAssembler* a, uint16_t value) {
+	_emit8(a, value);
+	_emit8(a, value >> 8);
+}
+
+static void _emit32(struct BenchAssembler* a, uint32_t value) {
+	_emit16(a, value);
+	_emit16(a, value >> 16);
+}
+
+#ifdef M_CORE_GBA
+enum {
+	ARM_COND_EQ = 0x0,
+	ARM_COND_NE = 0x1,
+	ARM_COND_AL = 0xE,
+};
+
+enum {
+	ARM_AND = 0x0,
+	ARM_EOR = 0x1,
+	ARM_SUB = 0x2,
+	ARM_RSB = 0x3,
+	ARM_ADD = 0x4,
+	ARM_CMP = 0xA,
+	ARM_ORR = 0xC,
+	ARM_MOV = 0xD,
+};
+
+// Scratch registers used by the I/O helpers
+#define ARM_IO_BASE 12
+#define ARM_IO_VALUE 11
+#define ARM_IO_ADDRESS 10
+
+static void _armDataImm(struct BenchAssembler* a, int cond, int op, int rd, int rn, uint32_t imm) {
+	int rotate;
+	for (rotate = 0; rotate < 16; ++rotate) {
+		uint32_t value = rotate ? (imm << (rotate * 2)) | (imm >> (32 - rotate * 2)) : imm;
+		if (value < 0x100) {
+			int s = op == ARM_CMP;
+			_emit32(a, (cond << 28) | (1 << 25) | (op << 21) | (s << 20) | (rn << 16) | (rd << 12) | (rotate << 8) | value);
+			return;
+		}
+	}
+	abort();
+}
+
+static void _armLoadImm(struct BenchAssembler* a, int rd, uint32_t value) {
+	int shift;
+	bool first = true;
+	for (shift = 0; shift < 32; shift += 8) {
+		uint32_t chunk = value & (0xFFU << shift);
+		if (!chunk) {
+			continue;
+		}
+		if (first) {
+			_armDataImm(a, ARM_COND_AL, ARM_MOV, rd, 0, chunk);
+			first = false;
+		} else {
+			_armDataImm(a, ARM_COND_AL, ARM_ORR, rd, rd, chunk);
+		}
+	}
+	if (first) {
+		_armDataImm(a, ARM_COND_AL, ARM_MOV, rd, 0, 0);
+	}
+}
+
+static void _armLdrStr(struct BenchAssembler* a, bool load, int rd, int rn, uint32_t offset) {
+	_emit32(a, 0xE5800000 | (load << 20) | (rn << 16) | (rd << 12) | offset);
+}
+
+static void _armLdrhStrh(struct BenchAssembler* a, bool load, int rd, int rn, uint32_t offset) {
+	_emit32(a, 0xE1C000B0 | (load << 20) | (rn << 16) | (rd << 12) | ((offset & 0xF0) << 4) | (offset & 0xF));
+}
+
+static void _armBlock(struct BenchAssembler* a, bool load, bool writeback, int rn, uint16_t list) {
+	_emit32(a, 0xE8800000 | (writeback << 21) | (load << 20) | (rn << 16) | list);
+}
+
+static void _armBranch(struct BenchAssembler* a, int cond, uint32_t target) {
+	_emit32(a, (cond << 28) | 0x0A000000 | (((target - (_here(a) + 8)) >> 2) & 0xFFFFFF));
+}
+
+static void _armIO16(struct BenchAssembler* a, uint32_t reg, uint16_t value) {
+	_armLoadImm(a, ARM_IO_VALUE, value);
+	if (reg < 0x100) {
+		_armLdrhStrh(a, false, ARM_IO_VALUE, ARM_IO_BASE, reg);
+	} else {
+		_armLoadImm(a, ARM_IO_ADDRESS, GBA_BASE_IO | reg);
+		_armLdrhStrh(a, false, ARM_IO_VALUE, ARM_IO_ADDRESS, 0);
+	}
+}
+
+static void _armIO32(struct BenchAssembler* a, uint32_t reg, uint32_t value) {
+	_armLoadImm(a, ARM_IO_VALUE, value);
+	_armLdrStr(a, false, ARM_IO_VALUE, ARM_IO_BASE, reg);
+}
+
+static void _armDMA3(struct BenchAssembler* a, uint32_t source, uint32_t dest, uint16_t words) {
+	_armIO32(a, GBA_REG_DMA3SAD_LO, source);
+	_armIO32(a, GBA_REG_DMA3DAD_LO, dest);
+	_armIO32(a, GBA_REG_DMA3CNT_LO, 0x84000000 | words);
+}
+
+static void _armWaitVCount(struct BenchAssembler* a, int cond) {
+	uint32_t poll = _here(a);
+	_armLdrhStrh(a, true, 0, ARM_IO_BASE, GBA_REG_VCOUNT);
+	_armDataImm(a, ARM_COND_AL, ARM_CMP, 0, 0, GBA_VIDEO_VERTICAL_PIXELS);
+	_armBranch(a, cond, poll);
+}
+
+static void _armWaitVBlank(struct BenchAssembler* a) {
+	_armWaitVCount(a, ARM_COND_NE);
+}
+
+static void _armWaitVBlankEnd(struct BenchAssembler* a) {
+	_armWaitVCount(a, ARM_COND_EQ);
+}
+
+static uint32_t _gbaData(struct BenchAssembler* a, uint32_t offset, const void* data, size_t size) {
+	memcpy(&a->rom[offset], data, size);
+	return GBA_BASE_ROM0 + offset;
+}
+
+static uint32_t _gbaRandomData(struct BenchAssembler* a, uint32_t offset, size_t size) {
+	size_t i;
+	for (i = 0; i < size; ++i) {
+		a->rom[offset + i] = _next();
+	}
+	return GBA_BASE_ROM0 + offset;
+}
+
+static uint32_t _gbaPalette(struct BenchAssembler* a, uint32_t offset) {
+	uint16_t palette[256];
+	int i;
+	for (i = 0; i < 256; ++i) {
+		palette[i] = (i & 0x1F) | (((i * 3) & 0x1F) << 5) | (((i * 7) & 0x1F) << 10);
+	}
+	return _gbaData(a, offset, palette, sizeof(palette));
+}
+
+static uint32_t _gbaTextMap(struct BenchAssembler* a, uint32_t offset) {
+	int i;
+	for (i = 0; i < 32 * 32; ++i) {
+		uint16_t entry = _next() & 0xFFFF;
+		a->rom[offset + i * 2] = entry;
+		a->rom[offset + i * 2 + 1] = entry >> 8;
+	}
+	return GBA_BASE_ROM0 + offset;
+}
+
+static void _gbaPrologue(struct BenchAssembler* a, uint16_t waitcnt) {
+	_armLoadImm(a, ARM_IO_BASE, GBA_BASE_IO);
+	_armIO16(a, GBA_REG_WAITCNT, waitcnt);
+	_armIO16(a, GBA_REG_DISPCNT, 0);
+}
+
+static void _gbaThumbALU(struct BenchAssembler* a) {
+	_gbaPrologue(a, 0x4317);
+
+	// Switch to Thumb for the rest of the ROM
+	_armDataImm(a, ARM_COND_AL, ARM_ADD, 0, 15, 1);
+	_emit32(a, 0xE12FFF10);
+
+	int i;
+	for (i = 1; i < 8; ++i) {
+		_emit16(a, 0x2000 | (i << 8) | (i * 2 + 1)); // mov ri, #(2i + 1)
+	}
+	uint32_t loop = _here(a);
+	for (i = 0; i < 8; ++i) {
+		_emit16(a, 0x1880); // add r0, r0, r2
+		_emit16(a, 0x4059); // eor r1, r3
+		_emit16(a, 0x00DA); // lsl r2, r3, #3
+		_emit16(a, 0x1A23); // sub r3, r4, r0
+		_emit16(a, 0x432C); // orr r4, r5
+		_emit16(a, 0x4035); // and r5, r6
+		_emit16(a, 0x087E); // lsr r6, r7, #1
+		_emit16(a, 0x4147); // adc r7, r0
+		_emit16(a, 0x4348); // mul r0, r1
+		_emit16(a, 0x3107); // add r1, #7
+		_emit16(a, 0x43D2); // mvn r2, r2
+		_emit16(a, 0x41E3); // ror r3, r4
+		_emit16(a, 0x43BC); // bic r4, r7
+		_emit16(a, 0x424D); // neg r5, r1
+		_emit16(a, 0x3E01); // sub r6, #1
+		_emit16(a, 0x42BE); // cmp r6, r7
+	}
+	_emit16(a, 0xE000 | (((loop - (_here(a) + 4)) >> 1) & 0x7FF));
+}
+
+static void _gbaLdmStm(struct BenchAssembler* a) {
+	_gbaPrologue(a, 0x4317);
+	_armLoadImm(a, 8, GBA_BASE_IWRAM);
+	_armLoadImm(a, 9, GBA_BASE_EWRAM);
+	uint32_t loop = _here(a);
+	int i;
+	for (i = 0; i < 8; ++i) {
+		_armBlock(a, true, false, 8, 0x00FF);
+		_armBlock(a, false, false, 9, 0x00FF);
+		_armBlock(a, true, false, 9, 0x00FF);
+		_armBlock(a, false, false, 8, 0x00FF);
+	}
+	_armBranch(a, ARM_COND_AL, loop);
+}
+
+static void _gbaRomWaitstates(struct BenchAssembler* a) {
+	// 8-cycle non-sequential accesses with the prefetcher off
+	_gbaPrologue(a, 0x000C);
+	_gbaRandomData(a, BENCH_GBA_DATA, 0x2000);
+	uint32_t loop = _here(a);
+	_armLoadImm(a, 8, GBA_BASE_ROM0 + BENCH_GBA_DATA);
+	int i;
+	for (i = 0; i < 8; ++i) {
+		_armBlock(a, true, true, 8, 0x00FF);
+	}
+	for (i = 0; i < 16; ++i) {
+		_armLdrStr(a, true, i & 7, 8, i * 0xF4);
+	}
+	_armBranch(a, ARM_COND_AL, loop);
+}
+
+static void _gbaDMA(struct BenchAssembler* a) {
+	_gbaPrologue(a, 0x4317);
+	_gbaRandomData(a, BENCH_GBA_DATA, 0x8000);
+	_armLoadImm(a, 0, GBA_BASE_ROM0 + BENCH_GBA_DATA);
+	_armLoadImm(a, 1, GBA_BASE_EWRAM);
+	_armLoadImm(a, 2, 0x84000000 | 0x2000);
+	_armLoadImm(a, 3, GBA_BASE_EWRAM);
+	_armLoadImm(a, 4, GBA_BASE_VRAM);
+	_armLoadImm(a, 5, 0x84000000 | 0x2000);
+	_armLoadImm(a, 9, GBA_BASE_IO | GBA_REG_DMA3SAD_LO);
+	uint32_t loop = _here(a);
+	_armBlock(a, false, false, 9, 0x0007);
+	_armBlock(a, false, false, 9, 0x0038);
+	_armBranch(a, ARM_COND_AL, loop);
+}
+
+static void _gbaMode0(struct BenchAssembler* a) {
+	_gbaPrologue(a, 0x4317);
+	uint32_t offset = BENCH_GBA_DATA;
+	uint32_t palette = _gbaPalette(a, offset);
+	offset += 0x200;
+	uint32_t tiles = _gbaRandomData(a, offset, 0x4000);
+	offset += 0x4000;
+	uint32_t maps = _gbaTextMap(a, offset);
+	int i;
+	for (i = 1; i < 4; ++i) {
+		_gbaTextMap(a, offset + i * 0x800);
+	}
+	_armDMA3(a, palette, GBA_BASE_PALETTE_RAM, 0x80);
+	_armDMA3(a, tiles, GBA_BASE_VRAM, 0x1000);
+	_armDMA3(a, maps, GBA_BASE_VRAM + 0xE000, 0x800);
+	for (i = 0; i < 4; ++i) {
+		_armIO16(a, GBA_REG_BG0CNT + i * 2, ((28 + i) << 8) | i);
+	}
+	_armIO16(a, GBA_REG_BLDCNT, 0x3E41);
+	_armIO16(a, GBA_REG_BLDALPHA, 0x0808);
+	_armIO16(a, GBA_REG_DISPCNT, 0x0F00);
+
+	_armLoadImm(a, 1, 0);
+	uint32_t loop = _here(a);
+	_armWaitVBlank(a);
+	_armDataImm(a, ARM_COND_AL, ARM_ADD, 1, 1, 1);
+	_armLdrhStrh(a, false, 1, ARM_IO_BASE, GBA_REG_BG0HOFS);
+	_armLdrhStrh(a, false, 1, ARM_IO_BASE, GBA_REG_BG1VOFS);
+	_armLdrhStrh(a, false, 1, ARM_IO_BASE, GBA_REG_BG2HOFS);
+	_armLdrhStrh(a, false, 1, ARM_IO_BASE, GBA_REG_BG3VOFS);
+	_armWaitVBlankEnd(a);
+	_armBranch(a, ARM_COND_AL, loop);
+}
+
+static void _gbaMode2(struct BenchAssembler* a) {
+	_gbaPrologue(a, 0x4317);
+	uint32_t offset = BENCH_GBA_DATA;
+	uint32_t palette = _gbaPalette(a, offset);
+	offset += 0x200;
+	uint32_t tiles = _gbaRandomData(a, offset, 0x4000);
+	offset += 0x4000;
+	uint32_t maps = _gbaRandomData(a, offset, 0x2000);
+	_armDMA3(a, palette, GBA_BASE_PALETTE_RAM, 0x80);
+	_armDMA3(a, tiles, GBA_BASE_VRAM, 0x1000);
+	_armDMA3(a, maps, GBA_BASE_VRAM + 0xE000, 0x800);
+	// 512x512 wrapping affine backgrounds
+	_armIO16(a, GBA_REG_BG2CNT, 0xA000 | (28 << 8) | 1);
+	_armIO16(a, GBA_REG_BG3CNT, 0xA000 | (30 << 8) | 2);
+	_armIO16(a, GBA_REG_BG2PA, 0x100);
+	_armIO16(a, GBA_REG_BG2PD, 0x100);
+	_armIO16(a, GBA_REG_BG3PA, 0x0C0);
+	_armIO16(a, GBA_REG_BG3PD, 0x140);
+	_armIO16(a, GBA_REG_DISPCNT, 0x0C02);
+
+	_armLoadImm(a, 1, 0);
+	uint32_t loop = _here(a);
+	_armWaitVBlank(a);
+	_armDataImm(a, ARM_COND_AL, ARM_ADD, 1, 1, 1);
+	_armDataImm(a, ARM_COND_AL, ARM_RSB, 2, 1, 0);
+	_armLdrhStrh(a, false, 1, ARM_IO_BASE, GBA_REG_BG2PB);
+	_armLdrhStrh(a, false, 2, ARM_IO_BASE, GBA_REG_BG2PC);
+	_armLdrhStrh(a, false, 2, ARM_IO_BASE, GBA_REG_BG3PB);
+	_armLdrhStrh(a, false, 1, ARM_IO_BASE, GBA_REG_BG3PC);
+	_armWaitVBlankEnd(a);
+	_armBranch(a, ARM_COND_AL, loop);
+}
+
+static void _gbaMode3(struct BenchAssembler* a) {
+	_gbaPrologue(a, 0x4317);
+	uint32_t offset = BENCH_GBA_DATA;
+	int x, y;
+	for (y = 0; y < GBA_VIDEO_VERTICAL_PIXELS; ++y) {
+		for (x = 0; x < GBA_VIDEO_HORIZONTAL_PIXELS; ++x) {
+			uint16_t color = ((x >> 3) & 0x1F) | (((y >> 2) & 0x1F) << 5) | ((_next() & 0x1F) << 10);
+			a->rom[offset] = color;
+			a->rom[offset + 1] = color >> 8;
+			offset += 2;
+		}
+	}
+	_armDMA3(a, GBA_BASE_ROM0 + BENCH_GBA_DATA, GBA_BASE_VRAM, GBA_VIDEO_HORIZONTAL_PIXELS * GBA_VIDEO_VERTICAL_PIXELS / 2);
+	_armIO16(a, GBA_REG_BG2PA, 0x100);
+	_armIO16(a, GBA_REG_BG2PD, 0x100);
+	_armIO16(a, GBA_REG_DISPCNT, 0x0403);
+
+	_armLoadImm(a, 1, 0);
+	uint32_t loop = _here(a);
+	_armWaitVBlank(a);
+	_armDataImm(a, ARM_COND_AL, ARM_ADD, 1, 1, 0x80);
+	_armLdrStr(a, false, 1, ARM_IO_BASE, GBA_REG_BG2X_LO);
+	_armWaitVBlankEnd(a);
+	_armBranch(a, ARM_COND_AL, loop);
+}
+
+static void _gbaSprites(struct BenchAssembler* a) {
+	_gbaPrologue(a, 0x4317);
+	uint32_t offset = BENCH_GBA_DATA;
+	uint32_t palette = _gbaPalette(a, offset);
+	offset += 0x200;
+	uint32_t tiles = _gbaRandomData(a, offset, 0x8000);
+	offset += 0x8000;
+	uint32_t oam = GBA_BASE_ROM0 + offset;
+	int frame;
+	for (frame = 0; frame < 2; ++frame) {
+		int i;
+		for (i = 0; i < 128; ++i) {
+			uint16_t attr[4];
+			attr[0] = ((i * 37 + frame * 8) % 192) & 0xFF;
+			attr[1] = ((i * 53 + frame * 4) % 272) | (3 << 14);
+			attr[2] = ((i & 15) * 64) | ((i & 15) << 12) | ((i & 3) << 10);
+			if ((i & 3) == 0) {
+				// Double-size affine sprites using one of four matrices
+				attr[0] |= 0x0300;
+				attr[1] |= ((i >> 2) & 3) << 9;
+			}
+			attr[3] = 0;
+			int j;
+			for (j = 0; j < 4; ++j) {
+				a->rom[offset + i * 8 + j * 2] = attr[j];
+				a->rom[offset + i * 8 + j * 2 + 1] = attr[j] >> 8;
+			}
+		}
+		for (i = 0; i < 4; ++i) {
+			static const int16_t matrix[4][4] = {
+				{ 0x100, 0, 0, 0x100 },
+				{ 0x0B5, -0x0B5, 0x0B5, 0x0B5 },
+				{ 0, 0x100, -0x100, 0 },
+				{ 0x080, 0x040, -0x040, 0x180 },
+			};
+			int j;
+			for (j = 0; j < 4; ++j) {
+				uint16_t param = matrix[(i + frame) & 3][j];
+				a->rom[offset + i * 32 + j * 8 + 6] = param;
+				a->rom[offset + i * 32 + j * 8 + 7] = param >> 8;
+			}
+		}
+		offset += 0x400;
+	}
+	_armDMA3(a, palette, GBA_BASE_PALETTE_RAM + 0x200, 0x80);
+	_armDMA3(a, tiles, GBA_BASE_VRAM + 0x10000, 0x2000);
+	_armDMA3(a, oam, GBA_BASE_OAM, 0x100);
+	_armIO16(a, GBA_REG_DISPCNT, 0x1040);
+
+	_armLoadImm(a, 1, oam);
+	uint32_t loop = _here(a);
+	_armWaitVBlank(a);
+	_armDataImm(a, ARM_COND_AL, ARM_EOR, 1, 1, 0x400);
+	_armLdrStr(a, false, 1, ARM_IO_BASE, GBA_REG_DMA3SAD_LO);
+	_armIO32(a, GBA_REG_DMA3DAD_LO, GBA_BASE_OAM);
+	_armIO32(a, GBA_REG_DMA3CNT_LO, 0x84000100);
+	_armWaitVBlankEnd(a);
+	_armBranch(a, ARM_COND_AL, loop);
+}
+
+static void _gbaAudio(struct BenchAssembler* a) {
+	_gbaPrologue(a, 0x4317);
+	uint32_t samples = GBA_BASE_ROM0 + BENCH_GBA_DATA;
+	int i;
+	for (i = 0; i < 0x4000; ++i) {
+		int triangle = (i & 0x7F) < 0x40 ? (i & 0x3F) * 4 - 128 : 127 - (i & 0x3F) * 4;
+		a->rom[BENCH_GBA_DATA + i] = (triangle + (int) (_next() & 0xF) - 8) / 2;
+	}
+
+	_armIO16(a, GBA_REG_SOUNDCNT_X, 0x0080);
+	_armIO16(a, GBA_REG_SOUNDCNT_LO, 0xFF77);
+	_armIO16(a, GBA_REG_SOUNDCNT_HI, 0x0B06);
+	_armIO16(a, GBA_REG_SOUND1CNT_LO, 0x0077);
+	_armIO16(a, GBA_REG_SOUND1CNT_HI, 0xF780);
+	_armIO16(a, GBA_REG_SOUND1CNT_X, 0x8400);
+	_armIO16(a, GBA_REG_SOUND2CNT_LO, 0xF7C0);
+	_armIO16(a, GBA_REG_SOUND2CNT_HI, 0x8600);
+	_armIO16(a, GBA_REG_SOUND3CNT_LO, 0x0040);
+	for (i = 0; i < 8; ++i) {
+		_armIO16(a, GBA_REG_WAVE_RAM0_LO + i * 2, 0x0123 * (i + 1));
+	}
+	_armIO16(a, GBA_REG_SOUND3CNT_LO, 0x0080);
+	_armIO16(a, GBA_REG_SOUND3CNT_HI, 0x2000);
+	_armIO16(a, GBA_REG_SOUND3CNT_X, 0x8500);
+	_armIO16(a, GBA_REG_SOUND4CNT_LO, 0xF700);
+	_armIO16(a, GBA_REG_SOUND4CNT_HI, 0x8021);
+
+	// 32768 Hz FIFO A fed by DMA 1
+	_armIO32(a, GBA_REG_DMA1DAD_LO, GBA_BASE_IO | GBA_REG_FIFO_A_LO);
+	_armIO32(a, GBA_REG_TM0CNT_LO, 0x0080FE00);
+
+	_armLoadImm(a, 1, 0);
+	uint32_t loop = _here(a);
+	_armWaitVBlank(a);
+	// Restart the sample stream and sweep the square channel every frame
+	_armIO16(a, GBA_REG_DMA1CNT_HI, 0);
+	_armIO32(a, GBA_REG_DMA1SAD_LO, samples);
+	_armIO16(a, GBA_REG_DMA1CNT_HI, 0xB640);
+	_armDataImm(a, ARM_COND_AL, ARM_ADD, 1, 1, 4);
+	_armDataImm(a, ARM_COND_AL, ARM_AND, 1, 1, 0x3FC);
+	_armDataImm(a, ARM_COND_AL, ARM_ORR, 2, 1, 0x8000);
+	_armLdrhStrh(a, false, 2, ARM_IO_BASE, GBA_REG_SOUND1CNT_X);
+	_armWaitVBlankEnd(a);
+	_armBranch(a, ARM_COND_AL, loop);
+}
+
+static void _gbaHeader(struct BenchAssembler* a, const char* name) {
+	// b 0x080000C0
+	a->rom[0] = 0x2E;
+	a->rom[3] = 0xEA;
+	strncpy((char*) &a->rom[0xA0], name, 12);
+	memcpy(&a->rom[0xAC], "ZBME", 4);
+	memcpy(&a->rom[0xB0], "01", 2);
+	a->rom[0xB2] = 0x96;
+	uint8_t checksum = 0;
+	int i;
+	for (i = 0xA0; i < 0xBD; ++i) {
+		checksum -= a->rom[i];
+	}
+	a->rom[0xBD] = checksum - 0x19;
+}
+#endif
+
+#ifdef M_CORE_GB
+static const uint8_t _gbLogo[48] = {
+	0xCE, 0xED, 0x66, 0x66, 0xCC, 0x0D, 0x00, 0x0B, 0x03, 0x73, 0x00, 0x83, 0x00, 0x0C, 0x00, 0x0D,
+	0x00, 0x08, 0x11, 0x1F, 0x88, 0x89, 0x00, 0x0E, 0xDC, 0xCC, 0x6E, 0xE6, 0xDD, 0xDD, 0xD9, 0x99,
+	0xBB, 0xBB, 0x67, 0x63, 0x6E, 0x0E, 0xEC, 0xCC, 0xDD, 0xDC, 0x99, 0x9F, 0xBB, 0xB9, 0x33, 0x3E,
+};
+
+// Fixed location of the block copy subroutine
+#define GB_COPY 0x0F00
+
+static void _gbEmit(struct BenchAssembler* a, size_t count, const uint8_t* bytes) {
+	size_t i;
+	for (i = 0; i < count; ++i) {
+		_emit8(a, bytes[i]);
+	}
+}
+
+#define GB_EMIT(A, ...) do { \
+		static const uint8_t _bytes[] = { __VA_ARGS__ }; \
+		_gbEmit(A, sizeof(_bytes), _bytes); \
+	} while (0)
+
+static void _gbJr(struct BenchAssembler* a, uint8_t opcode, uint32_t target) {
+	_emit8(a, opcode);
+	_emit8(a, target - (_here(a) + 1));
+}
+
+static void _gbLoad16(struct BenchAssembler* a, uint8_t opcode, uint16_t value) {
+	_emit8(a, opcode);
+	_emit16(a, value);
+}
+
+static void _gbWriteIO(struct BenchAssembler* a, uint8_t reg, uint8_t value) {
+	_emit8(a, 0x3E); // ld a, value
+	_emit8(a, value);
+	_emit8(a, 0xE0); // ldh (reg), a
+	_emit8(a, reg);
+}
+
+static void _gbCopy(struct BenchAssembler* a, uint16_t source, uint16_t dest, uint16_t size) {
+	_gbLoad16(a, 0x21, source); // ld hl, source
+	_gbLoad16(a, 0x11, dest); // ld de, dest
+	_gbLoad16(a, 0x01, size); // ld bc, size
+	_gbLoad16(a, 0xCD, GB_COPY); // call copy
+}
+
+static void _gbWaitLY(struct BenchAssembler* a, uint8_t jr) {
+	uint32_t poll = _here(a);
+	GB_EMIT(a, 0xF0, GB_REG_LY, 0xFE, GB_VIDEO_VERTICAL_PIXELS); // ldh a, (LY); cp 144
+	_gbJr(a, jr, poll);
+}
+
+static void _gbWaitVBlank(struct BenchAssembler* a) {
+	_gbWaitLY(a, 0x20); // jr nz
+}
+
+static void _gbWaitVBlankEnd(struct BenchAssembler* a) {
+	_gbWaitLY(a, 0x28); // jr z
+}
+
+static void _gbPrologue(struct BenchAssembler* a) {
+	uint32_t offset = a->offset;
+	a->offset = GB_COPY;
+	// ld a, (hl+); ld (de), a; inc de; dec bc; ld a, b; or c; jr nz, -8; ret
+	GB_EMIT(a, 0x2A, 0x12, 0x13, 0x0B, 0x78, 0xB1, 0x20, 0xF8, 0xC9);
+	a->offset = offset;
+	GB_EMIT(a, 0xF3); // di
+	_gbLoad16(a, 0x31, 0xFFFE); // ld sp, $FFFE
+}
+
+static void _gbALU(struct BenchAssembler* a) {
+	_gbPrologue(a);
+	uint32_t loop = _here(a);
+	int i;
+	for (i = 0; i < 4; ++i) {
+		GB_EMIT(a,
+			0x80, // add a, b
+			0xA9, // xor c
+			0x07, // rlca
+			0x14, // inc d
+			0x1D, // dec e
+			0x8C, // adc a, h
+			0x9D, // sbc a, l
+			0xA2, // and d
+			0xB3, // or e
+			0xB8, // cp b
+			0x23, // inc hl
+			0x47, // ld b, a
+			0xCB, 0x37, // swap a
+			0xCB, 0x5F, // bit 3, a
+			0xCB, 0x1A, // rr d
+			0xCB, 0x23, // sla e
+			0x19, // add hl, de
+			0x4F // ld c, a
+		);
+	}
+	_gbJr(a, 0x18, loop);
+}
+
+static void _gbMemcpy(struct BenchAssembler* a) {
+	_gbPrologue(a);
+	size_t i;
+	for (i = 0; i < 0x1000; ++i) {
+		a->rom[BENCH_GB_DATA + i] = _next();
+	}
+	uint32_t loop = _here(a);
+	_gbCopy(a, BENCH_GB_DATA, GB_BASE_WORKING_RAM_BANK0, 0x1000);
+	_gbCopy(a, GB_BASE_WORKING_RAM_BANK0, GB_BASE_WORKING_RAM_BANK0 + 0x1000, 0x1000);
+	_gbJr(a, 0x18, loop);
+}
+
+static void _gbRender(struct BenchAssembler* a) {
+	_gbPrologue(a);
+	size_t i;
+	for (i = 0; i < 0x1800; ++i) {
+		a->rom[BENCH_GB_DATA + i] = _next();
+	}
+	for (i = 0; i < 40; ++i) {
+		uint8_t* sprite = &a->rom[BENCH_GB_DATA + 0x1800 + i * 4];
+		sprite[0] = 16 + (i * 29) % 144;
+		sprite[1] = 8 + (i * 41) % 160;
+		sprite[2] = i * 2;
+		sprite[3] = (i & 7) << 4;
+	}
+
+	_gbWaitVBlank(a);
+	_gbWriteIO(a, GB_REG_LCDC, 0);
+	_gbCopy(a, BENCH_GB_DATA, GB_BASE_VRAM, 0x1000);
+	_gbCopy(a, BENCH_GB_DATA + 0x1000, GB_BASE_VRAM + 0x1800, 0x800);
+	_gbCopy(a, BENCH_GB_DATA + 0x1800, GB_BASE_OAM, 0xA0);
+	_gbWriteIO(a, GB_REG_BGP, 0xE4);
+	_gbWriteIO(a, GB_REG_OBP0, 0xD2);
+	_gbWriteIO(a, GB_REG_OBP1, 0x1B);
+	_gbWriteIO(a, GB_REG_WY, 0x40);
+	_gbWriteIO(a, GB_REG_WX, 0x57);
+	// LCD, window at $9C00, tiles at $8000, 8x16 objects, all layers on
+	_gbWriteIO(a, GB_REG_LCDC, 0xF7);
+
+	uint32_t loop = _here(a);
+	_gbWaitVBlank(a);
+	GB_EMIT(a, 0xF0, GB_REG_SCX, 0x3C, 0xE0, GB_REG_SCX); // ldh a, (SCX); inc a; ldh (SCX), a
+	GB_EMIT(a, 0xF0, GB_REG_SCY, 0x3D, 0xE0, GB_REG_SCY); // ldh a, (SCY); dec a; ldh (SCY), a
+	_gbWaitVBlankEnd(a);
+	_gbJr(a, 0x18, loop);
+}
+
+static void _gbAudio(struct BenchAssembler* a) {
+	_gbPrologue(a);
+	_gbWriteIO(a, GB_REG_NR52, 0x80);
+	_gbWriteIO(a, GB_REG_NR50, 0x77);
+	_gbWriteIO(a, GB_REG_NR51, 0xFF);
+	_gbWriteIO(a, GB_REG_NR10, 0x00);
+	_gbWriteIO(a, GB_REG_NR11, 0x80);
+	_gbWriteIO(a, GB_REG_NR12, 0xF0);
+	_gbWriteIO(a, GB_REG_NR13, 0x00);
+	_gbWriteIO(a, GB_REG_NR14, 0x87);
+	_gbWriteIO(a, GB_REG_NR21, 0x40);
+	_gbWriteIO(a, GB_REG_NR22, 0xF0);
+	_gbWriteIO(a, GB_REG_NR23, 0x80);
+	_gbWriteIO(a, GB_REG_NR24, 0x86);
+	int i;
+	for (i = 0; i < 16; ++i) {
+		_gbWriteIO(a, GB_REG_WAVE_0 + i, i * 0x11);
+	}
+	_gbWriteIO(a, GB_REG_NR30, 0x80);
+	_gbWriteIO(a, GB_REG_NR31, 0x00);
+	_gbWriteIO(a, GB_REG_NR32, 0x20);
+	_gbWriteIO(a, GB_REG_NR33, 0x00);
+	_gbWriteIO(a, GB_REG_NR34, 0x87);
+	_gbWriteIO(a, GB_REG_NR41, 0x00);
+	_gbWriteIO(a, GB_REG_NR42, 0xF0);
+	_gbWriteIO(a, GB_REG_NR43, 0x55);
+	_gbWriteIO(a, GB_REG_NR44, 0x80);
+
+	GB_EMIT(a, 0x06, 0x00); // ld b, 0
+	uint32_t loop = _here(a);
+	_gbWaitVBlank(a);
+	// Sweep the first square channel each frame
+	GB_EMIT(a, 0x04, 0x78, 0xE0, GB_REG_NR13); // inc b; ld a, b; ldh (NR13), a
+	GB_EMIT(a, 0x3E, 0x87, 0xE0, GB_REG_NR14); // ld a, $87; ldh (NR14), a
+	_gbWaitVBlankEnd(a);
+	_gbJr(a, 0x18, loop);
+}
+
+static void _gbHeader(struct BenchAssembler* a, const char* name) {
+	a->rom[0x100] = 0x00; // nop
+	a->rom[0x101] = 0xC3; // jp $0150
+	a->rom[0x102] = 0x50;
+	a->rom[0x103] = 0x01;
+	memcpy(&a->rom[0x104], _gbLogo, sizeof(_gbLogo));
+	strncpy((char*) &a->rom[0x134], name, 15);
+	uint8_t checksum = 0;
+	int i;
+	for (i = 0x134; i < 0x14D; ++i) {
+		checksum -= a->rom[i] + 1;
+	}
+	a->rom[0x14D] = checksum;
+}
+#endif
+
+static const struct BenchROM _benchmarks[] = {
+#ifdef M_CORE_GBA
+	{ "gba-thumb-alu", "Unrolled Thumb ALU loop", mPLATFORM_GBA, _gbaThumbALU },
+	{ "gba-arm-ldmstm", "ARM LDM/STM block copies between IWRAM and EWRAM", mPLATFORM_GBA, _gbaLdmStm },
+	{ "gba-rom-waitstates", "ROM loads with slow waitstates and no prefetch", mPLATFORM_GBA, _gbaRomWaitstates },
+	{ "gba-dma", "Back-to-back 32 KiB DMA 3 bursts", mPLATFORM_GBA, _gbaDMA },
+	{ "gba-mode0", "Four scrolling, blended text backgrounds", mPLATFORM_GBA, _gbaMode0 },
+	{ "gba-mode2", "Two rotating affine backgrounds", mPLATFORM_GBA, _gbaMode2 },
+	{ "gba-mode3", "Panning 16-bit bitmap", mPLATFORM_GBA, _gbaMode3 },
+	{ "gba-sprites", "128 large regular and affine sprites", mPLATFORM_GBA, _gbaSprites },
+	{ "gba-audio", "All PSG channels and a DMA-fed FIFO", mPLATFORM_GBA, _gbaAudio },
+#endif
+#ifdef M_CORE_GB
+	{ "gb-alu", "Unrolled SM83 ALU loop", mPLATFORM_GB, _gbALU },
+	{ "gb-memcpy", "Byte copy loop between ROM and WRAM", mPLATFORM_GB, _gbMemcpy },
+	{ "gb-render", "Scrolling background, window and 40 sprites", mPLATFORM_GB, _gbRender },
+	{ "gb-audio", "All PSG channels", mPLATFORM_GB, _gbAudio },
+#endif
+	{ 0 }
+};
+
+static struct VFile* _buildROM(const struct BenchROM* bench) {
+	size_t size;
+	uint32_t base;
+	uint32_t entry;
+	switch (bench->platform) {
+#ifdef M_CORE_GBA
+	case mPLATFORM_GBA:
+		size = BENCH_GBA_ROM_SIZE;
+		base = GBA_BASE_ROM0;
+		entry = 0xC0;
+		break;
+#endif
+#ifdef M_CORE_GB
+	case mPLATFORM_GB:
+		size = BENCH_GB_ROM_SIZE;
+		base = 0;
+		entry = 0x150;
+		break;
+#endif
+	default:
+		return NULL;
+	}
+	struct BenchAssembler a = {
+		.rom = calloc(1, size),
+		.base = base,
+		.offset = entry
+	};
+	_seed(bench->name);
+	bench->build(&a);
+	switch (bench->platform) {
+#ifdef M_CORE_GBA
+	case mPLATFORM_GBA:
+		_gbaHeader(&a, bench->name);
+		break;
+#endif
+#ifdef M_CORE_GB
+	case mPLATFORM_GB:
+		_gbHeader(&a, bench->name);
+		break;
+#endif
+	default:
+		break;
+	}
+	struct VFile* vf = VFileMemChunk(a.rom, size);
+	free(a.rom);
+	return vf;
+}
+
+static bool _writeROM(const struct BenchROM* bench, const char* outdir) {
+	struct VFile* rom = _buildROM(bench);
+	if (!rom) {
+		return false;
+	}
+	char path[PATH_MAX];
+	snprintf(path, sizeof(path), "%s" PATH_SEP "%s.%s", outdir, bench->name, bench->platform == mPLATFORM_GBA ? "gba" : "gb");
+	struct VFile* vf = VFileOpen(path, O_WRONLY | O_CREAT | O_TRUNC);
+	bool success = false;
+	if (vf) {
+		size_t size = rom->size(rom);
+		void* data = rom->map(rom, size, MAP_READ);
+		success = vf->write(vf, data, size) == (ssize_t) size;
+		rom->unmap(rom, data, size);
+		vf->close(vf);
+	}
+	rom->close(rom);
+	return success;
+}
+
+static bool _runROM(const struct BenchROM* bench, unsigned frames, bool noVideo, bool csv) {
+	struct VFile* rom = _buildROM(bench);
+	if (!rom) {
+		return false;
+	}
+	struct mCore* core = mCoreCreate(bench->platform);
+	if (!core) {
+		rom->close(rom);
+		return false;
+	}
+	core->init(core);
+	static color_t outputBuffer[256 * 256];
+	if (!noVideo) {
+		core->setVideoBuffer(core, outputBuffer, 256);
+	}
+	if (!core->loadROM(core, rom)) {
+		rom->close(rom);
+		core->deinit(core);
+		return false;
+	}
+	mCoreInitConfig(core, NULL);
+	// Match a frontend at full volume instead of running muted
+	mCoreConfigSetDefaultIntValue(&core->config, "volume", 0x100);
+	mCoreLoadConfig(core);
+	core->reset(core);
+
+	struct timeval tv;
+	gettimeofday(&tv, 0);
+	uint64_t start = 1000000LL * tv.tv_sec + tv.tv_usec;
+	unsigned frame;
+	for (frame = 0; frame < frames && !_dispatchExiting; ++frame) {
+		core->runFrame(core);
+	}
+	gettimeofday(&tv, 0);
+	uint64_t duration = 1000000LL * tv.tv_sec + tv.tv_usec - start;
+
+	mCoreConfigDeinit(&core->config);
+	core->deinit(core);
+
+	if (!duration) {
+		duration = 1;
+	}
+	float fps = frame * 1000000.f / duration;
+	if (csv) {
+		printf("%s,%u,%" PRIu64 "\n", bench->name, frame, duration);
+	} else {
+		printf("%-20s %6u frames in %8.1f ms: %9.1f fps (%.2fx)\n", bench->name, frame, duration / 1000.f, fps, fps / 60.f);
+	}
+	fflush(stdout);
+	return true;
+}
+
+static bool _selected(const struct BenchROM* bench, int argc, char* const* argv) {
+	if (!argc) {
+		return true;
+	}
+	int i;
+	for (i = 0; i < argc; ++i) {
+		if (strcmp(argv[i], bench->name) == 0) {
+			return true;
+		}
+	}
+	return false;
+}
+
+static void _usage(const char* arg0) {
+	printf("usage: %s [-hlNP] [-F FRAMES] [-o DIR] [--version] [benchmark...]\n", arg0);
+	puts("  -F, --frames FRAMES        Run each benchmark for FRAMES frames (default 600)");
+	puts("  -h, --help                 Print this usage and exit");
+	puts("  -l, --list                 List the available benchmarks");
+	puts("  -N, --no-video             Disable video rendering entirely");
+	puts("  -o, --outdir DIR           Write the generated ROMs to DIR instead of running them");
+	puts("  -P, --csv                  CSV output, useful for parsing");
+	puts("  --version                  Print version and exit");
+}
+
+int main(int argc, char** argv) {
+	signal(SIGINT, _benchShutdown);
+
+	struct mLogger logger = { .log = _log };
+	mLogSetDefaultLogger(&logger);
+
+	unsigned frames = 600;
+	bool noVideo = false;
+	bool csv = false;
+	bool list = false;
+	const char* outdir = NULL;
+
+	int ch;
+	int index = 0;
+	while ((ch = getopt_long(argc, argv, shortOpts, longOpts, &index)) != -1) {
+		const struct option* opt = &longOpts[index];
+		switch (ch) {
+		case '\0':
+			if (strcmp(opt->name, "version") == 0) {
+				printf("%s %s (%s)\n", argv[0], projectVersion, gitCommit);
+				return 0;
+			}
+			_usage(argv[0]);
+			return 1;
+		case 'F':
+			frames = strtoul(optarg, NULL, 10);
+			break;
+		case 'h':
+			_usage(argv[0]);
+			return 0;
+		case 'l':
+			list = true;
+			break;
+		case 'N':
+			noVideo = true;
+			break;
+		case 'o':
+			outdir = optarg;
+			break;
+		case 'P':
+			csv = true;
+			break;
+		default:
+			_usage(argv[0]);
+			return 1;
+		}
+	}
+	argc -= optind;
+	argv += optind;
+
+	if (csv && !list && !outdir) {
+		puts("rom,frames,duration");
+	}
+	bool success = true;
+	const struct BenchROM* bench;
+	for (bench = _benchmarks; bench->name && !_dispatchExiting; ++bench) {
+		if (!_selected(bench, argc, argv)) {
+			continue;
+		}
+		if (list) {
+			printf("%-20s %s\n", bench->name, bench->description);
+		} else if (outdir) {
+			if (!_writeROM(bench, outdir)) {
+				fprintf(stderr, "Could not write %s\n", bench->name);
+				success = false;
+			}
+		} else if (!_runROM(bench, frames, noVideo, csv)) {
+			fprintf(stderr, "Could not run %s\n", bench->name);
+			success = false;
+		}
+	}
+	return !success;
+}
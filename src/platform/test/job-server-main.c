@@ -0,0 +1,143 @@
+/* Copyright (c) 2013-2024 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include <mgba/core/config.h>
+#include <mgba/core/log.h>
+#include <mgba/feature/commandline.h>
+#include <mgba/feature/job-server.h>
+
+#include <signal.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+#define JOB_SERVER_OPTIONS "S:w:"
+#define JOB_SERVER_USAGE \
+	"Additional options:\n" \
+	"  -S SOCKET        Path of the UNIX domain socket to listen on\n" \
+	"  -w WORKERS       Number of jobs to run at once (default: 4)\n"
+
+struct JobServerOpts {
+	char* socketPath;
+	int workers;
+};
+
+static volatile bool _dispatchExiting = false;
+static struct mStandardLogger _logger;
+
+static void _jobServerShutdown(int signal) {
+	UNUSED(signal);
+	_dispatchExiting = true;
+}
+
+static bool _parseJobServerOpts(struct mSubParser* parser, int option, const char* arg) {
+	struct JobServerOpts* opts = parser->opts;
+	char* end;
+	switch (option) {
+	case 'S':
+		free(opts->socketPath);
+		opts->socketPath = strdup(arg);
+		return true;
+	case 'w':
+		opts->workers = strtol(arg, &end, 10);
+		return !*end && opts->workers > 0;
+	default:
+		return false;
+	}
+}
+
+static Socket _listenUnix(const char* path) {
+	struct sockaddr_un address = { .sun_family = AF_UNIX };
+	if (strlen(path) >= sizeof(address.sun_path)) {
+		return INVALID_SOCKET;
+	}
+	strncpy(address.sun_path, path, sizeof(address.sun_path) - 1);
+
+	// Clear out a socket left behind by a previous server, but nothing else
+	struct stat st;
+	if (stat(path, &st) == 0 && S_ISSOCK(st.st_mode)) {
+		unlink(path);
+	}
+
+	Socket sock = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (SOCKET_FAILED(sock)) {
+		return INVALID_SOCKET;
+	}
+	if (bind(sock, (struct sockaddr*) &address, sizeof(address)) < 0 || SOCKET_FAILED(SocketListen(sock, 16))) {
+		SocketClose(sock);
+		return INVALID_SOCKET;
+	}
+	return sock;
+}
+
+int main(int argc, char* argv[]) {
+	signal(SIGINT, _jobServerShutdown);
+	signal(SIGTERM, _jobServerShutdown);
+	signal(SIGPIPE, SIG_IGN);
+
+	struct JobServerOpts jobServerOpts = { NULL, 4 };
+	struct mSubParser subparser = {
+		.usage = JOB_SERVER_USAGE,
+		.parse = _parseJobServerOpts,
+		.extraOptions = JOB_SERVER_OPTIONS,
+		.opts = &jobServerOpts
+	};
+
+	struct mArguments args;
+	bool parsed = mArgumentsParse(&args, argc, argv, &subparser, 1);
+	if (!jobServerOpts.socketPath) {
+		parsed = false;
+	}
+	if (!parsed || args.showHelp) {
+		usage(argv[0], NULL, NULL, &subparser, 1);
+		free(jobServerOpts.socketPath);
+		mArgumentsDeinit(&args);
+		return !parsed;
+	}
+	if (args.showVersion) {
+		version(argv[0]);
+		free(jobServerOpts.socketPath);
+		mArgumentsDeinit(&args);
+		return 0;
+	}
+
+	// Every core is configured from this once, instead of rereading it for each job
+	struct mCoreConfig config;
+	mCoreConfigInit(&config, "jobServer");
+	mCoreConfigLoad(&config);
+	mArgumentsApply(&args, NULL, 0, &config);
+	mCoreConfigSetDefaultValue(&config, "idleOptimization", "detect");
+
+	mStandardLoggerInit(&_logger);
+	mStandardLoggerConfig(&_logger, &config);
+	mLogSetDefaultLogger(&_logger.d);
+
+	int didFail = 1;
+	SocketSubsystemInit();
+	Socket listener = _listenUnix(jobServerOpts.socketPath);
+	if (SOCKET_FAILED(listener)) {
+		fprintf(stderr, "Could not listen on %s\n", jobServerOpts.socketPath);
+		goto cleanup;
+	}
+
+	struct mJobServer server;
+	mJobServerInit(&server, &config);
+	if (mJobServerStart(&server, jobServerOpts.workers)) {
+		mJobServerServe(&server, listener, &_dispatchExiting);
+		didFail = 0;
+	}
+	mJobServerDeinit(&server);
+
+	SocketClose(listener);
+	unlink(jobServerOpts.socketPath);
+
+cleanup:
+	SocketSubsystemDeinit();
+	mStandardLoggerDeinit(&_logger);
+	mCoreConfigDeinit(&config);
+	free(jobServerOpts.socketPath);
+	mArgumentsDeinit(&args);
+
+	return didFail;
+}
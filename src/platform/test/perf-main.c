@@ -12,8 +12,10 @@
 #include <mgba/gba/core.h>
 
 #include <mgba/feature/commandline.h>
+#include <mgba-util/memory.h>
 #include <mgba-util/socket.h>
 #include <mgba-util/string.h>
+#include <mgba-util/threading.h>
 #include <mgba-util/vfs.h>
 
 #ifdef __3DS__
@@ -41,8 +43,11 @@ size_t romBufferSize;
 #include <signal.h>
 #include <inttypes.h>
 #include <sys/time.h>
+#if defined(__linux__) || defined(__APPLE__)
+#include <sys/resource.h>
+#endif
 
-#define PERF_OPTIONS "DF:L:NPS:T"
+#define PERF_OPTIONS "A:DF:H:L:MNPRS:T"
 #define PERF_USAGE \
 	"Benchmark options:\n" \
 	"  -F FRAMES        Run for the specified number of FRAMES before exiting\n" \
@@ -51,6 +56,10 @@ size_t romBufferSize;
 	"  -P               CSV output, useful for parsing\n" \
 	"  -S SEC           Run for SEC in-game seconds before exiting\n" \
 	"  -L FILE          Load a savestate when starting the test\n" \
+	"  -A CPU           Pin the emulation thread to processor CPU\n" \
+	"  -H MODE          Back the ROM and large buffers with huge pages (thp or explicit)\n" \
+	"  -M               Move emulated memory to the local NUMA node\n" \
+	"  -R               Report memory usage and peak RSS for each run\n" \
 	"  -D               Act as a server"
 
 struct PerfOpts {
@@ -61,6 +70,10 @@ struct PerfOpts {
 	unsigned frames;
 	char* savestate;
 	bool server;
+	int affinity;
+	enum mHugePageMode hugePages;
+	bool numaLocal;
+	bool memoryReport;
 };
 
 #ifdef __SWITCH__
@@ -73,6 +86,8 @@ static bool _parsePerfOpts(struct mSubParser* parser, int option, const char* ar
 static void _log(struct mLogger*, int, enum mLogLevel, const char*, va_list);
 static bool _mPerfRunCore(const char* fname, const struct mArguments*, const struct PerfOpts*);
 static bool _mPerfRunServer(const struct mArguments*, const struct PerfOpts*);
+static void _resetPeakRSS(void);
+static size_t _peakRSS(void);
 
 static bool _dispatchExiting = false;
 static struct VFile* _savestate = 0;
@@ -122,7 +137,7 @@ int main(int argc, char** argv) {
 	struct mLogger logger = { .log = _log };
 	mLogSetDefaultLogger(&logger);
 
-	struct PerfOpts perfOpts = { false, false, false, 0, 0, 0, false };
+	struct PerfOpts perfOpts = { false, false, false, 0, 0, 0, false, -1, mHUGE_PAGES_NONE, false, false };
 	struct mSubParser subparser = {
 		.usage = PERF_USAGE,
 		.parse = _parsePerfOpts,
@@ -151,9 +166,14 @@ int main(int argc, char** argv) {
 		free(perfOpts.savestate);
 	}
 
+	if (perfOpts.affinity >= 0 && ThreadSetAffinity(perfOpts.affinity) != 0) {
+		fprintf(stderr, "Could not pin to processor %i\n", perfOpts.affinity);
+	}
+	mappedMemorySetHugePages(perfOpts.hugePages);
+
 	_outputBuffer = malloc(256 * 256 * 4);
 	if (perfOpts.csv) {
-		puts("game_code,frames,duration,renderer");
+		puts(perfOpts.memoryReport ? "game_code,frames,duration,renderer,peak_rss" : "game_code,frames,duration,renderer");
 #ifdef __SWITCH__
 		consoleUpdate(NULL);
 #elif defined(GEKKO)
@@ -199,11 +219,19 @@ bool _mPerfRunCore(const char* fname, const struct mArguments* args, const struc
 	// TODO: Put back debugger
 	char gameCode[9] = { 0 };
 
+	if (perfOpts->memoryReport) {
+		_resetPeakRSS();
+	}
 	core->init(core);
 	if (!perfOpts->noVideo) {
 		core->setVideoBuffer(core, _outputBuffer, 256);
 	}
-	mCoreLoadFile(core, fname);
+	if (perfOpts->hugePages != mHUGE_PAGES_NONE) {
+		// File-backed ROM mappings can't use huge pages, so copy the ROM into anonymous memory
+		mCorePreloadFile(core, fname);
+	} else {
+		mCoreLoadFile(core, fname);
+	}
 	mCoreConfigInit(&core->config, "perf");
 	mCoreConfigLoad(&core->config);
 
@@ -226,6 +254,9 @@ bool _mPerfRunCore(const char* fname, const struct mArguments* args, const struc
 	if (_savestate) {
 		mCoreLoadStateNamed(core, _savestate, 0);
 	}
+	if (perfOpts->numaLocal && !mCoreBindMemoryLocal(core)) {
+		fprintf(stderr, "Could not move emulated memory to the local NUMA node\n");
+	}
 
 	core->getGameCode(core, gameCode);
 
@@ -241,6 +272,13 @@ bool _mPerfRunCore(const char* fname, const struct mArguments* args, const struc
 	uint64_t end = 1000000LL * tv.tv_sec + tv.tv_usec;
 	uint64_t duration = end - start;
 
+	struct mCoreMemoryUsage usage;
+	size_t peakRSS = 0;
+	if (perfOpts->memoryReport) {
+		core->memoryUsage(core, &usage);
+		peakRSS = _peakRSS();
+	}
+
 	mCoreConfigFreeOpts(&opts);
 	mCoreConfigDeinit(&core->config);
 	core->deinit(core);
@@ -256,13 +294,30 @@ bool _mPerfRunCore(const char* fname, const struct mArguments* args, const struc
 		} else {
 			rendererName = "software";
 		}
-		snprintf(buffer, sizeof(buffer), "%s,%i,%" PRIu64 ",%s\n", gameCode, frames, duration, rendererName);
+		if (perfOpts->memoryReport) {
+			snprintf(buffer, sizeof(buffer), "%s,%i,%" PRIu64 ",%s,%zu\n", gameCode, frames, duration, rendererName, peakRSS);
+		} else {
+			snprintf(buffer, sizeof(buffer), "%s,%i,%" PRIu64 ",%s\n", gameCode, frames, duration, rendererName);
+		}
 		printf("%s", buffer);
 		if (_socket != INVALID_SOCKET) {
 			SocketSend(_socket, buffer, strlen(buffer));
 		}
 	} else {
 		printf("%u frames in %" PRIu64 " microseconds: %g fps (%gx)\n", frames, duration, scaledFrames / duration, scaledFrames / (duration * 60.f));
+		if (perfOpts->memoryReport) {
+			int i;
+			for (i = 0; i < mCORE_MEMORY_USAGE_MAX; ++i) {
+				printf("%-9s %8zu KiB allocated, %8zu KiB resident", mCoreMemoryUsageName(i), usage.allocated[i] / 1024, usage.resident[i] / 1024);
+				if (usage.shared[i]) {
+					printf(", %8zu KiB shared", usage.shared[i] / 1024);
+				}
+				printf("\n");
+			}
+			if (peakRSS) {
+				printf("Peak RSS: %zu KiB\n", peakRSS / 1024);
+			}
+		}
 	}
 #ifdef __SWITCH__
 	consoleUpdate(NULL);
@@ -326,7 +381,7 @@ static bool _mPerfRunServer(const struct mArguments* args, const struct PerfOpts
 		return false;
 	}
 	if (perfOpts->csv) {
-		const char* header = "game_code,frames,duration,renderer\n";
+		const char* header = perfOpts->memoryReport ? "game_code,frames,duration,renderer,peak_rss\n" : "game_code,frames,duration,renderer\n";
 		SocketSend(_socket, header, strlen(header));
 	}
 	char path[PATH_MAX];
@@ -352,6 +407,49 @@ static bool _mPerfRunServer(const struct mArguments* args, const struct PerfOpts
 	return true;
 }
 
+// The high-water mark is reset before each run where the platform allows it,
+// so runs in server mode each report their own peak
+static void _resetPeakRSS(void) {
+#ifdef __linux__
+	FILE* clearRefs = fopen("/proc/self/clear_refs", "w");
+	if (clearRefs) {
+		fputs("5", clearRefs);
+		fclose(clearRefs);
+	}
+#endif
+}
+
+static size_t _peakRSS(void) {
+#ifdef __linux__
+	FILE* status = fopen("/proc/self/status", "r");
+	if (status) {
+		char line[128];
+		size_t peak = 0;
+		while (fgets(line, sizeof(line), status)) {
+			if (strncmp(line, "VmHWM:", 6) == 0) {
+				peak = strtoull(&line[6], NULL, 10) * 1024;
+				break;
+			}
+		}
+		fclose(status);
+		if (peak) {
+			return peak;
+		}
+	}
+#endif
+#if defined(__linux__) || defined(__APPLE__)
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) == 0) {
+#ifdef __APPLE__
+		return usage.ru_maxrss;
+#else
+		return usage.ru_maxrss * 1024;
+#endif
+	}
+#endif
+	return 0;
+}
+
 static void _mPerfShutdown(int signal) {
 	UNUSED(signal);
 	_dispatchExiting = true;
@@ -363,6 +461,9 @@ static bool _parsePerfOpts(struct mSubParser* parser, int option, const char* ar
 	struct PerfOpts* opts = parser->opts;
 	errno = 0;
 	switch (option) {
+	case 'A':
+		opts->affinity = strtol(arg, 0, 10);
+		return !errno && opts->affinity >= 0;
 	case 'D':
 		opts->server = true;
 		return true;
@@ -381,9 +482,26 @@ static bool _parsePerfOpts(struct mSubParser* parser, int option, const char* ar
 	case 'T':
 		opts->threadedVideo = true;
 		return true;
+	case 'H':
+		if (strcmp(arg, "thp") == 0) {
+			opts->hugePages = mHUGE_PAGES_TRANSPARENT;
+		} else if (strcmp(arg, "explicit") == 0) {
+			opts->hugePages = mHUGE_PAGES_EXPLICIT;
+		} else if (strcmp(arg, "none") == 0) {
+			opts->hugePages = mHUGE_PAGES_NONE;
+		} else {
+			return false;
+		}
+		return true;
 	case 'L':
 		opts->savestate = strdup(arg);
 		return true;
+	case 'M':
+		opts->numaLocal = true;
+		return true;
+	case 'R':
+		opts->memoryReport = true;
+		return true;
 	default:
 		return false;
 	}
@@ -0,0 +1,363 @@
+/* Copyright (c) 2013-2024 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include <mgba/core/core.h>
+#include <mgba/core/version.h>
+#include <mgba/internal/debugger/symbols.h>
+#include <mgba/internal/debugger/tracer.h>
+#ifdef M_CORE_GBA
+#include <mgba/internal/arm/decoder.h>
+#endif
+#ifdef M_CORE_GB
+#include <mgba/internal/gb/debugger/symbols.h>
+#include <mgba/internal/sm83/decoder.h>
+#endif
+
+#include <mgba-util/string.h>
+#include <mgba-util/table.h>
+#include <mgba-util/vfs.h>
+
+#ifdef _MSC_VER
+#include <mgba-util/platform/windows/getopt.h>
+#else
+#include <getopt.h>
+#endif
+
+#define TRACE_HOTSPOTS 20
+
+static const struct option longOpts[] = {
+	{ "address",  required_argument, 0, 'a' },
+	{ "count",    required_argument, 0, 'n' },
+	{ "cycles",   required_argument, 0, 'c' },
+	{ "help",     no_argument, 0, 'h' },
+	{ "hotspots", no_argument, 0, 'H' },
+	{ "memory",   no_argument, 0, 'm' },
+	{ "regs",     no_argument, 0, 'r' },
+	{ "symbols",  required_argument, 0, 's' },
+	{ "version",  no_argument, 0, '\0' },
+	{ 0, 0, 0, 0 }
+};
+
+static const char shortOpts[] = "a:c:hHmn:rs:";
+
+struct TraceOpts {
+	uint32_t minAddress;
+	uint32_t maxAddress;
+	uint64_t minCycles;
+	uint64_t maxCycles;
+	uint64_t count;
+	bool showRegisters;
+	bool showMemory;
+	bool hotspots;
+	const char* symbols;
+};
+
+struct TraceHotspot {
+	uint32_t address;
+	uint64_t count;
+};
+
+struct TraceHotspotList {
+	struct TraceHotspot* hotspots;
+	size_t size;
+};
+
+static const char* const _armRegisters[] = {
+	"r0", "r1", "r2", "r3", "r4", "r5", "r6", "r7",
+	"r8", "r9", "r10", "r11", "r12", "sp", "lr", "pc"
+};
+
+static const char* const _sm83Registers[] = {
+	"af", "bc", "de", "hl", "sp", "pc"
+};
+
+static void _usage(const char* arg0) {
+	printf("usage: %s [-hHmr] [-a ADDR[-ADDR]] [-c CYCLE[-CYCLE]] [-n COUNT] [-s SYMBOLS] [--version] TRACE\n", arg0);
+	puts("  -a, --address ADDR[-ADDR]  Only show instructions within an address range");
+	puts("  -c, --cycles CYCLE[-CYCLE] Only show instructions within a cycle range");
+	puts("  -h, --help                 Print this usage and exit");
+	puts("  -H, --hotspots             Summarize the most executed addresses instead");
+	puts("  -m, --memory               Show recorded memory writes");
+	puts("  -n, --count COUNT          Stop after showing COUNT instructions");
+	puts("  -r, --regs                 Show recorded register changes");
+	puts("  -s, --symbols FILE         Load symbols for labels and disassembly");
+	puts("  --version                  Print version and exit");
+}
+
+static bool _parseRange(const char* arg, uint64_t* min, uint64_t* max) {
+	char* end;
+	*min = strtoull(arg, &end, 0);
+	if (end == arg) {
+		return false;
+	}
+	if (!*end) {
+		*max = *min + 1;
+		return true;
+	}
+	if (*end != '-') {
+		return false;
+	}
+	arg = end + 1;
+	*max = strtoull(arg, &end, 0);
+	return end != arg && !*end && *max > *min;
+}
+
+static void _disassemble(const struct mDebuggerTraceReader* reader, const struct mDebuggerTraceRecord* record, const struct mDebuggerSymbols* symbols, char* out, size_t size) {
+	switch (reader->platform) {
+#ifdef M_CORE_GBA
+	case mPLATFORM_GBA: {
+		struct ARMInstructionInfo info;
+		// The T bit of the recorded CPSR
+		if (record->mode & 0x20) {
+			size_t written = snprintf(out, size, "%04X      ", record->value & 0xFFFF);
+			ARMDecodeThumb(record->value, &info);
+			ARMDisassemble(&info, NULL, symbols, record->address + WORD_SIZE_THUMB, out + written, size - written);
+		} else {
+			size_t written = snprintf(out, size, "%08X  ", record->value);
+			ARMDecodeARM(record->value, &info);
+			ARMDisassemble(&info, NULL, symbols, record->address + WORD_SIZE_ARM, out + written, size - written);
+		}
+		return;
+	}
+#endif
+#ifdef M_CORE_GB
+	case mPLATFORM_GB: {
+		struct SM83InstructionInfo info = {0};
+		char bytes[16] = "";
+		size_t bytesRemaining;
+		size_t i = 0;
+		for (bytesRemaining = 1; bytesRemaining && i < 3; --bytesRemaining, ++i) {
+			uint8_t byte = record->value >> (i * 8);
+			snprintf(&bytes[i * 2], sizeof(bytes) - i * 2, "%02X", byte);
+			bytesRemaining += SM83Decode(byte, &info);
+		}
+		size_t written = snprintf(out, size, "%-8s  ", bytes);
+		SM83Disassemble(&info, record->address + i, out + written, size - written);
+		return;
+	}
+#endif
+	default:
+		snprintf(out, size, "%08X", record->value);
+		return;
+	}
+}
+
+static void _printRegister(const struct mDebuggerTraceReader* reader, const struct mDebuggerTraceRecord* record) {
+	const char* name = NULL;
+	switch (reader->platform) {
+	case mPLATFORM_GBA:
+		if (record->index < sizeof(_armRegisters) / sizeof(*_armRegisters)) {
+			name = _armRegisters[record->index];
+		}
+		break;
+	case mPLATFORM_GB:
+		if (record->index < sizeof(_sm83Registers) / sizeof(*_sm83Registers)) {
+			name = _sm83Registers[record->index];
+		}
+		break;
+	default:
+		break;
+	}
+	if (name) {
+		printf("%21s %s = %08X\n", "", name, record->value);
+	} else {
+		printf("%21s r%u = %08X\n", "", record->index, record->value);
+	}
+}
+
+static void _countHotspot(struct Table* table, uint32_t address) {
+	uint64_t* count = TableLookup(table, address);
+	if (!count) {
+		count = calloc(1, sizeof(*count));
+		TableInsert(table, address, count);
+	}
+	++*count;
+}
+
+static void _collectHotspot(uint32_t key, void* value, void* user) {
+	struct TraceHotspotList* list = user;
+	list->hotspots[list->size].address = key;
+	list->hotspots[list->size].count = *(uint64_t*) value;
+	++list->size;
+}
+
+static int _compareHotspots(const void* a, const void* b) {
+	const struct TraceHotspot* ha = a;
+	const struct TraceHotspot* hb = b;
+	if (ha->count != hb->count) {
+		return ha->count < hb->count ? 1 : -1;
+	}
+	return ha->address < hb->address ? -1 : ha->address > hb->address;
+}
+
+static void _printHotspots(struct Table* table, uint64_t total, const struct mDebuggerSymbols* symbols) {
+	struct TraceHotspotList list = {
+		.hotspots = calloc(TableSize(table) + 1, sizeof(struct TraceHotspot)),
+		.size = 0
+	};
+	TableEnumerate(table, _collectHotspot, &list);
+	qsort(list.hotspots, list.size, sizeof(*list.hotspots), _compareHotspots);
+	size_t i;
+	for (i = 0; i < list.size && i < TRACE_HOTSPOTS; ++i) {
+		const char* label = symbols ? mDebuggerSymbolReverseLookup(symbols, list.hotspots[i].address, -1) : NULL;
+		printf("%08X %12" PRIu64 " %6.2f%% %s\n", list.hotspots[i].address, list.hotspots[i].count, list.hotspots[i].count * 100. / total, label ? label : "");
+	}
+	free(list.hotspots);
+}
+
+int main(int argc, char** argv) {
+	struct TraceOpts opts = {
+		.minAddress = 0,
+		.maxAddress = 0xFFFFFFFF,
+		.minCycles = 0,
+		.maxCycles = UINT64_MAX,
+		.count = UINT64_MAX,
+	};
+
+	int ch;
+	int index = 0;
+	uint64_t min, max;
+	while ((ch = getopt_long(argc, argv, shortOpts, longOpts, &index)) != -1) {
+		const struct option* opt = &longOpts[index];
+		switch (ch) {
+		case '\0':
+			if (strcmp(opt->name, "version") == 0) {
+				printf("%s %s (%s)\n", argv[0], projectVersion, gitCommit);
+				return 0;
+			}
+			_usage(argv[0]);
+			return 1;
+		case 'a':
+			if (!_parseRange(optarg, &min, &max) || max - 1 > 0xFFFFFFFF) {
+				_usage(argv[0]);
+				return 1;
+			}
+			opts.minAddress = min;
+			opts.maxAddress = max - 1;
+			break;
+		case 'c':
+			if (!_parseRange(optarg, &opts.minCycles, &opts.maxCycles)) {
+				_usage(argv[0]);
+				return 1;
+			}
+			break;
+		case 'h':
+			_usage(argv[0]);
+			return 0;
+		case 'H':
+			opts.hotspots = true;
+			break;
+		case 'm':
+			opts.showMemory = true;
+			break;
+		case 'n':
+			opts.count = strtoull(optarg, NULL, 10);
+			break;
+		case 'r':
+			opts.showRegisters = true;
+			break;
+		case 's':
+			opts.symbols = optarg;
+			break;
+		default:
+			_usage(argv[0]);
+			return 1;
+		}
+	}
+	if (optind + 1 != argc) {
+		_usage(argv[0]);
+		return 1;
+	}
+
+	struct VFile* vf = VFileOpen(argv[optind], O_RDONLY);
+	if (!vf) {
+		fprintf(stderr, "Could not open %s\n", argv[optind]);
+		return 1;
+	}
+	struct mDebuggerTraceReader reader;
+	if (!mDebuggerTraceReaderOpen(&reader, vf)) {
+		fprintf(stderr, "%s is not a valid trace\n", argv[optind]);
+		vf->close(vf);
+		return 1;
+	}
+
+	struct mDebuggerSymbols* symbols = NULL;
+	if (opts.symbols) {
+		struct VFile* symbolFile = VFileOpen(opts.symbols, O_RDONLY);
+		if (!symbolFile) {
+			fprintf(stderr, "Could not open %s\n", opts.symbols);
+			mDebuggerTraceReaderClose(&reader);
+			return 1;
+		}
+		symbols = mDebuggerSymbolTableCreate();
+		switch (reader.platform) {
+#ifdef M_CORE_GB
+		case mPLATFORM_GB:
+			GBLoadSymbols(symbols, symbolFile);
+			break;
+#endif
+		default:
+			mDebuggerLoadARMIPSSymbols(symbols, symbolFile);
+			break;
+		}
+		symbolFile->close(symbolFile);
+	}
+
+	struct Table hotspots;
+	TableInit(&hotspots, 0x400, free);
+	uint64_t shown = 0;
+	uint64_t total = 0;
+	bool lastShown = false;
+	struct mDebuggerTraceRecord record;
+	uint64_t cycles;
+	while (shown < opts.count && mDebuggerTraceReaderNext(&reader, &record, &cycles)) {
+		switch (record.type) {
+		case mTRACE_RECORD_INSTRUCTION:
+			lastShown = false;
+			if (cycles < opts.minCycles || record.address < opts.minAddress || record.address > opts.maxAddress) {
+				break;
+			}
+			if (cycles >= opts.maxCycles) {
+				opts.count = shown;
+				break;
+			}
+			lastShown = true;
+			++total;
+			if (opts.hotspots) {
+				_countHotspot(&hotspots, record.address);
+				break;
+			}
+			++shown;
+			const char* label = symbols ? mDebuggerSymbolReverseLookup(symbols, record.address, -1) : NULL;
+			if (label) {
+				printf("%s:\n", label);
+			}
+			char disassembly[128];
+			_disassemble(&reader, &record, symbols, disassembly, sizeof(disassembly));
+			printf("%10" PRIu64 " %08X: %s\n", cycles, record.address, disassembly);
+			break;
+		case mTRACE_RECORD_REGISTER:
+			if (opts.showRegisters && lastShown && !opts.hotspots) {
+				_printRegister(&reader, &record);
+			}
+			break;
+		case mTRACE_RECORD_MEMORY:
+			if (opts.showMemory && lastShown && !opts.hotspots) {
+				printf("%21s [%08X] <- %0*X\n", "", record.address, record.index * 2, record.value);
+			}
+			break;
+		}
+	}
+	if (opts.hotspots) {
+		_printHotspots(&hotspots, total, symbols);
+	}
+
+	TableDeinit(&hotspots);
+	if (symbols) {
+		mDebuggerSymbolTableDestroy(symbols);
+	}
+	mDebuggerTraceReaderClose(&reader);
+	return 0;
+}
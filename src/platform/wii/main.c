@@ -346,6 +346,7 @@ int main(int argc, char* argv[]) {
 
 	stream.videoDimensionsChanged = NULL;
 	stream.postVideoFrame = NULL;
+	stream.postVideoFrameRepeat = NULL;
 	stream.postAudioFrame = NULL;
 	stream.postAudioBuffer = _postAudioBuffer;
 
@@ -16,3 +16,47 @@ void mappedMemoryFree(void* memory, size_t size) {
 	// size is not useful here because we're freeing the memory, not decommitting it
 	VirtualFree(memory, 0, MEM_RELEASE);
 }
+
+void* mappedMemoryResize(void* memory, size_t oldSize, size_t newSize) {
+	void* newMemory = anonymousMemoryMap(newSize);
+	if (!newMemory) {
+		return NULL;
+	}
+	memcpy(newMemory, memory, oldSize < newSize ? oldSize : newSize);
+	mappedMemoryFree(memory, oldSize);
+	return newMemory;
+}
+
+void mappedMemoryClear(void* memory, size_t size) {
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	uintptr_t pageSize = info.dwPageSize;
+	uintptr_t start = ((uintptr_t) memory + pageSize - 1) & ~(pageSize - 1);
+	uintptr_t end = ((uintptr_t) memory + size) & ~(pageSize - 1);
+	// Decommitting and recommitting whole pages gives back fresh zeroed pages
+	if (end <= start || !VirtualFree((void*) start, end - start, MEM_DECOMMIT) || !VirtualAlloc((void*) start, end - start, MEM_COMMIT, PAGE_READWRITE)) {
+		memset(memory, 0, size);
+		return;
+	}
+	memset(memory, 0, start - (uintptr_t) memory);
+	memset((void*) end, 0, (uintptr_t) memory + size - end);
+}
+
+size_t mappedMemoryResident(const void* memory, size_t size) {
+	UNUSED(memory);
+	return size;
+}
+
+void mappedMemorySetHugePages(enum mHugePageMode mode) {
+	UNUSED(mode);
+}
+
+enum mHugePageMode mappedMemoryGetHugePages(void) {
+	return mHUGE_PAGES_NONE;
+}
+
+bool mappedMemoryBindLocal(void* memory, size_t size) {
+	UNUSED(memory);
+	UNUSED(size);
+	return false;
+}
@@ -61,6 +61,23 @@ static void SM83DebuggerCheckBreakpoints(struct mDebuggerPlatform* d) {
 	mDebuggerEnter(d->p, DEBUGGER_ENTER_BREAKPOINT, &info);
 }
 
+static void _checkBreakpointPage(struct mBreakpointPages* pages) {
+	SM83DebuggerCheckBreakpoints(pages->context);
+}
+
+static void _updateBreakpointPages(struct SM83Debugger* debugger) {
+	mBreakpointPagesClear(&debugger->breakpointPages);
+	size_t i;
+	for (i = 0; i < mBreakpointListSize(&debugger->breakpoints); ++i) {
+		mBreakpointPagesMark(&debugger->breakpointPages, mBreakpointListGetPointer(&debugger->breakpoints, i)->address);
+	}
+	if (mBreakpointListSize(&debugger->breakpoints)) {
+		debugger->cpu->breakpointPages = &debugger->breakpointPages;
+	} else {
+		debugger->cpu->breakpointPages = NULL;
+	}
+}
+
 static void SM83DebuggerInit(void* cpu, struct mDebuggerPlatform* platform);
 static void SM83DebuggerDeinit(struct mDebuggerPlatform* platform);
 
@@ -72,9 +89,10 @@ static bool SM83DebuggerClearBreakpoint(struct mDebuggerPlatform*, ssize_t id);
 static ssize_t SM83DebuggerSetWatchpoint(struct mDebuggerPlatform*, struct mDebuggerModule* owner, const struct mWatchpoint*);
 static void SM83DebuggerListWatchpoints(struct mDebuggerPlatform*, struct mDebuggerModule* owner, struct mWatchpointList*);
 static void SM83DebuggerCheckBreakpoints(struct mDebuggerPlatform*);
-static bool SM83DebuggerHasBreakpoints(struct mDebuggerPlatform*);
+static bool SM83DebuggerRequiresStepping(struct mDebuggerPlatform*);
 static void SM83DebuggerTrace(struct mDebuggerPlatform*, char* out, size_t* length);
 static void SM83DebuggerNextInstructionInfo(struct mDebuggerPlatform* d, struct mDebuggerInstructionInfo* info);
+static void SM83DebuggerSetInstructionHook(struct mDebuggerPlatform* d, struct mInstructionHook* hook);
 
 struct mDebuggerPlatform* SM83DebuggerPlatformCreate(void) {
 	struct SM83Debugger* platform = malloc(sizeof(struct SM83Debugger));
@@ -87,12 +105,13 @@ struct mDebuggerPlatform* SM83DebuggerPlatformCreate(void) {
 	platform->d.setWatchpoint = SM83DebuggerSetWatchpoint;
 	platform->d.listWatchpoints = SM83DebuggerListWatchpoints;
 	platform->d.checkBreakpoints = SM83DebuggerCheckBreakpoints;
-	platform->d.hasBreakpoints = SM83DebuggerHasBreakpoints;
+	platform->d.requiresStepping = SM83DebuggerRequiresStepping;
 	platform->d.trace = SM83DebuggerTrace;
 	platform->d.getStackTraceMode = NULL;
 	platform->d.setStackTraceMode = NULL;
 	platform->d.updateStackTrace = NULL;
 	platform->d.nextInstructionInfo = SM83DebuggerNextInstructionInfo;
+	platform->d.setInstructionHook = SM83DebuggerSetInstructionHook;
 	platform->printStatus = NULL;
 	return &platform->d;
 }
@@ -100,14 +119,19 @@ struct mDebuggerPlatform* SM83DebuggerPlatformCreate(void) {
 void SM83DebuggerInit(void* cpu, struct mDebuggerPlatform* platform) {
 	struct SM83Debugger* debugger = (struct SM83Debugger*) platform;
 	debugger->cpu = cpu;
-	debugger->originalMemory = debugger->cpu->memory;
 	mBreakpointListInit(&debugger->breakpoints, 0);
 	mWatchpointListInit(&debugger->watchpoints, 0);
+	mBreakpointPagesClear(&debugger->breakpointPages);
+	debugger->breakpointPages.check = _checkBreakpointPage;
+	debugger->breakpointPages.context = debugger;
 	debugger->nextId = 1;
 }
 
 void SM83DebuggerDeinit(struct mDebuggerPlatform* platform) {
 	struct SM83Debugger* debugger = (struct SM83Debugger*) platform;
+	debugger->cpu->breakpointPages = NULL;
+	debugger->cpu->watchpointPages = NULL;
+	debugger->cpu->instructionHook = NULL;
 	size_t i;
 	for (i = 0; i < mBreakpointListSize(&debugger->breakpoints); ++i) {
 		_destroyBreakpoint(debugger->d.p, mBreakpointListGetPointer(&debugger->breakpoints, i));
@@ -135,6 +159,7 @@ static ssize_t SM83DebuggerSetBreakpoint(struct mDebuggerPlatform* d, struct mDe
 	breakpoint->id = debugger->nextId;
 	TableInsert(&debugger->d.p->pointOwner, breakpoint->id, owner);
 	++debugger->nextId;
+	_updateBreakpointPages(debugger);
 	return breakpoint->id;
 }
 
@@ -148,6 +173,7 @@ static bool SM83DebuggerClearBreakpoint(struct mDebuggerPlatform* d, ssize_t id)
 		if (breakpoint->id == id) {
 			_destroyBreakpoint(debugger->d.p, breakpoint);
 			mBreakpointListShift(breakpoints, i, 1);
+			_updateBreakpointPages(debugger);
 			return true;
 		}
 	}
@@ -158,30 +184,27 @@ static bool SM83DebuggerClearBreakpoint(struct mDebuggerPlatform* d, ssize_t id)
 		if (watchpoint->id == id) {
 			_destroyWatchpoint(debugger->d.p, watchpoint);
 			mWatchpointListShift(watchpoints, i, 1);
-			if (!mWatchpointListSize(&debugger->watchpoints)) {
-				SM83DebuggerRemoveMemoryShim(debugger);
-			}
+			SM83DebuggerUpdateWatchpoints(debugger);
 			return true;
 		}
 	}
 	return false;
 }
 
-static bool SM83DebuggerHasBreakpoints(struct mDebuggerPlatform* d) {
-	struct SM83Debugger* debugger = (struct SM83Debugger*) d;
-	return mBreakpointListSize(&debugger->breakpoints) || mWatchpointListSize(&debugger->watchpoints);
+static bool SM83DebuggerRequiresStepping(struct mDebuggerPlatform* d) {
+	UNUSED(d);
+	// Breakpoints are checked by the run loop and watchpoints by the memory bus
+	return false;
 }
 
 static ssize_t SM83DebuggerSetWatchpoint(struct mDebuggerPlatform* d, struct mDebuggerModule* owner, const struct mWatchpoint* info) {
 	struct SM83Debugger* debugger = (struct SM83Debugger*) d;
-	if (!mWatchpointListSize(&debugger->watchpoints)) {
-		SM83DebuggerInstallMemoryShim(debugger);
-	}
 	struct mWatchpoint* watchpoint = mWatchpointListAppend(&debugger->watchpoints);
 	*watchpoint = *info;
 	watchpoint->id = debugger->nextId;
 	TableInsert(&debugger->d.p->pointOwner, watchpoint->id, owner);
 	++debugger->nextId;
+	SM83DebuggerUpdateWatchpoints(debugger);
 	return watchpoint->id;
 }
 
@@ -264,3 +287,9 @@ static void SM83DebuggerNextInstructionInfo(struct mDebuggerPlatform* d, struct
 		info->flagsEx[0] = mDebuggerAccessLogFlagsExFillErrorIllegalOpcode(info->flagsEx[0]);
 	}
 }
+
+static void SM83DebuggerSetInstructionHook(struct mDebuggerPlatform* d, struct mInstructionHook* hook) {
+	struct SM83Debugger* debugger = (struct SM83Debugger*) d;
+	debugger->cpu->instructionHook = hook;
+	SM83DebuggerUpdateWatchpoints(debugger);
+}
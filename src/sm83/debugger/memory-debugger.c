@@ -8,43 +8,14 @@
 #include <mgba/internal/debugger/parser.h>
 #include <mgba/internal/sm83/debugger/debugger.h>
 
-#include <mgba-util/math.h>
-
 #include <string.h>
 
-static void _checkWatchpoints(struct SM83Debugger* debugger, uint16_t address, enum mWatchpointType type, uint8_t newValue);
-
-#define FIND_DEBUGGER(DEBUGGER, CPU) \
-	do { \
-		DEBUGGER = 0; \
-		size_t i; \
-		for (i = 0; i < CPU->numComponents; ++i) { \
-			if (CPU->components[i]->id == DEBUGGER_ID) { \
-				DEBUGGER = (struct SM83Debugger*) ((struct mDebugger*) cpu->components[i])->platform; \
-				goto debuggerFound; \
-			} \
-		} \
-		abort(); \
-		debuggerFound: break; \
-	} while(0)
-
-#define CREATE_WATCHPOINT_SHIM(NAME, RW, VALUE, RETURN, TYPES, ...) \
-	static RETURN DebuggerShim_ ## NAME TYPES { \
-		struct SM83Debugger* debugger; \
-		FIND_DEBUGGER(debugger, cpu); \
-		_checkWatchpoints(debugger, address, WATCHPOINT_ ## RW, VALUE); \
-		return debugger->originalMemory.NAME(cpu, __VA_ARGS__); \
-	}
-
-CREATE_WATCHPOINT_SHIM(load8, READ, 0, uint8_t, (struct SM83Core* cpu, uint16_t address), address)
-CREATE_WATCHPOINT_SHIM(store8, WRITE, value, void, (struct SM83Core* cpu, uint16_t address, int8_t value), address, value)
-
 static void _checkWatchpoints(struct SM83Debugger* debugger, uint16_t address, enum mWatchpointType type, uint8_t newValue) {
 	struct mWatchpoint* watchpoint;
 	size_t i;
 	for (i = 0; i < mWatchpointListSize(&debugger->watchpoints); ++i) {
 		watchpoint = mWatchpointListGetPointer(&debugger->watchpoints, i);
-		if (watchpoint->type & type && address >= watchpoint->minAddress && address < watchpoint->maxAddress && (watchpoint->segment < 0 || watchpoint->segment == debugger->originalMemory.currentSegment(debugger->cpu, address))) {
+		if (watchpoint->type & type && address >= watchpoint->minAddress && address < watchpoint->maxAddress && (watchpoint->segment < 0 || watchpoint->segment == debugger->cpu->memory.currentSegment(debugger->cpu, address))) {
 			if (watchpoint->condition) {
 				int32_t value;
 				int segment;
@@ -52,7 +23,7 @@ static void _checkWatchpoints(struct SM83Debugger* debugger, uint16_t address, e
 					continue;
 				}
 			}
-			uint8_t oldValue = debugger->originalMemory.load8(debugger->cpu, address);
+			uint8_t oldValue = debugger->cpu->memory.load8(debugger->cpu, address);
 			if ((watchpoint->type & WATCHPOINT_CHANGE) && newValue == oldValue) {
 				continue;
 			}
@@ -62,7 +33,7 @@ static void _checkWatchpoints(struct SM83Debugger* debugger, uint16_t address, e
 			info.type.wp.watchType = watchpoint->type;
 			info.type.wp.accessType = type;
 			info.address = address;
-			info.segment = debugger->originalMemory.currentSegment(debugger->cpu, address);
+			info.segment = debugger->cpu->memory.currentSegment(debugger->cpu, address);
 			info.width = 1;
 			info.pointId = watchpoint->id;
 			info.target = TableLookup(&debugger->d.p->pointOwner, watchpoint->id);
@@ -71,13 +42,52 @@ static void _checkWatchpoints(struct SM83Debugger* debugger, uint16_t address, e
 	}
 }
 
-void SM83DebuggerInstallMemoryShim(struct SM83Debugger* debugger) {
-	debugger->originalMemory = debugger->cpu->memory;
-	debugger->cpu->memory.store8 = DebuggerShim_store8;
-	debugger->cpu->memory.load8 = DebuggerShim_load8;
+static void _watchRead(struct mWatchpointPages* pages, uint32_t address, int width) {
+	UNUSED(width);
+	struct SM83Debugger* debugger = pages->context;
+	// Detach while checking so reading the old value doesn't trip the watchpoint again
+	struct mWatchpointPages* attached = debugger->cpu->watchpointPages;
+	debugger->cpu->watchpointPages = NULL;
+	_checkWatchpoints(debugger, address, WATCHPOINT_READ, 0);
+	// Editing watchpoints from the debugger reattaches them itself
+	if (!debugger->cpu->watchpointPages) {
+		debugger->cpu->watchpointPages = attached;
+	}
+}
+
+static void _watchWrite(struct mWatchpointPages* pages, uint32_t address, uint32_t value, int width) {
+	struct SM83Debugger* debugger = pages->context;
+	struct mInstructionHook* hook = debugger->cpu->instructionHook;
+	if (hook && hook->write) {
+		hook->write(hook, address, value, width);
+	}
+	struct mWatchpointPages* attached = debugger->cpu->watchpointPages;
+	debugger->cpu->watchpointPages = NULL;
+	_checkWatchpoints(debugger, address, WATCHPOINT_WRITE, value);
+	if (!debugger->cpu->watchpointPages) {
+		debugger->cpu->watchpointPages = attached;
+	}
 }
 
-void SM83DebuggerRemoveMemoryShim(struct SM83Debugger* debugger) {
-	debugger->cpu->memory.store8 = debugger->originalMemory.store8;
-	debugger->cpu->memory.load8 = debugger->originalMemory.load8;
+void SM83DebuggerUpdateWatchpoints(struct SM83Debugger* debugger) {
+	struct mWatchpointPages* pages = &debugger->watchpointPages;
+	mWatchpointPagesClear(pages);
+	pages->read = _watchRead;
+	pages->write = _watchWrite;
+	pages->context = debugger;
+	size_t i;
+	for (i = 0; i < mWatchpointListSize(&debugger->watchpoints); ++i) {
+		struct mWatchpoint* watchpoint = mWatchpointListGetPointer(&debugger->watchpoints, i);
+		mWatchpointPagesMark(pages, watchpoint->minAddress, watchpoint->maxAddress, watchpoint->type & WATCHPOINT_READ, watchpoint->type & WATCHPOINT_WRITE);
+	}
+	// A hook that sees every write needs every page flagged
+	bool hooked = debugger->cpu->instructionHook && debugger->cpu->instructionHook->write;
+	if (hooked) {
+		mWatchpointPagesMark(pages, 0, 0x10000, false, true);
+	}
+	if (mWatchpointListSize(&debugger->watchpoints) || hooked) {
+		debugger->cpu->watchpointPages = pages;
+	} else {
+		debugger->cpu->watchpointPages = NULL;
+	}
 }
@@ -8,6 +8,9 @@
 #include <mgba/internal/sm83/isa-sm83.h>
 
 void SM83Init(struct SM83Core* cpu) {
+	cpu->breakpointPages = NULL;
+	cpu->watchpointPages = NULL;
+	cpu->instructionHook = NULL;
 	cpu->master->init(cpu, cpu->master);
 	size_t i;
 	for (i = 0; i < cpu->numComponents; ++i) {
@@ -115,7 +118,7 @@ static void _SM83Step(struct SM83Core* cpu) {
 			cpu->irqh.setInterrupts(cpu, false);
 			break;
 		}
-		cpu->bus = cpu->memory.cpuLoad8(cpu, cpu->pc);
+		cpu->bus = cpu->memory.view8(cpu, cpu->pc);
 		cpu->instruction = _sm83InstructionTable[cpu->bus];
 		++cpu->pc;
 		break;
@@ -126,7 +129,7 @@ static void _SM83Step(struct SM83Core* cpu) {
 		cpu->memory.store8(cpu, cpu->index, cpu->bus);
 		break;
 	case SM83_CORE_READ_PC:
-		cpu->bus = cpu->memory.cpuLoad8(cpu, cpu->pc);
+		cpu->bus = cpu->memory.view8(cpu, cpu->pc);
 		++cpu->pc;
 		break;
 	case SM83_CORE_STALL:
@@ -140,7 +143,7 @@ static void _SM83Step(struct SM83Core* cpu) {
 			cpu->irqh.setInterrupts(cpu, false);
 			break;
 		}
-		cpu->bus = cpu->memory.cpuLoad8(cpu, cpu->pc);
+		cpu->bus = cpu->memory.view8(cpu, cpu->pc);
 		cpu->instruction = _sm83InstructionTable[cpu->bus];
 		break;
 	default:
@@ -186,7 +189,44 @@ void SM83Tick(struct SM83Core* cpu) {
 	}
 }
 
+static void _SM83RunInstrumented(struct SM83Core* cpu) {
+	struct mBreakpointPages* pages = cpu->breakpointPages;
+	struct mInstructionHook* hook = cpu->instructionHook;
+	unsigned page = 0xFFFFFFFF;
+	bool flagged = false;
+	bool running = true;
+	while (running || cpu->executionState != SM83_CORE_FETCH) {
+		if (cpu->cycles >= cpu->nextEvent) {
+			cpu->irqh.processEvents(cpu);
+			running = false;
+			continue;
+		}
+		if (hook && cpu->executionState == SM83_CORE_FETCH && !cpu->irqPending && !cpu->halted) {
+			uint32_t opcode = cpu->memory.view8(cpu, cpu->pc);
+			opcode |= cpu->memory.view8(cpu, cpu->pc + 1) << 8;
+			opcode |= cpu->memory.view8(cpu, cpu->pc + 2) << 16;
+			uint32_t regs[6] = { cpu->af, cpu->bc, cpu->de, cpu->hl, cpu->sp, cpu->pc };
+			hook->instruction(hook, cpu->pc, opcode, 0, regs, 6);
+		}
+		running = _SM83TickInternal(cpu) && running;
+		if (!pages || cpu->executionState != SM83_CORE_FETCH) {
+			continue;
+		}
+		if (cpu->pc >> mBREAKPOINT_PAGE_SHIFT != page) {
+			page = cpu->pc >> mBREAKPOINT_PAGE_SHIFT;
+			flagged = mBreakpointPagesTest(pages, cpu->pc);
+		}
+		if (flagged) {
+			pages->check(pages);
+		}
+	}
+}
+
 void SM83Run(struct SM83Core* cpu) {
+	if (cpu->breakpointPages || cpu->instructionHook) {
+		_SM83RunInstrumented(cpu);
+		return;
+	}
 	bool running = true;
 	while (running || cpu->executionState != SM83_CORE_FETCH) {
 		if (cpu->cycles < cpu->nextEvent) {
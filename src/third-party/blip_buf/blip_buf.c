@@ -67,6 +67,7 @@ struct blip_t
 	int avail;
 	int size;
 	int integrator;
+	int dirty; /* samples past this point are known to be zero */
 };
 
 typedef int buf_t;
@@ -114,11 +115,14 @@ blip_t* blip_new( int size )
 	blip_t* m;
 	assert( size >= 0 );
 	
-	m = (blip_t*) malloc( sizeof *m + (size + buf_extra) * sizeof (buf_t) );
+	/* Fresh zeroed memory is already clear, so large buffers never get
+	touched past what's actually used */
+	m = (blip_t*) calloc( 1, sizeof *m + (size + buf_extra) * sizeof (buf_t) );
 	if ( m )
 	{
 		m->factor = time_unit / blip_max_ratio;
 		m->size   = size;
+		m->dirty  = 0;
 		blip_clear( m );
 		check_assumptions();
 	}
@@ -135,6 +139,13 @@ void blip_delete( blip_t* m )
 	}
 }
 
+size_t blip_footprint( const blip_t* m )
+{
+	if ( m == NULL )
+		return 0;
+	return sizeof (blip_t) + (m->size + buf_extra) * sizeof (buf_t);
+}
+
 void blip_set_rates( blip_t* m, double clock_rate, double sample_rate )
 {
 	double factor = time_unit * sample_rate / clock_rate;
@@ -163,7 +174,8 @@ void blip_clear( blip_t* m )
 	m->offset     = m->factor / 2;
 	m->avail      = 0;
 	m->integrator = 0;
-	memset( SAMPLES( m ), 0, (m->size + buf_extra) * sizeof (buf_t) );
+	memset( SAMPLES( m ), 0, m->dirty * sizeof (buf_t) );
+	m->dirty      = 0;
 }
 
 int blip_clocks_needed( const blip_t* m, int samples )
@@ -203,6 +215,8 @@ static void remove_samples( blip_t* m, int count )
 	
 	memmove( &buf [0], &buf [count], remain * sizeof buf [0] );
 	memset( &buf [remain], 0, count * sizeof buf [0] );
+	if ( m->dirty <= remain + count )
+		m->dirty = remain;
 }
 
 int blip_read_samples( blip_t* m, short out [], int count, int stereo )
@@ -308,6 +322,9 @@ void blip_add_delta( blip_t* m, unsigned time, int delta )
 	/* Fails if buffer size was exceeded */
 	assert( out <= &SAMPLES( m ) [m->size + end_frame_extra] );
 	
+	if ( out + half_width * 2 > SAMPLES( m ) + m->dirty )
+		m->dirty = out + half_width * 2 - SAMPLES( m );
+	
 	out [0] += in[0]*delta + in[half_width+0]*delta2;
 	out [1] += in[1]*delta + in[half_width+1]*delta2;
 	out [2] += in[2]*delta + in[half_width+2]*delta2;
@@ -339,6 +356,9 @@ void blip_add_delta_fast( blip_t* m, unsigned time, int delta )
 	/* Fails if buffer size was exceeded */
 	assert( out <= &SAMPLES( m ) [m->size + end_frame_extra] );
 	
+	if ( out + 9 > SAMPLES( m ) + m->dirty )
+		m->dirty = out + 9 - SAMPLES( m );
+	
 	out [7] += delta * delta_unit - delta2;
 	out [8] += delta2;
 }
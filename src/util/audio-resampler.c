@@ -0,0 +1,408 @@
+/* Copyright (c) 2013-2024 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include <mgba-util/audio-resampler.h>
+
+#define TAPS mAUDIO_RESAMPLER_TAPS
+#define PHASES mAUDIO_RESAMPLER_PHASES
+#define INPUT_CAPACITY (mAUDIO_RESAMPLER_BUFFER + TAPS)
+
+// Stretches closer to 1 than this are folded into the rate instead. The
+// resulting pitch change is well under a semitone, and it avoids the
+// latency and smearing that overlap-add would otherwise introduce.
+#define STRETCH_THRESHOLD 0.02
+
+static void _buildFilter(struct mAudioResampler* resampler, double ratio) {
+	double cutoff = 1.0;
+	if (ratio > 1.0) {
+		// Downsampling, so band-limit to the destination rate
+		cutoff = 0.95 / ratio;
+	}
+	int phase;
+	for (phase = 0; phase < PHASES; ++phase) {
+		double taps[TAPS];
+		double sum = 0;
+		int k;
+		for (k = 0; k < TAPS; ++k) {
+			double x = k - (TAPS / 2 - 1) - phase / (double) PHASES;
+			double t = (x + TAPS / 2) / TAPS;
+			double window = 0.42 - 0.5 * cos(2 * M_PI * t) + 0.08 * cos(4 * M_PI * t);
+			double sinc = x == 0 ? 1.0 : sin(M_PI * cutoff * x) / (M_PI * cutoff * x);
+			taps[k] = sinc * window;
+			sum += taps[k];
+		}
+
+		// Quantize to Q14, leaving headroom for the center tap, so that
+		// each phase sums to exactly unity gain
+		int16_t* coeffs = &resampler->filter[phase * TAPS];
+		double error = 0;
+		for (k = 0; k < TAPS; ++k) {
+			double value = taps[k] * 0x4000 / sum + error;
+			coeffs[k] = lrint(value);
+			error = value - coeffs[k];
+		}
+	}
+}
+
+static int16_t _convolve(const int16_t* restrict samples, const int16_t* restrict coeffs) {
+	// Kept as a plain fixed-length loop: GCC already compiles it to the same
+	// pmaddwd loop that SSE2 intrinsics would, at -O2 and above, and measured
+	// no faster with them written out by hand
+	int32_t sum = 0;
+	int k;
+	for (k = 0; k < TAPS; ++k) {
+		sum += samples[k] * coeffs[k];
+	}
+	sum = (sum + 0x2000) >> 14;
+	if (sum > INT16_MAX) {
+		return INT16_MAX;
+	}
+	if (sum < INT16_MIN) {
+		return INT16_MIN;
+	}
+	return sum;
+}
+
+static void _freeBuffers(struct mAudioResampler* resampler) {
+	unsigned c;
+	for (c = 0; c < mAUDIO_RESAMPLER_MAX_CHANNELS; ++c) {
+		free(resampler->output[c]);
+		free(resampler->tail[c]);
+		free(resampler->segment[c]);
+		resampler->output[c] = NULL;
+		resampler->tail[c] = NULL;
+		resampler->segment[c] = NULL;
+	}
+	free(resampler->mix);
+	free(resampler->tailMix);
+	resampler->mix = NULL;
+	resampler->tailMix = NULL;
+}
+
+static void _updateStep(struct mAudioResampler* resampler) {
+	double ratio = resampler->sourceRate / resampler->destRate;
+	resampler->stretching = fabs(resampler->stretch - 1.0) >= STRETCH_THRESHOLD;
+	if (!resampler->stretching) {
+		ratio *= resampler->stretch;
+	} else {
+		resampler->stretchPrimed = false;
+	}
+	resampler->step = llrint(ratio * 0x100000000LL);
+	_buildFilter(resampler, ratio);
+}
+
+void mAudioResamplerInit(struct mAudioResampler* resampler, unsigned channels) {
+	memset(resampler, 0, sizeof(*resampler));
+	if (channels > mAUDIO_RESAMPLER_MAX_CHANNELS) {
+		channels = mAUDIO_RESAMPLER_MAX_CHANNELS;
+	}
+	if (!channels) {
+		channels = 1;
+	}
+	resampler->channels = channels;
+	resampler->stretch = 1.0;
+	resampler->filter = malloc(PHASES * TAPS * sizeof(*resampler->filter));
+	unsigned c;
+	for (c = 0; c < mAUDIO_RESAMPLER_MAX_CHANNELS; ++c) {
+		resampler->input[c] = malloc(INPUT_CAPACITY * sizeof(*resampler->input[c]));
+	}
+	mAudioResamplerSetRates(resampler, 48000, 48000);
+}
+
+void mAudioResamplerDeinit(struct mAudioResampler* resampler) {
+	_freeBuffers(resampler);
+	unsigned c;
+	for (c = 0; c < mAUDIO_RESAMPLER_MAX_CHANNELS; ++c) {
+		free(resampler->input[c]);
+		resampler->input[c] = NULL;
+	}
+	free(resampler->filter);
+	resampler->filter = NULL;
+}
+
+void mAudioResamplerSetRates(struct mAudioResampler* resampler, double sourceRate, double destRate) {
+	if (sourceRate <= 0 || destRate <= 0) {
+		return;
+	}
+	if (sourceRate == resampler->sourceRate && destRate == resampler->destRate) {
+		return;
+	}
+	resampler->sourceRate = sourceRate;
+	resampler->destRate = destRate;
+
+	// Overlap-add parameters, in destination frames
+	resampler->sequence = destRate * 40 / 1000;
+	resampler->overlap = destRate * 8 / 1000;
+	resampler->seek = destRate * 15 / 1000;
+	if (resampler->overlap < 1) {
+		resampler->overlap = 1;
+	}
+	if (resampler->sequence < resampler->overlap * 2) {
+		resampler->sequence = resampler->overlap * 2;
+	}
+	if (resampler->seek < 1) {
+		resampler->seek = 1;
+	}
+	resampler->outputCapacity = resampler->sequence + resampler->seek + mAUDIO_RESAMPLER_BUFFER / 4;
+
+	_freeBuffers(resampler);
+	unsigned c;
+	for (c = 0; c < mAUDIO_RESAMPLER_MAX_CHANNELS; ++c) {
+		resampler->output[c] = malloc(resampler->outputCapacity * sizeof(*resampler->output[c]));
+		resampler->tail[c] = malloc(resampler->overlap * sizeof(*resampler->tail[c]));
+		resampler->segment[c] = malloc(resampler->sequence * sizeof(*resampler->segment[c]));
+	}
+	resampler->mix = malloc((resampler->seek + resampler->overlap) * sizeof(*resampler->mix));
+	resampler->tailMix = malloc(resampler->overlap * sizeof(*resampler->tailMix));
+
+	_updateStep(resampler);
+	mAudioResamplerClear(resampler);
+}
+
+void mAudioResamplerSetStretch(struct mAudioResampler* resampler, double stretch) {
+	if (stretch <= 0 || stretch == resampler->stretch) {
+		return;
+	}
+	resampler->stretch = stretch;
+	_updateStep(resampler);
+}
+
+void mAudioResamplerClear(struct mAudioResampler* resampler) {
+	// Prime the history so the first input frame lands in the middle of the filter
+	resampler->inputFrames = TAPS / 2 - 1;
+	unsigned c;
+	for (c = 0; c < mAUDIO_RESAMPLER_MAX_CHANNELS; ++c) {
+		memset(resampler->input[c], 0, resampler->inputFrames * sizeof(*resampler->input[c]));
+	}
+	resampler->position = 0;
+	resampler->dropFrames = 0;
+	resampler->outputFrames = 0;
+	resampler->segmentFrames = 0;
+	resampler->segmentRead = 0;
+	resampler->skipResidue = 0;
+	resampler->stretchPrimed = false;
+}
+
+size_t mAudioResamplerWrite(struct mAudioResampler* resampler, const int16_t* samples, size_t frames) {
+	size_t consumed = resampler->position >> 32;
+	if (resampler->inputFrames + frames > INPUT_CAPACITY && consumed) {
+		if (consumed > resampler->inputFrames) {
+			consumed = resampler->inputFrames;
+		}
+		unsigned c;
+		for (c = 0; c < resampler->channels; ++c) {
+			memmove(resampler->input[c], &resampler->input[c][consumed], (resampler->inputFrames - consumed) * sizeof(*resampler->input[c]));
+		}
+		resampler->inputFrames -= consumed;
+		resampler->position -= (uint64_t) consumed << 32;
+	}
+	if (frames > INPUT_CAPACITY - resampler->inputFrames) {
+		frames = INPUT_CAPACITY - resampler->inputFrames;
+	}
+
+	// Deinterleave so each channel can be filtered from contiguous memory
+	size_t i;
+	if (resampler->channels == 2) {
+		int16_t* restrict left = &resampler->input[0][resampler->inputFrames];
+		int16_t* restrict right = &resampler->input[1][resampler->inputFrames];
+		for (i = 0; i < frames; ++i) {
+			left[i] = samples[i * 2];
+			right[i] = samples[i * 2 + 1];
+		}
+	} else {
+		memcpy(&resampler->input[0][resampler->inputFrames], samples, frames * sizeof(*samples));
+	}
+	resampler->inputFrames += frames;
+	return frames;
+}
+
+static bool _resample(struct mAudioResampler* resampler) {
+	if (resampler->inputFrames < TAPS) {
+		return false;
+	}
+	size_t available = resampler->inputFrames - TAPS + 1;
+	unsigned c;
+	while (resampler->dropFrames && (resampler->position >> 32) < available) {
+		resampler->position += resampler->step;
+		--resampler->dropFrames;
+	}
+
+	size_t produced = 0;
+	size_t space = resampler->outputCapacity - resampler->outputFrames;
+	if (resampler->step == 0x100000000LL && !(resampler->position & 0xFFFFFFFF)) {
+		// Rates match exactly, so the filter would only return its center tap
+		size_t index = resampler->position >> 32;
+		if (index < available) {
+			produced = available - index;
+			if (produced > space) {
+				produced = space;
+			}
+			for (c = 0; c < resampler->channels; ++c) {
+				memcpy(&resampler->output[c][resampler->outputFrames], &resampler->input[c][index + TAPS / 2 - 1], produced * sizeof(*resampler->output[c]));
+			}
+			resampler->position += (uint64_t) produced << 32;
+		}
+	} else {
+		for (; produced < space; ++produced) {
+			size_t index = resampler->position >> 32;
+			if (index >= available) {
+				break;
+			}
+			const int16_t* coeffs = &resampler->filter[((resampler->position >> (32 - 8)) & (PHASES - 1)) * TAPS];
+			for (c = 0; c < resampler->channels; ++c) {
+				resampler->output[c][resampler->outputFrames + produced] = _convolve(&resampler->input[c][index], coeffs);
+			}
+			resampler->position += resampler->step;
+		}
+	}
+	resampler->outputFrames += produced;
+	return produced > 0;
+}
+
+static void _dropOutput(struct mAudioResampler* resampler, size_t frames) {
+	if (frames > resampler->outputFrames) {
+		resampler->dropFrames += frames - resampler->outputFrames;
+		frames = resampler->outputFrames;
+	}
+	unsigned c;
+	for (c = 0; c < resampler->channels; ++c) {
+		memmove(resampler->output[c], &resampler->output[c][frames], (resampler->outputFrames - frames) * sizeof(*resampler->output[c]));
+	}
+	resampler->outputFrames -= frames;
+}
+
+static float _mixSample(const struct mAudioResampler* resampler, int16_t* const* planes, size_t index) {
+	if (resampler->channels == 2) {
+		return planes[0][index] + planes[1][index];
+	}
+	return planes[0][index];
+}
+
+static size_t _findSeekOffset(struct mAudioResampler* resampler) {
+	size_t overlap = resampler->overlap;
+	size_t i;
+	for (i = 0; i < overlap; ++i) {
+		resampler->tailMix[i] = _mixSample(resampler, resampler->tail, i);
+	}
+	for (i = 0; i < resampler->seek + overlap; ++i) {
+		resampler->mix[i] = _mixSample(resampler, resampler->output, i);
+	}
+
+	// Pick the offset whose start lines up best with the end of the last
+	// segment, measured by normalized cross-correlation
+	const float* restrict tail = resampler->tailMix;
+	float energy = 0;
+	for (i = 0; i < overlap; ++i) {
+		energy += resampler->mix[i] * resampler->mix[i];
+	}
+	size_t best = 0;
+	float bestScore = -INFINITY;
+	size_t offset;
+	for (offset = 0; offset < resampler->seek; ++offset) {
+		const float* restrict mix = &resampler->mix[offset];
+		float correlation = 0;
+		for (i = 0; i < overlap; ++i) {
+			correlation += tail[i] * mix[i];
+		}
+		float score = correlation / sqrtf(energy + 1.f);
+		if (score > bestScore) {
+			bestScore = score;
+			best = offset;
+		}
+		energy += mix[overlap] * mix[overlap] - mix[0] * mix[0];
+	}
+	return best;
+}
+
+static void _stretchSegment(struct mAudioResampler* resampler) {
+	size_t overlap = resampler->overlap;
+	size_t length = resampler->sequence - overlap;
+	size_t offset = 0;
+	unsigned c;
+	size_t i;
+	if (resampler->stretchPrimed) {
+		offset = _findSeekOffset(resampler);
+		for (c = 0; c < resampler->channels; ++c) {
+			const int16_t* restrict tail = resampler->tail[c];
+			const int16_t* restrict next = &resampler->output[c][offset];
+			int16_t* restrict segment = resampler->segment[c];
+			for (i = 0; i < overlap; ++i) {
+				segment[i] = (tail[i] * (int32_t) (overlap - i) + next[i] * (int32_t) i) / (int32_t) overlap;
+			}
+		}
+	} else {
+		for (c = 0; c < resampler->channels; ++c) {
+			memcpy(resampler->segment[c], resampler->output[c], overlap * sizeof(*resampler->segment[c]));
+		}
+		resampler->stretchPrimed = true;
+	}
+	for (c = 0; c < resampler->channels; ++c) {
+		memcpy(&resampler->segment[c][overlap], &resampler->output[c][offset + overlap], (length - overlap) * sizeof(*resampler->segment[c]));
+		memcpy(resampler->tail[c], &resampler->output[c][offset + length], overlap * sizeof(*resampler->tail[c]));
+	}
+	resampler->segmentFrames = length;
+	resampler->segmentRead = 0;
+
+	// Advance the input by the stretched amount, regardless of the chosen offset
+	double skip = length * resampler->stretch + resampler->skipResidue;
+	size_t frames = skip;
+	resampler->skipResidue = skip - frames;
+	_dropOutput(resampler, frames);
+}
+
+static void _emit(const struct mAudioResampler* resampler, int16_t* const* planes, size_t start, int16_t* samples, size_t frames, unsigned channels) {
+	const int16_t* left = &planes[0][start];
+	const int16_t* right = resampler->channels == 2 ? &planes[1][start] : left;
+	size_t i;
+	if (channels == 1) {
+		for (i = 0; i < frames; ++i) {
+			samples[i] = (left[i] + right[i]) >> 1;
+		}
+	} else if (channels == 2) {
+		for (i = 0; i < frames; ++i) {
+			samples[i * 2] = left[i];
+			samples[i * 2 + 1] = right[i];
+		}
+	} else {
+		memset(samples, 0, frames * channels * sizeof(*samples));
+		for (i = 0; i < frames; ++i) {
+			samples[i * channels] = left[i];
+			samples[i * channels + 1] = right[i];
+		}
+	}
+}
+
+size_t mAudioResamplerRead(struct mAudioResampler* resampler, int16_t* samples, size_t frames, unsigned channels) {
+	if (!channels) {
+		return 0;
+	}
+	size_t produced = 0;
+	while (produced < frames) {
+		size_t remaining = frames - produced;
+		int16_t* out = &samples[produced * channels];
+		if (resampler->segmentRead < resampler->segmentFrames) {
+			size_t count = resampler->segmentFrames - resampler->segmentRead;
+			if (count > remaining) {
+				count = remaining;
+			}
+			_emit(resampler, resampler->segment, resampler->segmentRead, out, count, channels);
+			resampler->segmentRead += count;
+			produced += count;
+		} else if (!resampler->stretching && resampler->outputFrames) {
+			size_t count = resampler->outputFrames;
+			if (count > remaining) {
+				count = remaining;
+			}
+			_emit(resampler, resampler->output, 0, out, count, channels);
+			_dropOutput(resampler, count);
+			produced += count;
+		} else if (resampler->stretching && resampler->outputFrames >= resampler->sequence + resampler->seek) {
+			_stretchSegment(resampler);
+		} else if (!_resample(resampler)) {
+			break;
+		}
+	}
+	return produced;
+}
@@ -13,3 +13,34 @@ void mappedMemoryFree(void* memory, size_t size) {
 	UNUSED(size);
 	free(memory);
 }
+
+void* mappedMemoryResize(void* memory, size_t oldSize, size_t newSize) {
+	void* newMemory = realloc(memory, newSize);
+	if (newMemory && newSize > oldSize) {
+		memset((void*) ((uintptr_t) newMemory + oldSize), 0, newSize - oldSize);
+	}
+	return newMemory;
+}
+
+void mappedMemoryClear(void* memory, size_t size) {
+	memset(memory, 0, size);
+}
+
+size_t mappedMemoryResident(const void* memory, size_t size) {
+	UNUSED(memory);
+	return size;
+}
+
+void mappedMemorySetHugePages(enum mHugePageMode mode) {
+	UNUSED(mode);
+}
+
+enum mHugePageMode mappedMemoryGetHugePages(void) {
+	return mHUGE_PAGES_NONE;
+}
+
+bool mappedMemoryBindLocal(void* memory, size_t size) {
+	UNUSED(memory);
+	UNUSED(size);
+	return false;
+}
@@ -0,0 +1,137 @@
+/* Copyright (c) 2013-2024 Jeffrey Pfau
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+#include "util/test/suite.h"
+
+#include <mgba-util/audio-resampler.h>
+
+static size_t _runConstant(struct mAudioResampler* resampler, int16_t value, size_t frames, int16_t* out, size_t outFrames) {
+	int16_t in[256 * 2];
+	size_t i;
+	for (i = 0; i < 256 * 2; ++i) {
+		in[i] = value;
+	}
+	size_t produced = 0;
+	while (frames) {
+		size_t chunk = frames > 256 ? 256 : frames;
+		chunk = mAudioResamplerWrite(resampler, in, chunk);
+		frames -= chunk;
+		produced += mAudioResamplerRead(resampler, &out[produced * 2], outFrames - produced, 2);
+	}
+	return produced;
+}
+
+M_TEST_DEFINE(passthrough) {
+	struct mAudioResampler resampler;
+	mAudioResamplerInit(&resampler, 2);
+	mAudioResamplerSetRates(&resampler, 32768, 32768);
+
+	int16_t in[512 * 2];
+	int16_t out[512 * 2];
+	size_t i;
+	for (i = 0; i < 512; ++i) {
+		in[i * 2] = i;
+		in[i * 2 + 1] = -(int16_t) i;
+	}
+	assert_int_equal(mAudioResamplerWrite(&resampler, in, 512), 512);
+	size_t produced = mAudioResamplerRead(&resampler, out, 512, 2);
+	assert_true(produced > 512 - mAUDIO_RESAMPLER_TAPS);
+	for (i = 0; i < produced; ++i) {
+		assert_int_equal(out[i * 2], i);
+		assert_int_equal(out[i * 2 + 1], -(int16_t) i);
+	}
+
+	mAudioResamplerDeinit(&resampler);
+}
+
+M_TEST_DEFINE(upsampleLength) {
+	struct mAudioResampler resampler;
+	mAudioResamplerInit(&resampler, 2);
+	mAudioResamplerSetRates(&resampler, 32768, 48000);
+
+	static int16_t out[48000 * 2];
+	size_t produced = _runConstant(&resampler, 1000, 32768, out, 48000);
+	assert_true(produced <= 48000);
+	assert_true(produced > 48000 - mAUDIO_RESAMPLER_TAPS * 2);
+	size_t i;
+	for (i = mAUDIO_RESAMPLER_TAPS * 2; i < produced; ++i) {
+		assert_in_range(out[i * 2], 999, 1001);
+		assert_in_range(out[i * 2 + 1], 999, 1001);
+	}
+
+	mAudioResamplerDeinit(&resampler);
+}
+
+M_TEST_DEFINE(downsampleLength) {
+	struct mAudioResampler resampler;
+	mAudioResamplerInit(&resampler, 2);
+	mAudioResamplerSetRates(&resampler, 96000, 44100);
+
+	static int16_t out[44100 * 2];
+	size_t produced = _runConstant(&resampler, -2000, 96000, out, 44100);
+	assert_true(produced <= 44100);
+	assert_true(produced > 44100 - mAUDIO_RESAMPLER_TAPS);
+	size_t i;
+	for (i = mAUDIO_RESAMPLER_TAPS; i < produced; ++i) {
+		assert_in_range(out[i * 2], -2001, -1999);
+	}
+
+	mAudioResamplerDeinit(&resampler);
+}
+
+M_TEST_DEFINE(stretch) {
+	struct mAudioResampler resampler;
+	mAudioResamplerInit(&resampler, 2);
+	mAudioResamplerSetRates(&resampler, 48000, 48000);
+	mAudioResamplerSetStretch(&resampler, 2);
+
+	static int16_t out[48000 * 2];
+	size_t produced = _runConstant(&resampler, 500, 48000, out, 48000);
+
+	// Overlap-add holds back up to a sequence and a seek window of input
+	assert_true(produced <= 24000);
+	assert_true(produced > 24000 - 48000 * 55 / 1000);
+	size_t i;
+	for (i = 0; i < produced; ++i) {
+		assert_int_equal(out[i * 2], 500);
+	}
+
+	mAudioResamplerDeinit(&resampler);
+}
+
+M_TEST_DEFINE(layout) {
+	struct mAudioResampler resampler;
+	mAudioResamplerInit(&resampler, 2);
+
+	int16_t in[64 * 2];
+	size_t i;
+	for (i = 0; i < 64; ++i) {
+		in[i * 2] = 100;
+		in[i * 2 + 1] = 300;
+	}
+	mAudioResamplerWrite(&resampler, in, 64);
+	int16_t mono[8];
+	assert_int_equal(mAudioResamplerRead(&resampler, mono, 8, 1), 8);
+	for (i = 0; i < 8; ++i) {
+		assert_int_equal(mono[i], 200);
+	}
+	int16_t quad[8 * 4];
+	assert_int_equal(mAudioResamplerRead(&resampler, quad, 8, 4), 8);
+	for (i = 0; i < 8; ++i) {
+		assert_int_equal(quad[i * 4], 100);
+		assert_int_equal(quad[i * 4 + 1], 300);
+		assert_int_equal(quad[i * 4 + 2], 0);
+		assert_int_equal(quad[i * 4 + 3], 0);
+	}
+
+	mAudioResamplerDeinit(&resampler);
+}
+
+M_TEST_SUITE_DEFINE(AudioResampler,
+	cmocka_unit_test(passthrough),
+	cmocka_unit_test(upsampleLength),
+	cmocka_unit_test(downsampleLength),
+	cmocka_unit_test(stretch),
+	cmocka_unit_test(layout))
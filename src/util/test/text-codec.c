@@ -898,6 +898,40 @@ M_TEST_DEFINE(nullBytes) {
 	vf->close(vf);
 }
 
+M_TEST_DEFINE(matchPrefixes) {
+	static const char file[] =
+		"10=t\n"
+		"11=h\n"
+		"80=th\n"
+		"81=the";
+	struct VFile* vf = VFileFromConstMemory(file, sizeof(file) - 1);
+	struct TextCodec codec;
+	assert_true(TextCodecLoadTBL(&codec, vf, true));
+	struct TextCodecMatch matches[4];
+
+	assert_int_equal(TextCodecMatchPrefixes(&codec, true, (const uint8_t*) "then", 4, matches, 4), 3);
+	assert_int_equal(matches[0].consumed, 1);
+	assert_int_equal(matches[0].outputLength, 1);
+	assert_memory_equal(matches[0].output, "\x10", 1);
+	assert_int_equal(matches[1].consumed, 2);
+	assert_memory_equal(matches[1].output, "\x80", 1);
+	assert_int_equal(matches[2].consumed, 3);
+	assert_memory_equal(matches[2].output, "\x81", 1);
+
+	assert_int_equal(TextCodecMatchPrefixes(&codec, true, (const uint8_t*) "then", 4, matches, 1), 1);
+	assert_int_equal(matches[0].consumed, 1);
+	assert_int_equal(TextCodecMatchPrefixes(&codec, true, (const uint8_t*) "hat", 3, matches, 4), 1);
+	assert_int_equal(TextCodecMatchPrefixes(&codec, true, (const uint8_t*) "a", 1, matches, 4), 0);
+
+	assert_int_equal(TextCodecMatchPrefixes(&codec, false, (const uint8_t*) "\x80\x11", 2, matches, 4), 1);
+	assert_int_equal(matches[0].consumed, 1);
+	assert_int_equal(matches[0].outputLength, 2);
+	assert_memory_equal(matches[0].output, "th", 2);
+
+	TextCodecDeinit(&codec);
+	vf->close(vf);
+}
+
 M_TEST_SUITE_DEFINE(TextCodec,
 	cmocka_unit_test(emptyCodec),
 	cmocka_unit_test(singleEntry),
@@ -909,4 +943,5 @@ M_TEST_SUITE_DEFINE(TextCodec,
 	cmocka_unit_test(overlappingEntryReverse),
 	cmocka_unit_test(raggedEntry),
 	cmocka_unit_test(controlCodes),
-	cmocka_unit_test(nullBytes))
+	cmocka_unit_test(nullBytes),
+	cmocka_unit_test(matchPrefixes))
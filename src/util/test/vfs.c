@@ -145,6 +145,25 @@ M_TEST_DEFINE(mapMemChunk) {
 	vf->close(vf);
 }
 
+#if SIZE_MAX > 0xFFFFFFFFU
+M_TEST_DEFINE(growMemChunkFailure) {
+	struct VFile* vf = VFileMemChunk("abcd", 4);
+	// Far more than can be mapped; the chunk has to stay as it was
+	off_t huge = (off_t) 1 << 62;
+	assert_int_equal(vf->seek(vf, huge, SEEK_SET), -1);
+	vf->truncate(vf, huge);
+	assert_int_equal(vf->size(vf), 4);
+	assert_int_equal(vf->seek(vf, 0, SEEK_CUR), 0);
+
+	char buffer[4];
+	assert_int_equal(vf->read(vf, buffer, sizeof(buffer)), 4);
+	assert_memory_equal(buffer, "abcd", 4);
+	assert_int_equal(vf->write(vf, "e", 1), 1);
+	assert_int_equal(vf->size(vf), 5);
+	vf->close(vf);
+}
+#endif
+
 M_TEST_SUITE_DEFINE(VFS,
 #if !defined(MINIMAL_CORE) || MINIMAL_CORE < 2
 	cmocka_unit_test(openNullPathR),
@@ -162,6 +181,9 @@ M_TEST_SUITE_DEFINE(VFS,
 	cmocka_unit_test(resizeMem),
 	cmocka_unit_test(resizeConstMem),
 	cmocka_unit_test(resizeMemChunk),
+#if SIZE_MAX > 0xFFFFFFFFU
+	cmocka_unit_test(growMemChunkFailure),
+#endif
 	cmocka_unit_test(mapMem),
 	cmocka_unit_test(mapConstMem),
 	cmocka_unit_test(mapMemChunk))
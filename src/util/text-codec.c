@@ -195,3 +195,20 @@ ssize_t TextCodecFinish(struct TextCodecIterator* iter, uint8_t* output, size_t
 	}
 	return _TextCodecFinishInternal(node, output, outputLength);
 }
+
+size_t TextCodecMatchPrefixes(const struct TextCodec* codec, bool reverse, const uint8_t* input, size_t inputLength, struct TextCodecMatch* matches, size_t maxMatches) {
+	struct TextCodecNode* node = reverse ? codec->reverseRoot : codec->forwardRoot;
+	size_t found = 0;
+	size_t i;
+	for (i = 0; node && i < inputLength && found < maxMatches; ++i) {
+		node = TableLookup(&node->children, input[i]);
+		if (!node || !node->leafLength) {
+			continue;
+		}
+		matches[found].consumed = i + 1;
+		matches[found].output = node->leaf;
+		matches[found].outputLength = node->leafLength;
+		++found;
+	}
+	return found;
+}
@@ -6,6 +6,10 @@
 #include <mgba-util/vfs.h>
 #include <mgba-util/math.h>
 #include <mgba-util/memory.h>
+#include <mgba-util/threading.h>
+
+#define VFM_POOL_ENTRIES 4
+#define VFM_POOL_MAX_BUFFER 0x400000
 
 struct VFileMem {
 	struct VFile d;
@@ -30,6 +34,192 @@ static void _vfmTruncateNoop(struct VFile* vf, size_t size);
 static ssize_t _vfmSize(struct VFile* vf);
 static bool _vfmSync(struct VFile* vf, void* buffer, size_t size);
 
+// Buffers from closed memory chunks are kept around per-thread so that
+// frequently recreated chunks (e.g. in-memory savestates) don't need to
+// go back to the OS for fresh pages every time
+struct VFileMemPool {
+	void* mem[VFM_POOL_ENTRIES];
+	size_t size[VFM_POOL_ENTRIES];
+};
+
+static void _vfmDestroyPool(struct VFileMemPool* pool) {
+	size_t i;
+	for (i = 0; i < VFM_POOL_ENTRIES; ++i) {
+		if (pool->mem[i]) {
+			mappedMemoryFree(pool->mem[i], pool->size[i]);
+		}
+	}
+	free(pool);
+}
+
+// Where the platform supports it, a thread's pool is destroyed when the thread exits
+#ifdef DISABLE_THREADING
+static struct VFileMemPool* _pool;
+
+static struct VFileMemPool* _vfmPoolGet(void) {
+	return _pool;
+}
+
+static void _vfmPoolSet(struct VFileMemPool* pool) {
+	_pool = pool;
+}
+#elif defined(USE_PTHREADS)
+static pthread_key_t _poolKey;
+static pthread_once_t _poolOnce = PTHREAD_ONCE_INIT;
+
+static void _poolDestructor(void* pool) {
+	_vfmDestroyPool(pool);
+}
+
+static void _createTLS(void) {
+	pthread_key_create(&_poolKey, _poolDestructor);
+}
+
+static struct VFileMemPool* _vfmPoolGet(void) {
+	pthread_once(&_poolOnce, _createTLS);
+	return pthread_getspecific(_poolKey);
+}
+
+static void _vfmPoolSet(struct VFileMemPool* pool) {
+	pthread_setspecific(_poolKey, pool);
+}
+#elif defined(_WIN32)
+static DWORD _poolKey;
+static INIT_ONCE _poolOnce = INIT_ONCE_STATIC_INIT;
+
+static VOID WINAPI _poolDestructor(PVOID pool) {
+	if (pool) {
+		_vfmDestroyPool(pool);
+	}
+}
+
+static BOOL CALLBACK _createTLS(PINIT_ONCE once, PVOID param, PVOID* context) {
+	UNUSED(once);
+	UNUSED(param);
+	UNUSED(context);
+	// Unlike TLS, fiber-local storage runs a callback on thread exit
+	_poolKey = FlsAlloc(_poolDestructor);
+	return TRUE;
+}
+
+static struct VFileMemPool* _vfmPoolGet(void) {
+	InitOnceExecuteOnce(&_poolOnce, _createTLS, NULL, 0);
+	return FlsGetValue(_poolKey);
+}
+
+static void _vfmPoolSet(struct VFileMemPool* pool) {
+	FlsSetValue(_poolKey, pool);
+}
+#else
+// No exit hook here, so threads have to call VFileMemChunkPoolFlush themselves
+static ThreadLocal _poolKey;
+static int _poolKeyState; // 0: not created, 1: being created, 2: ready
+
+// There's no once primitive to lean on here, so whichever thread wins the exchange
+// creates the key and any others wait until it's done
+static void _setupTLS(void) {
+	int state;
+	ATOMIC_LOAD(state, _poolKeyState);
+	if (state == 2) {
+		return;
+	}
+	int expected = 0;
+	while (!ATOMIC_CMPXCHG(_poolKeyState, expected, 1)) {
+		if (expected) {
+			do {
+				ATOMIC_LOAD(state, _poolKeyState);
+			} while (state != 2);
+			return;
+		}
+	}
+	ThreadLocalInitKey(&_poolKey);
+	ATOMIC_STORE(_poolKeyState, 2);
+}
+
+static struct VFileMemPool* _vfmPoolGet(void) {
+	_setupTLS();
+	return ThreadLocalGetValue(_poolKey);
+}
+
+static void _vfmPoolSet(struct VFileMemPool* pool) {
+	_setupTLS();
+	ThreadLocalSetKey(_poolKey, pool);
+}
+#endif
+
+static struct VFileMemPool* _vfmGetPool(bool create) {
+	struct VFileMemPool* pool = _vfmPoolGet();
+	if (!pool && create) {
+		pool = calloc(1, sizeof(*pool));
+		_vfmPoolSet(pool);
+	}
+	return pool;
+}
+
+static void* _vfmAcquireBuffer(size_t size, size_t* bufferSize) {
+	struct VFileMemPool* pool = _vfmGetPool(false);
+	if (pool) {
+		size_t best = VFM_POOL_ENTRIES;
+		size_t i;
+		for (i = 0; i < VFM_POOL_ENTRIES; ++i) {
+			if (!pool->mem[i] || pool->size[i] < size) {
+				continue;
+			}
+			if (best == VFM_POOL_ENTRIES || pool->size[i] < pool->size[best]) {
+				best = i;
+			}
+		}
+		if (best < VFM_POOL_ENTRIES) {
+			void* mem = pool->mem[best];
+			*bufferSize = pool->size[best];
+			pool->mem[best] = NULL;
+			pool->size[best] = 0;
+			return mem;
+		}
+	}
+	*bufferSize = size;
+	return anonymousMemoryMap(size);
+}
+
+static void _vfmReleaseBuffer(void* mem, size_t bufferSize) {
+	if (!mem) {
+		return;
+	}
+	if (bufferSize <= VFM_POOL_MAX_BUFFER) {
+		struct VFileMemPool* pool = _vfmGetPool(true);
+		if (pool) {
+			size_t smallest = 0;
+			size_t i;
+			for (i = 0; i < VFM_POOL_ENTRIES; ++i) {
+				if (!pool->mem[i]) {
+					pool->mem[i] = mem;
+					pool->size[i] = bufferSize;
+					return;
+				}
+				if (pool->size[i] < pool->size[smallest]) {
+					smallest = i;
+				}
+			}
+			if (pool->size[smallest] < bufferSize) {
+				mappedMemoryFree(pool->mem[smallest], pool->size[smallest]);
+				pool->mem[smallest] = mem;
+				pool->size[smallest] = bufferSize;
+				return;
+			}
+		}
+	}
+	mappedMemoryFree(mem, bufferSize);
+}
+
+void VFileMemChunkPoolFlush(void) {
+	struct VFileMemPool* pool = _vfmGetPool(false);
+	if (!pool) {
+		return;
+	}
+	_vfmPoolSet(NULL);
+	_vfmDestroyPool(pool);
+}
+
 struct VFile* VFileFromMemory(void* mem, size_t size) {
 	if (!mem || !size) {
 		return 0;
@@ -93,14 +283,16 @@ struct VFile* VFileMemChunk(const void* mem, size_t size) {
 	}
 
 	vfm->size = size;
-	vfm->bufferSize = toPow2(size);
 	if (size) {
-		vfm->mem = anonymousMemoryMap(vfm->bufferSize);
+		vfm->mem = _vfmAcquireBuffer(toPow2(size), &vfm->bufferSize);
 		if (mem) {
 			memcpy(vfm->mem, mem, size);
+		} else {
+			memset(vfm->mem, 0, size);
 		}
 	} else {
 		vfm->mem = 0;
+		vfm->bufferSize = 0;
 	}
 	vfm->offset = 0;
 	vfm->d.close = _vfmCloseFree;
@@ -117,22 +309,33 @@ struct VFile* VFileMemChunk(const void* mem, size_t size) {
 	return &vfm->d;
 }
 
-void _vfmExpand(struct VFileMem* vfm, size_t newSize) {
+// On failure the file keeps its old buffer and size
+static bool _vfmExpand(struct VFileMem* vfm, size_t newSize) {
+	if (newSize > 0x80000000U) {
+		// Buffers are sized to 32-bit powers of two
+		return false;
+	}
 	size_t alignedSize = toPow2(newSize);
 	if (alignedSize > vfm->bufferSize) {
-		void* oldBuf = vfm->mem;
-		vfm->mem = anonymousMemoryMap(alignedSize);
-		if (oldBuf) {
-			if (newSize < vfm->size) {
-				memcpy(vfm->mem, oldBuf, newSize);
-			} else {
-				memcpy(vfm->mem, oldBuf, vfm->size);
-			}
-			mappedMemoryFree(oldBuf, vfm->bufferSize);
+		void* mem;
+		size_t bufferSize = alignedSize;
+		if (vfm->mem) {
+			mem = mappedMemoryResize(vfm->mem, vfm->bufferSize, alignedSize);
+		} else {
+			mem = _vfmAcquireBuffer(alignedSize, &bufferSize);
 		}
-		vfm->bufferSize = alignedSize;
+		if (!mem) {
+			return false;
+		}
+		vfm->mem = mem;
+		vfm->bufferSize = bufferSize;
+	}
+	if (newSize > vfm->size) {
+		// Reused buffers may contain stale data past the end of the file
+		memset((void*) ((uintptr_t) vfm->mem + vfm->size), 0, newSize - vfm->size);
 	}
 	vfm->size = newSize;
+	return true;
 }
 
 bool _vfmClose(struct VFile* vf) {
@@ -144,7 +347,7 @@ bool _vfmClose(struct VFile* vf) {
 
 bool _vfmCloseFree(struct VFile* vf) {
 	struct VFileMem* vfm = (struct VFileMem*) vf;
-	mappedMemoryFree(vfm->mem, vfm->bufferSize);
+	_vfmReleaseBuffer(vfm->mem, vfm->bufferSize);
 	vfm->mem = 0;
 	free(vfm);
 	return true;
@@ -212,8 +415,8 @@ off_t _vfmSeekExpanding(struct VFile* vf, off_t offset, int whence) {
 		return -1;
 	}
 
-	if (position > vfm->size) {
-		_vfmExpand(vfm, position);
+	if (position > vfm->size && !_vfmExpand(vfm, position)) {
+		return -1;
 	}
 
 	vfm->offset = position;
@@ -248,8 +451,8 @@ ssize_t _vfmWrite(struct VFile* vf, const void* buffer, size_t size) {
 ssize_t _vfmWriteExpanding(struct VFile* vf, const void* buffer, size_t size) {
 	struct VFileMem* vfm = (struct VFileMem*) vf;
 
-	if (size + vfm->offset > vfm->size) {
-		_vfmExpand(vfm, vfm->offset + size);
+	if (size + vfm->offset > vfm->size && !_vfmExpand(vfm, vfm->offset + size)) {
+		return -1;
 	}
 
 	memcpy((void*) ((uintptr_t) vfm->mem + vfm->offset), buffer, size);
@@ -284,6 +487,7 @@ void _vfmUnmap(struct VFile* vf, void* memory, size_t size) {
 
 void _vfmTruncate(struct VFile* vf, size_t size) {
 	struct VFileMem* vfm = (struct VFileMem*) vf;
+	// There's no way to report failure here, but the old contents are kept
 	_vfmExpand(vfm, size);
 }
 